@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+/// Maps the first token of messages to an enum, so that handlers can dispatch
+/// with a switch instead of a chain of string comparisons.
+/// The table is sorted at compile time and searched by bisection.
+template <typename Command, std::size_t N> class CommandTable
+{
+public:
+    using Entry = std::pair<std::string_view, Command>;
+
+    constexpr explicit CommandTable(const Entry (&entries)[N])
+        : _entries{}
+    {
+        std::copy(entries, entries + N, _entries.begin());
+        std::sort(_entries.begin(), _entries.end(),
+                  [](const Entry& lhs, const Entry& rhs) { return less(lhs.first, rhs.first); });
+    }
+
+    /// For a static_assert: each name must map to a single command.
+    constexpr bool hasDuplicates() const
+    {
+        return std::adjacent_find(_entries.begin(), _entries.end(),
+                                  [](const Entry& lhs, const Entry& rhs)
+                                  { return lhs.first == rhs.first; }) != _entries.end();
+    }
+
+    /// Returns the command of name, or unknown.
+    constexpr Command find(const std::string_view name, const Command unknown) const
+    {
+        const auto it = std::lower_bound(_entries.begin(), _entries.end(), name,
+                                         [](const Entry& entry, const std::string_view value)
+                                         { return less(entry.first, value); });
+        return (it != _entries.end() && it->first == name) ? it->second : unknown;
+    }
+
+private:
+    /// Orders by length first: most comparisons are then decided without reading the names.
+    static constexpr bool less(const std::string_view lhs, const std::string_view rhs)
+    {
+        return lhs.size() != rhs.size() ? lhs.size() < rhs.size() : lhs < rhs;
+    }
+
+    std::array<Entry, N> _entries;
+};
+
+/// Deduces the size of the table from the entries.
+template <typename Command, std::size_t N>
+constexpr CommandTable<Command, N>
+makeCommandTable(const std::pair<std::string_view, Command> (&entries)[N])
+{
+    return CommandTable<Command, N>(entries);
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
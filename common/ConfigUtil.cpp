@@ -42,6 +42,9 @@ RuntimeConstant<bool> SslTermination;
 //       "setting[@name]" before "setting", which is more readable.
 static const std::unordered_map<std::string, std::string> DefAppConfig = {
     { "accessibility.enable", "false" },
+    { "adaptive_prespawn.enable", "false" },
+    { "adaptive_prespawn.max_children", "4" },
+    { "adaptive_prespawn.max_memory_mb", "1024" },
     { "admin_console.enable", "true" },
     { "admin_console.enable_pam", "false" },
     { "admin_console.logging.admin_action", "true" },
@@ -99,6 +102,7 @@ static const std::unordered_map<std::string, std::string> DefAppConfig = {
     { "indirection_endpoint.migration_timeout_secs", "180" },
     { "indirection_endpoint.server_name", "" },
     { "indirection_endpoint.url", "" },
+    { "jail_pool_size", "2" },
     { "languagetool.api_key", "" },
     { "languagetool.base_url", "" },
     { "languagetool.enabled", "false" },
@@ -192,6 +196,8 @@ static const std::unordered_map<std::string, std::string> DefAppConfig = {
     { "per_document.batch_priority", "5" },
     { "per_document.bgsave_priority", "5" },
     { "per_document.bgsave_timeout_secs", "120" },
+    { "per_document.callback_delays_report_secs", "60" },
+    { "per_document.callback_drain_budget_ms", "10" },
     { "per_document.cleanup.bad_behavior_period_secs", "60" },
     { "per_document.cleanup.cleanup_interval_ms", "10000" },
     { "per_document.cleanup.idle_time_secs", "300" },
@@ -199,6 +205,9 @@ static const std::unordered_map<std::string, std::string> DefAppConfig = {
     { "per_document.cleanup.limit_dirty_mem_mb", "3072" },
     { "per_document.cleanup.lost_kit_grace_period_secs", "120" },
     { "per_document.cleanup[@enable]", "true" },
+    { "per_document.hibernate.idle_secs", "600" },
+    { "per_document.hibernate.memproportion", "60.0" },
+    { "per_document.hibernate[@enable]", "false" },
     { "per_document.idle_timeout_secs", "3600" },
     { "per_document.idlesave_duration_secs", "30" },
     { "per_document.limit_convert_secs", "100" },
@@ -209,10 +218,12 @@ static const std::unordered_map<std::string, std::string> DefAppConfig = {
     { "per_document.limit_store_failures", "5" },
     { "per_document.limit_virt_mem_mb", "0" },
     { "per_document.max_concurrency", "4" },
+    { "per_document.memory_sharing_report_secs", "300" },
     { "per_document.min_time_between_saves_ms", "500" },
     { "per_document.min_time_between_uploads_ms", "5000" },
     { "per_document.pdf_resolution_dpi", "96" },
     { "per_document.redlining_as_comments", "false" },
+    { "per_document.text_input_batch_ms", "5" },
     { "per_view.custom_os_info", "" },
     { "per_view.idle_timeout_secs", "900" },
     { "per_view.min_saved_message_timeout_secs", "6" },
@@ -22,6 +22,7 @@
 #include <ftw.h>
 #include <grp.h>
 #include <pwd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -483,6 +484,112 @@ namespace FileUtil
 
         return true;
     }
+
+    MappedFile::MappedFile()
+        : _dev(0)
+        , _ino(0)
+        , _data(nullptr)
+        , _size(0)
+        , _mapped(false)
+        , _valid(false)
+    {
+    }
+
+    MappedFile::MappedFile(const std::string& path)
+        : MappedFile()
+    {
+        const int fd = openFileAsFD(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            LOG_SYS("Failed to open [" << path << "] for mapping");
+            return;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            LOG_SYS("Failed to stat [" << path << "] for mapping");
+            closeFD(fd);
+            return;
+        }
+
+        if (static_cast<std::size_t>(st.st_size) < MinMappedSize)
+        {
+            // Reads until EOF, or the size we got, retrying on EINTR.
+            _contents.resize(st.st_size);
+            const ssize_t n = FileUtil::read(fd, _contents.data(), _contents.size());
+            closeFD(fd);
+            if (n < 0)
+            {
+                LOG_SYS("Failed to read [" << path << ']');
+                _contents.clear();
+                return;
+            }
+
+            _contents.resize(n);
+            _data = _contents.data();
+            _size = _contents.size();
+            _valid = true;
+            return;
+        }
+
+        // This doesn't copy: changes to the file in place show through, see MappedFile.
+        void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        closeFD(fd);
+        if (addr == MAP_FAILED)
+        {
+            LOG_SYS("Failed to map " << st.st_size << " bytes of [" << path << ']');
+            return;
+        }
+
+        _path = path;
+        _dev = st.st_dev;
+        _ino = st.st_ino;
+        _data = static_cast<const char*>(addr);
+        _size = st.st_size;
+        _mapped = true;
+        _valid = true;
+    }
+
+    int MappedFile::openAgain() const
+    {
+        if (!_mapped)
+            return -1;
+
+        const int fd = openFileAsFD(_path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            LOG_SYS("Failed to open [" << _path << "] again");
+            return -1;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_dev != _dev || st.st_ino != _ino ||
+            static_cast<std::size_t>(st.st_size) != _size)
+        {
+            LOG_DBG("File [" << _path << "] changed since mapped");
+            closeFD(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    std::shared_ptr<MappedFile> MappedFile::create(std::string data)
+    {
+        std::shared_ptr<MappedFile> file(new MappedFile());
+        file->_contents = std::move(data);
+        file->_data = file->_contents.data();
+        file->_size = file->_contents.size();
+        file->_valid = true;
+        return file;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (_mapped)
+            ::munmap(const_cast<char*>(_data), _size);
+    }
 } // namespace FileUtil
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -30,6 +30,12 @@
 #include <set>
 #include <string>
 
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
 #include <Poco/File.h>
 #include <Poco/Path.h>
 
@@ -82,6 +88,17 @@ namespace FileUtil
                 LOG_INF("Copying " << st.st_size << " bytes from " << anonymizeUrl(fromPath)
                                    << " to " << anonymizeUrl(toPath));
 
+#ifdef FICLONE
+            // On file-systems with copy-on-write (btrfs, xfs, bcachefs...) share the extents
+            // instead, which is near-instant and costs no space until either side is modified.
+            if (ioctl(to, FICLONE, from) == 0)
+            {
+                closeFD(from);
+                closeFD(to);
+                return true;
+            }
+#endif
+
             char buffer[64 * 1024];
 
             off_t bytesIn = 0;
@@ -196,6 +213,26 @@ namespace FileUtil
         return false;
     }
 
+    bool linkAtomic(const std::string& fromPath, const std::string& toPath)
+    {
+        const std::string randFilename = toPath + Util::rng::getFilename(12);
+        if (::link(fromPath.c_str(), randFilename.c_str()) != 0)
+        {
+            LOG_SYS("Failed to link [" << fromPath << "] -> [" << randFilename << ']');
+            return false;
+        }
+
+        // Now rename atomically, replacing any existing files with the same name.
+        const bool renamed = (rename(randFilename.c_str(), toPath.c_str()) == 0);
+        if (!renamed)
+            LOG_SYS("Failed to link [" << fromPath << "] -> [" << toPath
+                                       << "] while atomically renaming:");
+
+        // Renaming over another link to the same file does nothing; always cleanup.
+        ::unlink(randFilename.c_str());
+        return renamed;
+    }
+
     bool compareFileContents(const std::string& rhsPath, const std::string& lhsPath)
     {
         std::ifstream rhs;
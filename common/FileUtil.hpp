@@ -15,7 +15,9 @@
 #include <chrono>
 #include <fcntl.h>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <sys/stat.h>
 
 #include <Poco/Path.h>
@@ -163,6 +165,11 @@ namespace FileUtil
     bool copyAtomic(const std::string& fromPath, const std::string& toPath,
                     bool preserveTimestamps);
 
+    /// Atomically hard-link a file, replacing @toPath if it exists.
+    /// Like copyAtomic(), but both names share the data, timestamps included.
+    /// Does not throw. Returns true on success.
+    bool linkAtomic(const std::string& fromPath, const std::string& toPath);
+
     /// Copy a file from @fromPath to @toPath, throws on failure.
     inline void copyFileTo(const std::string& fromPath, const std::string& toPath)
     {
@@ -364,6 +371,55 @@ namespace FileUtil
         }
     };
 
+    /// The read-only contents of a whole file. Large files are memory-mapped,
+    /// and small ones read into memory, where they don't take a page each.
+    /// No file-descriptor is kept open, so any number of them can be held.
+    /// A mapping shows any change made to the file in place, and truncating it
+    /// faults (SIGBUS) on reading past its new end. Replacing the file, by
+    /// renaming another over it as installs do, leaves the mapping intact.
+    class MappedFile final
+    {
+    public:
+        /// Files of at least this size are mapped rather than read.
+        static constexpr std::size_t MinMappedSize = 64 * 1024;
+
+        /// Maps or reads the file at the given path. Check isValid() for success.
+        explicit MappedFile(const std::string& path);
+
+        /// Holds the given data, e.g. a compressed copy of a file.
+        static std::shared_ptr<MappedFile> create(std::string data);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile();
+
+        bool isValid() const { return _valid; }
+        bool isMapped() const { return _mapped; }
+        const char* data() const { return _data; }
+        std::size_t size() const { return _size; }
+        std::string_view view() const { return std::string_view(_data, _size); }
+
+        /// Opens the mapped file again, to hand it to the kernel, e.g. with
+        /// sendfile(2), iff its path still has the same file, at the same size.
+        /// Returns the file-descriptor, for the caller to close, or -1.
+        int openAgain() const;
+
+    private:
+        MappedFile();
+
+        /// The contents when not mapped.
+        std::string _contents;
+        /// The path, device and inode of the mapped file.
+        std::string _path;
+        dev_t _dev;
+        ino_t _ino;
+        const char* _data;
+        std::size_t _size;
+        bool _mapped;
+        bool _valid;
+    };
+
     void lslr(const std::string& dir);
 
     std::vector<std::string> getDirEntries(const std::string& dirPath);
@@ -0,0 +1,153 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// A histogram of durations, with fixed buckets and an overflow.
+/// Bounds are the upper bounds of the buckets, in milliseconds; a bound is in its bucket.
+/// The sum is kept in microseconds, for short durations to add up.
+/// Histograms can be serialized, e.g. for the kits to send theirs over to WSD to be added up.
+template <const auto& Bounds> class Histogram
+{
+public:
+    static constexpr const auto& BucketBounds = Bounds;
+
+    Histogram()
+        : _count(0)
+        , _sumUs(0)
+    {
+        _buckets.fill(0);
+    }
+
+    void add(std::chrono::microseconds duration)
+    {
+        const std::uint64_t us = std::max<std::int64_t>(duration.count(), 0);
+        const auto it = std::lower_bound(BucketBounds.begin(), BucketBounds.end(), us,
+                                         [](std::uint32_t bound, std::uint64_t value)
+                                         { return bound * std::uint64_t(1000) < value; });
+        ++_buckets[it - BucketBounds.begin()];
+        ++_count;
+        _sumUs += us;
+    }
+
+    void merge(const Histogram& other)
+    {
+        for (std::size_t i = 0; i < _buckets.size(); ++i)
+            _buckets[i] += other._buckets[i];
+
+        _count += other._count;
+        _sumUs += other._sumUs;
+    }
+
+    bool empty() const { return _count == 0; }
+
+    std::uint64_t getCount() const { return _count; }
+    std::uint64_t getSumUs() const { return _sumUs; }
+
+    /// The number of durations in bucket i; the last is the overflow.
+    std::uint64_t getBucket(std::size_t i) const { return _buckets[i]; }
+
+    /// Estimates the duration, in milliseconds, under which the given percent of
+    /// the durations are, interpolating within the bucket. 0 when empty.
+    double getPercentile(double percent) const
+    {
+        if (_count == 0)
+            return 0;
+
+        const double rank = std::clamp(percent, 0.0, 100.0) * _count / 100;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < _buckets.size(); ++i)
+        {
+            if (_buckets[i] == 0 || seen + _buckets[i] < rank)
+            {
+                seen += _buckets[i];
+                continue;
+            }
+
+            // The overflow has no upper bound; report its lower one.
+            if (i == BucketBounds.size())
+                return BucketBounds.back();
+
+            const double lower = (i == 0) ? 0 : BucketBounds[i - 1];
+            const double upper = BucketBounds[i];
+            return lower + (upper - lower) * (rank - seen) / _buckets[i];
+        }
+
+        return BucketBounds.back();
+    }
+
+    /// The buckets, then the sum in microseconds, separated by commas.
+    std::string serialize() const
+    {
+        std::string result;
+        for (const std::uint64_t bucket : _buckets)
+        {
+            result += std::to_string(bucket);
+            result += ',';
+        }
+
+        result += std::to_string(_sumUs);
+        return result;
+    }
+
+    /// Parses what serialize() wrote. False, and untouched, when malformed.
+    bool deserialize(std::string_view text)
+    {
+        Histogram histogram;
+        for (std::size_t i = 0; i <= histogram._buckets.size(); ++i)
+        {
+            std::uint64_t value = 0;
+            const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (result.ec != std::errc())
+                return false;
+
+            text.remove_prefix(result.ptr - text.data());
+            if (i < histogram._buckets.size())
+            {
+                if (text.empty() || text.front() != ',')
+                    return false;
+
+                text.remove_prefix(1);
+                histogram._buckets[i] = value;
+                histogram._count += value;
+            }
+            else
+                histogram._sumUs = value;
+        }
+
+        if (!text.empty())
+            return false;
+
+        *this = histogram;
+        return true;
+    }
+
+private:
+    std::array<std::uint64_t, BucketBounds.size() + 1> _buckets;
+    std::uint64_t _count;
+    std::uint64_t _sumUs;
+};
+
+/// The bounds, in milliseconds, for short delays.
+inline constexpr std::array<std::uint32_t, 10> DelayBucketBounds = {
+    1, 2, 5, 10, 20, 50, 100, 250, 500, 1000
+};
+
+/// A histogram of short delays, such as the time the LOK callbacks wait in
+/// the kit's queue, or the latency of keystrokes.
+using DelayHistogram = Histogram<DelayBucketBounds>;
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -22,12 +22,15 @@
 #include <sys/sysmacros.h>
 #endif
 
+#include <algorithm>
+#include <cerrno>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include "Log.hpp"
 #include <SigUtil.hpp>
@@ -267,6 +270,8 @@ void removeAuxFolders(const std::string &root)
 {
     FileUtil::removeFile(Poco::Path(root, "tmp").toString(), true);
     FileUtil::removeFile(Poco::Path(root, "linkable").toString(), true);
+    // Pooled jails are always copied, never mounted.
+    FileUtil::removeFile(root + CHILDROOT_JAIL_POOL_PATH, true);
 }
 
 /*
@@ -325,6 +330,56 @@ bool tryRemoveJail(const std::string& root)
     return true;
 }
 
+bool claimPooledJail(const std::string& childRoot, const std::string& path)
+{
+    const std::string poolPath = childRoot + CHILDROOT_JAIL_POOL_PATH;
+    std::vector<std::string> entries;
+    try
+    {
+        Poco::File(poolPath).list(entries);
+    }
+    catch (const std::exception&)
+    {
+        return false; // No pool.
+    }
+
+    for (const auto& entry : entries)
+    {
+        // Jails still being built are hidden.
+        if (entry.empty() || entry[0] == '.')
+            continue;
+
+        // Another kit may win the race for the same entry; try the next one.
+        const std::string pooledPath = poolPath + '/' + entry;
+        if (::rename(pooledPath.c_str(), path.c_str()) == 0)
+        {
+            LOG_DBG("Claimed pooled jail [" << pooledPath << "] as [" << path << ']');
+            return true;
+        }
+
+        if (errno != ENOENT)
+            LOG_WRN_SYS("Failed to claim pooled jail [" << pooledPath << "] as [" << path << ']');
+    }
+
+    return false;
+}
+
+std::size_t countPooledJails(const std::string& childRoot)
+{
+    std::vector<std::string> entries;
+    try
+    {
+        Poco::File(childRoot + CHILDROOT_JAIL_POOL_PATH).list(entries);
+    }
+    catch (const std::exception&)
+    {
+        return 0;
+    }
+
+    return std::count_if(entries.begin(), entries.end(), [](const std::string& entry)
+                         { return !entry.empty() && entry[0] != '.'; });
+}
+
 /// This cleans up the jails directories.
 /// Note that we assume the templates are mounted
 /// and we unmount first. This is critical, because
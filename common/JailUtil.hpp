@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 #include <Poco/File.h>
@@ -25,6 +26,12 @@ constexpr const char CHILDROOT_TMP_INCOMING_PATH[] = "/tmp/incoming";
 
 constexpr const char CHILDROOT_TMP_SHARED_PRESETS_PATH[] = "/tmp/sharedpresets";
 
+/// Documents are kept here while hibernated, as they have no jail then.
+constexpr const char CHILDROOT_TMP_HIBERNATED_PATH[] = "/tmp/hibernated";
+
+/// Jails linked/copied ahead of the kits that will use them, when not bind-mounting.
+constexpr const char CHILDROOT_JAIL_POOL_PATH[] = "/pool";
+
 /// The LO installation directory with jail.
 constexpr const char LO_JAIL_SUBPATH[] = "lo";
 
@@ -61,6 +68,13 @@ bool isJailCopied(const std::string& root);
 /// Remove the jail directory and all its contents.
 bool tryRemoveJail(const std::string& root);
 
+/// Moves a ready jail from the pool of the child-root to path, which must
+/// be missing or an empty directory. Returns false when none is ready.
+bool claimPooledJail(const std::string& childRoot, const std::string& path);
+
+/// The number of ready jails in the pool of the child-root.
+std::size_t countPooledJails(const std::string& childRoot);
+
 /// Remove all jails.
 void cleanupJails(const std::string& jailRoot);
 
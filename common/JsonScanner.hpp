@@ -0,0 +1,332 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// Reads, and patches in place, the top-level members of a JSON object
+/// without building a DOM.
+/// Meant for the messages that are mostly passed through, such as the LOK
+/// callback payloads, where only a field or two is of interest.
+/// Anything before the first '{' is skipped, like JsonUtil::parseJSON does,
+/// so a message with its prefix can be given as is.
+/// Nested values are skipped, not validated; a malformed object reads as if
+/// the member was missing.
+namespace JsonScanner
+{
+namespace detail
+{
+inline std::size_t skipWhitespace(const std::string_view json, std::size_t pos)
+{
+    while (pos < json.size() &&
+           (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r'))
+        ++pos;
+
+    return pos;
+}
+
+/// Returns the position after the closing quote of the string at pos, or npos.
+inline std::size_t skipString(const std::string_view json, std::size_t pos)
+{
+    for (++pos; pos < json.size(); ++pos)
+    {
+        if (json[pos] == '\\')
+            ++pos;
+        else if (json[pos] == '"')
+            return pos + 1;
+    }
+
+    return std::string_view::npos;
+}
+
+/// Returns the position after the value at pos, or npos.
+inline std::size_t skipValue(const std::string_view json, std::size_t pos)
+{
+    if (pos >= json.size())
+        return std::string_view::npos;
+
+    if (json[pos] == '"')
+        return skipString(json, pos);
+
+    if (json[pos] == '{' || json[pos] == '[')
+    {
+        int depth = 0;
+        while (pos < json.size())
+        {
+            const char c = json[pos];
+            if (c == '"')
+            {
+                pos = skipString(json, pos);
+                if (pos == std::string_view::npos)
+                    break;
+
+                continue;
+            }
+
+            if (c == '{' || c == '[')
+                ++depth;
+            else if ((c == '}' || c == ']') && --depth == 0)
+                return pos + 1;
+
+            ++pos;
+        }
+
+        return std::string_view::npos;
+    }
+
+    // A number, true, false or null.
+    const std::size_t end = json.find_first_of(",}] \t\n\r", pos);
+    return end == pos ? std::string_view::npos : end;
+}
+
+/// Where a member is, or would go.
+struct Member
+{
+    std::size_t _valueStart = std::string_view::npos;
+    std::size_t _valueEnd = std::string_view::npos;
+    /// Where to append the member when it is missing: after the last value,
+    /// or before the closing brace of an empty object.
+    std::size_t _appendPos = std::string_view::npos;
+    bool _empty = true;
+};
+
+inline Member findMember(const std::string_view json, const std::string_view key)
+{
+    Member member;
+
+    std::size_t pos = json.find('{');
+    if (pos == std::string_view::npos)
+        return member;
+
+    for (pos = skipWhitespace(json, pos + 1); pos < json.size();)
+    {
+        if (json[pos] == '}')
+        {
+            if (member._empty)
+                member._appendPos = pos;
+
+            return member;
+        }
+
+        if (json[pos] != '"')
+            break;
+
+        const std::size_t keyEnd = skipString(json, pos);
+        if (keyEnd == std::string_view::npos)
+            break;
+
+        const std::string_view name = json.substr(pos + 1, keyEnd - pos - 2);
+        pos = skipWhitespace(json, keyEnd);
+        if (pos >= json.size() || json[pos] != ':')
+            break;
+
+        const std::size_t valueStart = skipWhitespace(json, pos + 1);
+        const std::size_t valueEnd = skipValue(json, valueStart);
+        if (valueEnd == std::string_view::npos)
+            break;
+
+        if (name == key)
+        {
+            member._valueStart = valueStart;
+            member._valueEnd = valueEnd;
+            return member;
+        }
+
+        member._empty = false;
+        member._appendPos = valueEnd;
+
+        pos = skipWhitespace(json, valueEnd);
+        if (pos < json.size() && json[pos] == ',')
+            pos = skipWhitespace(json, pos + 1);
+        else if (pos >= json.size() || json[pos] != '}')
+            break;
+    }
+
+    return Member();
+}
+
+inline void appendUtf8(std::uint32_t code, std::string& value)
+{
+    if (code < 0x80)
+        value += static_cast<char>(code);
+    else if (code < 0x800)
+    {
+        value += static_cast<char>(0xC0 | (code >> 6));
+        value += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        value += static_cast<char>(0xE0 | (code >> 12));
+        value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        value += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        value += static_cast<char>(0xF0 | (code >> 18));
+        value += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        value += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+inline bool readHex4(const std::string_view text, std::size_t pos, std::uint32_t& code)
+{
+    if (pos + 4 > text.size())
+        return false;
+
+    const auto result = std::from_chars(text.data() + pos, text.data() + pos + 4, code, 16);
+    return result.ec == std::errc() && result.ptr == text.data() + pos + 4;
+}
+
+/// Decodes the escapes of the contents of a JSON string.
+inline bool unescape(const std::string_view text, std::string& value)
+{
+    value.clear();
+    value.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i)
+    {
+        const std::size_t escape = text.find('\\', i);
+        value.append(text.data() + i, std::min(escape, text.size()) - i);
+        if (escape == std::string_view::npos)
+            break;
+
+        i = escape + 1;
+        if (i >= text.size())
+            return false;
+
+        switch (text[i])
+        {
+            case '"':
+            case '\\':
+            case '/':
+                value += text[i];
+                break;
+            case 'b':
+                value += '\b';
+                break;
+            case 'f':
+                value += '\f';
+                break;
+            case 'n':
+                value += '\n';
+                break;
+            case 'r':
+                value += '\r';
+                break;
+            case 't':
+                value += '\t';
+                break;
+            case 'u':
+            {
+                std::uint32_t code = 0;
+                if (!readHex4(text, i + 1, code))
+                    return false;
+
+                i += 4;
+
+                // A surrogate pair encodes the code points above the BMP.
+                std::uint32_t low = 0;
+                if (code >= 0xD800 && code < 0xDC00 && i + 2 < text.size() &&
+                    text[i + 1] == '\\' && text[i + 2] == 'u' && readHex4(text, i + 3, low) &&
+                    low >= 0xDC00 && low < 0xE000)
+                {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+
+                appendUtf8(code, value);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+} // namespace detail
+
+/// The raw text of the value of the top-level member key: strings keep their
+/// quotes and escapes. Empty when the member is missing.
+inline std::string_view findValue(const std::string_view json, const std::string_view key)
+{
+    const detail::Member member = detail::findMember(json, key);
+    if (member._valueStart == std::string_view::npos)
+        return std::string_view();
+
+    return json.substr(member._valueStart, member._valueEnd - member._valueStart);
+}
+
+/// Gets the top-level string member key, unescaped.
+/// False when missing, or not a string.
+inline bool getString(const std::string_view json, const std::string_view key,
+                      std::string& value)
+{
+    const std::string_view raw = findValue(json, key);
+    if (raw.size() < 2 || raw.front() != '"')
+        return false;
+
+    return detail::unescape(raw.substr(1, raw.size() - 2), value);
+}
+
+/// Gets the top-level integer member key. As LOK often sends numbers
+/// as strings, a quoted integer is accepted too.
+/// False when missing, or not an integer.
+inline bool getInteger(const std::string_view json, const std::string_view key, int& value)
+{
+    std::string_view raw = findValue(json, key);
+    if (raw.size() >= 2 && raw.front() == '"')
+        raw = raw.substr(1, raw.size() - 2);
+
+    if (raw.empty())
+        return false;
+
+    int number = 0;
+    const auto result = std::from_chars(raw.data(), raw.data() + raw.size(), number);
+    if (result.ec != std::errc() || result.ptr != raw.data() + raw.size())
+        return false;
+
+    value = number;
+    return true;
+}
+
+/// Sets the top-level member key to rawValue, which must be valid JSON (quoted and
+/// escaped, for a string). The member is appended when missing.
+/// The key is written as is, so it must not need escaping.
+/// False, and json is untouched, when json is not an object.
+inline bool setValue(std::string& json, const std::string_view key, const std::string_view rawValue)
+{
+    const detail::Member member = detail::findMember(json, key);
+    if (member._valueStart != std::string_view::npos)
+    {
+        json.replace(member._valueStart, member._valueEnd - member._valueStart, rawValue);
+        return true;
+    }
+
+    if (member._appendPos == std::string_view::npos)
+        return false;
+
+    std::string entry;
+    entry.reserve(key.size() + rawValue.size() + 6);
+    if (!member._empty)
+        entry += ", ";
+
+    entry += '"';
+    entry += key;
+    entry += "\": ";
+    entry += rawValue;
+    json.insert(member._appendPos, entry);
+    return true;
+}
+} // namespace JsonScanner
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
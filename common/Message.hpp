@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <string>
@@ -43,7 +44,7 @@ public:
             const enum Dir dir) :
         _forwardToken(getForwardToken(p, len)),
         _data(copyDataAfterOffset(p, len, _forwardToken.size())),
-        _tokens(StringVector::tokenize(_data.data(), _data.size())),
+        _tokens(StringVector::tokenize(_data.data(), getFirstLineSize(_data))),
         _id(makeId(dir)),
         _type(detectType()),
         _hash(0)
@@ -148,6 +149,7 @@ private:
     {
         if (_tokens.equals(0, "tile:") ||
             _tokens.equals(0, "tilecombine:") ||
+            _tokens.equals(0, "tilebin:") ||
             _tokens.equals(0, "delta:") ||
             _tokens.equals(0, "renderfont:") ||
             _tokens.equals(0, "rendersearchresult:") ||
@@ -175,6 +177,12 @@ private:
         return std::string();
     }
 
+    /// Only the first line is tokenized, don't copy the payload for it.
+    static size_t getFirstLineSize(const std::vector<char>& data)
+    {
+        return std::find(data.begin(), data.end(), '\n') - data.begin();
+    }
+
     std::vector<char> copyDataAfterOffset(const char *p, size_t len, size_t fromOffset)
     {
         if (!p || fromOffset >= len)
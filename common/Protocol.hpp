@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <CommandTable.hpp>
 #include <StringVector.hpp>
 #include <Util.hpp>
 
@@ -221,6 +222,197 @@ namespace LOOLProtocol
         }
     }
 
+    /// The commands that clients send, as the first token of their messages.
+    /// Both ClientSession and ChildSession dispatch on these.
+    enum class ClientCommand : std::uint8_t
+    {
+        Unknown,
+        A11yState,
+        AddConfig,
+        AskSignatureStatus,
+        AttemptLock,
+        BlockingCommandStatus,
+        BrowserSetting,
+        ClientVisibleArea,
+        ClientZoom,
+        CloseDocument,
+        CommandValues,
+        CompleteFunction,
+        ContentControlEvent,
+        Debug,
+        DialogEvent,
+        DownloadAs,
+        DummyMsg,
+        Error,
+        ExportAs,
+        ExtractDocumentStructure,
+        ExtractLinkTargets,
+        FormFieldEvent,
+        GetA11yCaretPosition,
+        GetA11yFocusedParagraph,
+        GetChildId,
+        GetClipboard,
+        GetPresentationInfo,
+        GetSlide,
+        GetTextSelection,
+        GetThumbnail,
+        InsertFile,
+        JsError,
+        JsException,
+        Key,
+        Load,
+        LoadWithPassword,
+        LoggingLevelOverride,
+        LoolClient,
+        Mouse,
+        MoveSelectedClientParts,
+        OutlineState,
+        PaintWindow,
+        PartPageRectangles,
+        Paste,
+        Ping,
+        RemoveSession,
+        RemoveTextContext,
+        RenameFile,
+        RenderFont,
+        RenderSearchResult,
+        RenderShapeSelection,
+        ResetAccessToken,
+        ResetSelection,
+        ResizeWindow,
+        RouteTokenSanityCheck,
+        SalLogOverride,
+        Save,
+        SaveAs,
+        SaveToStorage,
+        SelectClientPart,
+        SelectGraphic,
+        SelectText,
+        SetClientPart,
+        SetClipboard,
+        SetPage,
+        SlideShowFollow,
+        Status,
+        StatusUpdate,
+        SwitchRequest,
+        TextInput,
+        Tile,
+        TileCombine,
+        TileProcessed,
+        ToggleTileDumping,
+        TraceEvent,
+        TraceEventRecording,
+        TransformDocumentStructure,
+        Uno,
+        Urp,
+        UserActive,
+        UserInactive,
+        VersionBar,
+        VersionRestore,
+        WindowCommand,
+        WindowGesture,
+        WindowKey,
+        WindowMouse,
+        WindowSelectText,
+    };
+
+    /// Looks up the command of the first token of a client message.
+    inline ClientCommand getClientCommand(const std::string_view token)
+    {
+        static constexpr auto Commands = makeCommandTable<ClientCommand>({
+            { "a11ystate", ClientCommand::A11yState },
+            { "addconfig", ClientCommand::AddConfig },
+            { "asksignaturestatus", ClientCommand::AskSignatureStatus },
+            { "attemptlock", ClientCommand::AttemptLock },
+            { "blockingcommandstatus", ClientCommand::BlockingCommandStatus },
+            { "browsersetting", ClientCommand::BrowserSetting },
+            { "clientvisiblearea", ClientCommand::ClientVisibleArea },
+            { "clientzoom", ClientCommand::ClientZoom },
+            { "closedocument", ClientCommand::CloseDocument },
+            { "commandvalues", ClientCommand::CommandValues },
+            { "completefunction", ClientCommand::CompleteFunction },
+            { "contentcontrolevent", ClientCommand::ContentControlEvent },
+            { "DEBUG", ClientCommand::Debug },
+            { "dialogevent", ClientCommand::DialogEvent },
+            { "downloadas", ClientCommand::DownloadAs },
+            { "dummymsg", ClientCommand::DummyMsg },
+            { "ERROR", ClientCommand::Error },
+            { "exportas", ClientCommand::ExportAs },
+            { "extractdocumentstructure", ClientCommand::ExtractDocumentStructure },
+            { "extractlinktargets", ClientCommand::ExtractLinkTargets },
+            { "formfieldevent", ClientCommand::FormFieldEvent },
+            { "geta11ycaretposition", ClientCommand::GetA11yCaretPosition },
+            { "geta11yfocusedparagraph", ClientCommand::GetA11yFocusedParagraph },
+            { "getchildid", ClientCommand::GetChildId },
+            { "getclipboard", ClientCommand::GetClipboard },
+            { "getpresentationinfo", ClientCommand::GetPresentationInfo },
+            { "getslide", ClientCommand::GetSlide },
+            { "gettextselection", ClientCommand::GetTextSelection },
+            { "getthumbnail", ClientCommand::GetThumbnail },
+            { "insertfile", ClientCommand::InsertFile },
+            { "jserror", ClientCommand::JsError },
+            { "jsexception", ClientCommand::JsException },
+            { "key", ClientCommand::Key },
+            { "load", ClientCommand::Load },
+            { "loadwithpassword", ClientCommand::LoadWithPassword },
+            { "loggingleveloverride", ClientCommand::LoggingLevelOverride },
+            { "loolclient", ClientCommand::LoolClient },
+            { "mouse", ClientCommand::Mouse },
+            { "moveselectedclientparts", ClientCommand::MoveSelectedClientParts },
+            { "outlinestate", ClientCommand::OutlineState },
+            { "paintwindow", ClientCommand::PaintWindow },
+            { "partpagerectangles", ClientCommand::PartPageRectangles },
+            { "paste", ClientCommand::Paste },
+            { "ping", ClientCommand::Ping },
+            { "removesession", ClientCommand::RemoveSession },
+            { "removetextcontext", ClientCommand::RemoveTextContext },
+            { "renamefile", ClientCommand::RenameFile },
+            { "renderfont", ClientCommand::RenderFont },
+            { "rendersearchresult", ClientCommand::RenderSearchResult },
+            { "rendershapeselection", ClientCommand::RenderShapeSelection },
+            { "resetaccesstoken", ClientCommand::ResetAccessToken },
+            { "resetselection", ClientCommand::ResetSelection },
+            { "resizewindow", ClientCommand::ResizeWindow },
+            { "routetokensanitycheck", ClientCommand::RouteTokenSanityCheck },
+            { "sallogoverride", ClientCommand::SalLogOverride },
+            { "save", ClientCommand::Save },
+            { "saveas", ClientCommand::SaveAs },
+            { "savetostorage", ClientCommand::SaveToStorage },
+            { "selectclientpart", ClientCommand::SelectClientPart },
+            { "selectgraphic", ClientCommand::SelectGraphic },
+            { "selecttext", ClientCommand::SelectText },
+            { "setclientpart", ClientCommand::SetClientPart },
+            { "setclipboard", ClientCommand::SetClipboard },
+            { "setpage", ClientCommand::SetPage },
+            { "slideshowfollow", ClientCommand::SlideShowFollow },
+            { "status", ClientCommand::Status },
+            { "statusupdate", ClientCommand::StatusUpdate },
+            { "switch_request", ClientCommand::SwitchRequest },
+            { "textinput", ClientCommand::TextInput },
+            { "tile", ClientCommand::Tile },
+            { "tilecombine", ClientCommand::TileCombine },
+            { "tileprocessed", ClientCommand::TileProcessed },
+            { "toggletiledumping", ClientCommand::ToggleTileDumping },
+            { "TRACEEVENT", ClientCommand::TraceEvent },
+            { "traceeventrecording", ClientCommand::TraceEventRecording },
+            { "transformdocumentstructure", ClientCommand::TransformDocumentStructure },
+            { "uno", ClientCommand::Uno },
+            { "urp", ClientCommand::Urp },
+            { "useractive", ClientCommand::UserActive },
+            { "userinactive", ClientCommand::UserInactive },
+            { "versionbar", ClientCommand::VersionBar },
+            { "versionrestore", ClientCommand::VersionRestore },
+            { "windowcommand", ClientCommand::WindowCommand },
+            { "windowgesture", ClientCommand::WindowGesture },
+            { "windowkey", ClientCommand::WindowKey },
+            { "windowmouse", ClientCommand::WindowMouse },
+            { "windowselecttext", ClientCommand::WindowSelectText },
+        });
+        static_assert(!Commands.hasDuplicates(), "Each command must have a single name");
+
+        return Commands.find(token, ClientCommand::Unknown);
+    }
+
     /// Returns true if the token is a user-interaction token.
     /// Currently this excludes commands sent automatically.
     /// Notice that this doesn't guarantee editing activity,
@@ -10,8 +10,11 @@
 #pragma once
 
 #include <algorithm> // std::min, std::max
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <sstream>
+#include <vector>
 
 namespace Util
 {
@@ -149,6 +152,27 @@ public:
                && _x1 <= o._x1;
     }
 
+    /// Returns whether this Rectangle and the given one share some surface,
+    /// unlike intersects(), touching edges don't count.
+    bool overlaps(const Rectangle& o) const
+    {
+        return std::max(_x1, o._x1) < std::min(_x2, o._x2)
+               && std::max(_y1, o._y1) < std::min(_y2, o._y2);
+    }
+
+    /// The surface, which doesn't fit in an int for large rectangles.
+    std::int64_t getArea() const
+    {
+        if (!hasSurface())
+            return 0;
+        return (static_cast<std::int64_t>(_x2) - _x1) * (static_cast<std::int64_t>(_y2) - _y1);
+    }
+
+    bool operator==(const Rectangle& o) const
+    {
+        return _x1 == o._x1 && _y1 == o._y1 && _x2 == o._x2 && _y2 == o._y2;
+    }
+
     std::string toString()
     {
         std::ostringstream oss;
@@ -157,6 +181,64 @@ public:
     }
 };
 
+/// An area made of disjoint rectangles, for what a single Rectangle can only
+/// describe by covering too much, like an L shape or two distant spots.
+/// Rectangles without surface are ignored; edges may touch.
+class Region
+{
+public:
+    Region() {}
+
+    explicit Region(const Rectangle& rectangle) { unite(rectangle); }
+
+    bool isEmpty() const { return _rectangles.empty(); }
+
+    /// The disjoint rectangles of the region, in no particular order.
+    const std::vector<Rectangle>& getRectangles() const { return _rectangles; }
+
+    /// The smallest rectangle enclosing the region; without surface when empty.
+    Rectangle getBounds() const;
+
+    std::int64_t getArea() const;
+
+    /// Returns whether some of the surface of the given Rectangle is in the region.
+    bool overlaps(const Rectangle& rectangle) const;
+
+    /// Returns whether all of the given Rectangle is in the region.
+    bool contains(const Rectangle& rectangle) const;
+
+    /// Adds the given Rectangle to the region.
+    void unite(const Rectangle& rectangle);
+
+    void unite(const Region& region)
+    {
+        for (const Rectangle& rectangle : region._rectangles)
+            unite(rectangle);
+    }
+
+    /// Removes the given Rectangle from the region.
+    void subtract(const Rectangle& rectangle);
+
+    /// Keeps only what of the region is in the given Rectangle.
+    void intersect(const Rectangle& rectangle);
+
+    std::string toString() const
+    {
+        std::ostringstream oss;
+        oss << '[';
+        for (Rectangle rectangle : _rectangles)
+            oss << ' ' << rectangle.toString() << ';';
+        oss << " ]";
+        return oss.str();
+    }
+
+private:
+    /// Merges the rectangles that share a whole edge.
+    void coalesce();
+
+    std::vector<Rectangle> _rectangles;
+};
+
 }
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
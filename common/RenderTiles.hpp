@@ -237,33 +237,18 @@ namespace RenderTiles
         if (tileIndex == 0)
             return false;
 
-        std::string tileMsg;
-        if (tileCombined.getCombined())
-        {
-            tileMsg = renderedTiles.serialize("tilecombine:", "\n");
-
-            LOG_TRC("Sending back painted tiles for " << tileMsg << " of size " << output.size() << " bytes) for: " << tileMsg);
-
-            const size_t responseSize = tileMsg.size() + output.size();
-            std::unique_ptr<char[]> response(std::make_unique<char[]>(responseSize));
-            std::copy(tileMsg.begin(), tileMsg.end(), response.get());
-            std::copy(output.begin(), output.end(), response.get() + tileMsg.size());
-            outputMessage(response.get(), responseSize);
-        }
-        else
-        {
-            size_t outputOffset = 0;
-            for (const auto &i : renderedTiles.getTiles())
-            {
-                tileMsg = i.serialize("tile:", "\n");
-                const size_t responseSize = tileMsg.size() + i.getImgSize();
-                std::unique_ptr<char[]> response(std::make_unique<char[]>(responseSize));
-                std::copy(tileMsg.begin(), tileMsg.end(), response.get());
-                std::copy(output.begin() + outputOffset, output.begin() + outputOffset + i.getImgSize(), response.get() + tileMsg.size());
-                outputMessage(response.get(), responseSize);
-                outputOffset += i.getImgSize();
-            }
-        }
+        // WSD re-serializes the headers for the clients, so it gets them in the binary form.
+        const std::string tileMsg = renderedTiles.serializeBinary();
+
+        LOG_TRC("Sending back painted tiles for "
+                << renderedTiles.serialize("tilecombine:") << " of size " << output.size()
+                << " bytes");
+
+        const size_t responseSize = tileMsg.size() + output.size();
+        std::unique_ptr<char[]> response(std::make_unique<char[]>(responseSize));
+        std::copy(tileMsg.begin(), tileMsg.end(), response.get());
+        std::copy(output.begin(), output.end(), response.get() + tileMsg.size());
+        outputMessage(response.get(), responseSize);
 
         // Should we do this more frequently? and/or should we defer it?
         deltaGen.rebalanceDeltas();
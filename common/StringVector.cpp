@@ -27,8 +27,8 @@ bool StringVector::equals(std::size_t index, const StringVector& other, std::siz
 
     const StringToken& token = _tokens[index];
     const StringToken& otherToken = other._tokens[otherIndex];
-    int ret = _string.compare(token._index, token._length, other._string, otherToken._index,
-                              otherToken._length);
+    int ret = _view.compare(token._index, token._length, other._view, otherToken._index,
+                            otherToken._length);
     return ret == 0;
 }
 
@@ -43,10 +43,10 @@ bool StringVector::getUInt32(std::size_t index, const std::string& key, uint32_t
 
     size_t offset = key.size() + 1;
     if (token._length > offset &&
-            _string.compare(token._index, key.size(), key, 0, key.size()) == 0 &&
-            _string[token._index + key.size()] == '=')
+            _view.compare(token._index, key.size(), key, 0, key.size()) == 0 &&
+            _view[token._index + key.size()] == '=')
     {
-        value = Util::safe_atoi(&_string[token._index + offset], token._length - offset);
+        value = Util::safe_atoi(_view.data() + token._index + offset, token._length - offset);
         return value < std::numeric_limits<uint32_t>::max();
     }
 
@@ -64,7 +64,7 @@ bool StringVector::getNameIntegerPair(std::size_t index, std::string& name, int&
     size_t mid = std::string::npos;
     for (size_t i = token._index; i < token._index + token._length; ++i)
     {
-        if (_string[i] != '=')
+        if (_view[i] != '=')
         {
             continue;
         }
@@ -77,9 +77,9 @@ bool StringVector::getNameIntegerPair(std::size_t index, std::string& name, int&
         return false;
     }
 
-    name = _string.substr(token._index, mid - token._index);
+    name = _view.substr(token._index, mid - token._index);
     size_t offset = mid + 1;
-    value = Util::safe_atoi(&_string[offset], token._index + token._length - offset);
+    value = Util::safe_atoi(_view.data() + offset, token._index + token._length - offset);
     return value > std::numeric_limits<int>::min() && value < std::numeric_limits<int>::max();
 }
 
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
@@ -39,29 +40,219 @@ struct StringToken
     }
 };
 
+/**
+ * The tokens of a StringVector. The first few are stored inline, so that
+ * tokenizing a typical message doesn't allocate; longer lists move to the heap.
+ */
+class StringTokenList
+{
+public:
+    /// Most messages have fewer tokens; this was the reserved size of the old vector.
+    static constexpr std::size_t InlineCapacity = 16;
+
+    StringTokenList()
+        : _size(0)
+    {
+    }
+
+    explicit StringTokenList(std::vector<StringToken> tokens)
+        : _size(tokens.size())
+    {
+        if (_size <= InlineCapacity)
+            std::copy(tokens.begin(), tokens.end(), _inline);
+        else
+            _heap = std::move(tokens);
+    }
+
+    StringTokenList(const StringTokenList& other)
+        : _heap(other._heap)
+        , _size(other._size)
+    {
+        if (_heap.empty())
+            std::copy(other._inline, other._inline + _size, _inline);
+    }
+
+    StringTokenList(StringTokenList&& other) noexcept
+        : _heap(std::move(other._heap))
+        , _size(other._size)
+    {
+        if (_heap.empty())
+            std::copy(other._inline, other._inline + _size, _inline);
+
+        other._heap.clear();
+        other._size = 0;
+    }
+
+    StringTokenList& operator=(const StringTokenList& other)
+    {
+        if (this != &other)
+        {
+            _heap = other._heap;
+            _size = other._size;
+            if (_heap.empty())
+                std::copy(other._inline, other._inline + _size, _inline);
+        }
+
+        return *this;
+    }
+
+    StringTokenList& operator=(StringTokenList&& other) noexcept
+    {
+        if (this != &other)
+        {
+            _heap = std::move(other._heap);
+            _size = other._size;
+            if (_heap.empty())
+                std::copy(other._inline, other._inline + _size, _inline);
+
+            other._heap.clear();
+            other._size = 0;
+        }
+
+        return *this;
+    }
+
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    /// Only reserves once on the heap; the inline storage is always there.
+    void reserve(std::size_t capacity)
+    {
+        if (!_heap.empty())
+            _heap.reserve(capacity);
+    }
+
+    void emplace_back(std::size_t index, std::size_t length)
+    {
+        if (_heap.empty())
+        {
+            if (_size < InlineCapacity)
+            {
+                _inline[_size++] = StringToken(index, length);
+                return;
+            }
+
+            _heap.reserve(InlineCapacity * 2);
+            _heap.assign(_inline, _inline + _size);
+        }
+
+        _heap.emplace_back(index, length);
+        _size = _heap.size();
+    }
+
+    StringToken* erase(const StringToken* it)
+    {
+        const std::size_t index = it - begin();
+        assert(index < _size && "Erasing past the end");
+        if (_heap.empty())
+        {
+            std::copy(_inline + index + 1, _inline + _size, _inline + index);
+            --_size;
+        }
+        else
+        {
+            _heap.erase(_heap.begin() + index);
+            _size = _heap.size();
+        }
+
+        return begin() + index;
+    }
+
+    const StringToken& operator[](std::size_t index) const { return begin()[index]; }
+
+    const StringToken* begin() const { return _heap.empty() ? _inline : _heap.data(); }
+    StringToken* begin() { return _heap.empty() ? _inline : _heap.data(); }
+    const StringToken* end() const { return begin() + _size; }
+    StringToken* end() { return begin() + _size; }
+
+private:
+    /// All the tokens once there are more than fit inline, otherwise empty.
+    std::vector<StringToken> _heap;
+    std::size_t _size;
+    StringToken _inline[InlineCapacity];
+};
+
 /**
  * Safe wrapper around an std::vector<std::string>. Gives
  * you an empty string if you would read past the ends
  * of the vector.
+ * Owns a copy of the tokenized string, unless made by tokenizeView().
  */
 class StringVector
 {
-    /// All tokens are substrings of this string.
+    /// The copy of the tokenized string, unless a view.
     std::string _string;
-    std::vector<StringToken> _tokens;
+    /// All tokens are substrings of this string: _string, or the viewed buffer.
+    std::string_view _view;
+    StringTokenList _tokens;
+
+    bool isView() const { return _view.data() != _string.data(); }
+
+    /// Copies the viewed buffer, before modifying it.
+    void ensureOwned()
+    {
+        if (isView())
+        {
+            _string.assign(_view);
+            _view = _string;
+        }
+    }
 
 public:
     explicit StringVector() = default;
 
     explicit StringVector(std::string string, std::vector<StringToken> tokens)
         : _string(std::move(string))
+        , _view(_string)
         , _tokens(std::move(tokens))
     {
     }
 
+    StringVector(const StringVector& other)
+        : _string(other._string)
+        , _view(other.isView() ? other._view : std::string_view(_string))
+        , _tokens(other._tokens)
+    {
+    }
+
+    StringVector(StringVector&& other) noexcept
+        : _tokens(std::move(other._tokens))
+    {
+        // Moving may change the address of a short string, so test first.
+        const bool view = other.isView();
+        _string = std::move(other._string);
+        _view = view ? other._view : std::string_view(_string);
+        other._string.clear();
+        other._view = other._string;
+    }
+
+    StringVector& operator=(const StringVector& other)
+    {
+        if (this != &other)
+            *this = StringVector(other);
+
+        return *this;
+    }
+
+    StringVector& operator=(StringVector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            const bool view = other.isView();
+            _string = std::move(other._string);
+            _view = view ? other._view : std::string_view(_string);
+            _tokens = std::move(other._tokens);
+            other._string.clear();
+            other._view = other._string;
+        }
+
+        return *this;
+    }
+
     /// Tokenize delimited values until we hit new-line or the end.
+    template <typename TokenList>
     static void tokenize(const char* data, const std::size_t size, const char delimiter,
-                         std::vector<StringToken>& tokens)
+                         TokenList& tokens)
     {
         if (size == 0 || data == nullptr || *data == '\0')
             return;
@@ -125,9 +316,11 @@ public:
         if (size == 0 || data == nullptr || *data == '\0')
             return StringVector();
 
-        std::vector<StringToken> tokens;
-        tokenize(data, size, delimiter, tokens);
-        return StringVector(std::string(data, size), std::move(tokens));
+        StringVector result;
+        result._string.assign(data, size);
+        result._view = result._string;
+        tokenize(data, size, delimiter, result._tokens);
+        return result;
     }
 
     /// Tokenize single-char delimited values until we hit new-line or the end.
@@ -136,9 +329,25 @@ public:
         if (s.empty())
             return StringVector();
 
-        std::vector<StringToken> tokens;
-        tokenize(s.data(), s.size(), delimiter, tokens);
-        return StringVector(std::move(s), std::move(tokens));
+        StringVector result;
+        result._string = std::move(s);
+        result._view = result._string;
+        tokenize(result._view.data(), result._view.size(), delimiter, result._tokens);
+        return result;
+    }
+
+    /// Like tokenize(), but without copying the data: the result, and any of its
+    /// copies, refer to data, which must outlive them and not change meanwhile.
+    static StringVector tokenizeView(const char* data, const std::size_t size,
+                                     const char delimiter = ' ')
+    {
+        if (size == 0 || data == nullptr || *data == '\0')
+            return StringVector();
+
+        StringVector result;
+        result._view = std::string_view(data, size);
+        tokenize(data, size, delimiter, result._tokens);
+        return result;
     }
 
     /// Tokenize by the delimiter string.
@@ -182,37 +391,55 @@ public:
         }
 
         const StringToken& token = _tokens[index];
-        return _string.substr(token._index, token._length);
+        return std::string(_view.substr(token._index, token._length));
+    }
+
+    /// Like operator[], but gives a view into the tokenized string, without copying.
+    std::string_view getView(std::size_t index) const
+    {
+        if (index >= _tokens.size())
+        {
+            return std::string_view();
+        }
+
+        const StringToken& token = _tokens[index];
+        return _view.substr(token._index, token._length);
     }
 
     std::size_t size() const { return _tokens.size(); }
 
     bool empty() const { return _tokens.empty(); }
 
-    std::vector<StringToken>::const_iterator begin() const { return _tokens.begin(); }
+    const StringToken* begin() const { return _tokens.begin(); }
 
-    std::vector<StringToken>::iterator begin() { return _tokens.begin(); }
+    StringToken* begin() { return _tokens.begin(); }
 
-    std::vector<StringToken>::const_iterator end() const { return _tokens.end(); }
+    const StringToken* end() const { return _tokens.end(); }
 
-    std::vector<StringToken>::iterator end() { return _tokens.end(); }
+    StringToken* end() { return _tokens.end(); }
 
-    std::vector<StringToken>::iterator erase(std::vector<StringToken>::const_iterator it)
-    {
-        return _tokens.erase(it);
-    }
+    StringToken* erase(const StringToken* it) { return _tokens.erase(it); }
 
     void push_back(const std::string_view string)
     {
+        ensureOwned();
         _tokens.emplace_back(_string.size(), string.size());
         _string += string;
+        _view = _string;
     }
 
     /// Gets the underlying string of a single token.
     std::string getParam(const StringToken& token) const
     {
-        assert(token._index < _string.size() && "Index is out of range");
-        return _string.substr(token._index, token._length);
+        assert(token._index < _view.size() && "Index is out of range");
+        return std::string(_view.substr(token._index, token._length));
+    }
+
+    /// Gets a view of a single token, without copying it.
+    std::string_view getParamView(const StringToken& token) const
+    {
+        assert(token._index < _view.size() && "Index is out of range");
+        return std::string_view(_view.data() + token._index, token._length);
     }
 
     /// Concats tokens starting from firstOffset, using separator as separator.
@@ -229,7 +456,7 @@ public:
         assert(!_tokens.empty() && "Unexpected empty tokens");
 
         std::string ret;
-        ret.reserve(_string.size() * 2);
+        ret.reserve(_view.size() * 2);
 
         std::size_t i = firstOffset;
         const std::size_t end = std::min<std::size_t>(lastOffset, _tokens.size() - 1);
@@ -257,7 +484,7 @@ public:
                                     ? _tokens[lastOffset]._index + _tokens[lastOffset]._length -
                                           _tokens[firstOffset]._index
                                     : std::string::npos;
-        return _string.substr(_tokens[firstOffset]._index, end);
+        return std::string(_view.substr(_tokens[firstOffset]._index, end));
     }
 
     /// Compares the nth token with string.
@@ -269,7 +496,7 @@ public:
         }
 
         const StringToken& token = _tokens[index];
-        return std::string_view(_string.data() + token._index, token._length) == string;
+        return std::string_view(_view.data() + token._index, token._length) == string;
     }
 
     /// Compares the nth token with string.
@@ -283,7 +510,7 @@ public:
         const StringToken& token = _tokens[index];
         constexpr auto len = N - 1; // we don't want to compare the '\0'
         return token._length == len &&
-               std::string_view(_string.data() + token._index, token._length) ==
+               std::string_view(_view.data() + token._index, token._length) ==
                    std::string_view(string, len);
     }
 
@@ -298,20 +525,20 @@ public:
 
         const StringToken& token = _tokens[index];
         constexpr auto len = N - 1; // we don't want to compare the '\0'
-        return token._length >= len && _string.compare(token._index, len, string) == 0;
+        return token._length >= len && _view.compare(token._index, len, string) == 0;
     }
 
     // Checks if the token text starts with the given string
     template <std::size_t N>
     bool startsWith(const StringToken& token, const char (&string)[N]) const
     {
-        if (token._index >= _string.size())
+        if (token._index >= _view.size())
         {
             return false;
         }
 
         constexpr auto len = N - 1; // we don't want to compare the '\0'
-        return token._length >= len && _string.compare(token._index, len, string) == 0;
+        return token._length >= len && _view.compare(token._index, len, string) == 0;
     }
 
     /// Compares the nth token with the mth token from another StringVector.
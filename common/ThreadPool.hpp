@@ -10,9 +10,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <deque>
 #include <memory>
-#include <queue>
 #include <thread>
 #include <condition_variable>
 #include <fstream>
@@ -21,24 +22,47 @@
 
 #include <Util.hpp>
 
+/// Runs batches of work, pushed with pushWork(), on the calling thread of
+/// run() and _maxConcurrency - 1 more threads.
+/// Each thread has a queue of its own, which the work is dealt into; once
+/// its queue is empty, a thread steals from the back of the others' queues,
+/// so no single lock is contended by all threads for every item.
 class ThreadPool
 {
     friend class WhiteBoxTests;
 
+    typedef std::function<void()> ThreadFn;
+
+    struct WorkQueue
+    {
+        std::mutex _mutex;
+        std::deque<ThreadFn> _work;
+    };
+
     std::mutex _mutex;
     std::condition_variable _cond;
     std::condition_variable _complete;
-    typedef std::function<void()> ThreadFn;
-    std::queue<ThreadFn> _work;
+    /// One per thread; the caller of run() takes from the first.
+    std::vector<std::unique_ptr<WorkQueue>> _queues;
     std::vector<std::thread> _threads;
+    /// The work pushed and not yet done.
+    std::atomic<size_t> _pending;
+    /// The number of items pushed, to deal them out in turn.
+    size_t _pushed;
+    /// The threads working on the current run.
     size_t _working;
+    /// Bumped on every run(), for the threads to join it once.
+    uint64_t _generation;
     int _maxConcurrency;
     bool _shutdown;
     std::atomic<bool> _running;
 
 public:
     ThreadPool()
-        : _working(0)
+        : _pending(0)
+        , _pushed(0)
+        , _working(0)
+        , _generation(0)
         , _maxConcurrency(2)
         , _shutdown(false)
         , _running(false)
@@ -54,6 +78,10 @@ public:
             _maxConcurrency = atoi(max);
 #endif
         LOG_TRC("PNG compression thread pool size " << _maxConcurrency);
+
+        for (int i = 0; i < std::max(_maxConcurrency, 1); ++i)
+            _queues.emplace_back(std::make_unique<WorkQueue>());
+
         start();
     }
 
@@ -70,7 +98,7 @@ public:
             _shutdown = false;
         }
         for (int i = _threads.size(); i < _maxConcurrency - 1; ++i)
-            _threads.emplace_back(&ThreadPool::work, this);
+            _threads.emplace_back(&ThreadPool::work, this, i + 1);
     }
 
     void stop()
@@ -86,76 +114,75 @@ public:
         _threads.clear();
     }
 
-    size_t count() const { return _work.size(); }
+    size_t count() const { return _pending; }
 
     void pushWork(const ThreadFn& fn)
     {
-        std::unique_lock<std::mutex> lock(_mutex);
         assert(!_running);
         assert(!_shutdown);
         assert(_working == 0);
-        _work.push(fn);
-    }
 
-    void runOne(std::unique_lock<std::mutex>& lock)
-    {
-        assert(_running);
-        assert(!_work.empty());
-
-        ThreadFn fn = _work.front();
-        _work.pop();
-        _working++;
-        lock.unlock();
-
-        try
-        {
-            fn();
-        }
-        catch (...)
-        {
-            LOG_ERR("Exception in thread pool execution.");
-        }
-
-        lock.lock();
-        _working--;
-        if (_work.empty() && _working == 0)
-            _complete.notify_all();
+        WorkQueue& queue = *_queues[_pushed++ % _queues.size()];
+        std::unique_lock<std::mutex> lock(queue._mutex);
+        queue._work.push_back(fn);
+        ++_pending;
     }
 
     void run()
     {
-        std::unique_lock<std::mutex> lock(_mutex);
         assert(!_running);
         assert(_working == 0);
 
-        _running = true;
-
         // Avoid notifying threads if we don't need to.
-        bool useThreads = _threads.size() > 1 && _work.size() > 1;
+        const bool useThreads = !_threads.empty() && _pending > 1;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _running = true;
+            if (useThreads)
+                ++_generation;
+        }
+
         if (useThreads)
             _cond.notify_all();
 
-        while (!_work.empty())
-            runOne(lock);
+        runAll(0);
 
-        if (useThreads && (_working > 0 || !_work.empty()))
-            _complete.wait(lock, [this]() { return _working == 0 && _work.empty(); });
+        // Wait even when we didn't notify: a thread woken late for an earlier
+        // run can join this one, and may still be running what it took.
+        std::unique_lock<std::mutex> lock(_mutex);
+        _complete.wait(lock, [this]() { return _working == 0 && _pending == 0; });
 
         _running = false;
+        _pushed = 0;
 
         assert(_working == 0);
-        assert(_work.empty());
+        assert(_pending == 0);
     }
 
-    void work()
+    void work(size_t index)
     {
         Util::setThreadName("ThreadPool::work");
         std::unique_lock<std::mutex> lock(_mutex);
+        uint64_t generation = _generation;
         while (!_shutdown)
         {
-            _cond.wait(lock);
-            while (!_shutdown && !_work.empty() && _running)
-                runOne(lock);
+            // Only while running, not to take work that is still being pushed.
+            // A late wake-up can still join a later run, which run() waits for.
+            _cond.wait(lock,
+                       [&]() { return _shutdown || (_running && _generation != generation); });
+            if (_shutdown)
+                break;
+
+            generation = _generation;
+            _working++;
+            lock.unlock();
+
+            runAll(index);
+
+            lock.lock();
+            _working--;
+            if (_working == 0 && _pending == 0)
+                _complete.notify_all();
         }
     }
 
@@ -167,6 +194,62 @@ public:
             << "\n\t\twork count: " << count() << "\n\t\tthread count " << _threads.size() << "\n";
         THREAD_UNSAFE_DUMP_END
     }
+
+private:
+    /// Takes from the front of our queue, or else steals from the back of another.
+    bool takeWork(size_t index, ThreadFn& fn)
+    {
+        const size_t count = _queues.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            WorkQueue& queue = *_queues[(index + i) % count];
+            std::unique_lock<std::mutex> lock(queue._mutex);
+            if (!queue._work.empty())
+            {
+                if (i == 0)
+                {
+                    fn = std::move(queue._work.front());
+                    queue._work.pop_front();
+                }
+                else
+                {
+                    fn = std::move(queue._work.back());
+                    queue._work.pop_back();
+                }
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Runs work until there is none left to take; nothing is pushed while running.
+    void runAll(size_t index)
+    {
+        assert(_running);
+
+        ThreadFn fn;
+        while (takeWork(index, fn))
+        {
+            try
+            {
+                fn();
+            }
+            catch (...)
+            {
+                LOG_ERR("Exception in thread pool execution.");
+            }
+
+            fn = nullptr;
+            if (--_pending == 0)
+            {
+                // Under the lock, not to notify between the check and the wait of run().
+                std::unique_lock<std::mutex> lock(_mutex);
+                _complete.notify_all();
+            }
+        }
+    }
 };
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -593,6 +593,12 @@ public:
     virtual void onDocBrokerRemoveSession(const std::string&, const std::shared_ptr<ClientSession>&)
     {
     }
+    /// Called when a DocumentBroker hibernates, unloading its Kit but keeping its sessions.
+    virtual void onDocBrokerHibernated(const std::string&) {}
+
+    /// Called when a hibernated DocumentBroker has reloaded all its views in a new Kit.
+    virtual void onDocBrokerWokeUp(const std::string&) {}
+
     /// Called when document presets install is launched
     virtual void onDocBrokerPresetsInstallStart() {}
     /// Called when document presets install is finished
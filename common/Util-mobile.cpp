@@ -25,11 +25,14 @@ size_t getTotalSystemMemoryKb() { return 0; }
 std::size_t getFromFile(const char*) { return 0; }
 std::size_t getCGroupMemLimit() { return 0; }
 std::size_t getCGroupMemSoftLimit() { return 0; }
+unsigned getCGroupCpuLimit() { return 0; }
 size_t getMemoryUsagePSS(pid_t) { return 0; }
 size_t getMemoryUsageRSS(pid_t) { return 0; }
 size_t getCurrentThreadCount() { return 0; }
 std::string getMemoryStats(FILE*) { return std::string(); }
 std::pair<size_t, size_t> getPssAndDirtyFromSMaps(FILE*) { return std::make_pair(0, 0); }
+int getPressureSomeAvg10(int) { return -1; }
+bool getProcStat(int, ProcStat&) { return false; }
 std::size_t getProcessTreePss(pid_t) { return 0; }
 size_t getCpuUsage(pid_t) { return 0; }
 size_t getStatFromPid(pid_t, int) { return 0; }
@@ -25,6 +25,7 @@ extern char** environ;
 #endif
 
 #include <dirent.h>
+#include <unistd.h>
 #include <spawn.h>
 
 #include <fstream>
@@ -50,6 +51,67 @@ const char* startsWith(const char* line, const char* tag, std::size_t tagLen)
     return nullptr;
 }
 
+/// Parses the first unsigned number in a /proc value, skipping leading blanks.
+std::size_t parseProcNumber(std::string_view value)
+{
+    std::size_t pos = 0;
+    while (pos < value.size() && (value[pos] == ' ' || value[pos] == '\t'))
+        ++pos;
+
+    std::size_t number = 0;
+    for (; pos < value.size() && value[pos] >= '0' && value[pos] <= '9'; ++pos)
+        number = number * 10 + (value[pos] - '0');
+
+    return number;
+}
+
+/// Reads a /proc file with pread(2) through a fixed buffer and calls
+/// onLine with each line, without the newline. Lines longer than the
+/// buffer are skipped. The fd can be kept open and scanned repeatedly.
+template <typename F> void scanProcFile(int fd, F onLine)
+{
+    char buffer[4096];
+    std::size_t kept = 0; // Bytes of a partial line carried over.
+    bool skipping = false; // Dropping the rest of an overlong line.
+    off_t offset = 0;
+    for (;;)
+    {
+        ssize_t len;
+        while ((len = pread(fd, buffer + kept, sizeof(buffer) - kept, offset)) < 0 &&
+               errno == EINTR)
+            ;
+
+        if (len <= 0)
+        {
+            if (kept && !skipping)
+                onLine(std::string_view(buffer, kept));
+            return;
+        }
+
+        offset += len;
+        const char* const end = buffer + kept + len;
+        const char* line = buffer;
+        const char* eol;
+        while ((eol = static_cast<const char*>(memchr(line, '\n', end - line))))
+        {
+            if (!skipping)
+                onLine(std::string_view(line, eol - line));
+
+            skipping = false;
+            line = eol + 1;
+        }
+
+        kept = end - line;
+        if (kept == sizeof(buffer))
+        {
+            skipping = true;
+            kept = 0;
+        }
+        else if (kept && line != buffer)
+            memmove(buffer, line, kept);
+    }
+}
+
 std::size_t getFromCGroup(const std::string& group, const std::string& key)
 {
     std::size_t num = 0;
@@ -322,34 +384,188 @@ std::size_t getCGroupMemSoftLimit()
 #endif
 }
 
+unsigned getCGroupCpuLimit()
+{
+#ifdef __linux__
+    long quota = -1;
+    long period = 0;
+    if (isCGroupV2())
+    {
+        // "max 100000" when unlimited, else "<quota> <period>".
+        std::ifstream file("/sys/fs/cgroup" + getCurrentCGroupPath() + "/cpu.max");
+        std::string max;
+        if (file >> max >> period && max != "max")
+            quota = std::atol(max.c_str());
+    }
+    else
+    {
+        // -1 when unlimited. The controller is mounted on its own or with cpuacct.
+        for (const char* group : { "cpu,cpuacct", "cpu" })
+        {
+            period = static_cast<long>(getFromCGroup(group, "cpu.cfs_period_us"));
+            if (period > 0)
+            {
+                quota = static_cast<long>(getFromCGroup(group, "cpu.cfs_quota_us"));
+                break;
+            }
+        }
+    }
+
+    if (quota > 0 && period > 0)
+        return (quota + period - 1) / period;
+#endif
+    return 0;
+}
+
 std::pair<std::size_t, std::size_t> getPssAndDirtyFromSMaps(FILE* file)
 {
     std::size_t numPSSKb = 0;
     std::size_t numDirtyKb = 0;
     if (file)
     {
-        rewind(file);
-        char line[4096] = { 0 };
-        while (fgets(line, sizeof(line), file))
-        {
-            if (line[0] != 'P')
-                continue;
+        // pread(2) into a fixed buffer: no stdio buffering nor per-line
+        // copies, and no file position to rewind (or to race on).
+        scanProcFile(fileno(file),
+                     [&](std::string_view line)
+                     {
+                         if (line.empty() || line[0] != 'P')
+                             return;
+
+                         // Shared_Dirty is accounted for by forkit's RSS
+                         if (line.starts_with("Private_Dirty:"))
+                             numDirtyKb += parseProcNumber(line.substr(14));
+                         else if (line.starts_with("Pss:"))
+                             numPSSKb += parseProcNumber(line.substr(4));
+                     });
+    }
 
-            const char* value;
+    return std::make_pair(numPSSKb, numDirtyKb);
+}
 
-            // Shared_Dirty is accounted for by forkit's RSS
-            if ((value = startsWith(line, "Private_Dirty:", 14)))
-            {
-                numDirtyKb += atoi(value);
-            }
-            else if ((value = startsWith(line, "Pss:", 4)))
-            {
-                numPSSKb += atoi(value);
-            }
+int getPressureSomeAvg10(int fd)
+{
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    int avg10 = -1;
+    if (fd >= 0)
+    {
+        scanProcFile(fd,
+                     [&](std::string_view line)
+                     {
+                         const std::size_t pos = line.find(" avg10=");
+                         if (line.starts_with("some ") && pos != std::string_view::npos)
+                         {
+                             // Whole percents are enough for us.
+                             avg10 = parseProcNumber(line.substr(pos + 7));
+                         }
+                     });
+    }
+
+    return avg10;
+}
+
+bool getProcStat(int fd, ProcStat& stat)
+{
+    // A stat line is well under 1KB; comm is at most 16 chars.
+    char buffer[1024];
+    ssize_t len;
+    while ((len = pread(fd, buffer, sizeof(buffer), 0)) < 0 && errno == EINTR)
+        ;
+
+    if (len <= 0)
+        return false;
+
+    // comm, the 2nd field, is in parens and may contain spaces and parens.
+    const std::string_view line(buffer, len);
+    const std::size_t paren = line.rfind(')');
+    if (paren == std::string_view::npos)
+        return false;
+
+    stat = ProcStat();
+    int field = 2;
+    std::size_t pos = paren + 1;
+    while (pos < line.size() && field < 20)
+    {
+        pos = line.find_first_not_of(' ', pos);
+        if (pos == std::string_view::npos)
+            break;
+
+        ++field;
+        const std::size_t end = std::min(line.find(' ', pos), line.size());
+        switch (field)
+        {
+            case 14: // utime
+            case 15: // stime
+                stat._jiffies += parseProcNumber(line.substr(pos, end - pos));
+                break;
+            case 20: // num_threads
+                stat._threadCount = parseProcNumber(line.substr(pos, end - pos));
+                break;
         }
+
+        pos = end;
     }
 
-    return std::make_pair(numPSSKb, numDirtyKb);
+    return field == 20;
+}
+
+std::map<std::string, MappingMemory> getMemoryByMappingFromSMaps(FILE* file)
+{
+    std::map<std::string, MappingMemory> mappings;
+    if (!file)
+        return mappings;
+
+    // pread(2), as getPssAndDirtyFromSMaps does: the FILE is shared with it,
+    // so there must be no file position to rewind.
+    MappingMemory* current = nullptr;
+    scanProcFile(fileno(file),
+                 [&](std::string_view line)
+                 {
+                     if (line.empty())
+                         return;
+
+                     if (line[0] >= 'A' && line[0] <= 'Z')
+                     {
+                         if (!current)
+                             return;
+
+                         if (line.starts_with("Shared_Clean:") ||
+                             line.starts_with("Shared_Dirty:"))
+                             current->_sharedKb += parseProcNumber(line.substr(13));
+                         else if (line.starts_with("Private_Dirty:"))
+                             current->_privateDirtyKb += parseProcNumber(line.substr(14));
+
+                         return;
+                     }
+
+                     // A mapping header, eg.:
+                     // 7f1c2a400000-7f1c2a421000 rw-p 00000000 00:00 0          [heap]
+                     // 7f1c2b000000-7f1c2b100000 r--p 00000000 08:01 1234       /usr/lib/libfoo.so
+                     std::string_view header = line;
+                     while (!header.empty() && header.back() == ' ')
+                         header.remove_suffix(1);
+
+                     // Skip the 5 fields before the optional pathname.
+                     std::size_t pos = 0;
+                     for (int field = 0; field < 5 && pos != std::string_view::npos; ++field)
+                     {
+                         pos = header.find(' ', pos);
+                         if (pos != std::string_view::npos)
+                             pos = header.find_first_not_of(' ', pos);
+                     }
+
+                     std::string_view name =
+                         (pos == std::string_view::npos) ? "[anon]" : header.substr(pos);
+                     if (name.front() == '/')
+                     {
+                         const std::size_t slash = name.rfind('/');
+                         name.remove_prefix(slash + 1);
+                     }
+
+                     current = &mappings[std::string(name)];
+                 });
+
+    return mappings;
 }
 
 std::string getMemoryStats(FILE* file)
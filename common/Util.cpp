@@ -981,6 +981,164 @@ namespace Util
         }
     }
 
+    namespace
+    {
+        /// Appends the parts of from that aren't in hole, which it overlaps.
+        void cutOut(const Rectangle& from, const Rectangle& hole, std::vector<Rectangle>& out)
+        {
+            const int top = std::max(from.getTop(), hole.getTop());
+            const int bottom = std::min(from.getBottom(), hole.getBottom());
+
+            if (from.getTop() < top)
+                out.push_back(Rectangle::create(from.getLeft(), from.getTop(), from.getRight(), top));
+            if (bottom < from.getBottom())
+                out.push_back(
+                    Rectangle::create(from.getLeft(), bottom, from.getRight(), from.getBottom()));
+            if (from.getLeft() < hole.getLeft())
+                out.push_back(Rectangle::create(from.getLeft(), top, hole.getLeft(), bottom));
+            if (hole.getRight() < from.getRight())
+                out.push_back(Rectangle::create(hole.getRight(), top, from.getRight(), bottom));
+        }
+
+        Rectangle bounds(const Rectangle& a, const Rectangle& b)
+        {
+            Rectangle result = a;
+            result.extend(b);
+            return result;
+        }
+    }
+
+    Rectangle Region::getBounds() const
+    {
+        Rectangle result;
+        for (const Rectangle& rectangle : _rectangles)
+            result.extend(rectangle);
+        return result;
+    }
+
+    std::int64_t Region::getArea() const
+    {
+        std::int64_t area = 0;
+        for (const Rectangle& rectangle : _rectangles)
+            area += rectangle.getArea();
+        return area;
+    }
+
+    bool Region::overlaps(const Rectangle& rectangle) const
+    {
+        return std::any_of(_rectangles.begin(), _rectangles.end(),
+                           [&rectangle](const Rectangle& it) { return it.overlaps(rectangle); });
+    }
+
+    bool Region::contains(const Rectangle& rectangle) const
+    {
+        if (!rectangle.hasSurface())
+            return true;
+
+        Region rest(rectangle);
+        for (const Rectangle& it : _rectangles)
+        {
+            rest.subtract(it);
+            if (rest.isEmpty())
+                return true;
+        }
+
+        return false;
+    }
+
+    void Region::unite(const Rectangle& rectangle)
+    {
+        if (!rectangle.hasSurface())
+            return;
+
+        // Add only the parts that aren't in the region yet, to stay disjoint.
+        std::vector<Rectangle> pieces{ rectangle };
+        std::vector<Rectangle> rest;
+        for (const Rectangle& it : _rectangles)
+        {
+            rest.clear();
+            for (const Rectangle& piece : pieces)
+            {
+                if (piece.overlaps(it))
+                    cutOut(piece, it, rest);
+                else
+                    rest.push_back(piece);
+            }
+
+            pieces.swap(rest);
+            if (pieces.empty())
+                return;
+        }
+
+        _rectangles.insert(_rectangles.end(), pieces.begin(), pieces.end());
+        coalesce();
+    }
+
+    void Region::subtract(const Rectangle& rectangle)
+    {
+        if (!rectangle.hasSurface() || !overlaps(rectangle))
+            return;
+
+        std::vector<Rectangle> rest;
+        rest.reserve(_rectangles.size() + 3);
+        for (const Rectangle& it : _rectangles)
+        {
+            if (it.overlaps(rectangle))
+                cutOut(it, rectangle, rest);
+            else
+                rest.push_back(it);
+        }
+
+        _rectangles.swap(rest);
+        coalesce();
+    }
+
+    void Region::intersect(const Rectangle& rectangle)
+    {
+        std::vector<Rectangle> rest;
+        for (const Rectangle& it : _rectangles)
+        {
+            if (it.overlaps(rectangle))
+                rest.push_back(Rectangle::create(
+                    std::max(it.getLeft(), rectangle.getLeft()),
+                    std::max(it.getTop(), rectangle.getTop()),
+                    std::min(it.getRight(), rectangle.getRight()),
+                    std::min(it.getBottom(), rectangle.getBottom())));
+        }
+
+        _rectangles.swap(rest);
+    }
+
+    void Region::coalesce()
+    {
+        bool merged = true;
+        while (merged)
+        {
+            merged = false;
+            for (std::size_t i = 0; i < _rectangles.size() && !merged; ++i)
+            {
+                for (std::size_t j = i + 1; j < _rectangles.size(); ++j)
+                {
+                    const Rectangle& a = _rectangles[i];
+                    const Rectangle& b = _rectangles[j];
+                    const bool sameColumn = a.getLeft() == b.getLeft() &&
+                                            a.getRight() == b.getRight() &&
+                                            (a.getBottom() == b.getTop() || b.getBottom() == a.getTop());
+                    const bool sameRow = a.getTop() == b.getTop() &&
+                                         a.getBottom() == b.getBottom() &&
+                                         (a.getRight() == b.getLeft() || b.getRight() == a.getLeft());
+                    if (sameColumn || sameRow)
+                    {
+                        _rectangles[i] = bounds(a, b);
+                        _rectangles.erase(_rectangles.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
     std::string base64Encode(std::string_view input)
     {
         std::ostringstream oss;
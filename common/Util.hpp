@@ -326,6 +326,10 @@ namespace Util
     /// Returns the cgroup's soft memory limit, or 0 if not available in bytes
     std::size_t getCGroupMemSoftLimit();
 
+    /// Returns the number of CPUs the cgroup's CPU bandwidth quota allows, rounded up,
+    /// or 0 if unlimited or not available.
+    unsigned getCGroupCpuLimit();
+
     /// Returns the process PSS in KB (works only when we have perms for /proc/pid/smaps).
     size_t getMemoryUsagePSS(pid_t pid);
 
@@ -343,6 +347,35 @@ namespace Util
     /// returns them as a pair in the same order
     std::pair<size_t, size_t> getPssAndDirtyFromSMaps(FILE* file);
 
+    /// The fields of /proc/<pid>/stat that we track.
+    struct ProcStat
+    {
+        /// utime + stime, in clock ticks.
+        std::size_t _jiffies = 0;
+        std::size_t _threadCount = 0;
+    };
+
+    /// Reads the "some avg10" percentage, rounded down, from an open
+    /// /proc/pressure/{memory,cpu,io} fd; -1 when not available.
+    int getPressureSomeAvg10(int fd);
+
+    /// Reads /proc/<pid>/stat from an fd that the caller keeps open
+    /// across calls; returns false once the process is gone.
+    bool getProcStat(int fd, ProcStat& stat);
+
+    /// The memory of the mappings with a given name, in KB.
+    struct MappingMemory
+    {
+        /// Shared_Clean + Shared_Dirty: still shared, e.g. with the process we forked from.
+        std::size_t _sharedKb = 0;
+        /// Private_Dirty: unshared since fork (copy-on-write broken), or new.
+        std::size_t _privateDirtyKb = 0;
+    };
+
+    /// Reads a full (not rollup) SMaps file and sums the memory of the mappings
+    /// by name: the file name of mapped files, or [heap], [stack], [anon] etc.
+    std::map<std::string, MappingMemory> getMemoryByMappingFromSMaps(FILE* file);
+
     /// Returns the total PSS usage of the process and all its children.
     std::size_t getProcessTreePss(pid_t pid);
 
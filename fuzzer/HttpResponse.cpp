@@ -14,16 +14,86 @@
 #include <net/HttpRequest.hpp>
 #include <fuzzer/Common.hpp>
 
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+/// Parses the header in one go and incrementally, as it would arrive
+/// over the network, and checks that the results match.
+void parseHeader(const char* data, size_t size)
+{
+    http::Header whole;
+    const int64_t wholeRead = whole.parse(data, size);
+
+    http::Header incremental;
+    int64_t read = 0;
+    for (size_t i = 0; i <= size && read == 0; ++i)
+        read = incremental.parse(data, i);
+
+    // Errors can be detected earlier with less data (e.g. too long a field).
+    if (wholeRead > 0)
+    {
+        assert(read == wholeRead && "Incremental header parsing consumed differently");
+        assert(incremental.size() == whole.size() && "Incremental header parsing differs");
+    }
+}
+
+/// Feeds the request parser like the socket does: only what was
+/// consumed is removed and the rest is given again with more data.
+void parseRequest(const char* data, size_t size)
+{
+    http::RequestParser request;
+    size_t consumed = 0;
+    for (size_t end = 0; end <= size; ++end)
+    {
+        const int64_t read = request.readData(data + consumed, end - consumed);
+        if (read < 0 || request.stage() == http::RequestParser::Stage::Finished)
+            break;
+
+        consumed += read;
+    }
+}
+
+/// When LOOL_FUZZER_BENCH is set, reports how long parsing each input takes.
+void benchmark(const char* data, size_t size)
+{
+    static const int iterations = std::getenv("LOOL_FUZZER_BENCH")
+                                      ? std::atoi(std::getenv("LOOL_FUZZER_BENCH"))
+                                      : 0;
+    if (iterations <= 0)
+        return;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        http::RequestParser request;
+        request.readData(data, size);
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cerr << "Parsed " << size << " bytes in " << elapsed.count() / iterations << " ns\n";
+}
+} // namespace
+
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
 {
     static bool initialized = fuzzer::DoInitialization();
     (void)initialized;
 
+    const char* p = reinterpret_cast<const char*>(data);
     for (size_t i = 0; i < size; ++i)
     {
         http::Response response;
-        response.readData(reinterpret_cast<const char*>(data), i);
+        response.readData(p, i);
     }
+
+    parseHeader(p, size);
+    parseRequest(p, size);
+    benchmark(p, size);
     return 0;
 }
 
@@ -39,6 +39,7 @@
 #include <common/base64.hpp>
 #include <common/ConfigUtil.hpp>
 #include <common/FileUtil.hpp>
+#include <common/JsonScanner.hpp>
 #include <common/JsonUtil.hpp>
 #include <common/Authorization.hpp>
 #include <common/TraceEvent.hpp>
@@ -197,7 +198,8 @@ bool ChildSession::_handleInput(const char *buffer, int length)
 {
     LOG_TRC("handling [" << getAbbreviatedMessage(buffer, length) << ']');
     const std::string firstLine = getFirstLine(buffer, length);
-    const StringVector tokens = StringVector::tokenize(firstLine.data(), firstLine.size());
+    const StringVector tokens = StringVector::tokenizeView(firstLine.data(), firstLine.size());
+    const ClientCommand command = getClientCommand(tokens.getView(0));
 
     // if _clientVisibleArea.getWidth() == 0, then it is probably not a real user.. probably is a convert-to or similar
     LogUiCommands logUndoRelatedcommandAtfunctionEnd(*this, &tokens);
@@ -212,7 +214,7 @@ bool ChildSession::_handleInput(const char *buffer, int length)
         updateLastActivityTime();
     }
 
-    if (tokens.size() > 0 && tokens.equals(0, "useractive") && getLOKitDocument() != nullptr)
+    if (command == ClientCommand::UserActive && getLOKitDocument() != nullptr)
     {
         LOG_DBG("Handling message after inactivity of " << getInactivityMS());
         setIsActive(true);
@@ -281,20 +283,20 @@ bool ChildSession::_handleInput(const char *buffer, int length)
         LOG_TRC("Finished replaying messages.");
     }
 
-    if (tokens.equals(0, "dummymsg"))
+    if (command == ClientCommand::DummyMsg)
     {
         // Just to update the activity of a view-only client.
         return true;
     }
-    else if (tokens.equals(0, "commandvalues"))
+    else if (command == ClientCommand::CommandValues)
     {
         return getCommandValues(tokens);
     }
-    else if (tokens.equals(0, "dialogevent"))
+    else if (command == ClientCommand::DialogEvent)
     {
         return dialogEvent(tokens);
     }
-    else if (tokens.equals(0, "load"))
+    else if (command == ClientCommand::Load)
     {
         if (_isDocLoaded)
         {
@@ -316,7 +318,7 @@ bool ChildSession::_handleInput(const char *buffer, int length)
         LOG_TRC("isDocLoaded state after loadDocument: " << _isDocLoaded);
         return _isDocLoaded;
     }
-    else if (tokens.equals(0, "extractlinktargets"))
+    else if (command == ClientCommand::ExtractLinkTargets)
     {
         if (tokens.size() < 2)
         {
@@ -347,7 +349,7 @@ bool ChildSession::_handleInput(const char *buffer, int length)
 
         return success;
     }
-    else if (tokens.equals(0, "extractdocumentstructure"))
+    else if (command == ClientCommand::ExtractDocumentStructure)
     {
         if (tokens.size() < 2)
         {
@@ -385,7 +387,7 @@ bool ChildSession::_handleInput(const char *buffer, int length)
 
         return success;
     }
-    else if (tokens.equals(0, "transformdocumentstructure"))
+    else if (command == ClientCommand::TransformDocumentStructure)
     {
         if (tokens.size() < 3)
         {
@@ -425,7 +427,7 @@ bool ChildSession::_handleInput(const char *buffer, int length)
 
         return true;
     }
-    else if (tokens.equals(0, "getthumbnail"))
+    else if (command == ClientCommand::GetThumbnail)
     {
         if (tokens.size() < 3)
         {
@@ -487,7 +489,7 @@ bool ChildSession::_handleInput(const char *buffer, int length)
 
         return success;
     }
-    else if (tokens.equals(0, "addconfig"))
+    else if (command == ClientCommand::AddConfig)
     {
         Poco::Path presetsPath(JAILED_CONFIG_ROOT);
         getLOKit()->setOption("addconfig", Poco::URI(presetsPath).toString().c_str());
@@ -497,47 +499,47 @@ bool ChildSession::_handleInput(const char *buffer, int length)
         sendTextFrameAndLogError("error: cmd=" + tokens[0] + " kind=nodocloaded");
         return false;
     }
-    else if (tokens.equals(0, "renderfont"))
+    else if (command == ClientCommand::RenderFont)
     {
         sendFontRendering(tokens);
     }
-    else if (tokens.equals(0, "setclientpart"))
+    else if (command == ClientCommand::SetClientPart)
     {
         return setClientPart(tokens);
     }
-    else if (tokens.equals(0, "selectclientpart"))
+    else if (command == ClientCommand::SelectClientPart)
     {
         return selectClientPart(tokens);
     }
-    else if (tokens.equals(0, "moveselectedclientparts"))
+    else if (command == ClientCommand::MoveSelectedClientParts)
     {
         return moveSelectedClientParts(tokens);
     }
-    else if (tokens.equals(0, "setpage"))
+    else if (command == ClientCommand::SetPage)
     {
         return setPage(tokens);
     }
-    else if (tokens.equals(0, "status"))
+    else if (command == ClientCommand::Status)
     {
         return getStatus();
     }
-    else if (tokens.equals(0, "getslide"))
+    else if (command == ClientCommand::GetSlide)
     {
         return renderSlide(tokens);
     }
-    else if (tokens.equals(0, "paintwindow"))
+    else if (command == ClientCommand::PaintWindow)
     {
         return renderWindow(tokens);
     }
-    else if (tokens.equals(0, "resizewindow"))
+    else if (command == ClientCommand::ResizeWindow)
     {
         return resizeWindow(tokens);
     }
-    else if (tokens.equals(0, "tile") || tokens.equals(0, "tilecombine"))
+    else if (command == ClientCommand::Tile || command == ClientCommand::TileCombine)
     {
         assert(false && "Tile traffic should go through the DocumentBroker-LoKit WS.");
     }
-    else if (tokens.equals(0, "blockingcommandstatus"))
+    else if (command == ClientCommand::BlockingCommandStatus)
     {
 #if ENABLE_FEATURE_LOCK || ENABLE_FEATURE_RESTRICTION
         return updateBlockingCommandStatus(tokens);
@@ -548,339 +550,308 @@ bool ChildSession::_handleInput(const char *buffer, int length)
         // All other commands are such that they always require a LibreOfficeKitDocument session,
         // i.e. need to be handled in a child process.
 
-        assert(Util::isFuzzing() ||
-               tokens.equals(0, "clientzoom") ||
-               tokens.equals(0, "clientvisiblearea") ||
-               tokens.equals(0, "outlinestate") ||
-               tokens.equals(0, "downloadas") ||
-               tokens.equals(0, "getchildid") ||
-               tokens.equals(0, "gettextselection") ||
-               tokens.equals(0, "getclipboard") ||
-               tokens.equals(0, "setclipboard") ||
-               tokens.equals(0, "paste") ||
-               tokens.equals(0, "insertfile") ||
-               tokens.equals(0, "key") ||
-               tokens.equals(0, "textinput") ||
-               tokens.equals(0, "windowkey") ||
-               tokens.equals(0, "mouse") ||
-               tokens.equals(0, "windowmouse") ||
-               tokens.equals(0, "windowgesture") ||
-               tokens.equals(0, "uno") ||
-               tokens.equals(0, "save") ||
-               tokens.equals(0, "selecttext") ||
-               tokens.equals(0, "windowselecttext") ||
-               tokens.equals(0, "selectgraphic") ||
-               tokens.equals(0, "resetselection") ||
-               tokens.equals(0, "saveas") ||
-               tokens.equals(0, "exportas") ||
-               tokens.equals(0, "useractive") ||
-               tokens.equals(0, "userinactive") ||
-               tokens.equals(0, "windowcommand") ||
-               tokens.equals(0, "asksignaturestatus") ||
-               tokens.equals(0, "rendershapeselection") ||
-               tokens.equals(0, "removetextcontext") ||
-               tokens.equals(0, "dialogevent") ||
-               tokens.equals(0, "completefunction")||
-               tokens.equals(0, "formfieldevent") ||
-               tokens.equals(0, "traceeventrecording") ||
-               tokens.equals(0, "sallogoverride") ||
-               tokens.equals(0, "rendersearchresult") ||
-               tokens.equals(0, "contentcontrolevent") ||
-               tokens.equals(0, "a11ystate") ||
-               tokens.equals(0, "geta11yfocusedparagraph") ||
-               tokens.equals(0, "geta11ycaretposition") ||
-               tokens.equals(0, "toggletiledumping") ||
-               tokens.equals(0, "getpresentationinfo"));
-
         ProfileZone pz("ChildSession::_handleInput:" + tokens[0]);
-        if (tokens.equals(0, "clientzoom"))
-        {
-            return clientZoom(tokens);
-        }
-        else if (tokens.equals(0, "clientvisiblearea"))
-        {
-            return clientVisibleArea(tokens);
-        }
-        else if (tokens.equals(0, "outlinestate"))
-        {
-            return outlineState(tokens);
-        }
-        else if (tokens.equals(0, "downloadas"))
-        {
-            return downloadAs(tokens);
-        }
-        else if (tokens.equals(0, "getchildid"))
-        {
-            return getChildId();
-        }
-        else if (tokens.equals(0, "gettextselection")) // deprecated.
-        {
-            return getTextSelection(tokens);
-        }
-        else if (tokens.equals(0, "getclipboard"))
-        {
-            return getClipboard(tokens);
-        }
-        else if (tokens.equals(0, "setclipboard"))
-        {
-            return setClipboard(tokens);
-        }
-        else if (tokens.equals(0, "paste"))
-        {
-            return paste(buffer, length, tokens);
-        }
-        else if (tokens.equals(0, "insertfile"))
-        {
-            return insertFile(tokens);
-        }
-        else if (tokens.equals(0, "key"))
-        {
-            return keyEvent(tokens, LokEventTargetEnum::Document);
-        }
-        else if (tokens.equals(0, "textinput"))
-        {
-            return extTextInputEvent(tokens);
-        }
-        else if (tokens.equals(0, "windowkey"))
-        {
-            return keyEvent(tokens, LokEventTargetEnum::Window);
-        }
-        else if (tokens.equals(0, "mouse"))
-        {
-            return mouseEvent(tokens, LokEventTargetEnum::Document);
-        }
-        else if (tokens.equals(0, "windowmouse"))
-        {
-            return mouseEvent(tokens, LokEventTargetEnum::Window);
-        }
-        else if (tokens.equals(0, "windowgesture"))
-        {
-            return gestureEvent(tokens);
-        }
-        else if (tokens.equals(0, "uno"))
+        switch (command)
         {
-            // SpellCheckApplySuggestion might contain non separator spaces
-            if (tokens[1].find(".uno:SpellCheckApplySuggestion") != std::string::npos ||
-                tokens[1].find(".uno:LanguageStatus") != std::string::npos)
+            case ClientCommand::ClientZoom:
             {
-                StringVector newTokens;
-                newTokens.push_back(tokens[0]);
-                newTokens.push_back(firstLine.substr(4)); // Copy the remaining part.
-                return unoCommand(newTokens);
+                return clientZoom(tokens);
             }
-            else if (tokens[1].find(".uno:Save") != std::string::npos)
+            case ClientCommand::ClientVisibleArea:
             {
-                LOG_ERR("Unexpected UNO Save command in client");
-                // save should go through path below
-                assert(false);
-                return false;
+                return clientVisibleArea(tokens);
+            }
+            case ClientCommand::OutlineState:
+            {
+                return outlineState(tokens);
+            }
+            case ClientCommand::DownloadAs:
+            {
+                return downloadAs(tokens);
+            }
+            case ClientCommand::GetChildId:
+            {
+                return getChildId();
+            }
+            case ClientCommand::GetTextSelection: // deprecated.
+            {
+                return getTextSelection(tokens);
+            }
+            case ClientCommand::GetClipboard:
+            {
+                return getClipboard(tokens);
+            }
+            case ClientCommand::SetClipboard:
+            {
+                return setClipboard(tokens);
+            }
+            case ClientCommand::Paste:
+            {
+                return paste(buffer, length, tokens);
             }
-            else if (tokens[1].find(".uno:SetDocumentProperties") != std::string::npos && tokens.size() == 2)
+            case ClientCommand::InsertFile:
             {
-                // Don't append anything if command has any parameters
-                // It maybe json and appending plain string makes everything broken
-                std::string PossibleFileExtensions[3] = {"", TO_UPLOAD_SUFFIX + std::string(UPLOADING_SUFFIX), TO_UPLOAD_SUFFIX};
-                for (size_t i = 0; i < 3; i++)
+                return insertFile(tokens);
+            }
+            case ClientCommand::Key:
+            {
+                return keyEvent(tokens, LokEventTargetEnum::Document);
+            }
+            case ClientCommand::TextInput:
+            {
+                return extTextInputEvent(tokens);
+            }
+            case ClientCommand::WindowKey:
+            {
+                return keyEvent(tokens, LokEventTargetEnum::Window);
+            }
+            case ClientCommand::Mouse:
+            {
+                return mouseEvent(tokens, LokEventTargetEnum::Document);
+            }
+            case ClientCommand::WindowMouse:
+            {
+                return mouseEvent(tokens, LokEventTargetEnum::Window);
+            }
+            case ClientCommand::WindowGesture:
+            {
+                return gestureEvent(tokens);
+            }
+            case ClientCommand::Uno:
+            {
+                // SpellCheckApplySuggestion might contain non separator spaces
+                if (tokens[1].find(".uno:SpellCheckApplySuggestion") != std::string::npos ||
+                    tokens[1].find(".uno:LanguageStatus") != std::string::npos)
+                {
+                    StringVector newTokens;
+                    newTokens.push_back(tokens[0]);
+                    newTokens.push_back(firstLine.substr(4)); // Copy the remaining part.
+                    return unoCommand(newTokens);
+                }
+                else if (tokens[1].find(".uno:Save") != std::string::npos)
+                {
+                    LOG_ERR("Unexpected UNO Save command in client");
+                    // save should go through path below
+                    assert(false);
+                    return false;
+                }
+                else if (tokens[1].find(".uno:SetDocumentProperties") != std::string::npos && tokens.size() == 2)
                 {
-                    const auto st = FileUtil::Stat(Poco::URI(getJailedFilePath()).getPath() + PossibleFileExtensions[i]);
-                    if (st.exists())
+                    // Don't append anything if command has any parameters
+                    // It maybe json and appending plain string makes everything broken
+                    std::string PossibleFileExtensions[3] = {"", TO_UPLOAD_SUFFIX + std::string(UPLOADING_SUFFIX), TO_UPLOAD_SUFFIX};
+                    for (size_t i = 0; i < 3; i++)
                     {
-                        const std::size_t size = (st.good() ? st.size() : 0);
-                        std::string addedProperty = firstLine + "?FileSize:string=" + std::to_string(size);
-                        StringVector newTokens = StringVector::tokenize(addedProperty.data(), addedProperty.size());
-                        return unoCommand(newTokens);
+                        const auto st = FileUtil::Stat(Poco::URI(getJailedFilePath()).getPath() + PossibleFileExtensions[i]);
+                        if (st.exists())
+                        {
+                            const std::size_t size = (st.good() ? st.size() : 0);
+                            std::string addedProperty = firstLine + "?FileSize:string=" + std::to_string(size);
+                            StringVector newTokens = StringVector::tokenize(addedProperty.data(), addedProperty.size());
+                            return unoCommand(newTokens);
+                        }
                     }
                 }
-            }
-            else if (tokens[1] == ".uno:Signature" || tokens[1] == ".uno:InsertSignatureLine")
-            {
-                // See if the command has parameters: if not, annotate with sign cert/key.
-                if (tokens.size() == 2 && unoSignatureCommand(tokens[1]))
+                else if (tokens[1] == ".uno:Signature" || tokens[1] == ".uno:InsertSignatureLine")
                 {
-                    // The command has been sent with parameters from user private info, done.
-                    return true;
+                    // See if the command has parameters: if not, annotate with sign cert/key.
+                    if (tokens.size() == 2 && unoSignatureCommand(tokens[1]))
+                    {
+                        // The command has been sent with parameters from user private info, done.
+                        return true;
+                    }
                 }
+
+                return unoCommand(tokens);
             }
+            case ClientCommand::Save:
+            {
+                bool background = tokens[1] == "background=true";
+                SigUtil::addActivity(getId(), (background ? "bg " : "") + firstLine);
 
-            return unoCommand(tokens);
-        }
-        else if (tokens.equals(0, "save"))
-        {
-            bool background = tokens[1] == "background=true";
-            SigUtil::addActivity(getId(), (background ? "bg " : "") + firstLine);
+                StringVector unoSave = StringVector::tokenize("uno .uno:Save " + tokens.cat(' ', 2));
 
-            StringVector unoSave = StringVector::tokenize("uno .uno:Save " + tokens.cat(' ', 2));
+                // See copyForUpload().
+                _inodeBeforeSave =
+                    FileUtil::Stat(Poco::URI(getJailedFilePath()).getPath()).inodeNumber();
 
-            bool saving = false;
-            if (background)
-                saving = saveDocumentBackground(unoSave);
+                bool saving = false;
+                if (background)
+                    saving = saveDocumentBackground(unoSave);
 
-            if (!saving)
-            { // fallback to foreground save
+                if (!saving)
+                { // fallback to foreground save
 
-                UnitKit::get().preSaveHook();
+                    UnitKit::get().preSaveHook();
+
+                    // Disable processing of other messages while saving document
+                    InputProcessingManager processInput(getProtocol(), false);
+                    // disable watchdog while saving
+                    WatchdogGuard watchdogGuard;
+
+                    std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+                    bool result = unoCommand(unoSave);
+                    if (result)
+                    {
+    #if WASMAPP
+                        saveToServer();
+    #endif
+                        LogUiCommands uiLog(*this);
+                        uiLog.logSaveLoad("save", Poco::URI(getJailedFilePath()).getPath(), timeStart);
+                    }
 
-                // Disable processing of other messages while saving document
-                InputProcessingManager processInput(getProtocol(), false);
-                // disable watchdog while saving
-                WatchdogGuard watchdogGuard;
+                    return result;
+                }
 
+                return true;
+            }
+            case ClientCommand::SelectText:
+            {
+                return selectText(tokens, LokEventTargetEnum::Document);
+            }
+            case ClientCommand::WindowSelectText:
+            {
+                return selectText(tokens, LokEventTargetEnum::Window);
+            }
+            case ClientCommand::SelectGraphic:
+            {
+                return selectGraphic(tokens);
+            }
+            case ClientCommand::ResetSelection:
+            {
+                return resetSelection(tokens);
+            }
+            case ClientCommand::SaveAs:
+            {
                 std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
-                bool result = unoCommand(unoSave);
+                bool result = saveAs(tokens);
                 if (result)
                 {
-#if WASMAPP
-                    saveToServer();
-#endif
                     LogUiCommands uiLog(*this);
-                    uiLog.logSaveLoad("save", Poco::URI(getJailedFilePath()).getPath(), timeStart);
+                    uiLog.logSaveLoad("saveas", Poco::URI(getJailedFilePath()).getPath(), timeStart);
                 }
-
                 return result;
             }
-
-            return true;
-        }
-        else if (tokens.equals(0, "selecttext"))
-        {
-            return selectText(tokens, LokEventTargetEnum::Document);
-        }
-        else if (tokens.equals(0, "windowselecttext"))
-        {
-            return selectText(tokens, LokEventTargetEnum::Window);
-        }
-        else if (tokens.equals(0, "selectgraphic"))
-        {
-            return selectGraphic(tokens);
-        }
-        else if (tokens.equals(0, "resetselection"))
-        {
-            return resetSelection(tokens);
-        }
-        else if (tokens.equals(0, "saveas"))
-        {
-            std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
-            bool result = saveAs(tokens);
-            if (result)
+            case ClientCommand::ExportAs:
             {
-                LogUiCommands uiLog(*this);
-                uiLog.logSaveLoad("saveas", Poco::URI(getJailedFilePath()).getPath(), timeStart);
+                std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
+                bool result = exportAs(tokens);
+                if (result)
+                {
+                    LogUiCommands uiLog(*this);
+                    uiLog.logSaveLoad("exportas", Poco::URI(getJailedFilePath()).getPath(), timeStart);
+                }
+                return result;
             }
-            return result;
-        }
-        else if (tokens.equals(0, "exportas"))
-        {
-            std::chrono::steady_clock::time_point timeStart = std::chrono::steady_clock::now();
-            bool result = exportAs(tokens);
-            if (result)
+            case ClientCommand::UserActive:
             {
-                LogUiCommands uiLog(*this);
-                uiLog.logSaveLoad("exportas", Poco::URI(getJailedFilePath()).getPath(), timeStart);
+                setIsActive(true);
+                break;
             }
-            return result;
-        }
-        else if (tokens.equals(0, "useractive"))
-        {
-            setIsActive(true);
-        }
-        else if (tokens.equals(0, "userinactive"))
-        {
-            setIsActive(false);
-            _docManager->trimIfInactive();
-        }
-        else if (tokens.equals(0, "windowcommand"))
-        {
-            sendWindowCommand(tokens);
-        }
-        else if (tokens.equals(0, "asksignaturestatus"))
-        {
-            askSignatureStatus(buffer, length, tokens);
-        }
-        else if (tokens.equals(0, "rendershapeselection"))
-        {
-            return renderShapeSelection(tokens);
-        }
-        else if (tokens.equals(0, "removetextcontext"))
-        {
-            return removeTextContext(tokens);
-        }
-        else if (tokens.equals(0, "completefunction"))
-        {
-            return completeFunction(tokens);
-        }
-        else if (tokens.equals(0, "formfieldevent"))
-        {
-            return formFieldEvent(buffer, length, tokens);
-        }
-        else if (tokens.equals(0, "contentcontrolevent"))
-        {
-            return contentControlEvent(tokens);
-        }
-        else if (tokens.equals(0, "traceeventrecording"))
-        {
-            static const bool traceEventsEnabled =
-                ConfigUtil::getBool("trace_event[@enable]", false);
-            if (traceEventsEnabled)
+            case ClientCommand::UserInactive:
+            {
+                setIsActive(false);
+                _docManager->trimIfInactive();
+                break;
+            }
+            case ClientCommand::WindowCommand:
+            {
+                sendWindowCommand(tokens);
+                break;
+            }
+            case ClientCommand::AskSignatureStatus:
+            {
+                askSignatureStatus(buffer, length, tokens);
+                break;
+            }
+            case ClientCommand::RenderShapeSelection:
+            {
+                return renderShapeSelection(tokens);
+            }
+            case ClientCommand::RemoveTextContext:
+            {
+                return removeTextContext(tokens);
+            }
+            case ClientCommand::CompleteFunction:
             {
-                if (tokens.size() > 0)
+                return completeFunction(tokens);
+            }
+            case ClientCommand::FormFieldEvent:
+            {
+                return formFieldEvent(buffer, length, tokens);
+            }
+            case ClientCommand::ContentControlEvent:
+            {
+                return contentControlEvent(tokens);
+            }
+            case ClientCommand::TraceEventRecording:
+            {
+                static const bool traceEventsEnabled =
+                    ConfigUtil::getBool("trace_event[@enable]", false);
+                if (traceEventsEnabled)
                 {
-                    if (tokens.equals(1, "start"))
+                    if (tokens.size() > 0)
                     {
-                        getLOKit()->setOption("traceeventrecording", "start");
-                        TraceEvent::startRecording();
-                        LOG_INF("Trace Event recording in this Kit process turned on (might have been on already)");
-                    }
-                    else if (tokens.equals(1, "stop"))
-                    {
-                        getLOKit()->setOption("traceeventrecording", "stop");
-                        TraceEvent::stopRecording();
-                        LOG_INF("Trace Event recording in this Kit process turned off (might have been off already)");
+                        if (tokens.equals(1, "start"))
+                        {
+                            getLOKit()->setOption("traceeventrecording", "start");
+                            TraceEvent::startRecording();
+                            LOG_INF("Trace Event recording in this Kit process turned on (might have been on already)");
+                        }
+                        else if (tokens.equals(1, "stop"))
+                        {
+                            getLOKit()->setOption("traceeventrecording", "stop");
+                            TraceEvent::stopRecording();
+                            LOG_INF("Trace Event recording in this Kit process turned off (might have been off already)");
+                        }
                     }
                 }
+                break;
             }
-        }
-        else if (tokens.equals(0, "sallogoverride"))
-        {
-            if (tokens.empty() || tokens.equals(1, "default"))
+            case ClientCommand::SalLogOverride:
             {
-                getLOKit()->setOption("sallogoverride", nullptr);
+                if (tokens.empty() || tokens.equals(1, "default"))
+                {
+                    getLOKit()->setOption("sallogoverride", nullptr);
+                }
+                else if (tokens.size() > 0 && tokens.equals(1, "off"))
+                {
+                    getLOKit()->setOption("sallogoverride", "-WARN-INFO");
+                }
+                else if (tokens.size() > 0)
+                {
+                    getLOKit()->setOption("sallogoverride", tokens[1].c_str());
+                }
+                break;
             }
-            else if (tokens.size() > 0 && tokens.equals(1, "off"))
+            case ClientCommand::RenderSearchResult:
             {
-                getLOKit()->setOption("sallogoverride", "-WARN-INFO");
+                return renderSearchResult(buffer, length, tokens);
             }
-            else if (tokens.size() > 0)
+            case ClientCommand::A11yState:
             {
-                getLOKit()->setOption("sallogoverride", tokens[1].c_str());
+                return setAccessibilityState(tokens[1] == "true");
             }
-        }
-        else if (tokens.equals(0, "rendersearchresult"))
-        {
-            return renderSearchResult(buffer, length, tokens);
-        }
-        else if (tokens.equals(0, "a11ystate"))
-        {
-            return setAccessibilityState(tokens[1] == "true");
-        }
-        else if (tokens.equals(0, "geta11yfocusedparagraph"))
-        {
-            return getA11yFocusedParagraph();
-        }
-        else if (tokens.equals(0, "geta11ycaretposition"))
-        {
-            return getA11yCaretPosition();
-        }
-        else if (tokens.equals(0, "toggletiledumping"))
-        {
-            setDumpTiles(tokens[1] == "true");
-        }
-        else if (tokens.equals(0, "getpresentationinfo"))
-        {
-            return getPresentationInfo();
-        }
-        else
-        {
-            assert(Util::isFuzzing() && "Unknown command token.");
+            case ClientCommand::GetA11yFocusedParagraph:
+            {
+                return getA11yFocusedParagraph();
+            }
+            case ClientCommand::GetA11yCaretPosition:
+            {
+                return getA11yCaretPosition();
+            }
+            case ClientCommand::ToggleTileDumping:
+            {
+                setDumpTiles(tokens[1] == "true");
+                break;
+            }
+            case ClientCommand::GetPresentationInfo:
+            {
+                return getPresentationInfo();
+            }
+            default:
+                assert(Util::isFuzzing() && "Unknown command token.");
+                break;
         }
     }
 
@@ -905,20 +876,38 @@ namespace {
      * Create the 'upload' file regardless of success or failure,
      * because we don't know if the last upload worked or not.
      * DocBroker will have to decide to upload or skip.
+     *
+     * When Core saved to a new file, replacing the one with @inodeBeforeSave,
+     * it will not write into this one either, so it's handed over to upload
+     * as-is, by hard-linking it, instead of copying all of it.
      */
     [[maybe_unused]]
-    void copyForUpload(const std::string& url)
+    void copyForUpload(const std::string& url, ino_t inodeBeforeSave = 0)
     {
         const std::string oldName = Poco::URI(url).getPath();
         const std::string newName = oldName + TO_UPLOAD_SUFFIX;
-        if (!FileUtil::copyAtomic(oldName, newName, /*preserveTimestamps=*/true))
+        const auto start = std::chrono::steady_clock::now();
+
+        const FileUtil::Stat st(oldName);
+        if (inodeBeforeSave && st.exists() && st.inodeNumber() != inodeBeforeSave &&
+            FileUtil::linkAtomic(oldName, newName))
+        {
+            LOG_DBG("Linked [" << oldName << "] to [" << newName << "] ("
+                               << st.size() << " bytes) in "
+                               << std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - start));
+        }
+        else if (!FileUtil::copyAtomic(oldName, newName, /*preserveTimestamps=*/true))
         {
             // It's not an error if there was no file to copy, when the document isn't modified.
             LOG_TRC_SYS("Failed to copy [" << oldName << "] to [" << newName << ']');
         }
         else
         {
-            LOG_TRC("Copied [" << oldName << "] to [" << newName << ']');
+            LOG_DBG("Copied [" << oldName << "] to [" << newName << "] (" << st.size()
+                               << " bytes) in "
+                               << std::chrono::duration_cast<std::chrono::microseconds>(
+                                      std::chrono::steady_clock::now() - start));
         }
     }
 }
@@ -3385,11 +3374,11 @@ void ChildSession::rememberEventsForInactiveUser(const int type, const std::stri
              type == LOK_CALLBACK_VIEW_CURSOR_VISIBLE ||
              type == LOK_CALLBACK_VIEW_LOCK)
     {
-        Poco::JSON::Parser parser;
-
-        Poco::JSON::Object::Ptr root = parser.parse(payload).extract<Poco::JSON::Object::Ptr>();
-        int viewId = root->getValue<int>("viewId");
-        _stateRecorder.recordViewEvent(viewId, type, payload);
+        int viewId = -1;
+        if (JsonScanner::getInteger(payload, "viewId", viewId))
+            _stateRecorder.recordViewEvent(viewId, type, payload);
+        else
+            LOG_WRN("No viewId in " << lokCallbackTypeToString(type) << ": " << payload);
     }
     else if (type == LOK_CALLBACK_STATE_CHANGED)
     {
@@ -3654,22 +3643,18 @@ void ChildSession::loKitCallback(const int type, const std::string& payload)
     }
     case LOK_CALLBACK_UNO_COMMAND_RESULT:
     {
-        Parser parser;
-        Poco::Dynamic::Var var = parser.parse(payload);
-        Object::Ptr object = var.extract<Object::Ptr>();
-
-        auto commandName = object->get("commandName");
-        auto success = object->get("success");
+        std::string commandName;
+        JsonScanner::getString(payload, "commandName", commandName);
 
         bool saveCommand = false;
 
-        if (!commandName.isEmpty() && commandName.toString() == ".uno:Save")
+        if (commandName == ".uno:Save")
         {
             if constexpr (!Util::isMobileApp())
             {
                 consistencyCheckJail();
 
-                copyForUpload(getJailedFilePath());
+                copyForUpload(getJailedFilePath(), _inodeBeforeSave);
 
                 saveCommand = true;
             }
@@ -3678,7 +3663,7 @@ void ChildSession::loKitCallback(const int type, const std::string& payload)
                 // After the document has been saved (into the temporary copy that we set up in
                 // -[CODocument loadFromContents:ofType:error:]), save it also using the system API so
                 // that file provider extensions notice.
-                if (!success.isEmpty() && success.toString() == "true")
+                if (JsonScanner::findValue(payload, "success") == "true")
                 {
 #if defined(IOS)
                     CODocument* document =
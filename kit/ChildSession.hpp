@@ -15,6 +15,8 @@
 
 #include <atomic>
 
+#include <sys/types.h>
+
 #define LOK_USE_UNSTABLE_API
 #include <LibreOfficeKit/LibreOfficeKit.hxx>
 
@@ -85,6 +87,8 @@ public:
     bool getStatus();
     bool getPartStatus();
     int getViewId() const { return _viewId; }
+    /// The part (sheet, slide, page) this view shows.
+    int getCurrentPart() const { return _currentPart; }
     void setViewId(const int viewId) { _viewId = viewId; }
     const std::string& getViewUserId() const { return getUserId(); }
     const std::string& getViewUserName() const { return getUserName(); }
@@ -353,6 +357,9 @@ private:
     int _lastUiCmdLinesLoggedCount = 0;
     LogUiCommandsLine _lastUiCmdLinesLogged[2];
     std::chrono::steady_clock::time_point _logUiSaveBackGroundTimeStart;
+
+    /// The inode of the document before the last save, to tell whether Core replaced it.
+    ino_t _inodeBeforeSave = 0;
 };
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <memory>
+#include <set>
 #include <unordered_set>
 #include <fstream>
 #include <assert.h>
@@ -676,6 +677,36 @@ class DeltaGenerator {
         rebalanceDeltasT(true);
     }
 
+    /// Drops the cached deltas of all but the given parts,
+    /// returns the size of the dropped entries in bytes.
+    size_t dropCacheExceptParts(const std::set<int>& parts)
+    {
+        std::unique_lock<std::mutex> guard(_deltaGuard);
+        size_t released = 0;
+        for (auto it = _deltaEntries.begin(); it != _deltaEntries.end();)
+        {
+            if (parts.count((*it)->_loc._part))
+            {
+                ++it;
+                continue;
+            }
+
+            released += (*it)->sizeBytes();
+            it = _deltaEntries.erase(it);
+        }
+        return released;
+    }
+
+    /// The size of all the cached deltas in bytes.
+    size_t getCacheSize()
+    {
+        std::unique_lock<std::mutex> guard(_deltaGuard);
+        size_t total = 0;
+        for (const auto& it : _deltaEntries)
+            total += it->sizeBytes();
+        return total;
+    }
+
     void dumpState(std::ostream& oss)
     {
         oss << "\tdelta generator with " << _deltaEntries.size() << " entries vs. max "
@@ -20,14 +20,17 @@
 #include <sys/wait.h>
 #include <sysexits.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <thread>
 #include <chrono>
 #include <utility>
+#include <vector>
 
 #include <Poco/Path.h>
 #include <Poco/URI.h>
@@ -77,6 +80,12 @@ static std::map<pid_t, std::string> childJails;
 static std::vector<std::string> cleanupJailPaths;
 /// The [subforkit pid -> subforkit id] map.
 static std::map<pid_t, std::string> subForKitPids;
+/// The child removing the jails of exited kits, or 0.
+static pid_t jailRemoverPid = 0;
+/// The child building jails for the pool, or 0.
+static pid_t jailPoolBuilderPid = 0;
+/// The number of jails to keep ready in the pool, when linking/copying.
+static std::size_t JailPoolSize = 0;
 
 /// The Main polling main-loop of this (single threaded) process
 static std::unique_ptr<SocketPoll> ForKitPoll;
@@ -99,7 +108,11 @@ void dump_forkit_state()
         << "  SingleKit: " << SingleKit << "\n"
 #endif
         << "  ClientPortNumber: " << ClientPortNumber << "\n"
-        << "  MasterLocation: " << MasterLocation
+        << "  MasterLocation: " << MasterLocation << "\n"
+        << "  JailPoolSize: " << JailPoolSize << "\n"
+        << "  jailRemoverPid: " << jailRemoverPid << "\n"
+        << "  jailPoolBuilderPid: " << jailPoolBuilderPid << "\n"
+        << "  cleanupJailPaths: " << cleanupJailPaths.size()
         << "\n";
 
     oss << "\nMalloc info [" << getpid() << "]: \n\t"
@@ -291,6 +304,45 @@ static bool haveCorrectCapabilities()
 }
 #endif // HAVE_LIBCAP
 
+/// Forks a short-lived child that runs func and exits, for slow
+/// file-system work off the spawn path. Returns its pid, or 0 on failure.
+static pid_t forkHelper(const std::string& childProcessName, const std::function<void()>& func)
+{
+    // As in forkKit, the watchdog thread must not be running when we fork.
+    const bool hasWatchDog(SocketPoll::PollWatchdog);
+    if (hasWatchDog)
+        SocketPoll::PollWatchdog->joinThread();
+
+    Log::preFork();
+
+    const pid_t pid = fork();
+    if (!pid)
+    {
+        Log::postFork();
+        Util::setThreadName(childProcessName);
+
+        close(0);
+        if (ForKitPoll)
+            ForKitPoll->closeAllSockets();
+        SigUtil::setSigChildHandler(nullptr);
+
+        func();
+        Util::forcedExit(EX_OK);
+    }
+
+    if (hasWatchDog)
+        SocketPoll::PollWatchdog->startThread();
+
+    if (pid < 0)
+    {
+        LOG_SYS("Fork failed for " << childProcessName);
+        return 0;
+    }
+
+    LOG_TRC("Forked " << childProcessName << " [" << pid << ']');
+    return pid;
+}
+
 /// Check if some previously forked kids have died.
 static void cleanupChildren(const std::string& childRoot)
 {
@@ -381,6 +433,18 @@ static void cleanupChildren(const std::string& childRoot)
 
             subForKitPids.erase(subit);
         }
+        else if (exitedChildPid == jailRemoverPid)
+        {
+            LOG_DBG("Jail remover " << exitedChildPid << " has exited with status " << status);
+            jailRemoverPid = 0;
+        }
+        else if (exitedChildPid == jailPoolBuilderPid)
+        {
+            if (info.si_code != CLD_EXITED || status != EX_OK)
+                LOG_WRN("Jail pool builder " << exitedChildPid << " has failed with status "
+                                             << status);
+            jailPoolBuilderPid = 0;
+        }
         else
         {
             LOG_ERR("Unknown child " << exitedChildPid << " has exited, with status: " << status);
@@ -417,13 +481,24 @@ static void cleanupChildren(const std::string& childRoot)
         }
     }
 
-    // Now delete the jails.
+    // Now delete the jails, unless the previous batch is still being removed.
+    if (jailRemoverPid != 0)
+        return;
+
+    std::vector<std::string> removePaths;
     auto i = cleanupJailPaths.size();
     while (i > 0)
     {
         --i;
         const std::string path = cleanupJailPaths[i];
 
+        const FileUtil::Stat st(path);
+        if (!st.good() || !st.isDirectory())
+        {
+            cleanupJailPaths.erase(cleanupJailPaths.begin() + i);
+            continue;
+        }
+
         // Don't delete jails where there was a crash until it's ~3 minutes old.
         const FileUtil::Stat noteStat(path + "/tmp/kit-crashed");
         if (noteStat.good())
@@ -433,13 +508,55 @@ static void cleanupChildren(const std::string& childRoot)
                 continue;
         }
 
-        JailUtil::tryRemoveJail(path);
-        const FileUtil::Stat st(path);
-        if (st.good() && st.isDirectory())
-            LOG_DBG("Could not remove jail path [" << path << "]. Will retry later.");
-        else
-            cleanupJailPaths.erase(cleanupJailPaths.begin() + i);
+        removePaths.push_back(path);
     }
+
+    if (removePaths.empty())
+        return;
+
+    // Removing linked/copied jails means unlinking thousands of files,
+    // so do it in a child to not delay the kits we are asked to spawn.
+    // The paths stay listed until we find them gone, to retry failures.
+    LOG_DBG("Removing " << removePaths.size() << " jails in the background");
+    jailRemoverPid = forkHelper("jailremover", [removePaths]()
+                                {
+                                    for (const auto& path : removePaths)
+                                    {
+                                        JailUtil::tryRemoveJail(path);
+                                        const FileUtil::Stat st(path);
+                                        if (st.good() && st.isDirectory())
+                                            LOG_DBG("Could not remove jail path ["
+                                                    << path << "]. Will retry later.");
+                                    }
+                                });
+}
+
+/// Keeps JailPoolSize jails ready for the kits to claim when we don't
+/// bind-mount, building the missing ones in a child.
+static void fillJailPool(const std::string& childRoot, const std::string& sysTemplate,
+                         const std::string& loTemplate)
+{
+    // Only the main forkit, while no kits are waiting, as we compete for the disk.
+    if (JailPoolSize == 0 || jailPoolBuilderPid != 0 || ForkCounter > 0 || NoCapsForKit ||
+        !ForKitIdent.empty() || JailUtil::isBindMountingEnabled() || Util::isKitInProcess())
+        return;
+
+    const std::size_t ready = JailUtil::countPooledJails(childRoot);
+    if (ready >= JailPoolSize)
+        return;
+
+    const std::size_t count = JailPoolSize - ready;
+    LOG_DBG("Building " << count << " jails for the pool of " << JailPoolSize);
+    jailPoolBuilderPid = forkHelper("jailpool",
+                                    [childRoot, sysTemplate, loTemplate, count]()
+                                    {
+                                        for (std::size_t n = 0; n < count; ++n)
+                                        {
+                                            if (!buildPooledJail(childRoot, sysTemplate,
+                                                                 loTemplate))
+                                                Util::forcedExit(EX_SOFTWARE);
+                                        }
+                                    });
 }
 
 void sleepForDebugger()
@@ -1027,6 +1144,7 @@ int forkit_main(int argc, char** argv)
         const auto conf = std::getenv("LOOL_CONFIG");
         ConfigUtil::initialize(std::string(conf ? conf : std::string()));
         EnableExperimental = ConfigUtil::getBool("experimental_features", false);
+        JailPoolSize = std::max(0, ConfigUtil::getInt("jail_pool_size", 2));
     }
 
     Util::setThreadName("forkit");
@@ -1100,6 +1218,8 @@ int forkit_main(int argc, char** argv)
                 forkLibreOfficeKit(childRoot, sysTemplate, loTemplate, useMountNamespaces);
                 // new sub forkits are launched after an 'addforkit' message
                 createSubForKits(childRoot, sysTemplate, loTemplate, useMountNamespaces);
+                // and jails are prepared for the kits to come while we are idle
+                fillJailPool(childRoot, sysTemplate, loTemplate);
             }
     }
 
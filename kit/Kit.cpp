@@ -24,6 +24,7 @@
 
 #ifdef __linux__
 #include <ftw.h>
+#include <malloc.h>
 #include <sys/vfs.h>
 #include <linux/magic.h>
 #include <sys/sysmacros.h>
@@ -59,6 +60,7 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -175,6 +177,16 @@ static std::string JailRoot;
 #if !MOBILEAPP
 static int URPtoLoFDs[2] { -1, -1 };
 static int URPfromLoFDs[2] { -1, -1 };
+
+/// Our full /proc/self/smaps, opened before chroot, to report which
+/// mappings we have un-shared from forkit.
+static FILE* ProcSMapsDetail = nullptr;
+
+/// Our /proc/self/smaps_rollup, opened before chroot, to measure what trimming released.
+static FILE* ProcSMapsRollup = nullptr;
+
+/// The host's /proc/pressure/memory, opened before chroot, to trim sooner under pressure.
+static int ProcPressureMemory = -1;
 #endif
 
 // Abnormally we get LOK events from another thread, which must be
@@ -801,9 +813,15 @@ Document::Document(const std::shared_ptr<lok::Office>& loKit, const std::string&
     , _editorId(-1)
     , _editorChangeWarning(false)
     , _lastMemTrimTime(std::chrono::steady_clock::now())
+    , _trimStage(TrimStage::None)
+    , _lastMemSharingReportTime(std::chrono::steady_clock::now())
+    , _lastCallbackDelaysReportTime(std::chrono::steady_clock::now())
+    , _drainingCallbacks(false)
     , _mobileAppDocId(mobileAppDocId)
     , _duringLoad(0)
     , _bgSavesOngoing(0)
+    , _assignedTime(std::chrono::steady_clock::now())
+    , _firstTileRendered(false)
 {
     LOG_INF("Document ctor for [" << _docKey <<
             "] url [" << anonymizeUrl(_url) << "] on child [" << _jailId <<
@@ -871,7 +889,7 @@ bool Document::postMessage(const char* data, int size, const WSOpCode code) cons
         return false;
     }
 
-    _websocketHandler->sendMessage(data, size, code, /*flush=*/true);
+    _websocketHandler->sendMessage(data, size, code, /*flush=*/!_drainingCallbacks);
     return true;
 }
 
@@ -1041,6 +1059,19 @@ void Document::renderTiles(TileCombined &tileCombined)
         LOG_DBG("All tiles skipped, not producing empty tilecombine: message");
         return;
     }
+
+    if (!_firstTileRendered)
+    {
+        _firstTileRendered = true;
+
+        const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - _assignedTime);
+        const std::string type = LOKitHelper::documentTypeToString(
+            static_cast<LibreOfficeKitDocumentType>(_loKitDocument->getDocumentType()));
+        LOG_INF("First tile of " << type << " document [" << _docKey << "] rendered " << duration
+                                 << " after kit assignment");
+        sendTextFrame("firsttile: type=" + type + " duration=" + std::to_string(duration.count()));
+    }
 }
 
 bool Document::sendFrame(const char* buffer, int length, WSOpCode opCode)
@@ -1098,21 +1129,108 @@ void Document::trimIfInactive()
     SigUtil::addActivity("trimIfInactive");
     _loKit->trimMemory(4096);
     _deltaGen->dropCache();
+    // Only the heap is left to trim if we stay idle.
+    _trimStage = TrimStage::CoreCaches;
+    _lastMemTrimTime = std::chrono::steady_clock::now();
     // Inform docbroker that document has (deep) trimmed memory
     sendTextFrame("memorytrimmed:");
 }
 
+namespace
+{
+/// The idle time after which each Document::TrimStage runs, in order.
+constexpr std::chrono::seconds TrimStageIdleTime[] = {
+    std::chrono::seconds(0), std::chrono::seconds(10), std::chrono::seconds(30),
+    std::chrono::seconds(60), std::chrono::seconds(300)
+};
+
+/// The minimum time between two trims of Core or the heap, even under pressure.
+constexpr std::chrono::seconds MinCoreTrimInterval = std::chrono::seconds(30);
+
+/// Under host memory pressure the stages run this many times sooner.
+constexpr int TrimPressureSpeedup = 4;
+
+/// The "some avg10" memory PSI, in percents, that we consider pressure.
+constexpr int TrimPressurePercent = 10;
+
+const char* trimStageName(Document::TrimStage stage)
+{
+    switch (stage)
+    {
+        case Document::TrimStage::None:
+            return "none";
+        case Document::TrimStage::OffscreenDeltas:
+            return "offscreen_deltas";
+        case Document::TrimStage::Deltas:
+            return "deltas";
+        case Document::TrimStage::CoreCaches:
+            return "core_caches";
+        case Document::TrimStage::Heap:
+            return "heap";
+    }
+
+    return "unknown";
+}
+
+/// Our Private_Dirty in KB, to measure what the trimming of Core and the heap released.
+std::size_t getPrivateDirtyKb()
+{
+#if !MOBILEAPP
+    // The rollup is a single record; the full smaps lists every mapping.
+    return Util::getPssAndDirtyFromSMaps(ProcSMapsRollup ? ProcSMapsRollup : ProcSMapsDetail)
+        .second;
+#else
+    return 0;
+#endif
+}
+} // namespace
+
+std::size_t Document::trimMemory(TrimStage stage)
+{
+    switch (stage)
+    {
+        case TrimStage::None:
+            return 0;
+        case TrimStage::OffscreenDeltas:
+        {
+            std::set<int> parts;
+            for (const auto& it : _sessions)
+                parts.insert(it.second->getCurrentPart());
+            return _deltaGen->dropCacheExceptParts(parts);
+        }
+        case TrimStage::Deltas:
+        {
+            const std::size_t size = _deltaGen->getCacheSize();
+            _deltaGen->dropCache();
+            return size;
+        }
+        case TrimStage::CoreCaches:
+        case TrimStage::Heap:
+            break;
+    }
+
+    const std::size_t dirtyKb = getPrivateDirtyKb();
+    if (stage == TrimStage::CoreCaches)
+        _loKit->trimMemory(1024);
+#if defined(M_TRIM_THRESHOLD)
+    else
+        malloc_trim(0);
+#endif
+    const std::size_t trimmedDirtyKb = getPrivateDirtyKb();
+    return trimmedDirtyKb < dirtyKb ? (dirtyKb - trimmedDirtyKb) * 1024 : 0;
+}
+
 void Document::trimAfterInactivity()
 {
     // Don't perturb memory un-necessarily
     if (_isBgSaveProcess || _bgSavesOngoing)
         return;
 
-    if (std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() -
-                                                         _lastMemTrimTime) < std::chrono::seconds(30))
-    {
+    const auto now = std::chrono::steady_clock::now();
+    const auto sinceLastTrim =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - _lastMemTrimTime);
+    if (sinceLastTrim < std::chrono::seconds(10))
         return;
-    }
 
     // If a deep trim was missed due to an ongoing bg save then enable that to happen now.
     if (_trimIfInactivePostponed)
@@ -1128,14 +1246,129 @@ void Document::trimAfterInactivity()
         minInactivityMs = std::min(it.second->getInactivityMS(), minInactivityMs);
     }
 
-    if (minInactivityMs >= 9999)
+    const std::chrono::milliseconds inactivity(
+        static_cast<int64_t>(std::min<double>(minInactivityMs, std::numeric_limits<int32_t>::max())));
+
+    // Someone was active since we last trimmed, start over.
+    if (inactivity < sinceLastTrim)
+        _trimStage = TrimStage::None;
+
+    if (_trimStage == TrimStage::Heap)
+        return;
+
+    const TrimStage stage = static_cast<TrimStage>(static_cast<int>(_trimStage) + 1);
+    const std::chrono::milliseconds idleTime = TrimStageIdleTime[static_cast<int>(stage)];
+    if (inactivity < idleTime / TrimPressureSpeedup)
+        return;
+
+    // Trimming Core and the heap is costly, and slows down the next edit.
+    if (stage >= TrimStage::CoreCaches && sinceLastTrim < MinCoreTrimInterval)
+        return;
+
+    if (inactivity < idleTime)
     {
-        LOG_DBG("Trimming Core caches");
-        SigUtil::addActivity("trimAfterInactivity");
-        _loKit->trimMemory(1024);
+#if !MOBILEAPP
+        // Not idle enough yet, unless the host is short of memory.
+        if (ProcPressureMemory < 0 || now - _lastMemPressureCheckTime < std::chrono::seconds(2))
+            return;
 
-        _lastMemTrimTime = std::chrono::steady_clock::now();
+        _lastMemPressureCheckTime = now;
+        const int pressure = Util::getPressureSomeAvg10(ProcPressureMemory);
+        if (pressure < TrimPressurePercent)
+            return;
+
+        LOG_DBG("Memory pressure at " << pressure << "%, trimming sooner");
+#else
+        return;
+#endif
+    }
+
+    SigUtil::addActivity("trimAfterInactivity");
+    const std::size_t released = trimMemory(stage);
+    LOG_DBG("Trimmed " << trimStageName(stage) << " after " << inactivity << " idle, released "
+                       << released << " bytes");
+
+    _trimStage = stage;
+    _lastMemTrimTime = std::chrono::steady_clock::now();
+
+    sendTextFrame(std::string("trimmed: stage=") + trimStageName(stage) +
+                  " released=" + std::to_string(released));
+}
+
+void Document::reportMemorySharing()
+{
+#if !MOBILEAPP
+    static const std::chrono::seconds interval(
+        ConfigUtil::getInt("per_document.memory_sharing_report_secs", 300));
+    if (!ProcSMapsDetail || interval.count() <= 0 || _isBgSaveProcess)
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _lastMemSharingReportTime < interval)
+        return;
+
+    _lastMemSharingReportTime = now;
+
+    // Only report the biggest copy-on-write breakers.
+    constexpr std::size_t MaxMappings = 10;
+
+    std::size_t sharedKb = 0;
+    std::size_t unsharedKb = 0;
+    std::vector<std::pair<std::size_t, std::string>> unshared;
+    for (const auto& [name, memory] : Util::getMemoryByMappingFromSMaps(ProcSMapsDetail))
+    {
+        sharedKb += memory._sharedKb;
+        unsharedKb += memory._privateDirtyKb;
+        if (memory._privateDirtyKb > 0)
+            unshared.emplace_back(memory._privateDirtyKb, name);
+    }
+
+    const std::size_t count = std::min(unshared.size(), MaxMappings);
+    std::partial_sort(unshared.begin(), unshared.begin() + count, unshared.end(),
+                      std::greater<>());
+
+    std::ostringstream oss;
+    oss << "memsharing: shared=" << sharedKb << " unshared=" << unsharedKb << " top=";
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        // Neither spaces nor our separators in the names.
+        std::string name = unshared[i].second;
+        std::replace_if(name.begin(), name.end(),
+                        [](char c) { return c == ' ' || c == ',' || c == ':'; }, '_');
+        oss << (i ? "," : "") << name << ':' << unshared[i].first;
     }
+
+    LOG_DBG("Reporting " << oss.str());
+    sendTextFrame(oss.str());
+#endif
+}
+
+void Document::reportCallbackDelays()
+{
+#if !MOBILEAPP
+    static const std::chrono::seconds interval(
+        ConfigUtil::getInt("per_document.callback_delays_report_secs", 60));
+    if (interval.count() <= 0 || _isBgSaveProcess)
+    {
+        _callbackDelays.clear();
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - _lastCallbackDelaysReportTime < interval)
+        return;
+
+    _lastCallbackDelaysReportTime = now;
+
+    // WSD adds them up, so only what was collected since the last report is sent.
+    for (const auto& [type, histogram] : _callbackDelays)
+    {
+        sendTextFrame(std::string("callbackdelays: type=") + lokCallbackTypeToString(type) +
+                      " histogram=" + histogram.serialize());
+    }
+
+    _callbackDelays.clear();
+#endif
 }
 
 /* static */ void Document::GlobalCallback(const int type, const char* p, void* data)
@@ -2071,7 +2304,10 @@ std::shared_ptr<lok::Document> Document::load(const std::shared_ptr<ChildSession
         const char* pURL = loadUri.c_str();
         LOG_DBG("Calling lokit::documentLoad(" << anonymizeUrl(pURL) << ", \"" << options << "\")");
         const auto start = std::chrono::steady_clock::now();
-        _loKitDocument.reset(_loKit->documentLoad(pURL, options.c_str()));
+        {
+            ProfileZone profileZone("lokit::documentLoad");
+            _loKitDocument.reset(_loKit->documentLoad(pURL, options.c_str()));
+        }
 #ifdef __ANDROID__
         _loKitDocumentForAndroidOnly = _loKitDocument;
         {
@@ -2127,6 +2363,9 @@ std::shared_ptr<lok::Document> Document::load(const std::shared_ptr<ChildSession
             return nullptr;
         }
 
+        sendTextFrame("loadphase: name=documentload duration=" +
+                      std::to_string(elapsed.count()));
+
         // Only save the options on opening the document.
         // No support for changing them after opening a document.
         _renderOpts = renderOpts;
@@ -2473,10 +2712,31 @@ bool Document::processInputEnabled() const
 
 void Document::drainCallbacks()
 {
+    // Bursts of callbacks, from a paste or a recalculation, mustn't hold up the
+    // tiles: after this much, drainQueue renders the urgent ones and we resume next time.
+    static const std::chrono::milliseconds budget(
+        ConfigUtil::getInt("per_document.callback_drain_budget_ms", 10));
+
     KitQueue::Callback cb;
 
     LOG_TRC("drainCallbacks with " << _queue->callbackSize() << " items");
 
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t drained = 0;
+
+    // One write for all the frames, rather than one per callback.
+    // Reset even when a callback throws, or every later frame would go unflushed.
+    struct DrainingGuard
+    {
+        bool& _draining;
+        DrainingGuard(bool& draining)
+            : _draining(draining)
+        {
+            _draining = true;
+        }
+        ~DrainingGuard() { _draining = false; }
+    } drainingGuard(_drainingCallbacks);
+
     while (_queue && _queue->getCallback(cb))
     {
         if (_stop || SigUtil::getTerminationFlag())
@@ -2487,6 +2747,9 @@ void Document::drainCallbacks()
 
         LOG_TRC("Kit handling callback " << cb);
 
+        _callbackDelays[cb._type].add(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - cb._queued));
+
         int viewId = cb._view;
         bool broadcast = cb._view == -1;
 
@@ -2524,12 +2787,40 @@ void Document::drainCallbacks()
                     "] is no longer active to process [" << lokCallbackTypeToString(type) <<
                     "] [" << LOOLProtocol::getAbbreviatedMessage(payload) <<
                     "] message to Master Session.");
+
+        ++drained;
+        if (budget.count() > 0 && std::chrono::steady_clock::now() - start >= budget &&
+            hasCallbacks())
+        {
+            LOG_DBG("drainCallbacks used its " << budget << " budget in " << drained
+                                               << " callbacks, " << _queue->callbackSize()
+                                               << " left for the next iteration");
+            break;
+        }
     }
 
     if (_websocketHandler)
         _websocketHandler->flush();
 }
 
+std::chrono::microseconds Document::getTextInputHold() const
+{
+    static const std::chrono::microseconds window(
+        std::chrono::milliseconds(ConfigUtil::getInt("per_document.text_input_batch_ms", 5)));
+
+    // Not when tiles are wanted: they would be rendered without it.
+    if (window.count() <= 0 || !_queue || !_queue->isTileQueueEmpty())
+        return std::chrono::microseconds::zero();
+
+    const auto queued = _queue->getLoneTextInputTime();
+    if (queued == std::chrono::steady_clock::time_point())
+        return std::chrono::microseconds::zero();
+
+    const auto held = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - queued);
+    return held < window ? window - held : std::chrono::microseconds::zero();
+}
+
 void Document::drainQueue()
 {
     if (UnitKit::get().filterDrainQueue())
@@ -2558,11 +2849,17 @@ void Document::drainQueue()
                 break;
             }
 
+            if (getTextInputHold().count() > 0)
+            {
+                LOG_TRC("Holding the text input back to merge what is typed next");
+                break;
+            }
+
             const KitQueue::Payload input = _queue->pop();
 
             LOG_TRC("Kit handling queue message: " << LOOLProtocol::getAbbreviatedMessage(input));
 
-            const StringVector tokens = StringVector::tokenize(input.data(), input.size());
+            const StringVector tokens = StringVector::tokenizeView(input.data(), input.size());
 
             if (tokens.equals(0, "eof"))
             {
@@ -3058,6 +3355,13 @@ int KitSocketPoll::kitPoll(int timeoutMicroS)
             int realTimeout = timeoutMicroS;
             if (_document && _document->needsQuickPoll())
                 realTimeout = 0;
+            else if (_document)
+            {
+                // Wake up when the text input held back is due.
+                const std::chrono::microseconds hold = _document->getTextInputHold();
+                if (hold.count() > 0)
+                    realTimeout = std::min<std::int64_t>(realTimeout, hold.count());
+            }
 
             if (poll(std::chrono::microseconds(realTimeout)) <= 0)
                 break;
@@ -3074,7 +3378,11 @@ int KitSocketPoll::kitPoll(int timeoutMicroS)
     drainQueue();
 
     if (_document)
+    {
         _document->trimAfterInactivity();
+        _document->reportMemorySharing();
+        _document->reportCallbackDelays();
+    }
 
     if constexpr (!Util::isMobileApp())
     {
@@ -3307,6 +3615,53 @@ void copyCertificateDatabaseToTmp(Poco::Path const& jailPath)
 
 } // namespace
 
+#if !MOBILEAPP
+
+bool buildPooledJail(const std::string& childRoot, const std::string& sysTemplate,
+                     const std::string& loTemplate)
+{
+    const std::string poolPath = childRoot + JailUtil::CHILDROOT_JAIL_POOL_PATH;
+    const std::string jailId = Util::rng::getFilename(16);
+
+    // Build under a hidden name, so that no kit can claim a partial jail.
+    const std::string buildPath = poolPath + "/." + jailId;
+    const std::string readyPath = poolPath + '/' + jailId;
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+        JailUtil::createJailPath(buildPath);
+        JailUtil::markJailCopied(buildPath);
+
+        const Poco::Path jailPath = Poco::Path::forDirectory(buildPath);
+        Poco::Path jailLOInstallation(jailPath, JailUtil::LO_JAIL_SUBPATH);
+        jailLOInstallation.makeDirectory();
+
+        const std::string linkablePath = childRoot + "/linkable";
+        linkOrCopy(sysTemplate, jailPath, linkablePath, LinkOrCopyType::All);
+        linkOrCopy(loTemplate, jailLOInstallation.toString(), linkablePath, LinkOrCopyType::LO);
+
+        if (::rename(buildPath.c_str(), readyPath.c_str()) != 0)
+        {
+            LOG_SYS("Failed to rename pooled jail [" << buildPath << "] to [" << readyPath << ']');
+            JailUtil::tryRemoveJail(buildPath);
+            return false;
+        }
+    }
+    catch (const std::exception& exc)
+    {
+        LOG_ERR("Failed to build pooled jail [" << buildPath << "]: " << exc.what());
+        JailUtil::tryRemoveJail(buildPath);
+        return false;
+    }
+
+    LOG_DBG("Built pooled jail [" << readyPath << "] in "
+                                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         std::chrono::steady_clock::now() - start));
+    return true;
+}
+
+#endif // !MOBILEAPP
+
 void lokit_main(
 #if !MOBILEAPP
                 const std::string& childRoot,
@@ -3415,6 +3770,15 @@ void lokit_main(
 
         // initialize while we have access to /proc/self/task
         threadCounter.reset(new Util::ThreadCounter());
+        // and to /proc/self/smaps
+        ProcSMapsDetail = fopen("/proc/self/smaps", "r");
+        if (!ProcSMapsDetail)
+            LOG_SYS("Failed to open /proc/self/smaps. Memory sharing will not be reported.");
+        // and to /proc/self/smaps_rollup, unless it is unreliable here
+        if (!std::getenv("LOOL_DISABLE_SMAPS_ROLLUP"))
+            ProcSMapsRollup = fopen("/proc/self/smaps_rollup", "r");
+        // and to /proc/pressure, which older kernels don't have
+        ProcPressureMemory = open("/proc/pressure/memory", O_RDONLY | O_CLOEXEC);
 #ifdef FDCOUNTER_USABLE
         // initialize while we have access to /proc/self/fd
         fdCounter.reset(new Util::FDCounter());
@@ -3422,6 +3786,7 @@ void lokit_main(
 
         bool usingMountNamespace = false;
         std::chrono::milliseconds jailSetupTime(0);
+        std::string jailSetupMethod;
 
         if (!ChildSession::NoCapsForKit)
         {
@@ -3603,7 +3968,8 @@ void lokit_main(
                     bindMount = false;
                     JailUtil::disableBindMounting();
                 }
-
+                else
+                    jailSetupMethod = "mounted";
             }
 
 #ifndef __FreeBSD__
@@ -3645,14 +4011,22 @@ void lokit_main(
                 // Make sure we have the jail directory.
                 JailUtil::createJailPath(jailPathStr);
 
-                // Create a file to mark this a copied jail.
-                JailUtil::markJailCopied(jailPathStr);
-
                 const std::string linkablePath = childRoot + "/linkable";
 
-                linkOrCopy(sysTemplate, jailPath, linkablePath, LinkOrCopyType::All);
+                // Take a jail that forkit prepared in the background, if one is ready.
+                if (JailUtil::claimPooledJail(childRoot, jailPathStr))
+                    jailSetupMethod = "pooled";
+                else
+                {
+                    jailSetupMethod = "copied";
+
+                    // Create a file to mark this a copied jail.
+                    JailUtil::markJailCopied(jailPathStr);
+
+                    linkOrCopy(sysTemplate, jailPath, linkablePath, LinkOrCopyType::All);
 
-                linkOrCopy(loTemplate, loJailDestPath, linkablePath, LinkOrCopyType::LO);
+                    linkOrCopy(loTemplate, loJailDestPath, linkablePath, LinkOrCopyType::LO);
+                }
 
                 if (!configId.empty())
                     linkOrCopy(sharedTemplate, loJailDestImpressTemplatePath + "/", linkablePath,
@@ -3856,6 +4230,11 @@ void lokit_main(
             pathAndQuery.append("&configid=");
             pathAndQuery.append(configId);
         }
+        if (!jailSetupMethod.empty())
+        {
+            pathAndQuery.append("&jailsetup=");
+            pathAndQuery.append(jailSetupMethod);
+        }
         if (queryVersion)
         {
             char* versionInfo = loKit->getVersionInfo();
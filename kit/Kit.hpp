@@ -13,6 +13,7 @@
 #include <map>
 #include <string>
 
+#include <common/Histogram.hpp>
 #include <common/Util.hpp>
 #include <common/StateEnum.hpp>
 #include <common/Session.hpp>
@@ -46,6 +47,13 @@ void lokit_main(
 #endif
     std::size_t numericIdentifier);
 
+#if !MOBILEAPP
+/// Links/copies the templates into a new jail in the pool of the child-root,
+/// for a kit to claim later. Called in a child of forkit, off the spawn path.
+bool buildPooledJail(const std::string& childRoot, const std::string& sysTemplate,
+                     const std::string& loTemplate);
+#endif
+
 #ifdef IOS
 void runKitLoopInAThread();
 #endif
@@ -254,6 +262,22 @@ public:
     void trimIfInactive();
     void trimAfterInactivity();
 
+    /// Periodically report which mappings un-shared the most memory from forkit.
+    void reportMemorySharing();
+
+    /// Periodically report how long the callbacks waited in the queue, by type.
+    void reportCallbackDelays();
+
+    /// The progressively deeper stages of trimming memory while idle.
+    enum class TrimStage : std::uint8_t
+    {
+        None,
+        OffscreenDeltas, ///< The cached deltas of the parts no view shows.
+        Deltas, ///< All the cached deltas.
+        CoreCaches, ///< Core's own caches.
+        Heap ///< Free heap pages back to the OS.
+    };
+
     // LibreOfficeKit callback entry points
     static void GlobalCallback(const int type, const char* p, void* data);
     static void ViewCallback(const int type, const char* p, void* data);
@@ -268,6 +292,9 @@ private:
     /// Cleanup bgSave child processes.
     static void reapZombieChildren();
 
+    /// Runs one trim stage, returns the bytes it released.
+    std::size_t trimMemory(TrimStage stage);
+
     /// Calculate tile rendering priority from a TileDesc
     virtual Priority getTilePriority(const TileDesc &desc) const override;
     virtual std::vector<ViewIdInactivity> getViewIdsByInactivity() const override;
@@ -389,11 +416,16 @@ public:
         // not processing input messages or tile renders
         if (!processInputEnabled())
             return false;
-        if (hasQueueItems() || canRenderTiles())
+        if ((hasQueueItems() && getTextInputHold().count() == 0) || canRenderTiles())
             return true;
         return false;
     }
 
+    /// How much longer the text input alone in the queue is held back, so that
+    /// the next characters typed are merged into it and rendered together; zero
+    /// when it is due, or when there is none.
+    std::chrono::microseconds getTextInputHold() const;
+
     void drainQueue();
     void drainCallbacks();
 
@@ -507,6 +539,24 @@ private:
     /// The timestamp of the last memory trimming.
     std::chrono::steady_clock::time_point _lastMemTrimTime;
 
+    /// The last trim stage done since the views went idle.
+    TrimStage _trimStage;
+
+    /// When we last checked the host memory pressure.
+    std::chrono::steady_clock::time_point _lastMemPressureCheckTime;
+
+    /// The timestamp of the last memory sharing report.
+    std::chrono::steady_clock::time_point _lastMemSharingReportTime;
+
+    /// How long the callbacks waited in the queue since the last report, by type.
+    std::map<int, DelayHistogram> _callbackDelays;
+
+    /// The timestamp of the last callback delays report.
+    std::chrono::steady_clock::time_point _lastCallbackDelaysReportTime;
+
+    /// While draining the callbacks, their frames are written out together at the end.
+    bool _drainingCallbacks;
+
     std::map<int, std::chrono::steady_clock::time_point> _lastUpdatedAt;
     std::map<int, int> _speedCount;
     /// For showing disconnected user info in the doc repair dialog.
@@ -520,6 +570,10 @@ private:
     int _duringLoad;
     int _bgSavesOngoing;
 
+    /// When we were assigned our document, to report the time to the first tile.
+    const std::chrono::steady_clock::time_point _assignedTime;
+    bool _firstTileRendered;
+
     LogUiCmd logUiCmd;
 };
 
@@ -19,6 +19,7 @@
 #include <iostream>
 
 #include "JsonUtil.hpp"
+#include "Rectangle.hpp"
 
 /* static */ std::string KitQueue::Callback::toString(int view, int type,
                                                       const std::string& payload)
@@ -73,7 +74,7 @@ void KitQueue::put(const Payload& value)
 
     else if (textItem(value, firstToken, removeText))
     {
-        StringVector tokens = StringVector::tokenize(value.data(), value.size());
+        StringVector tokens = StringVector::tokenizeView(value.data(), value.size());
 
         std::string newMsg = !removeText ? combineTextInput(tokens)
             : combineRemoveText(tokens);
@@ -82,9 +83,16 @@ void KitQueue::put(const Payload& value)
             _queue.emplace_back(newMsg.data(), newMsg.data() + newMsg.size());
         else
             _queue.emplace_back(value);
+
+        // Merged, it waits since its first part was queued.
+        if (newMsg.empty() || _textInputTime == std::chrono::steady_clock::time_point())
+            _textInputTime = std::chrono::steady_clock::now();
     }
     else // not so special
+    {
         _queue.emplace_back(value);
+        _textInputTime = std::chrono::steady_clock::time_point();
+    }
 }
 
 std::vector<TileDesc>* KitQueue::getTileQueue(CanonicalViewId viewid)
@@ -166,222 +174,363 @@ bool extractRectangle(const StringVector& tokens, int& x, int& y, int& w, int& h
 }
 
 void KitQueue::putCallback(int view, int type, const std::string &payload)
-{
-    if (!elideDuplicateCallback(view, type, payload))
-        _callbacks.emplace_back(view, type, payload);
-}
-
-bool KitQueue::elideDuplicateCallback(int view, int type, const std::string &payload)
 {
     const auto callbackType = static_cast<LibreOfficeKitCallbackType>(type);
-
-    // Nothing to combine in this case:
-    if (_callbacks.size() == 0)
-        return false;
-
     switch (callbackType)
     {
         case LOK_CALLBACK_INVALIDATE_TILES: // invalidation
-        {
-            StringVector tokens = StringVector::tokenize(payload);
+            putInvalidation(view, type, payload);
+            return;
 
-            int msgX, msgY, msgW, msgH, msgPart, msgMode;
-            if (!extractRectangle(tokens, msgX, msgY, msgW, msgH, msgPart, msgMode))
-                return false;
+        case LOK_CALLBACK_STATE_CHANGED: // state changed
+        {
+            const std::string unoCommand = extractUnoCommand(payload);
 
-            bool performedMerge = false;
+            // ModifiedStatus is needed because otherwise it creates some problems when
+            // a save occurs while a cell is still edited in Calc.
+            // Only a state with a value makes the later ones of the same command obsolete.
+            if (unoCommand.empty() || unoCommand == ".uno:ModifiedStatus")
+                break;
 
-            // we always travel the entire queue
-            std::size_t i = 0;
-            while (i < _callbacks.size())
+            if (payload.size() <= unoCommand.size() || payload[unoCommand.size()] != '=')
             {
-                auto& it = _callbacks[i];
-
-                if (it._type != type || it._view != view)
+                // Can't be superseded, but supersedes.
+                const auto it = _supersedable.find({ type, view, unoCommand });
+                const QueuedCallback* queued =
+                    (it != _supersedable.end() ? findCallback(it->second) : nullptr);
+                if (queued)
                 {
-                    ++i;
-                    continue;
+                    LOG_TRC("Remove obsolete uno command: " << queued->_callback << " -> "
+                            << Callback::toString(view, type, payload));
+                    elideCallback(it->second);
                 }
-                StringVector queuedTokens = StringVector::tokenize(it._payload);
+                break;
+            }
 
-                int queuedX, queuedY, queuedW, queuedH, queuedPart, queuedMode;
+            putSupersedingCallback({ type, view, unoCommand }, view, type, payload);
+            return;
+        }
 
-                if (!extractRectangle(queuedTokens, queuedX, queuedY, queuedW, queuedH, queuedPart, queuedMode))
-                {
-                    ++i;
-                    continue;
-                }
+        case LOK_CALLBACK_INVALIDATE_VISIBLE_CURSOR: // the cursor has moved
+        case LOK_CALLBACK_CURSOR_VISIBLE: // the cursor visibility has changed
+        case LOK_CALLBACK_STATUS_INDICATOR_SET_VALUE: // setting the indicator value
+        case LOK_CALLBACK_DOCUMENT_SIZE_CHANGED: // setting the document size
+        case LOK_CALLBACK_CELL_CURSOR: // the cell cursor has moved
+            putSupersedingCallback({ type, view, std::string() }, view, type, payload);
+            return;
 
-                if (msgPart != queuedPart)
-                {
-                    ++i;
-                    continue;
-                }
+        case LOK_CALLBACK_INVALIDATE_VIEW_CURSOR: // the view cursor has moved
+        case LOK_CALLBACK_CELL_VIEW_CURSOR: // the view cell cursor has moved
+        case LOK_CALLBACK_VIEW_CURSOR_VISIBLE: // the view cursor visibility has changed
+            // These are about another view, which we must not merge with the rest.
+            putSupersedingCallback({ type, view, extractViewId(payload) }, view, type, payload);
+            return;
 
-                if (msgMode != queuedMode)
-                {
-                    ++i;
-                    continue;
-                }
+        default:
+            break;
+    }
 
-                // the invalidation in the queue is fully covered by the payload,
-                // just remove it
-                if (msgX <= queuedX && queuedX + queuedW <= msgX + msgW && msgY <= queuedY
-                    && queuedY + queuedH <= msgY + msgH)
-                {
-                    LOG_TRC("Removing smaller invalidation: "
-                            << it._payload << " -> " << ' ' << msgX << ' ' << msgY << ' '
-                            << msgW << ' ' << msgH << ' ' << msgPart << ' ' << msgMode);
+    pushCallback(view, type, payload);
+}
 
-                    // remove from the queue
-                    _callbacks.erase(_callbacks.begin() + i);
-                    continue;
-                }
+std::uint64_t KitQueue::pushCallback(int view, int type, const std::string& payload)
+{
+    _callbacks.push_back(QueuedCallback{ Callback(view, type, payload), false, 0, 0, 0, 0 });
+    _callbacks.back()._callback._queued = std::chrono::steady_clock::now();
+    ++_callbackCount;
+    return _callbacksFront + _callbacks.size() - 1;
+}
 
-                // the invalidation just intersects, join those (if the result is
-                // small)
-                if (TileDesc::rectanglesIntersect(msgX, msgY, msgW, msgH, queuedX, queuedY, queuedW,
-                                                  queuedH))
-                {
-                    int joinX = std::min(msgX, queuedX);
-                    int joinY = std::min(msgY, queuedY);
-                    int joinW = std::max(msgX + msgW, queuedX + queuedW) - joinX;
-                    int joinH = std::max(msgY + msgH, queuedY + queuedH) - joinY;
-
-                    const int reasonableSizeX = 4 * 3840; // 4x tile at 100% zoom
-                    const int reasonableSizeY = 2 * 3840; // 2x tile at 100% zoom
-                    if (joinW > reasonableSizeX || joinH > reasonableSizeY)
-                    {
-                        ++i;
-                        continue;
-                    }
-
-                    LOG_TRC("Merging invalidations: "
-                            << Callback::toString(view, type, payload) << " and "
-                            << tokens[0] << ' ' << tokens[1] << ' ' << tokens[2] << ' '
-                            << msgX << ' ' << msgY << ' ' << msgW << ' ' << msgH << ' '
-                            << msgPart << ' ' << msgMode << " -> "
-                            << tokens[0] << ' ' << tokens[1] << ' ' << tokens[2] << ' '
-                            << joinX << ' ' << joinY << ' ' << joinW << ' ' << joinH << ' '
-                            << msgPart << ' ' << msgMode);
-
-                    msgX = joinX;
-                    msgY = joinY;
-                    msgW = joinW;
-                    msgH = joinH;
-                    performedMerge = true;
-
-                    // remove from the queue
-                    _callbacks.erase(_callbacks.begin() + i);
-                    continue;
-                }
+KitQueue::QueuedCallback* KitQueue::findCallback(std::uint64_t seq)
+{
+    if (seq < _callbacksFront || seq - _callbacksFront >= _callbacks.size())
+        return nullptr;
 
-                ++i;
-            }
+    QueuedCallback& queued = _callbacks[seq - _callbacksFront];
+    return queued._elided ? nullptr : &queued;
+}
 
-            if (performedMerge)
-            {
-                std::string newPayload =
-                    std::to_string(msgX) + ", " + std::to_string(msgY) + ", " +
-                    std::to_string(msgW) + ", " + std::to_string(msgH) + ", " +
-                    tokens.cat(' ', 4); // part etc. ...
+void KitQueue::elideCallback(std::uint64_t seq)
+{
+    QueuedCallback* queued = findCallback(seq);
+    assert(queued && "Eliding a callback that is not queued");
+    queued->_elided = true;
+    queued->_callback._payload.clear();
+    --_callbackCount;
+}
 
-                LOG_TRC("Merge result: " << newPayload);
+bool KitQueue::getCallback(Callback &callback)
+{
+    while (!_callbacks.empty())
+    {
+        QueuedCallback& front = _callbacks.front();
+        const bool elided = front._elided;
+        if (!elided)
+            callback = std::move(front._callback);
 
-                _callbacks.emplace_back(view, type, newPayload);
-                return true; // elide the original - use this instead
-            }
+        _callbacks.pop_front();
+        ++_callbacksFront;
+
+        if (!elided)
+        {
+            --_callbackCount;
+            if (_callbackCount == 0)
+                clearCallbacks(); // Drop the trailing elided ones and the indexes.
+            return true;
         }
-        break;
+    }
 
-        case LOK_CALLBACK_STATE_CHANGED: // state changed
+    return false;
+}
+
+void KitQueue::clearCallbacks()
+{
+    _callbacksFront += _callbacks.size();
+    _callbacks.clear();
+    _callbackCount = 0;
+    _invalidations.clear();
+    _supersedable.clear();
+}
+
+void KitQueue::putSupersedingCallback(std::tuple<int, int, std::string> key, int view, int type,
+                                      const std::string& payload)
+{
+    const auto it = _supersedable.find(key);
+    if (it != _supersedable.end())
+    {
+        if (QueuedCallback* queued = findCallback(it->second))
         {
-            std::string unoCommand = extractUnoCommand(payload);
-            if (unoCommand.empty())
-                return false;
+            LOG_TRC("Remove obsolete callback: " << queued->_callback << " -> "
+                    << Callback::toString(view, type, payload));
+            elideCallback(it->second);
+        }
+    }
 
-            // This is needed because otherwise it creates some problems when
-            // a save occurs while a cell is still edited in Calc.
-            if (unoCommand == ".uno:ModifiedStatus")
-                return false;
+    _supersedable.insert_or_assign(std::move(key), pushCallback(view, type, payload));
+}
 
-            // remove obsolete states of the same .uno: command
-            size_t unoCommandLen = unoCommand.size();
-            for (size_t i = 0; i < _callbacks.size(); ++i)
-            {
-                Callback& it = _callbacks[i];
-                if (it._type != type || it._view != view)
-                    continue;
-
-                size_t payloadLen = it._payload.size();
-                if (payloadLen < unoCommandLen + 1 ||
-                    unoCommand.compare(0, unoCommandLen, it._payload) != 0 ||
-                    it._payload[unoCommandLen] != '=')
-                    continue;
-
-                LOG_TRC("Remove obsolete uno command: " << it << " -> "
-                        << Callback::toString(view, type, payload));
-                _callbacks.erase(_callbacks.begin() + i);
-                break;
-            }
+namespace
+{
+/// Joined invalidations must stay within this size.
+constexpr int ReasonableSizeX = 4 * 3840; // 4x tile at 100% zoom
+constexpr int ReasonableSizeY = 2 * 3840; // 2x tile at 100% zoom
+
+/// The size of the cells of the InvalidationGrid, and the most cells
+/// that a rectangle is filed under in each direction.
+constexpr std::int64_t InvalidationCellSize = 7680;
+constexpr int MaxInvalidationCells = 8;
+/// The wildcard row or column of the InvalidationGrid.
+constexpr int AnyCell = INT_MAX;
+
+/// The first and last cells of the [from, to] span.
+std::pair<int, int> cellSpan(std::int64_t from, std::int64_t to)
+{
+    const auto cell = [](std::int64_t value)
+    {
+        const std::int64_t floor = value / InvalidationCellSize -
+                                   (value % InvalidationCellSize < 0 ? 1 : 0);
+        return static_cast<int>(std::clamp<std::int64_t>(floor, INT_MIN, AnyCell - 1));
+    };
+
+    return { cell(from), cell(to) };
+}
+
+/// Visits the cells of the grid in rows [firstRow, lastRow] and columns
+/// [firstColumn, lastColumn], plus the wildcard column of those rows.
+template <typename Visit>
+void visitCells(std::map<std::pair<int, int>, std::vector<std::uint64_t>>& grid, int firstRow,
+                int lastRow, int firstColumn, int lastColumn, const Visit& visit)
+{
+    auto it = grid.lower_bound({ firstRow, firstColumn });
+    while (it != grid.end() && it->first.first <= lastRow)
+    {
+        const auto [row, column] = it->first;
+        if (column < firstColumn)
+            it = grid.lower_bound({ row, firstColumn });
+        else if (column > lastColumn && column != AnyCell)
+            it = grid.lower_bound({ row, AnyCell });
+        else
+            it = visit(it);
+    }
+}
+} // namespace
+
+void KitQueue::putInvalidation(int view, int type, const std::string& payload)
+{
+    StringVector tokens = StringVector::tokenize(payload);
+
+    int msgX, msgY, msgW, msgH, msgPart, msgMode;
+    if (!extractRectangle(tokens, msgX, msgY, msgW, msgH, msgPart, msgMode))
+    {
+        pushCallback(view, type, payload);
+        return;
+    }
+
+    InvalidationGrid& grid = _invalidations[{ view, msgPart, msgMode }];
+
+    // Merging grows the rectangle up to the reasonable size only, so nothing
+    // queued beyond that distance can be covered by it, or be merged into it.
+    std::pair<int, int> rows = cellSpan(std::int64_t(msgY) - ReasonableSizeY - 1,
+                                        std::int64_t(msgY) + msgH + ReasonableSizeY + 1);
+    std::pair<int, int> columns = cellSpan(std::int64_t(msgX) - ReasonableSizeX - 1,
+                                           std::int64_t(msgX) + msgW + ReasonableSizeX + 1);
+    if (msgW < 0 || msgH < 0)
+    {
+        // Bogus; visit everything.
+        rows = { INT_MIN, AnyCell - 1 };
+        columns = { INT_MIN, AnyCell - 1 };
+    }
+
+    std::vector<std::uint64_t> candidates;
+    const auto collect = [&](InvalidationGrid::iterator it)
+    {
+        std::vector<std::uint64_t>& cell = it->second;
+        cell.erase(std::remove_if(cell.begin(), cell.end(),
+                                  [this](std::uint64_t seq) { return !findCallback(seq); }),
+                   cell.end());
+        if (cell.empty())
+            return grid.erase(it);
+
+        candidates.insert(candidates.end(), cell.begin(), cell.end());
+        return ++it;
+    };
+    visitCells(grid, rows.first, rows.second, columns.first, columns.second, collect);
+    visitCells(grid, AnyCell, AnyCell, columns.first, columns.second, collect);
+
+    // A rectangle spanning several cells is in each of them; visit in queue order.
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    bool performedMerge = false;
+
+    // What the elided invalidations asked for has been waiting since they were queued.
+    std::chrono::steady_clock::time_point oldest = std::chrono::steady_clock::time_point::max();
+
+    for (const std::uint64_t seq : candidates)
+    {
+        const QueuedCallback& it = _callbacks[seq - _callbacksFront];
+
+        // the invalidation in the queue is fully covered by the payload,
+        // just remove it
+        if (msgX <= it._x && it._x + it._w <= msgX + msgW && msgY <= it._y &&
+            it._y + it._h <= msgY + msgH)
+        {
+            LOG_TRC("Removing smaller invalidation: "
+                    << it._callback._payload << " -> " << ' ' << msgX << ' ' << msgY << ' '
+                    << msgW << ' ' << msgH << ' ' << msgPart << ' ' << msgMode);
+
+            oldest = std::min(oldest, it._callback._queued);
+            elideCallback(seq);
+            continue;
         }
-        break;
 
-        case LOK_CALLBACK_INVALIDATE_VISIBLE_CURSOR: // the cursor has moved
-        case LOK_CALLBACK_CURSOR_VISIBLE: // the cursor visibility has changed
-        case LOK_CALLBACK_STATUS_INDICATOR_SET_VALUE: // setting the indicator value
-        case LOK_CALLBACK_DOCUMENT_SIZE_CHANGED: // setting the document size
-        case LOK_CALLBACK_CELL_CURSOR: // the cell cursor has moved
-        case LOK_CALLBACK_INVALIDATE_VIEW_CURSOR: // the view cursor has moved
-        case LOK_CALLBACK_CELL_VIEW_CURSOR: // the view cell cursor has moved
-        case LOK_CALLBACK_VIEW_CURSOR_VISIBLE: // the view cursor visibility has changed
+        // the invalidation just intersects, join those (if the result is
+        // small)
+        if (TileDesc::rectanglesIntersect(msgX, msgY, msgW, msgH, it._x, it._y, it._w, it._h))
         {
-            const bool isViewCallback = (callbackType == LOK_CALLBACK_INVALIDATE_VIEW_CURSOR ||
-                                         callbackType == LOK_CALLBACK_CELL_VIEW_CURSOR ||
-                                         callbackType == LOK_CALLBACK_VIEW_CURSOR_VISIBLE);
+            const int joinX = std::min(msgX, it._x);
+            const int joinY = std::min(msgY, it._y);
+            const int joinW = std::max(msgX + msgW, it._x + it._w) - joinX;
+            const int joinH = std::max(msgY + msgH, it._y + it._h) - joinY;
 
-            const std::string viewId
-                = (isViewCallback ? extractViewId(payload) : std::string());
+            if (joinW > ReasonableSizeX || joinH > ReasonableSizeY)
+                continue;
 
-            for (std::size_t i = 0; i < _callbacks.size(); ++i)
-            {
-                const auto& it = _callbacks[i];
+            LOG_TRC("Merging invalidations: "
+                    << Callback::toString(view, type, payload) << " and "
+                    << it._callback._payload << " -> " << joinX << ' ' << joinY << ' '
+                    << joinW << ' ' << joinH << ' ' << msgPart << ' ' << msgMode);
 
-                if (it._type != type || it._view != view)
-                    continue;
+            msgX = joinX;
+            msgY = joinY;
+            msgW = joinW;
+            msgH = joinH;
+            performedMerge = true;
 
-                if (!isViewCallback)
-                {
-                    LOG_TRC("Remove obsolete callback: " << it <<  " -> "
-                            << Callback::toString(view, type, payload));
-                    _callbacks.erase(_callbacks.begin() + i);
-                    break;
-                }
-                else if (isViewCallback)
-                {
-                    // we additionally need to ensure that the payload is about
-                    // the same viewid (otherwise we'd merge them all views into
-                    // one)
-                    const std::string queuedViewId = extractViewId(it._payload);
-                    if (viewId == queuedViewId)
-                    {
-                        LOG_TRC("Remove obsolete view callback: " << it << " -> "
-                                << Callback::toString(view, type, payload));
-                        _callbacks.erase(_callbacks.begin() + i);
-                        break;
-                    }
-                }
-            }
+            oldest = std::min(oldest, it._callback._queued);
+            elideCallback(seq);
         }
-        break;
+    }
 
-        default:
-        break;
+    // What the queued invalidations we couldn't merge with already cover
+    // needs no repeating: trim that off, or drop it all when it's all covered.
+    bool trimmed = false;
+    if (!tokens.equals(0, "EMPTY,") && msgW > 0 && msgH > 0)
+    {
+        const Util::Rectangle msgRect(msgX, msgY, msgW, msgH);
+        Util::Region rest(msgRect);
+        for (const std::uint64_t seq : candidates)
+        {
+            const QueuedCallback* queued = findCallback(seq);
+            if (queued)
+                rest.subtract(Util::Rectangle(queued->_x, queued->_y, queued->_w, queued->_h));
+        }
 
-    } // switch
+        if (rest.isEmpty())
+        {
+            LOG_TRC("Dropping invalidation covered by the queued ones: "
+                    << msgX << ' ' << msgY << ' ' << msgW << ' ' << msgH << ' ' << msgPart
+                    << ' ' << msgMode);
+            return;
+        }
 
-    // Append the new command to the callbacks list
-    return false;
+        const Util::Rectangle bounds = rest.getBounds();
+        if (!(bounds == msgRect))
+        {
+            msgX = bounds.getLeft();
+            msgY = bounds.getTop();
+            msgW = bounds.getWidth();
+            msgH = bounds.getHeight();
+            trimmed = true;
+        }
+    }
+
+    std::uint64_t seq;
+    if (performedMerge || trimmed)
+    {
+        std::string newPayload =
+            std::to_string(msgX) + ", " + std::to_string(msgY) + ", " +
+            std::to_string(msgW) + ", " + std::to_string(msgH) + ", " +
+            tokens.cat(' ', 4); // part etc. ...
+
+        LOG_TRC((performedMerge ? "Merge result: " : "Trimmed to: ") << newPayload);
+
+        seq = pushCallback(view, type, newPayload);
+    }
+    else
+        seq = pushCallback(view, type, payload);
+
+    QueuedCallback& queued = _callbacks.back();
+    queued._callback._queued = std::min(queued._callback._queued, oldest);
+    queued._x = msgX;
+    queued._y = msgY;
+    queued._w = msgW;
+    queued._h = msgH;
+
+    // File it under the cells it spans, or under the wildcard when there are too many.
+    const auto filedSpan = [](std::int64_t from, std::int64_t to)
+    {
+        const std::pair<int, int> span = cellSpan(from, to);
+        if (span.second < span.first ||
+            std::int64_t(span.second) - span.first >= MaxInvalidationCells)
+            return std::make_pair(AnyCell, AnyCell);
+        return span;
+    };
+    const std::pair<int, int> spanRows = filedSpan(msgY, std::int64_t(msgY) + msgH);
+    const std::pair<int, int> spanColumns = filedSpan(msgX, std::int64_t(msgX) + msgW);
+
+    for (int row = spanRows.first;; ++row)
+    {
+        for (int column = spanColumns.first;; ++column)
+        {
+            grid[{ row, column }].push_back(seq);
+            if (column == spanColumns.second)
+                break;
+        }
+
+        if (row == spanRows.second)
+            break;
+    }
 }
 
 KitQueue::Payload KitQueue::pop()
@@ -701,7 +850,7 @@ std::string KitQueue::combineTextInput(const StringVector& tokens)
         auto& it = _queue[i];
 
         const std::string queuedMessage(it.data(), it.size());
-        StringVector queuedTokens = StringVector::tokenize(it.data(), it.size());
+        StringVector queuedTokens = StringVector::tokenizeView(it.data(), it.size());
 
         // If any messages of these types are present before the current ("textinput") message,
         // no combination is possible.
@@ -721,9 +870,6 @@ std::string KitQueue::combineTextInput(const StringVector& tokens)
             queuedId == id &&
             LOOLProtocol::getTokenString(queuedTokens, "text", queuedText))
         {
-            // Remove the queued textinput message and combine it with the current one
-            _queue.erase(_queue.begin() + i);
-
             std::string newMsg;
             newMsg.reserve(it.size() * 2);
             newMsg.append(queuedTokens[0]);
@@ -733,6 +879,10 @@ std::string KitQueue::combineTextInput(const StringVector& tokens)
             newMsg.append(queuedText);
             newMsg.append(text);
 
+            // Remove the queued textinput message, now combined with the current one.
+            // Last, as the tokens refer to it.
+            _queue.erase(_queue.begin() + i);
+
             LOG_TRC("Combined [" << queuedMessage << "] with current message to [" << newMsg
                     << ']');
 
@@ -751,8 +901,8 @@ void KitQueue::pushTileCombineRequest(const Payload &value)
 
     // Breakup tilecombine and deduplicate (we are re-combining
     // the tiles inside popTileQueue() again)
-    const std::string msg = std::string(value.data(), value.size());
-    const TileCombined tileCombined = TileCombined::parse(msg);
+    const TileCombined tileCombined =
+        TileCombined::parse(std::string_view(value.data(), value.size()));
 
     std::vector<TileDesc>& tileQueue = ensureTileQueue(tileCombined.getCanonicalViewId());
     const std::vector<TileDesc>& tiles = tileCombined.getTiles();
@@ -805,7 +955,7 @@ std::string KitQueue::combineRemoveText(const StringVector& tokens)
         auto& it = _queue[i];
 
         const std::string queuedMessage(it.data(), it.size());
-        StringVector queuedTokens = StringVector::tokenize(it.data(), it.size());
+        StringVector queuedTokens = StringVector::tokenizeView(it.data(), it.size());
 
         // If any messages of these types are present before the current (removetextcontext)
         // message, no combination is possible.
@@ -827,13 +977,14 @@ std::string KitQueue::combineRemoveText(const StringVector& tokens)
             LOOLProtocol::getTokenIntegerFromMessage(queuedMessage, "before", queuedBefore) &&
             LOOLProtocol::getTokenIntegerFromMessage(queuedMessage, "after", queuedAfter))
         {
-            // Remove the queued removetextcontext message and combine it with the current one
-            _queue.erase(_queue.begin() + i);
-
             std::string newMsg = queuedTokens[0] + " removetextcontext id=" + id +
                 " before=" + std::to_string(queuedBefore + before) +
                 " after=" + std::to_string(queuedAfter + after);
 
+            // Remove the queued removetextcontext message, now combined with the current one.
+            // Last, as the tokens refer to it.
+            _queue.erase(_queue.begin() + i);
+
             LOG_TRC("Combined [" << queuedMessage << "] with current message to [" << newMsg << "]");
 
             return newMsg;
@@ -863,10 +1014,14 @@ void KitQueue::dumpState(std::ostream& oss)
             oss << "\t\t\t" << i++ << ": " << it.serialize() << "\n";
     }
 
-    oss << "\tCallbacks size: " << _callbacks.size() << "\n";
+    oss << "\tCallbacks size: " << _callbackCount << " (" << _callbacks.size() - _callbackCount
+        << " elided)\n";
     i = 0;
-    for (auto &it : _callbacks)
-        oss << "\t\t" << i++ << ": " << it << "\n";
+    for (const auto& it : _callbacks)
+    {
+        if (!it._elided)
+            oss << "\t\t" << i++ << ": " << it._callback << "\n";
+    }
 }
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -11,9 +11,14 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <map>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "Log.hpp"
@@ -66,6 +71,8 @@ public:
         int _view; // -1 for all
         int _type;
         std::string _payload;
+        /// When it was queued, or when the oldest of the invalidations merged into it was.
+        std::chrono::steady_clock::time_point _queued;
 
         Callback() : _view(-1), _type(-1) { }
         Callback(const Callback&) = default;
@@ -82,12 +89,10 @@ public:
         static std::string toString(int view, int type, const std::string& payload);
     };
 
-    /// Queue a LibreOfficeKit callback for later emission
+    /// Queue a LibreOfficeKit callback for later emission, eliding
+    /// the queued callbacks that it makes obsolete.
     void putCallback(int view, int type, const std::string &message);
 
-    /// Work back over the queue to simplify & return false if we should not queue.
-    bool elideDuplicateCallback(int view, int type, const std::string &message);
-
     /// Obtain the next message.
     /// timeoutMs can be 0 to signify infinity.
     /// Returns an empty payload on timeout.
@@ -107,20 +112,13 @@ public:
     /// Obtain the next callback
     Callback getCallback()
     {
-        assert(_callbacks.size() > 0);
-        Callback front = _callbacks.front();
-        _callbacks.erase(_callbacks.begin());
+        assert(callbackSize() > 0);
+        Callback front;
+        getCallback(front);
         return front;
     }
 
-    bool getCallback(Callback &callback)
-    {
-        if (_callbacks.size() == 0)
-            return false;
-        callback = std::move(_callbacks.front());
-        _callbacks.erase(_callbacks.begin());
-        return true;
-    }
+    bool getCallback(Callback &callback);
 
     /// Anything in the queue ?
     bool isEmpty()
@@ -135,14 +133,22 @@ public:
 
     size_t callbackSize() const
     {
-        return _callbacks.size();
+        return _callbackCount;
     }
 
     /// Removal of all the pending messages.
     void clear()
     {
         _queue.clear();
-        _callbacks.clear();
+        _textInputTime = std::chrono::steady_clock::time_point();
+        clearCallbacks();
+    }
+
+    /// When the text input alone in the queue was first queued, or the epoch when
+    /// anything else is queued. While it waits, what is typed next is merged into it.
+    std::chrono::steady_clock::time_point getLoneTextInputTime() const
+    {
+        return _queue.size() == 1 ? _textInputTime : std::chrono::steady_clock::time_point();
     }
 
     void dumpState(std::ostream& oss);
@@ -165,13 +171,43 @@ protected:
     std::string combineRemoveText(const StringVector& tokens);
 
 private:
-    /// Search the queue for a duplicate callback and remove it (if present).
-    ///
-    /// This removes also callbacks that are made invalid by the current
-    /// message, like the new cursor position invalidates the old one etc.
-    ///
-    /// @return New message to put into the queue.  If empty, use what was in callbackMsg.
-    std::string removeCallbackDuplicate(const std::string& callbackMsg);
+    /// A queued callback; elided ones stay in place until popped,
+    /// so that removing from the middle of the queue is O(1).
+    struct QueuedCallback
+    {
+        Callback _callback;
+        bool _elided;
+        /// The parsed rectangle of an invalidation.
+        int _x;
+        int _y;
+        int _w;
+        int _h;
+    };
+
+    /// The queued invalidations of a [view, part, mode], filed by [row, column] under
+    /// the cells of a coarse grid that they span, so that a new invalidation only visits
+    /// its neighbourhood. Rectangles spanning many cells in a direction are filed under
+    /// a wildcard row or column instead.
+    /// May refer to popped or elided callbacks, which are pruned when visited.
+    typedef std::map<std::pair<int, int>, std::vector<std::uint64_t>> InvalidationGrid;
+
+    /// Appends a callback, returning its sequence number.
+    std::uint64_t pushCallback(int view, int type, const std::string& payload);
+
+    /// The live callback with the given sequence number, or null when popped or elided.
+    QueuedCallback* findCallback(std::uint64_t seq);
+
+    void elideCallback(std::uint64_t seq);
+
+    /// Queues an invalidation, dropping the queued ones that it covers
+    /// and merging those it intersects.
+    void putInvalidation(int view, int type, const std::string& payload);
+
+    /// Queues a callback that makes the previous one with the same key obsolete.
+    void putSupersedingCallback(std::tuple<int, int, std::string> key, int view, int type,
+                                const std::string& payload);
+
+    void clearCallbacks();
 
     std::vector<TileDesc>* getTileQueue(CanonicalViewId viewid);
     std::vector<TileDesc>& ensureTileQueue(CanonicalViewId viewid);
@@ -181,12 +217,26 @@ private:
     /// Queue of incoming messages from loolwsd
     std::vector<Payload> _queue;
 
+    /// When the text input at the back of _queue was first queued, or the epoch.
+    std::chrono::steady_clock::time_point _textInputTime;
+
     /// Queues of incoming tile requests from loolwsd
     typedef std::pair<CanonicalViewId, std::vector<TileDesc>> viewTileQueue;
     std::vector<viewTileQueue> _tileQueues;
 
     /// Queue of callbacks from Kit to send out to loolwsd
-    std::vector<Callback> _callbacks;
+    std::deque<QueuedCallback> _callbacks;
+    /// The sequence number of the front of _callbacks.
+    std::uint64_t _callbacksFront = 0;
+    /// The number of callbacks that are not elided.
+    std::size_t _callbackCount = 0;
+
+    /// The queued invalidations, by [view, part, mode].
+    std::map<std::tuple<int, int, int>, InvalidationGrid> _invalidations;
+
+    /// The last callback queued for each [type, view, id], where the id
+    /// distinguishes the .uno: command or the viewId of the payload.
+    std::map<std::tuple<int, int, std::string>, std::uint64_t> _supersedable;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const KitQueue::Callback &c)
@@ -13,10 +13,11 @@
 #include <common/Log.hpp>
 #include <common/Util.hpp>
 
-#include <Poco/MemoryStream.h>
 #include <Poco/Net/HTTPResponse.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <netdb.h>
 #include <stdexcept>
@@ -62,15 +63,13 @@ inline int64_t skipCRLF(const char* p, int64_t off, int64_t len)
 /// Ex.: for [xxxCRLFCRLF] the offset to the second LF is returned.
 inline int64_t findLineBreak(const char* p, int64_t off, int64_t len)
 {
-    // Find the line break, which ends the status line.
-    for (; off < len; ++off)
-    {
-        // We expect CRLF, but LF alone is enough.
-        if (p[off] == '\n')
-            return off;
-    }
+    if (off >= len)
+        return len;
 
-    return len;
+    // We expect CRLF, but LF alone is enough.
+    // memchr is vectorized, which matters for long lines.
+    const void* lf = std::memchr(p + off, '\n', len - off);
+    return lf ? static_cast<const char*>(lf) - p : len;
 }
 
 inline int64_t findLineBreak(const std::string_view data, int64_t off)
@@ -97,12 +96,34 @@ inline int64_t findBlankLine(const char* p, int64_t off, int64_t len)
             return off + 2; // Return the second LF.
         }
 
-        off += 3; // Skip over the mismatch.
+        ++off; // The next line break could be right after this one.
     }
 
     return len;
 }
 
+/// Returns the given string without leading and trailing spaces and tabs.
+inline std::string_view trimSpaceAndTab(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+/// Returns the line at off, without the line break, and moves off past it.
+/// The data must end with a line break.
+inline std::string_view nextLine(const std::string_view data, std::size_t& off)
+{
+    const std::size_t end = findLineBreak(data.data(), off, data.size());
+    std::string_view line = data.substr(off, end - off);
+    off = end + 1;
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    return line;
+}
+
 /// Find the end of text.
 /// Returns the offset to the first whitespace or
 /// line-break character if found, otherwise, len.
@@ -125,59 +146,94 @@ namespace http
 int64_t Header::parse(const char* p, int64_t len)
 {
     LOG_TRC("Parsing header given " << len << " bytes: " << std::string(p, std::min<int64_t>(len, 80L)));
+
     if (len < 4)
     {
         // Incomplete; we need at least \r\n\r\n.
         return 0;
     }
 
-    // Make sure we have the full header before parsing.
-    const int64_t endPos = findBlankLine(p, 0, len);
+    // Make sure we have the full header before parsing. We are given the same
+    // data again, with more at the end, until then; so resume where we left
+    // off, less the start of a blank line that may have been cut.
+    const int64_t resumeOff = std::max<int64_t>(0, std::min(_scannedLen, len) - 2);
+    const int64_t endPos = findBlankLine(p, resumeOff, len);
     if (endPos == len)
     {
+        if (len > MaxHeaderLen)
+        {
+            LOG_DBG("Http header is too long: " << len << " bytes without a blank line");
+            _scannedLen = 0;
+            return -1;
+        }
+
+        _scannedLen = len;
         return 0; // Incomplete.
     }
 
-    try
+    _scannedLen = 0;
+
+    // Parse the fields in place, preserving folded headers and following the
+    // same rules as Poco::Net::MessageHeader, which we used to use.
+    const std::string_view data(p, endPos + 1);
+    std::size_t off = 0;
+    int64_t fields = 0;
+    while (off < data.size())
     {
-        //FIXME: implement http header parser!
+        const std::string_view line = nextLine(data, off);
+        if (line.empty())
+            break; // The blank line.
 
-        // Now parse to preserve folded headers and other
-        // corner cases that is conformant to the rfc,
-        // detecting any errors and/or invalid entries.
-        // NB: request.read() expects full message and will fail.
-        Poco::Net::MessageHeader msgHeader;
-        Poco::MemoryInputStream data(p, len);
-        msgHeader.read(data);
-        if (data.tellg() < 0)
+        const std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos || colon > MaxNameLen)
         {
-            LOG_DBG("Failed to parse http header.");
-            return -1;
+            if (std::min(colon, line.size()) > MaxNameLen)
+            {
+                LOG_DBG("Invalid http header field name: " << line.substr(0, MaxNameLen));
+                return -1;
+            }
+
+            continue; // Not a field; e.g. the status line. Ignore.
         }
 
-        // Copy the header entries over to us.
-        for (const auto& pair : msgHeader)
+        std::string_view value = trimSpaceAndTab(line.substr(colon + 1));
+
+        // Folded values continue on lines that start with whitespace.
+        std::string folded;
+        while (off < data.size() && (data[off] == ' ' || data[off] == '\t'))
         {
-            set(Util::trimmed(pair.first), Util::trimmed(pair.second));
+            if (folded.empty())
+                folded = value;
+            folded.append(nextLine(data, off));
         }
 
-        _chunked = getTransferEncoding() == "chunked";
+        if (!folded.empty())
+            value = trimSpaceAndTab(folded);
 
-        LOG_TRC("Read " << data.tellg()
-                        << " bytes of header. hasContentLength: " << hasContentLength()
-                        << ", contentLength: " << (hasContentLength() ? getContentLength() : -1)
-                        << ", chunked: " << getChunkedTransferEncoding() << ":\n"
-                        << std::string(p, data.tellg()));
+        if (static_cast<int64_t>(value.size()) > MaxValueLen)
+        {
+            LOG_DBG("Http header field value is too long: " << value.size() << " bytes");
+            return -1;
+        }
 
-        // We consumed the full header, including the blank line.
-        return endPos + 1;
-    }
-    catch (const Poco::Exception& exc)
-    {
-        LOG_TRC("ERROR while parsing http header: " << exc.displayText());
+        if (++fields > MaxNumberFields)
+        {
+            LOG_DBG("Too many http header fields");
+            return -1;
+        }
+
+        set(trimSpaceAndTab(line.substr(0, colon)), std::string(value));
     }
 
-    return 0;
+    _chunked = getTransferEncoding() == "chunked";
+
+    LOG_TRC("Read " << endPos + 1 << " bytes of header. hasContentLength: " << hasContentLength()
+                    << ", contentLength: " << (hasContentLength() ? getContentLength() : -1)
+                    << ", chunked: " << getChunkedTransferEncoding() << ":\n"
+                    << std::string(p, endPos + 1));
+
+    // We consumed the full header, including the blank line.
+    return endPos + 1;
 }
 
 int64_t Header::getContentLength() const
@@ -461,13 +517,26 @@ int64_t MultipartDataParser::parsePart(std::string_view data, Header& header,
 
     ++end; // Skip the last char ('\n').
 
-    // Find the *next* boundary, or closing one.
-    auto [nextStart, nextEnd, nextLast] = findBoundary(data, _delimiter, end);
-    if (nextStart < 0 || (!last && nextEnd == 0))
+    // Find the *next* boundary, or closing one. The part can be large, so
+    // don't rescan what we already have when we get more data.
+    const int64_t searchOff =
+        std::max<int64_t>(end, std::min<std::size_t>(_resumeOffset, data.size()));
+    auto [nextStart, nextEnd, nextLast] = findBoundary(data, _delimiter, searchOff);
+    if (nextStart < 0)
+    {
+        // The delimiter can't start in its own length from the end, less one.
+        if (data.size() >= _delimiter.size())
+            _resumeOffset = data.size() - _delimiter.size() + 1;
+        return 0; // Incomplete.
+    }
+
+    if (!last && nextEnd == 0)
     {
+        _resumeOffset = nextStart;
         return 0; // Incomplete.
     }
 
+    _resumeOffset = 0;
     if (nextEnd < 0)
     {
         return -1; // Invalid.
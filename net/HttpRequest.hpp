@@ -21,6 +21,7 @@
 #endif
 
 #include <algorithm>
+#include <cerrno>
 #include <chrono>
 #include <cstdint>
 #include <ios>
@@ -34,6 +35,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #if !MOBILEAPP
 #include <sys/socket.h>
@@ -389,7 +391,10 @@ public:
     std::size_t size() const { return _headers.size(); }
 
     /// Parse the given data as an HTTP header.
-    /// Returns the number of bytes consumed (and must be removed from the input).
+    /// Returns the number of bytes consumed (and must be removed from the input),
+    /// 0 when incomplete, or -1 for invalid data.
+    /// When incomplete, it is expected to be called again with the same data,
+    /// extended with more, and it resumes scanning where it left off.
     int64_t parse(const char* p, int64_t len);
 
     /// Add an HTTP header field.
@@ -596,6 +601,8 @@ private:
     /// This isn't designed for lookup performance, but to preserve order.
     //TODO: We might not need this and get away with a map.
     Container _headers;
+    /// The length of the incomplete data scanned in the last parse call.
+    int64_t _scannedLen = 0;
     bool _chunked = false;
 };
 
@@ -753,21 +760,42 @@ public:
     }
 
     /// Set the file to send as the body of the request.
-    void setBodyFile(const std::string& path)
-    {
-        auto ifs = std::make_shared<std::ifstream>(path, std::ios::binary);
+    /// The file is read(2) straight into the socket's buffer, without
+    /// going through the stream buffers of an ifstream.
+    /// Returns false, leaving the request as it was, when the file can't be opened;
+    /// the request must not be sent then.
+    bool setBodyFile(const std::string& path)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0)
+        {
+            LOG_ERR("Failed to open [" << path << "] to send as the request body");
+            if (fd >= 0)
+                ::close(fd);
+
+            return false;
+        }
 
-        ifs->seekg(0, std::ios_base::end);
-        const int64_t size = ifs->tellg();
-        ifs->seekg(0, std::ios_base::beg);
+        // Closed with the last copy of the callback.
+        std::shared_ptr<int> file(new int(fd),
+                                  [](int* f)
+                                  {
+                                      ::close(*f);
+                                      delete f;
+                                  });
 
         setBodySource(
-            [ifs = std::move(ifs)](char* buf, int64_t len) -> int64_t
+            [file = std::move(file)](char* buf, int64_t len) -> int64_t
             {
-                ifs->read(buf, len);
-                return ifs->gcount();
+                ssize_t n;
+                while ((n = ::read(*file, buf, len)) < 0 && errno == EINTR)
+                    ;
+                return n;
             },
-            size);
+            st.st_size);
+
+        return true;
     }
 
     void setBody(std::string body, std::string contentType = "text/html;charset=utf-8")
@@ -829,6 +857,8 @@ public:
 
     /// Read the current part and return the payload and header.
     /// Returns an empty string if there is not enough data, or we're at the last part.
+    /// When there is not enough data, it is expected to be called again with the
+    /// same data, extended with more, and it resumes searching where it left off.
     int64_t readPart(std::string_view data, Header& header, std::string_view& body);
 
 private:
@@ -851,6 +881,8 @@ private:
     const std::string_view _boundary;
     /// The state of the parser.
     State _state;
+    /// Where to resume searching for the next boundary, after incomplete data.
+    std::size_t _resumeOffset = 0;
 };
 
 /// A server-side HTTP Request parser for incoming request.
@@ -1102,6 +1134,9 @@ public:
     const StatusLine& statusLine() const { return _statusLine; }
     StatusCode statusCode() const { return _statusLine.statusCode(); }
 
+    /// Change the status of an outgoing response, e.g. to 206 for partial content.
+    void setStatusCode(StatusCode statusCode) { _statusLine = StatusLine(statusCode); }
+
     const Header& header() const { return _header; }
 
     /// Add an HTTP header field.
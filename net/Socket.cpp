@@ -12,6 +12,7 @@
 #include "Socket.hpp"
 
 #include <common/ConfigUtil.hpp>
+#include <common/FileUtil.hpp>
 #include <common/HexUtil.hpp>
 #include <common/Log.hpp>
 #include <common/SigUtil.hpp>
@@ -47,6 +48,9 @@
 
 #include <sys/stat.h>
 #include <sys/types.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include <sysexits.h>
 #include <unistd.h>
@@ -1126,6 +1130,76 @@ void StreamSocket::dumpState(std::ostream& os)
     if (_inBuffer.size() > 0)
         HexUtil::dumpHex(os, _inBuffer, "\t\tinBuffer:\n", "\t\t");
     _outBuffer.dumpHex(os, "\t\toutBuffer:\n", "\t\t");
+    if (!_outFiles.empty())
+        os << "\t\toutFiles: " << _outFiles.size() << " with " << _outFilesSize
+           << " bytes remaining\n";
+}
+
+void StreamSocket::sendFile(std::shared_ptr<const FileUtil::MappedFile> file,
+                            const std::size_t offset, const std::size_t length, const bool doFlush)
+{
+    ASSERT_CORRECT_SOCKET_THREAD(this);
+    if (!file || length == 0)
+        return;
+
+    assert(offset + length <= file->size() && "Range is out of the file bounds");
+
+    // Count only the buffered data that isn't already ahead of earlier files.
+    std::size_t bufferedBefore = _outBuffer.size();
+    for (const OutFile& outFile : _outFiles)
+        bufferedBefore -= outFile._bufferedBefore;
+
+    // Only while queued, so that the files we serve don't each hold an fd.
+    const int fd = openFileToSend(*file);
+    _outFiles.emplace_back(std::move(file), offset, length, bufferedBefore, fd);
+    _outFilesSize += length;
+
+    if (doFlush)
+        writeOutgoingData();
+}
+
+StreamSocket::OutFile::~OutFile()
+{
+    if (_fd >= 0)
+        FileUtil::closeFD(_fd);
+}
+
+int StreamSocket::openFileToSend([[maybe_unused]] const FileUtil::MappedFile& file)
+{
+#if !MOBILEAPP && defined(__linux__)
+    return file.openAgain();
+#else
+    return -1;
+#endif
+}
+
+int StreamSocket::writeFileData(const FileUtil::MappedFile& file, [[maybe_unused]] const int fd,
+                                const std::size_t offset, const int len)
+{
+#if !MOBILEAPP && defined(__linux__)
+    if (fd >= 0)
+    {
+        ASSERT_CORRECT_SOCKET_THREAD(this);
+        assert((getFD() >= 0 || isShutdown()) && "Socket is closed but not marked correctly");
+
+#if ENABLE_DEBUG
+        if (simulateSocketError(false))
+            return -1;
+#endif
+        off_t fileOffset = offset;
+        const ssize_t sent = ::sendfile(getFD(), fd, &fileOffset, len);
+        if (sent == 0)
+        {
+            // Truncated since opened; we can't send all we promised.
+            errno = EIO;
+            return -1;
+        }
+
+        return sent;
+    }
+#endif
+
+    return writeData(file.data() + offset, len);
 }
 
 bool StreamSocket::send(const http::Response& response)
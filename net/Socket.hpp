@@ -27,11 +27,13 @@
 #include <climits>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <utility>
 
 #include <common/StateEnum.hpp>
 #include "Log.hpp"
@@ -68,6 +70,11 @@ namespace Poco
     class URI;
 }
 
+namespace FileUtil
+{
+class MappedFile;
+}
+
 class Socket;
 std::ostream& operator<<(std::ostream& os, const Socket &s);
 
@@ -1239,7 +1246,7 @@ public:
 
     ~StreamSocket() override
     {
-        LOG_TRC("StreamSocket dtor called with pending write: " << _outBuffer.size()
+        LOG_TRC("StreamSocket dtor called with pending write: " << getPendingWriteSize()
                                                                 << ", read: " << _inBuffer.size());
         ensureDisconnected();
         _socketHandler.reset();
@@ -1316,16 +1323,22 @@ public:
         // cf. SslSocket::getPollEvents
         ASSERT_CORRECT_SOCKET_THREAD(this);
         int events = _socketHandler->getPollEvents(now, timeoutMaxMicroS);
-        if (!_outBuffer.empty() || _shutdownSignalled)
+        if (hasPendingWrites() || _shutdownSignalled)
             events |= POLLOUT;
         return events;
     }
 
     bool hasBuffered() const override
     {
-        return !_outBuffer.empty() || !_inBuffer.empty();
+        return hasPendingWrites() || !_inBuffer.empty();
     }
 
+    /// True iff we have buffered data or queued files still to write.
+    bool hasPendingWrites() const { return !_outBuffer.empty() || !_outFiles.empty(); }
+
+    /// The number of bytes, buffered or in queued files, still to write.
+    std::size_t getPendingWriteSize() const { return _outBuffer.size() + _outFilesSize; }
+
     std::size_t totalBufferCapacity() const override
     {
         return _outBuffer.capacity() + _inBuffer.capacity();
@@ -1354,6 +1367,13 @@ public:
         send(str.data(), str.size(), doFlush);
     }
 
+    /// Send a byte-range of a file's contents to the socket peer without
+    /// copying it into the output buffer. Anything already buffered is sent before
+    /// the file, and anything buffered afterwards is sent after it.
+    /// The file is kept alive until it is fully written.
+    void sendFile(std::shared_ptr<const FileUtil::MappedFile> file, std::size_t offset,
+                  std::size_t length, bool doFlush = true);
+
     /// Send an http::Request and flush.
     /// Does not add any fields to the header.
     /// Will shutdown the socket upon error and return false.
@@ -1374,10 +1394,10 @@ public:
     /// Returns true iff no data is left in the buffer.
     inline bool attemptWrites()
     {
-        if (!_outBuffer.empty())
+        if (hasPendingWrites())
             writeOutgoingData();
 
-        return _outBuffer.empty();
+        return !hasPendingWrites();
     }
 
 #if !MOBILEAPP
@@ -1644,7 +1664,7 @@ public:
         if constexpr (Util::isMobileApp())
             return INT_MAX; // We want to always send a single record in one go
         const int capacity = getSendBufferSize();
-        return std::max<int>(0, capacity - _outBuffer.size());
+        return std::max<int64_t>(0, int64_t(capacity) - getPendingWriteSize());
     }
 
     virtual long getSslVerifyResult()
@@ -1764,7 +1784,7 @@ public:
             }
 
             // perform the shutdown if we have sent everything.
-            if (_shutdownSignalled && _outBuffer.empty())
+            if (_shutdownSignalled && !hasPendingWrites())
             {
                 LOG_TRC("Shutdown Signaled. Close Connection.");
                 shutdownConnection();
@@ -1772,10 +1792,10 @@ public:
                 break;
             }
 
-            oldSize = _outBuffer.size();
+            oldSize = getPendingWriteSize();
 
             // Write if we can and have data to write.
-            if ((events & POLLOUT) && !_outBuffer.empty())
+            if ((events & POLLOUT) && hasPendingWrites())
             {
                 if (writeOutgoingData() < 0)
                 {
@@ -1790,7 +1810,7 @@ public:
                     }
                 }
             }
-        } while (oldSize != _outBuffer.size());
+        } while (oldSize != getPendingWriteSize());
 
         if (closed)
         {
@@ -1808,19 +1828,39 @@ public:
     virtual int writeOutgoingData()
     {
         ASSERT_CORRECT_SOCKET_THREAD(this);
-        assert(!_outBuffer.empty());
+        assert(hasPendingWrites());
         ssize_t len = 0;
         int last_errno = 0;
         do
         {
+            // Files are written only once the data buffered ahead of them is out.
+            OutFile* const outFile =
+                (!_outFiles.empty() && _outFiles.front()._bufferedBefore == 0 ? &_outFiles.front()
+                                                                              : nullptr);
             do
             {
                 // Writing much more than we can absorb in the kernel causes wastage.
-                const int size = std::min((int)_outBuffer.getBlockSize(), getSendBufferSize());
-                if (size == 0)
-                    break;
+                if (outFile)
+                {
+                    const int size = std::min<std::size_t>(outFile->_remaining, getSendBufferSize());
+                    if (size == 0)
+                        break;
+
+                    len = writeFileData(*outFile->_file, outFile->_fd, outFile->_offset, size);
+                }
+                else
+                {
+                    std::size_t available = _outBuffer.getBlockSize();
+                    if (!_outFiles.empty())
+                        available = std::min(available, _outFiles.front()._bufferedBefore);
+
+                    const int size = std::min<std::size_t>(available, getSendBufferSize());
+                    if (size == 0)
+                        break;
+
+                    len = writeData(_outBuffer.getBlock(), size);
+                }
 
-                len = writeData(_outBuffer.getBlock(), size);
                 if (len < 0)
                     last_errno = errno; // Save only on error.
 
@@ -1828,9 +1868,13 @@ public:
                 if (len < 0 && last_errno != EAGAIN && last_errno != EWOULDBLOCK)
                     LOG_ERR_ERRNO(last_errno, "Socket write returned " << len);
                 else if (len <= 0) // Trace errno for debugging, even for "unspecified result."
-                    LOGA_TRC(Socket, "Write failed, have " << _outBuffer.size() << " buffered bytes ("
+                    LOGA_TRC(Socket, "Write failed, have " << getPendingWriteSize() << " pending bytes ("
                              << Util::symbolicErrno(last_errno) << ": "
                              << std::strerror(last_errno) << ')');
+                else if (outFile) // Success.
+                    LOGA_TRC(Socket, "Wrote " << len << " bytes of " << outFile->_remaining
+                                              << " remaining from file at offset "
+                                              << outFile->_offset);
                 else // Success.
                     LOGA_TRC(Socket,
                              "Wrote "
@@ -1846,10 +1890,25 @@ public:
 
             if (len > 0)
             {
-                LOG_ASSERT_MSG(len <= ssize_t(_outBuffer.size()),
-                               "Consumed more data than available");
                 notifyBytesSent(len);
-                _outBuffer.eraseFirst(len);
+                if (outFile)
+                {
+                    LOG_ASSERT_MSG(len <= ssize_t(outFile->_remaining),
+                                   "Consumed more file data than available");
+                    outFile->_offset += len;
+                    outFile->_remaining -= len;
+                    _outFilesSize -= len;
+                    if (outFile->_remaining == 0)
+                        _outFiles.pop_front();
+                }
+                else
+                {
+                    LOG_ASSERT_MSG(len <= ssize_t(_outBuffer.size()),
+                                   "Consumed more data than available");
+                    _outBuffer.eraseFirst(len);
+                    if (!_outFiles.empty())
+                        _outFiles.front()._bufferedBefore -= len;
+                }
             }
             else
             {
@@ -1857,7 +1916,7 @@ public:
                 break;
             }
         }
-        while (!_outBuffer.empty());
+        while (hasPendingWrites());
 
         // Restore errno from the write call.
         errno = last_errno;
@@ -1949,6 +2008,14 @@ protected:
 #endif
     }
 
+    /// Opens the file again, when queued to send, for writeFileData() to hand it to the
+    /// kernel. Returns -1 to write from its contents instead.
+    virtual int openFileToSend(const FileUtil::MappedFile& file);
+
+    /// Writes from the file with sendfile(2), given an fd from openFileToSend(),
+    /// or else from its contents with writeData().
+    int writeFileData(const FileUtil::MappedFile& file, int fd, std::size_t offset, int len);
+
     /// Override to handle writing data to socket differently.
     virtual int writeData(const char* buf, const int len)
     {
@@ -2002,6 +2069,48 @@ private:
     Buffer _inBuffer;
     Buffer _outBuffer;
 
+    /// A byte-range of a file queued for writing after the output buffer.
+    struct OutFile
+    {
+        OutFile(std::shared_ptr<const FileUtil::MappedFile> file, std::size_t offset,
+                std::size_t remaining, std::size_t bufferedBefore, int fd)
+            : _file(std::move(file))
+            , _offset(offset)
+            , _remaining(remaining)
+            , _bufferedBefore(bufferedBefore)
+            , _fd(fd)
+        {
+        }
+
+        OutFile(OutFile&& other) noexcept
+            : _file(std::move(other._file))
+            , _offset(other._offset)
+            , _remaining(other._remaining)
+            , _bufferedBefore(other._bufferedBefore)
+            , _fd(std::exchange(other._fd, -1))
+        {
+        }
+
+        OutFile(const OutFile&) = delete;
+        OutFile& operator=(const OutFile&) = delete;
+        OutFile& operator=(OutFile&&) = delete;
+
+        /// Closes the fd, if any.
+        ~OutFile();
+
+        std::shared_ptr<const FileUtil::MappedFile> _file;
+        std::size_t _offset;
+        std::size_t _remaining;
+        /// The number of bytes of _outBuffer to write before this file,
+        /// counted from the end of the previous file.
+        std::size_t _bufferedBefore;
+        /// Open only while queued, to send with sendfile(2); or -1.
+        int _fd;
+    };
+
+    std::deque<OutFile> _outFiles;
+    std::size_t _outFilesSize = 0; ///< Total bytes remaining in _outFiles.
+
     std::vector<int> _incomingFDs;
 
     /// Client handling the actual data.
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <common/FileUtil.hpp>
 #include <common/Log.hpp>
 #include <net/Ssl.hpp>
 #include <net/Socket.hpp>
@@ -200,6 +201,10 @@ public:
         return handleSslState(SSL_write(_ssl, buf, len), "write");
     }
 
+    /// We can't sendfile(2) through OpenSSL, but we can at least
+    /// encrypt straight from the contents, one chunk at a time.
+    int openFileToSend(const FileUtil::MappedFile&) override { return -1; }
+
     int getPollEvents(std::chrono::steady_clock::time_point now,
                       int64_t & timeoutMaxMicroS) override
     {
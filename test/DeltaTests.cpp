@@ -34,6 +34,7 @@ class DeltaTests : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST(testDeltaSequence);
     CPPUNIT_TEST(testRandomDeltas);
     CPPUNIT_TEST(testDeltaCopyOutOfBounds);
+    CPPUNIT_TEST(testDropCacheExceptParts);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -44,6 +45,7 @@ class DeltaTests : public CPPUNIT_NS::TestFixture
     void testDeltaSequence();
     void testRandomDeltas();
     void testDeltaCopyOutOfBounds();
+    void testDropCacheExceptParts();
 
     std::vector<char> applyDelta(const std::vector<char>& pixmap, uint32_t width, uint32_t height,
                                  const std::vector<char>& delta, const std::string_view testname);
@@ -497,6 +499,51 @@ void DeltaTests::testDeltaCopyOutOfBounds()
     assertEqual(reText2, text2, width, height, testname);
 }
 
+void DeltaTests::testDropCacheExceptParts()
+{
+    constexpr std::string_view testname = __func__;
+
+    DeltaGenerator gen;
+
+    uint32_t height, width, rowBytes;
+    std::vector<char> text =
+        Png::loadPng(TDOC "/delta-text.png", height, width, rowBytes);
+    LOK_ASSERT(height == 256 && width == 256 && rowBytes == 256*4);
+
+    // Stash the same tile of parts 0, 1 and 2 in the cache
+    std::vector<char> delta;
+    std::shared_ptr<DeltaGenerator::DeltaData> rleData;
+    for (int part = 0; part < 3; ++part)
+    {
+        LOK_ASSERT(gen.createDelta(
+                       reinterpret_cast<unsigned char *>(text.data()),
+                       0, 0, width, height, width, height,
+                       TileLocation(1, 2, 3, part, CanonicalViewId(1), 0), delta,
+                       part + 1, false, LOK_TILEMODE_RGBA, rleData) == false);
+    }
+
+    const size_t total = gen.getCacheSize();
+    LOK_ASSERT(total > 0);
+
+    // Only part 1 is shown: the other two go
+    const size_t released = gen.dropCacheExceptParts({ 1 });
+    LOK_ASSERT_EQUAL(total, released + gen.getCacheSize());
+    LOK_ASSERT_EQUAL(total / 3, gen.getCacheSize());
+
+    // Part 1 is still cached, and deltas against it work
+    std::vector<char> text2 =
+        Png::loadPng(TDOC "/delta-text2.png", height, width, rowBytes);
+    LOK_ASSERT(gen.createDelta(
+                   reinterpret_cast<unsigned char *>(text2.data()),
+                   0, 0, width, height, width, height,
+                   TileLocation(1, 2, 3, 1, CanonicalViewId(1), 0), delta,
+                   4, false, LOK_TILEMODE_RGBA, rleData) == true);
+
+    LOK_ASSERT_EQUAL(size_t(0), gen.dropCacheExceptParts({ 1 }));
+    gen.dropCache();
+    LOK_ASSERT_EQUAL(size_t(0), gen.getCacheSize());
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(DeltaTests);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -16,6 +16,8 @@
 #include <cppunit/TestAssert.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <array>
+#include <chrono>
 #include <cstddef>
 #include <memory>
 #include <unordered_map>
@@ -26,16 +28,24 @@ class FileServeTests : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST_SUITE(FileServeTests);
     CPPUNIT_TEST(testUIDefaults);
     CPPUNIT_TEST(testCSSVars);
+    CPPUNIT_TEST(testContentEncodingNegotiation);
+    CPPUNIT_TEST(testConditionalRequests);
+    CPPUNIT_TEST(testByteRanges);
     CPPUNIT_TEST(testPreProcessedFile);
     CPPUNIT_TEST(testPreProcessedFileRoundtrip);
     CPPUNIT_TEST(testPreProcessedFileSubstitution);
+    CPPUNIT_TEST(testPreProcessedFileBind);
     CPPUNIT_TEST_SUITE_END();
 
     void testUIDefaults();
     void testCSSVars();
+    void testContentEncodingNegotiation();
+    void testConditionalRequests();
+    void testByteRanges();
     void testPreProcessedFile();
     void testPreProcessedFileRoundtrip();
     void testPreProcessedFileSubstitution();
+    void testPreProcessedFileBind();
 
     void preProcessedFileSubstitution(const std::string_view testname,
                                       std::unordered_map<std::string, std::string> variables);
@@ -106,6 +116,140 @@ void FileServeTests::testCSSVars()
 }
 
 /// Tests file pre-processing through PreProcessedFile class.
+void FileServeTests::testContentEncodingNegotiation()
+{
+    constexpr std::string_view testname = __func__;
+
+    using Encoding = FileServerRequestHandler::ContentEncoding;
+    const auto negotiate = [](std::string_view acceptEncoding,
+                              const std::array<bool, FileServerRequestHandler::NumContentEncodings>&
+                                  available)
+    { return FileServerRequestHandler::negotiateContentEncoding(acceptEncoding, available); };
+
+    const std::array<bool, FileServerRequestHandler::NumContentEncodings> all{ true, true, true,
+                                                                               true };
+    const std::array<bool, FileServerRequestHandler::NumContentEncodings> gzipOnly{ true, true,
+                                                                                    false, false };
+    const std::array<bool, FileServerRequestHandler::NumContentEncodings> brotliOnly{
+        false, false, false, true
+    };
+
+    // No preference: our own order decides.
+    LOK_ASSERT(negotiate("", all) == Encoding::Identity);
+    LOK_ASSERT(negotiate("gzip, deflate, br, zstd", all) == Encoding::Brotli);
+    LOK_ASSERT(negotiate("gzip, deflate, zstd", all) == Encoding::Zstd);
+    LOK_ASSERT(negotiate("gzip, deflate, br, zstd", gzipOnly) == Encoding::Gzip);
+    LOK_ASSERT(negotiate("GZIP", all) == Encoding::Gzip);
+    LOK_ASSERT(negotiate("x-gzip", all) == Encoding::Gzip);
+
+    // The client's weights win over our order.
+    LOK_ASSERT(negotiate("br;q=0.5, gzip;q=0.8, zstd;q=0.7", all) == Encoding::Gzip);
+    LOK_ASSERT(negotiate("br;q=0.5, zstd ; q=0.9", all) == Encoding::Zstd);
+    LOK_ASSERT(negotiate("br;q=0, gzip", all) == Encoding::Gzip);
+    LOK_ASSERT(negotiate("identity;q=1, gzip;q=0.5", all) == Encoding::Identity);
+
+    // Wildcard.
+    LOK_ASSERT(negotiate("*", all) == Encoding::Brotli);
+    LOK_ASSERT(negotiate("gzip;q=1, *;q=0.1", all) == Encoding::Gzip);
+    LOK_ASSERT(negotiate("*;q=0", all) == Encoding::Identity);
+
+    // Invalid weights are treated as refusals.
+    LOK_ASSERT(negotiate("br;q=2x, gzip", all) == Encoding::Gzip);
+
+    // Fall back to identity when nothing acceptable is available.
+    LOK_ASSERT(negotiate("zstd", gzipOnly) == Encoding::Identity);
+    LOK_ASSERT(negotiate("gzip", brotliOnly) == Encoding::Identity);
+    LOK_ASSERT(negotiate("br", brotliOnly) == Encoding::Brotli);
+
+    LOK_ASSERT_EQUAL_STR("br", FileServerRequestHandler::contentEncodingName(Encoding::Brotli));
+    LOK_ASSERT_EQUAL_STR("zstd", FileServerRequestHandler::contentEncodingName(Encoding::Zstd));
+    LOK_ASSERT_EQUAL_STR("gzip", FileServerRequestHandler::contentEncodingName(Encoding::Gzip));
+}
+
+void FileServeTests::testConditionalRequests()
+{
+    constexpr std::string_view testname = __func__;
+
+    using Encoding = FileServerRequestHandler::ContentEncoding;
+    const std::string etag = FileServerRequestHandler::makeETag("0123456789abcdef", Encoding::Identity);
+    LOK_ASSERT_EQUAL_STR("\"0123456789abcdef\"", etag);
+    LOK_ASSERT_EQUAL_STR("\"0123456789abcdef-br\"",
+                         FileServerRequestHandler::makeETag("0123456789abcdef", Encoding::Brotli));
+
+    LOK_ASSERT(FileServerRequestHandler::etagMatches(etag, etag));
+    LOK_ASSERT(FileServerRequestHandler::etagMatches("W/" + etag, etag));
+    LOK_ASSERT(FileServerRequestHandler::etagMatches("\"other\", " + etag, etag));
+    LOK_ASSERT(FileServerRequestHandler::etagMatches("*", etag));
+    LOK_ASSERT(!FileServerRequestHandler::etagMatches("\"other\"", etag));
+    LOK_ASSERT(!FileServerRequestHandler::etagMatches("\"0123456789abcdef-br\"", etag));
+
+    // Sun, 06 Nov 1994 08:49:37 GMT
+    const auto lastModified = std::chrono::system_clock::from_time_t(784111777);
+    const std::string lastModifiedTime = "Sun, 06 Nov 1994 08:49:37 GMT";
+    LOK_ASSERT(!FileServerRequestHandler::isNotModified("", "", etag, lastModified));
+    LOK_ASSERT(FileServerRequestHandler::isNotModified(etag, "", etag, lastModified));
+    LOK_ASSERT(FileServerRequestHandler::isNotModified("", lastModifiedTime, etag, lastModified));
+    LOK_ASSERT(FileServerRequestHandler::isNotModified("", "Mon, 07 Nov 1994 08:49:37 GMT", etag,
+                                                       lastModified));
+    LOK_ASSERT(!FileServerRequestHandler::isNotModified("", "Sat, 05 Nov 1994 08:49:37 GMT", etag,
+                                                        lastModified));
+    LOK_ASSERT(!FileServerRequestHandler::isNotModified("", "garbage", etag, lastModified));
+
+    // If-None-Match takes precedence over If-Modified-Since.
+    LOK_ASSERT(!FileServerRequestHandler::isNotModified("\"other\"", lastModifiedTime, etag,
+                                                        lastModified));
+
+    LOK_ASSERT(FileServerRequestHandler::isRangeApplicable("", etag, lastModifiedTime));
+    LOK_ASSERT(FileServerRequestHandler::isRangeApplicable(etag, etag, lastModifiedTime));
+    LOK_ASSERT(!FileServerRequestHandler::isRangeApplicable("W/" + etag, etag, lastModifiedTime));
+    LOK_ASSERT(FileServerRequestHandler::isRangeApplicable(lastModifiedTime, etag, lastModifiedTime));
+    LOK_ASSERT(!FileServerRequestHandler::isRangeApplicable("Sat, 05 Nov 1994 08:49:37 GMT", etag,
+                                                            lastModifiedTime));
+}
+
+void FileServeTests::testByteRanges()
+{
+    constexpr std::string_view testname = __func__;
+
+    using RangeStatus = FileServerRequestHandler::RangeStatus;
+    std::size_t offset = 0;
+    std::size_t length = 0;
+    const auto parse = [&](std::string_view range, std::size_t size)
+    { return FileServerRequestHandler::parseByteRange(range, size, offset, length); };
+
+    LOK_ASSERT(parse("bytes=0-99", 1000) == RangeStatus::Partial);
+    LOK_ASSERT_EQUAL(std::size_t(0), offset);
+    LOK_ASSERT_EQUAL(std::size_t(100), length);
+
+    LOK_ASSERT(parse("bytes=900-", 1000) == RangeStatus::Partial);
+    LOK_ASSERT_EQUAL(std::size_t(900), offset);
+    LOK_ASSERT_EQUAL(std::size_t(100), length);
+
+    LOK_ASSERT(parse("bytes=-10", 1000) == RangeStatus::Partial);
+    LOK_ASSERT_EQUAL(std::size_t(990), offset);
+    LOK_ASSERT_EQUAL(std::size_t(10), length);
+
+    // Clamped to the end of the file.
+    LOK_ASSERT(parse("bytes=500-5000", 1000) == RangeStatus::Partial);
+    LOK_ASSERT_EQUAL(std::size_t(500), offset);
+    LOK_ASSERT_EQUAL(std::size_t(500), length);
+
+    LOK_ASSERT(parse("bytes=-5000", 1000) == RangeStatus::Partial);
+    LOK_ASSERT_EQUAL(std::size_t(0), offset);
+    LOK_ASSERT_EQUAL(std::size_t(1000), length);
+
+    LOK_ASSERT(parse("bytes=1000-", 1000) == RangeStatus::Unsatisfiable);
+    LOK_ASSERT(parse("bytes=-0", 1000) == RangeStatus::Unsatisfiable);
+    LOK_ASSERT(parse("bytes=0-", 0) == RangeStatus::Unsatisfiable);
+
+    LOK_ASSERT(parse("", 1000) == RangeStatus::Ignore);
+    LOK_ASSERT(parse("items=0-1", 1000) == RangeStatus::Ignore);
+    LOK_ASSERT(parse("bytes=0-1,5-6", 1000) == RangeStatus::Ignore);
+    LOK_ASSERT(parse("bytes=5-1", 1000) == RangeStatus::Ignore);
+    LOK_ASSERT(parse("bytes=a-1", 1000) == RangeStatus::Ignore);
+    LOK_ASSERT(parse("bytes=-", 1000) == RangeStatus::Ignore);
+}
+
 void FileServeTests::testPreProcessedFile()
 {
     constexpr std::string_view testname = __func__;
@@ -436,6 +580,54 @@ void FileServeTests::testPreProcessedFileSubstitution()
                                  std::unordered_map<std::string, std::string>());
 }
 
+void FileServeTests::testPreProcessedFileBind()
+{
+    constexpr std::string_view testname = __func__;
+
+    const std::unordered_map<std::string, std::string> variantVars = {
+        { "VERSION", "abcdef0123" },
+        { "SERVICE_ROOT", "/root" },
+        { "BRANDING_JS", "<script src=\"branding.js\"></script>" },
+        { "UI_THEME", "dark" }
+    };
+
+    const std::unordered_map<std::string, std::string> requestVars = {
+        { "ACCESS_TOKEN", "alksjdfiwjksnsdkafnsdl" },
+        { "CSS_VARIABLES", "<style>:root {--co-somestyle-text:#123456;}</style>" },
+        // Values are never substituted recursively.
+        { "POSTMESSAGE_ORIGIN", "%VERSION%" }
+    };
+
+    std::unordered_map<std::string, std::string> allVars = variantVars;
+    allVars.insert(requestVars.begin(), requestVars.end());
+
+    const Poco::Path path(TDIST);
+
+    std::vector<std::string> files;
+    Poco::File(path).list(files);
+    for (const std::string& file : files)
+    {
+        std::unique_ptr<std::vector<char>> data =
+            FileUtil::readFile(Poco::Path(path, file).toString());
+
+        if (data)
+        {
+            const std::string orig(data->data(), data->size());
+            const PreProcessedFile ppf(file, orig);
+
+            const PreProcessedFile bound = ppf.bind(variantVars);
+            LOK_ASSERT_EQUAL(file, bound.filename());
+            LOK_ASSERT(bound.segmentCount() <= ppf.segmentCount());
+
+            // Binding in two steps is the same as substituting in one.
+            LOK_ASSERT_EQUAL(ppf.substitute(allVars), bound.substitute(requestVars));
+
+            // And binding nothing changes nothing.
+            LOK_ASSERT_EQUAL(orig, ppf.bind({}).substitute({}));
+        }
+    }
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(FileServeTests);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -794,7 +794,8 @@ void HttpRequestTests::testPost()
     ofs.write(data.data(), data.size());
     ofs.close();
 
-    httpRequest.setBodyFile(path);
+    LOK_ASSERT(!httpRequest.setBodyFile(path + ".missing"));
+    LOK_ASSERT(httpRequest.setBodyFile(path));
 
     auto httpSession = http::Session::create(_localUri);
     if (httpSession)
@@ -35,6 +35,7 @@ class HttpWhiteBoxTests : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST(testStatusLineSerialize);
 
     CPPUNIT_TEST(testHeader);
+    CPPUNIT_TEST(testHeaderIncremental);
     CPPUNIT_TEST(testCookies);
 
     CPPUNIT_TEST(testRequestParserValidComplete);
@@ -55,6 +56,7 @@ class HttpWhiteBoxTests : public CPPUNIT_NS::TestFixture
     void testStatusLineParserValidIncomplete();
     void testStatusLineSerialize();
     void testHeader();
+    void testHeaderIncremental();
     void testCookies();
     void testRequestParserValidComplete();
     void testRequestParserValidIncomplete();
@@ -180,6 +182,39 @@ void HttpWhiteBoxTests::testHeader()
     LOK_ASSERT_EQUAL(0UL, header.size());
 }
 
+void HttpWhiteBoxTests::testHeaderIncremental()
+{
+    constexpr std::string_view testname = __func__;
+
+    const std::string data = "Host: localhost.com\r\n"
+                             "X-Folded: first\r\n"
+                             "  second\r\n"
+                             "Content-Type:text/plain  \r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "\r\n"
+                             "body";
+    const int64_t headerLen = data.find("\r\n\r\n") + 4;
+
+    // Feed the data one byte at a time, as it may arrive.
+    http::Header header;
+    for (int64_t i = 0; i < headerLen; ++i)
+    {
+        LOK_ASSERT_EQUAL_MESSAGE("i = " << i, 0L, header.parse(data.c_str(), i));
+    }
+
+    LOK_ASSERT_EQUAL(headerLen, header.parse(data.c_str(), headerLen));
+    LOK_ASSERT_EQUAL(4UL, header.size());
+    LOK_ASSERT_EQUAL_STR("localhost.com", header.get("Host"));
+    LOK_ASSERT_EQUAL_STR("first  second", header.get("X-Folded"));
+    LOK_ASSERT_EQUAL_STR("text/plain", header.getContentType());
+    LOK_ASSERT(header.getChunkedTransferEncoding());
+
+    // Overly long field names are invalid.
+    http::Header invalid;
+    const std::string longName = std::string(http::Header::MaxNameLen + 1, 'x') + ": y\r\n\r\n";
+    LOK_ASSERT_EQUAL(-1L, invalid.parse(longName.c_str(), longName.size()));
+}
+
 void HttpWhiteBoxTests::testCookies()
 {
     constexpr std::string_view testname = __func__;
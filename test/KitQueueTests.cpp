@@ -20,6 +20,9 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <chrono>
+#include <thread>
+
 /// KitQueue unit-tests.
 class KitQueueTests : public CPPUNIT_NS::TestFixture
 {
@@ -41,6 +44,11 @@ class KitQueueTests : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST(testCallbackInvalidation);
     CPPUNIT_TEST(testCallbackIndicatorValue);
     CPPUNIT_TEST(testCallbackPageSize);
+    CPPUNIT_TEST(testCallbackStateChanged);
+    CPPUNIT_TEST(testCallbackInvalidationStorm);
+    CPPUNIT_TEST(testCallbackInvalidationTrimming);
+    CPPUNIT_TEST(testCallbackQueuedTime);
+    CPPUNIT_TEST(testLoneTextInputTime);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -60,6 +68,11 @@ class KitQueueTests : public CPPUNIT_NS::TestFixture
     void testCallbackInvalidation();
     void testCallbackIndicatorValue();
     void testCallbackPageSize();
+    void testCallbackStateChanged();
+    void testCallbackInvalidationStorm();
+    void testCallbackInvalidationTrimming();
+    void testCallbackQueuedTime();
+    void testLoneTextInputTime();
 
     // Compat helper for tests
     std::string popHelper(KitQueue &queue)
@@ -720,6 +733,187 @@ void KitQueueTests::testCallbackModifiedStatusIsSkipped()
     }
 }
 
+void KitQueueTests::testCallbackStateChanged()
+{
+    constexpr std::string_view testname = __func__;
+
+    TilePrioritizer dummy;
+    KitQueue queue(dummy);
+    KitQueue::Callback item;
+
+    const std::string prefix = "callback all " + std::to_string(LOK_CALLBACK_STATE_CHANGED) + ' ';
+
+    // A later state of the same command supersedes the earlier one.
+    putCallback(queue, prefix + ".uno:Bold=true");
+    putCallback(queue, prefix + ".uno:Italic=true");
+    putCallback(queue, prefix + ".uno:Bold=false");
+
+    LOK_ASSERT_EQUAL(static_cast<size_t>(2), queue.callbackSize());
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR(".uno:Italic=true", item._payload);
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR(".uno:Bold=false", item._payload);
+    LOK_ASSERT_EQUAL(static_cast<size_t>(0), queue.callbackSize());
+}
+
+void KitQueueTests::testCallbackInvalidationStorm()
+{
+    constexpr std::string_view testname = __func__;
+
+    TilePrioritizer dummy;
+    KitQueue queue(dummy);
+    KitQueue::Callback item;
+
+    // Invalidations too far apart to be merged, interleaved with cursor moves,
+    // as when typing in a huge spreadsheet with many views. Each put must not
+    // rescan the whole queue.
+    constexpr int count = 20000;
+    const std::string invalidate =
+        "callback all " + std::to_string(LOK_CALLBACK_INVALIDATE_TILES) + ' ';
+    const std::string cursor =
+        "callback all " + std::to_string(LOK_CALLBACK_INVALIDATE_VISIBLE_CURSOR) + ' ';
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i)
+    {
+        const int x = (i % 100) * 40000;
+        const int y = (i / 100) * 40000;
+        putCallback(queue, invalidate + std::to_string(x) + ", " + std::to_string(y) +
+                               ", 1000, 1000, 0");
+        putCallback(queue, cursor + std::to_string(x) + ", " + std::to_string(y) + ", 0, 275");
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    TST_LOG("Queued " << 2 * count << " callbacks in " << elapsed.count() << "ms");
+
+    // All the invalidations, and only the last cursor.
+    LOK_ASSERT_EQUAL(static_cast<size_t>(count + 1), queue.callbackSize());
+    for (int i = 0; i < count; ++i)
+    {
+        item = queue.getCallback();
+        LOK_ASSERT_EQUAL(static_cast<int>(LOK_CALLBACK_INVALIDATE_TILES), item._type);
+    }
+
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL(static_cast<int>(LOK_CALLBACK_INVALIDATE_VISIBLE_CURSOR), item._type);
+    LOK_ASSERT_EQUAL(static_cast<size_t>(0), queue.callbackSize());
+
+    // A whole-part invalidation swallows them all.
+    for (int i = 0; i < count; ++i)
+        putCallback(queue, invalidate + std::to_string((i % 100) * 40000) + ", " +
+                               std::to_string((i / 100) * 40000) + ", 1000, 1000, 0");
+    putCallback(queue, invalidate + "EMPTY, 0");
+
+    LOK_ASSERT_EQUAL(static_cast<size_t>(1), queue.callbackSize());
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("EMPTY, 0", item._payload);
+}
+
+void KitQueueTests::testCallbackInvalidationTrimming()
+{
+    constexpr std::string_view testname = __func__;
+
+    TilePrioritizer dummy;
+    KitQueue queue(dummy);
+    KitQueue::Callback item;
+
+    // Too large to be merged, the second is trimmed to what the first misses.
+    putCallback(queue, "callback all 0 0, 0, 20000, 10000, 0");
+    putCallback(queue, "callback all 0 0, 5000, 20000, 10000, 0");
+
+    LOK_ASSERT_EQUAL(static_cast<size_t>(2), queue.callbackSize());
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("0, 0, 20000, 10000, 0", item._payload);
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("0, 10000, 20000, 5000, 0", item._payload);
+
+    // Covered by two queued ones together, none of which covers it alone.
+    putCallback(queue, "callback all 0 0, 0, 20000, 10000, 0");
+    putCallback(queue, "callback all 0 0, 10000, 20000, 10000, 0");
+    putCallback(queue, "callback all 0 1000, 5000, 18000, 10000, 0");
+
+    LOK_ASSERT_EQUAL(static_cast<size_t>(2), queue.callbackSize());
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("0, 0, 20000, 10000, 0", item._payload);
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("0, 10000, 20000, 10000, 0", item._payload);
+
+    // An L-shaped remainder isn't a rectangle: it is kept whole.
+    putCallback(queue, "callback all 0 0, 0, 20000, 10000, 0");
+    putCallback(queue, "callback all 0 10000, 5000, 20000, 10000, 0");
+
+    LOK_ASSERT_EQUAL(static_cast<size_t>(2), queue.callbackSize());
+    queue.getCallback();
+    item = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("10000, 5000, 20000, 10000, 0", item._payload);
+}
+
+void KitQueueTests::testCallbackQueuedTime()
+{
+    constexpr std::string_view testname = __func__;
+
+    TilePrioritizer dummy;
+    KitQueue queue(dummy);
+
+    const auto before = std::chrono::steady_clock::now();
+    putCallback(queue, "callback all 0 0, 0, 1000, 1000, 0");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    putCallback(queue, "callback all 0 50000, 50000, 1000, 1000, 0");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+    // Merged into the first, and queued again at the back: it has waited since the first.
+    putCallback(queue, "callback all 0 500, 500, 1000, 1000, 0");
+
+    LOK_ASSERT_EQUAL(static_cast<size_t>(2), queue.callbackSize());
+    const KitQueue::Callback unmerged = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("50000, 50000, 1000, 1000, 0", unmerged._payload);
+    const KitQueue::Callback merged = queue.getCallback();
+    LOK_ASSERT_EQUAL_STR("0, 0, 1500, 1500, 0", merged._payload);
+    LOK_ASSERT(before <= merged._queued);
+    LOK_ASSERT(merged._queued < unmerged._queued);
+}
+
+void KitQueueTests::testLoneTextInputTime()
+{
+    constexpr std::string_view testname = __func__;
+
+    TilePrioritizer dummy;
+    KitQueue queue(dummy);
+    const std::chrono::steady_clock::time_point none;
+
+    LOK_ASSERT(queue.getLoneTextInputTime() == none);
+
+    const auto before = std::chrono::steady_clock::now();
+    queue.put("child-foo textinput id=0 text=a");
+    const auto queued = queue.getLoneTextInputTime();
+    LOK_ASSERT(before <= queued);
+
+    // Merged, it still waits since the first character.
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    queue.put("child-foo textinput id=0 text=b");
+    LOK_ASSERT_EQUAL(static_cast<size_t>(1), queue.size());
+    LOK_ASSERT(queued == queue.getLoneTextInputTime());
+
+    // Not alone anymore.
+    queue.put("child-foo key type=input char=97 key=0");
+    LOK_ASSERT(queue.getLoneTextInputTime() == none);
+    queue.pop();
+    LOK_ASSERT(queue.getLoneTextInputTime() == none);
+
+    // Not at the back: the key isn't held back for the text before it.
+    queue.pop();
+    queue.put("child-foo textinput id=0 text=c");
+    queue.put("child-foo key type=input char=97 key=0");
+    queue.pop();
+    LOK_ASSERT_EQUAL(static_cast<size_t>(1), queue.size());
+    LOK_ASSERT(queue.getLoneTextInputTime() == none);
+
+    queue.pop();
+    queue.put("child-foo removetextcontext id=0 before=1 after=0");
+    LOK_ASSERT(queued < queue.getLoneTextInputTime());
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(KitQueueTests);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
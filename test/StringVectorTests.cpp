@@ -18,12 +18,16 @@ class StringVectorTests : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST_SUITE(StringVectorTests);
     CPPUNIT_TEST(testTokenizer);
     CPPUNIT_TEST(testTokenizerTokenizeAnyOf);
+    CPPUNIT_TEST(testTokenizeView);
+    CPPUNIT_TEST(testManyTokens);
     CPPUNIT_TEST(testStringVector);
     CPPUNIT_TEST(testCat);
     CPPUNIT_TEST_SUITE_END();
 
     void testTokenizer();
     void testTokenizerTokenizeAnyOf();
+    void testTokenizeView();
+    void testManyTokens();
     void testStringVector();
     void testCat();
     void testSubstrFromToken();
@@ -195,6 +199,76 @@ void StringVectorTests::testTokenizerTokenizeAnyOf()
     LOK_ASSERT_EQUAL_STR("H", tokens[7]);
 }
 
+void StringVectorTests::testTokenizeView()
+{
+    constexpr std::string_view testname = __func__;
+
+    std::string buffer = "tile nviewid=0 part=0\nbinary";
+    StringVector tokens = StringVector::tokenizeView(buffer.data(), buffer.size());
+    LOK_ASSERT_EQUAL(static_cast<std::size_t>(3), tokens.size());
+    LOK_ASSERT_EQUAL_STR("tile", tokens[0]);
+    LOK_ASSERT(tokens.equals(1, "nviewid=0"));
+    LOK_ASSERT_EQUAL_STR("part=0", tokens.getParamView(*std::prev(tokens.end())));
+
+    // The tokens refer to the buffer, and so do those of copies.
+    StringVector copy = tokens;
+    buffer[0] = 'T';
+    LOK_ASSERT_EQUAL_STR("Tile", tokens[0]);
+    LOK_ASSERT_EQUAL_STR("Tile", copy[0]);
+
+    // Modifying makes a copy of the buffer.
+    copy.push_back("mode=1");
+    buffer[0] = 't';
+    LOK_ASSERT_EQUAL_STR("Tile", copy[0]);
+    LOK_ASSERT_EQUAL_STR("mode=1", copy[3]);
+    LOK_ASSERT_EQUAL_STR("tile", tokens[0]);
+
+    // Moving keeps referring to the buffer, while moving an owner rebinds to the new string.
+    StringVector moved = std::move(tokens);
+    LOK_ASSERT_EQUAL_STR("tile", moved[0]);
+    StringVector owner = StringVector::tokenize("a b");
+    StringVector movedOwner = std::move(owner);
+    LOK_ASSERT_EQUAL_STR("b", movedOwner[1]);
+    LOK_ASSERT_EQUAL_STR("a b", movedOwner.substrFromToken(0));
+
+    LOK_ASSERT(StringVector::tokenizeView(buffer.data(), 0).empty());
+}
+
+void StringVectorTests::testManyTokens()
+{
+    constexpr std::string_view testname = __func__;
+
+    // More tokens than are stored inline.
+    std::string message;
+    for (int i = 0; i < 40; ++i)
+        message += std::to_string(i) + ' ';
+
+    StringVector tokens = StringVector::tokenize(message);
+    LOK_ASSERT_EQUAL(static_cast<std::size_t>(40), tokens.size());
+    LOK_ASSERT_EQUAL_STR("0", tokens[0]);
+    LOK_ASSERT_EQUAL_STR("39", tokens[39]);
+    LOK_ASSERT_EQUAL(static_cast<std::ptrdiff_t>(40), std::distance(tokens.begin(), tokens.end()));
+
+    const StringVector copy = tokens;
+    LOK_ASSERT_EQUAL_STR("17", copy[17]);
+
+    tokens.erase(tokens.begin());
+    LOK_ASSERT_EQUAL(static_cast<std::size_t>(39), tokens.size());
+    LOK_ASSERT_EQUAL_STR("1", tokens[0]);
+    LOK_ASSERT_EQUAL_STR("0", copy[0]);
+
+    StringVector few = StringVector::tokenize("a b c");
+    few.erase(few.begin() + 1);
+    LOK_ASSERT_EQUAL(static_cast<std::size_t>(2), few.size());
+    LOK_ASSERT_EQUAL_STR("c", few[1]);
+
+    for (int i = 0; i < 20; ++i)
+        few.push_back(std::to_string(i));
+    LOK_ASSERT_EQUAL(static_cast<std::size_t>(22), few.size());
+    LOK_ASSERT_EQUAL_STR("a c 0 1", few.cat(' ', 0, 3));
+    LOK_ASSERT_EQUAL_STR("19", few[21]);
+}
+
 void StringVectorTests::testStringVector()
 {
     constexpr std::string_view testname = __func__;
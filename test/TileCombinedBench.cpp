@@ -0,0 +1,103 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This file is part of the LibreOffice project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/*
+ * Counts the heap allocations, and times, the parsing and serializing
+ * of tilecombine messages. This replaces the global operator new, so it
+ * must remain a program of its own.
+ */
+
+#include <config.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <common/StringVector.hpp>
+#include <wsd/TileDesc.hpp>
+
+bool EnableExperimental = false;
+
+namespace
+{
+std::size_t AllocationCount = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    ++AllocationCount;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace
+{
+constexpr int Iterations = 100000;
+
+/// Runs func Iterations times and reports the allocations and time per call.
+template <typename Func> void measure(const std::string_view name, Func func)
+{
+    const std::size_t allocations = AllocationCount;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < Iterations; ++i)
+        func();
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": "
+              << static_cast<double>(AllocationCount - allocations) / Iterations
+              << " allocations, "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() /
+                     Iterations
+              << " ns per message\n";
+}
+}
+
+int main()
+{
+    // A typical request from the browser: two rows of four tiles.
+    const std::string message =
+        "tilecombine nviewid=0 part=0 width=256 height=256 "
+        "tileposx=0,3840,7680,11520,0,3840,7680,11520 "
+        "tileposy=0,0,0,0,3840,3840,3840,3840 oldwid=1,2,3,4,5,6,7,8 "
+        "tilewidth=3840 tileheight=3840";
+
+    const StringVector tokens = StringVector::tokenize(message);
+    const TileCombined tileCombined = TileCombined::parse(message);
+
+    std::size_t total = 0;
+    measure("parse(string_view)",
+            [&]() { total += TileCombined::parse(message).getTiles().size(); });
+    measure("parse(StringVector)",
+            [&]() { total += TileCombined::parse(tokens).getTiles().size(); });
+    measure("serialize()",
+            [&]() { total += tileCombined.serialize("tilecombine:").size(); });
+
+    std::string buffer;
+    measure("serialize(buffer)",
+            [&]()
+            {
+                buffer.clear();
+                tileCombined.serialize("tilecombine:", std::string_view(), buffer);
+                total += buffer.size();
+            });
+
+    // Keep the work from being optimized away.
+    return total == 0;
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,163 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * Copyright the Collabora Online contributors.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <config.h>
+
+#include "HttpRequest.hpp"
+#include "lokassert.hpp"
+
+#include <WopiTestServer.hpp>
+#include <Log.hpp>
+#include <Unit.hpp>
+#include <UnitHTTP.hpp>
+#include <helpers.hpp>
+#include <wsd/LOOLWSD.hpp>
+#include <Poco/Net/HTTPRequest.h>
+
+/// Test hibernating a modified document, and waking it up.
+/// We modify the document and ask it to hibernate, which saves and uploads first.
+/// Then we type while it's dormant, which must reload it and replay our input.
+class UnitHibernate : public WopiTestServer
+{
+    STATE_ENUM(Phase, Load, WaitLoadStatus, WaitModified, WaitPutFile, WaitHibernated,
+               WaitWokeUp, WaitModifiedAgain, WaitPutFileAgain, WaitDestroy)
+    _phase;
+
+    std::string _docKey;
+
+public:
+    UnitHibernate()
+        : WopiTestServer("UnitHibernate")
+        , _phase(Phase::Load)
+    {
+    }
+
+    void onDocBrokerCreate(const std::string& docKey) override
+    {
+        _docKey = docKey;
+    }
+
+    std::unique_ptr<http::Response>
+    assertPutFileRequest(const Poco::Net::HTTPRequest& request) override
+    {
+        // The document is modified, both times.
+        LOK_ASSERT_EQUAL_STR("true", request.get("X-LOOL-WOPI-IsModifiedByUser"));
+
+        if (_phase == Phase::WaitPutFile)
+        {
+            // Saved and uploaded to hibernate; the broker tries again by itself.
+            TRANSITION_STATE(_phase, Phase::WaitHibernated);
+            return std::make_unique<http::Response>(http::StatusCode::OK);
+        }
+
+        LOK_ASSERT_STATE(_phase, Phase::WaitPutFileAgain);
+        TRANSITION_STATE(_phase, Phase::WaitDestroy);
+        return std::make_unique<http::Response>(http::StatusCode::OK);
+    }
+
+    /// The document is loaded.
+    bool onDocumentLoaded(const std::string& message) override
+    {
+        TST_LOG("onDocumentLoaded: [" << message << ']');
+        if (_phase != Phase::WaitLoadStatus)
+        {
+            // Reloaded in the new Kit.
+            LOK_ASSERT_STATE(_phase, Phase::WaitWokeUp);
+            return true;
+        }
+
+        TRANSITION_STATE(_phase, Phase::WaitModified);
+
+        WSD_CMD("key type=input char=97 key=0");
+        WSD_CMD("key type=up char=0 key=512");
+
+        return true;
+    }
+
+    bool onDocumentModified(const std::string& message) override
+    {
+        TST_LOG("onDocumentModified: [" << message << ']');
+        if (_phase == Phase::WaitModified)
+        {
+            // Must save and upload before it can hibernate.
+            TRANSITION_STATE(_phase, Phase::WaitPutFile);
+            LOOLWSD::hibernateDocument(_docKey);
+            return true;
+        }
+
+        // Reloaded unmodified, so the input we typed while dormant reached the new Kit.
+        LOK_ASSERT_STATE(_phase, Phase::WaitModifiedAgain);
+        TRANSITION_STATE(_phase, Phase::WaitPutFileAgain);
+        WSD_CMD("closedocument");
+
+        return true;
+    }
+
+    void onDocBrokerHibernated(const std::string& docKey) override
+    {
+        TST_LOG("Hibernated dockey [" << docKey << ']');
+        LOK_ASSERT_STATE(_phase, Phase::WaitHibernated);
+        LOK_ASSERT_EQUAL(_docKey, docKey);
+
+        TRANSITION_STATE(_phase, Phase::WaitWokeUp);
+
+        // Held while dormant, and wakes the document up.
+        WSD_CMD("key type=input char=98 key=0");
+        WSD_CMD("key type=up char=0 key=512");
+    }
+
+    void onDocBrokerWokeUp(const std::string& docKey) override
+    {
+        TST_LOG("Woke up dockey [" << docKey << ']');
+        LOK_ASSERT_STATE(_phase, Phase::WaitWokeUp);
+
+        TRANSITION_STATE(_phase, Phase::WaitModifiedAgain);
+    }
+
+    // Wait for clean unloading.
+    void onDocBrokerDestroy(const std::string& docKey) override
+    {
+        TST_LOG("Destroyed dockey [" << docKey << ']');
+        LOK_ASSERT_STATE(_phase, Phase::WaitDestroy);
+
+        passTest("Document hibernated, woke up, and unloaded as expected.");
+    }
+
+    void invokeWSDTest() override
+    {
+        switch (_phase)
+        {
+            case Phase::Load:
+            {
+                TRANSITION_STATE(_phase, Phase::WaitLoadStatus);
+
+                TST_LOG("Load: initWebsocket.");
+                initWebsocket("/wopi/files/0?access_token=anything");
+
+                WSD_CMD("load url=" + getWopiSrc());
+                break;
+            }
+            case Phase::WaitLoadStatus:
+            case Phase::WaitModified:
+            case Phase::WaitPutFile:
+            case Phase::WaitHibernated:
+            case Phase::WaitWokeUp:
+            case Phase::WaitModifiedAgain:
+            case Phase::WaitPutFileAgain:
+            case Phase::WaitDestroy:
+                break;
+        }
+    }
+};
+
+UnitBase* unit_create_wsd(void) { return new UnitHibernate(); }
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -19,6 +19,9 @@
 #include <iomanip>
 #include <sstream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 /// Util unit-tests.
 class UtilTests : public CPPUNIT_NS::TestFixture
 {
@@ -34,6 +37,9 @@ class UtilTests : public CPPUNIT_NS::TestFixture
 #endif
     CPPUNIT_TEST(testEliminatePrefix);
     CPPUNIT_TEST(testStreamMatch);
+#if !MOBILEAPP
+    CPPUNIT_TEST(testProcStats);
+#endif
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -45,6 +51,7 @@ class UtilTests : public CPPUNIT_NS::TestFixture
     void testUtf8();
     void testEliminatePrefix();
     void testStreamMatch();
+    void testProcStats();
 };
 
 void UtilTests::testStringifyHexLine()
@@ -239,6 +246,34 @@ void UtilTests::testStreamMatch()
     LOK_ASSERT_EQUAL_STR(final, os.str());
 }
 
+void UtilTests::testProcStats()
+{
+    constexpr auto testname = __func__;
+
+    const int fd = open("/proc/self/stat", O_RDONLY);
+    LOK_ASSERT(fd >= 0);
+
+    Util::ProcStat stat;
+    LOK_ASSERT(Util::getProcStat(fd, stat));
+    LOK_ASSERT(stat._threadCount >= 1);
+    LOK_ASSERT(stat._jiffies <= Util::getCpuUsage(getpid()));
+
+    // The same fd is re-read from the start every time.
+    const std::size_t jiffies = stat._jiffies;
+    LOK_ASSERT(Util::getProcStat(fd, stat));
+    LOK_ASSERT(stat._jiffies >= jiffies);
+    close(fd);
+
+    // Full smaps is much bigger than the scan buffer.
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    LOK_ASSERT(smaps != nullptr);
+    const std::pair<std::size_t, std::size_t> pssAndDirty = Util::getPssAndDirtyFromSMaps(smaps);
+    LOK_ASSERT(pssAndDirty.first > 0);
+    LOK_ASSERT(pssAndDirty.second > 0);
+    LOK_ASSERT(pssAndDirty.second <= pssAndDirty.first);
+    fclose(smaps);
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(UtilTests);
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -10,8 +10,11 @@
 #include <config.h>
 
 #include <common/Anonymizer.hpp>
+#include <common/CommandTable.hpp>
 #include <common/Common.hpp>
+#include <common/Histogram.hpp>
 #include <common/FileUtil.hpp>
+#include <common/JsonScanner.hpp>
 #include <common/JsonUtil.hpp>
 #include <common/Message.hpp>
 #include <common/Protocol.hpp>
@@ -19,6 +22,9 @@
 #include <common/StateEnum.hpp>
 #include <common/ThreadPool.hpp>
 #include <common/Util.hpp>
+#include <wsd/KeystrokeLatency.hpp>
+#include <wsd/LoadProfile.hpp>
+#include <wsd/PrespawnPolicy.hpp>
 #include <wsd/TileCache.hpp>
 #include <wsd/TileDesc.hpp>
 
@@ -30,6 +36,7 @@
 #include <chrono>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <sstream>
@@ -53,21 +60,32 @@ class WhiteBoxTests : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST(testRegexListMatcher);
     CPPUNIT_TEST(testRegexListMatcher_Init);
     CPPUNIT_TEST(testTileDesc);
+    CPPUNIT_TEST(testTileCombinedBinary);
     CPPUNIT_TEST(testTileData);
     CPPUNIT_TEST(testRectanglesIntersect);
+    CPPUNIT_TEST(testRegion);
     CPPUNIT_TEST(testJson);
+    CPPUNIT_TEST(testJsonScanner);
     CPPUNIT_TEST(testAnonymization);
     CPPUNIT_TEST(testIso8601Time);
     CPPUNIT_TEST(testGetTimeForLog);
     CPPUNIT_TEST(testClockAsString);
     CPPUNIT_TEST(testStat);
+    CPPUNIT_TEST(testMappedFile);
+    CPPUNIT_TEST(testLinkAtomic);
     CPPUNIT_TEST(testStringCompare);
     CPPUNIT_TEST(testSafeAtoi);
     CPPUNIT_TEST(testJsonUtilEscapeJSONValue);
     CPPUNIT_TEST(testStateEnum);
+    CPPUNIT_TEST(testCommandTable);
     CPPUNIT_TEST(testFindInVector);
     CPPUNIT_TEST(testJoinPair);
     CPPUNIT_TEST(testThreadPool);
+    CPPUNIT_TEST(testThreadPoolSingleRun);
+    CPPUNIT_TEST(testPrespawnPolicy);
+    CPPUNIT_TEST(testLoadProfile);
+    CPPUNIT_TEST(testDelayHistogram);
+    CPPUNIT_TEST(testKeystrokeLatency);
     CPPUNIT_TEST_SUITE_END();
 
     void testLOOLProtocolFunctions();
@@ -82,21 +100,32 @@ class WhiteBoxTests : public CPPUNIT_NS::TestFixture
     void testRegexListMatcher();
     void testRegexListMatcher_Init();
     void testTileDesc();
+    void testTileCombinedBinary();
     void testTileData();
     void testRectanglesIntersect();
+    void testRegion();
     void testJson();
+    void testJsonScanner();
     void testAnonymization();
     void testIso8601Time();
     void testGetTimeForLog();
     void testClockAsString();
     void testStat();
+    void testMappedFile();
+    void testLinkAtomic();
     void testStringCompare();
     void testSafeAtoi();
     void testJsonUtilEscapeJSONValue();
     void testStateEnum();
+    void testCommandTable();
     void testFindInVector();
     void testJoinPair();
     void testThreadPool();
+    void testThreadPoolSingleRun();
+    void testPrespawnPolicy();
+    void testLoadProfile();
+    void testDelayHistogram();
+    void testKeystrokeLatency();
 
     size_t waitForThreads(size_t count);
 };
@@ -607,6 +636,71 @@ void WhiteBoxTests::testTileDesc()
     }
 }
 
+void WhiteBoxTests::testTileCombinedBinary()
+{
+    constexpr std::string_view testname = __func__;
+
+    const std::string text =
+        "tilecombine: nviewid=0 part=5 width=256 height=256 tileposx=0,3840,7680 "
+        "tileposy=0,0,3840 imgsize=10,20,30 tilewidth=3840 tileheight=3840 ver=-1,2,3 "
+        "oldwid=0,4,5 wid=6,7,8 mode=1";
+    const std::string binary = TileCombined::parse(text).serializeBinary();
+    LOK_ASSERT(binary.starts_with("tilebin:\n"));
+
+    // The images follow the header.
+    const std::string message = binary + std::string(60, 'x');
+    std::size_t offset = 0;
+    const TileCombined combined =
+        TileCombined::parseBinary(message.data(), message.size(), offset);
+    LOK_ASSERT_EQUAL(binary.size(), offset);
+    LOK_ASSERT_EQUAL(text, combined.serialize("tilecombine:"));
+
+    const auto isRejected = [](const std::string& header)
+    {
+        try
+        {
+            std::size_t size = 0;
+            TileCombined::parseBinary(header.data(), header.size(), size);
+        }
+        catch (const BadArgumentException&)
+        {
+            return true;
+        }
+
+        return false;
+    };
+
+    LOK_ASSERT(isRejected(binary.substr(0, binary.size() - 1)));
+    LOK_ASSERT(isRejected(text));
+
+    std::string version = binary;
+    ++version[TileCombined::BinaryToken.size() + 1];
+    LOK_ASSERT(isRejected(version));
+
+    // A negative width.
+    std::string width = binary;
+    const std::int32_t negative = -256;
+    std::memcpy(&width[TileCombined::BinaryToken.size() + 1 + 5 * sizeof(negative)], &negative,
+                sizeof(negative));
+    LOK_ASSERT(isRejected(width));
+
+    // A preview keeps its id, to match the request being rendered.
+    const TileDesc preview = TileDesc::parse(
+        "tile: nviewid=0 part=2 width=180 height=135 tileposx=0 tileposy=0 tilewidth=15875 "
+        "tileheight=11906 ver=9 id=3");
+    const std::string previewBinary = TileCombined(preview).serializeBinary();
+    const TileCombined previewCombined =
+        TileCombined::parseBinary(previewBinary.data(), previewBinary.size(), offset);
+    LOK_ASSERT_EQUAL(previewBinary.size(), offset);
+    LOK_ASSERT_EQUAL(std::size_t(1), previewCombined.getTiles().size());
+    LOK_ASSERT(previewCombined.getTiles()[0].isPreview());
+    LOK_ASSERT_EQUAL(3, previewCombined.getTiles()[0].getId());
+    LOK_ASSERT(previewCombined.getTiles()[0] == preview);
+
+    // The tiles that are not previews have none.
+    LOK_ASSERT_EQUAL(-1, combined.getTiles()[0].getId());
+}
+
 void WhiteBoxTests::testTileData()
 {
     constexpr std::string_view testname = __func__;
@@ -691,6 +785,50 @@ void WhiteBoxTests::testRectanglesIntersect()
                                                   1000, 1000, 2000, 1000));
 }
 
+void WhiteBoxTests::testRegion()
+{
+    constexpr std::string_view testname = __func__;
+
+    // An L shape is two rectangles, not its bounds.
+    Util::Region region(Util::Rectangle(0, 0, 1000, 100));
+    region.unite(Util::Rectangle(0, 0, 100, 1000));
+    LOK_ASSERT_EQUAL(static_cast<size_t>(2), region.getRectangles().size());
+    LOK_ASSERT_EQUAL(static_cast<std::int64_t>(1000 * 100 + 100 * 900), region.getArea());
+    LOK_ASSERT(region.contains(Util::Rectangle(0, 500, 100, 500)));
+    LOK_ASSERT(!region.contains(Util::Rectangle(500, 500, 10, 10)));
+    LOK_ASSERT(!region.overlaps(Util::Rectangle(500, 500, 10, 10)));
+    LOK_ASSERT(region.getBounds() == Util::Rectangle(0, 0, 1000, 1000));
+
+    // Touching edges don't overlap; neighbours sharing an edge are merged.
+    LOK_ASSERT(!region.overlaps(Util::Rectangle(1000, 0, 10, 10)));
+    region.unite(Util::Rectangle(1000, 0, 500, 100));
+    LOK_ASSERT_EQUAL(static_cast<size_t>(2), region.getRectangles().size());
+    LOK_ASSERT(region.contains(Util::Rectangle(0, 0, 1500, 100)));
+
+    // A hole in the middle.
+    Util::Region square(Util::Rectangle(0, 0, 300, 300));
+    square.subtract(Util::Rectangle(100, 100, 100, 100));
+    LOK_ASSERT_EQUAL(static_cast<std::int64_t>(300 * 300 - 100 * 100), square.getArea());
+    LOK_ASSERT(!square.overlaps(Util::Rectangle(100, 100, 100, 100)));
+    LOK_ASSERT(square.contains(Util::Rectangle(0, 0, 300, 100)));
+
+    square.subtract(Util::Rectangle(-10, -10, 1000, 1000));
+    LOK_ASSERT(square.isEmpty());
+
+    Util::Region clipped(Util::Rectangle(0, 0, 300, 300));
+    clipped.intersect(Util::Rectangle(200, 200, 300, 300));
+    LOK_ASSERT_EQUAL(static_cast<size_t>(1), clipped.getRectangles().size());
+    LOK_ASSERT(clipped.getRectangles()[0] == Util::Rectangle(200, 200, 100, 100));
+
+    // The tile cache invalidates the same tiles as the client requests:
+    // not those merely touching the edge of the invalidation.
+    const CanonicalViewId view = CanonicalViewId::None;
+    const TileDesc tile(view, 0, 0, 256, 256, 3840, 3840, 3840, 3840, -1, 0, -1);
+    LOK_ASSERT(TileCache::intersectsTile(tile, 0, 0, 3000, 3000, 1000, 1000, view));
+    LOK_ASSERT(!TileCache::intersectsTile(tile, 0, 0, 0, 0, 3840, 3840, view));
+    LOK_ASSERT(!TileCache::intersectsTile(tile, 0, 0, 7680, 3840, 100, 100, view));
+}
+
 void WhiteBoxTests::testJson()
 {
     constexpr std::string_view testname = __func__;
@@ -725,6 +863,61 @@ void WhiteBoxTests::testJson()
     LOK_ASSERT_EQUAL_STR("user@user.com", sValue);
 }
 
+void WhiteBoxTests::testJsonScanner()
+{
+    constexpr std::string_view testname = __func__;
+
+    // As LOK sends them, with a nested object to skip.
+    const std::string cursor =
+        "invalidatecursor: { \"viewId\": \"1\", \"rectangle\": \"3120, 1815, 0, 276\", "
+        "\"hyperlink\": { \"text\": \"a } \\\" b\", \"link\": [1, {}] }, \"part\": 2, "
+        "\"name\": \"caf\\u00e9 \\\"\\/\\\\\\n\\ud83d\\ude00\" }";
+
+    int value = 0;
+    LOK_ASSERT(JsonScanner::getInteger(cursor, "viewId", value));
+    LOK_ASSERT_EQUAL(1, value);
+    LOK_ASSERT(JsonScanner::getInteger(cursor, "part", value));
+    LOK_ASSERT_EQUAL(2, value);
+    LOK_ASSERT(!JsonScanner::getInteger(cursor, "rectangle", value));
+    LOK_ASSERT(!JsonScanner::getInteger(cursor, "missing", value));
+    LOK_ASSERT_EQUAL(2, value);
+
+    std::string text;
+    LOK_ASSERT(JsonScanner::getString(cursor, "rectangle", text));
+    LOK_ASSERT_EQUAL_STR("3120, 1815, 0, 276", text);
+    LOK_ASSERT(JsonScanner::getString(cursor, "name", text));
+    LOK_ASSERT_EQUAL_STR("caf\xc3\xa9 \"/\\\n\xf0\x9f\x98\x80", text);
+    LOK_ASSERT(!JsonScanner::getString(cursor, "part", text));
+
+    // Only the top-level members are found.
+    LOK_ASSERT(!JsonScanner::getString(cursor, "text", text));
+    LOK_ASSERT_EQUAL_STR("{ \"text\": \"a } \\\" b\", \"link\": [1, {}] }",
+                         JsonScanner::findValue(cursor, "hyperlink"));
+    LOK_ASSERT_EQUAL_STR("2", JsonScanner::findValue(cursor, "part"));
+    LOK_ASSERT(JsonScanner::findValue(cursor, "link").empty());
+
+    // Malformed objects read as empty.
+    LOK_ASSERT(!JsonScanner::getString("", "a", text));
+    LOK_ASSERT(!JsonScanner::getString("{ \"a\" \"b\" }", "a", text));
+    LOK_ASSERT(!JsonScanner::getString("{ \"b\": [1, 2, \"a\": \"c\" }", "a", text));
+    LOK_ASSERT(!JsonScanner::getString("{ \"a\": \"unterminated }", "a", text));
+
+    std::string json = "{ \"id\": \"media\", \"url\": \"file:///tmp/a.mp4\" }";
+    LOK_ASSERT(JsonScanner::setValue(json, "url", "\"https://host/media?tag=1\""));
+    LOK_ASSERT(JsonScanner::setValue(json, "mimeType", "\"video/mp4\""));
+    LOK_ASSERT_EQUAL_STR("{ \"id\": \"media\", \"url\": \"https://host/media?tag=1\", "
+                         "\"mimeType\": \"video/mp4\" }",
+                         json);
+
+    json = "prefix: {}";
+    LOK_ASSERT(JsonScanner::setValue(json, "a", "1"));
+    LOK_ASSERT_EQUAL_STR("prefix: {\"a\": 1}", json);
+
+    json = "[1, 2]";
+    LOK_ASSERT(!JsonScanner::setValue(json, "a", "1"));
+    LOK_ASSERT_EQUAL_STR("[1, 2]", json);
+}
+
 void WhiteBoxTests::testAnonymization()
 {
     constexpr std::string_view testname = __func__;
@@ -983,6 +1176,110 @@ void WhiteBoxTests::testStat()
     FileUtil::removeFile(tmpFile);
 }
 
+void WhiteBoxTests::testMappedFile()
+{
+    constexpr std::string_view testname = __func__;
+
+    FileUtil::MappedFile missing("/missing/file/path");
+    LOK_ASSERT(!missing.isValid());
+    LOK_ASSERT_EQUAL(std::size_t(0), missing.size());
+
+    const std::string tmpFile = FileUtil::getSysTempDirectoryPath() + "/test_mapped_file";
+    {
+        std::ofstream ofs(tmpFile);
+        ofs << "Hello, mapped world!";
+    }
+
+    {
+        // Small files are read, not mapped.
+        FileUtil::MappedFile file(tmpFile);
+        LOK_ASSERT(file.isValid());
+        LOK_ASSERT(!file.isMapped());
+        LOK_ASSERT_EQUAL_STR("Hello, mapped world!", file.view());
+        LOK_ASSERT_EQUAL(-1, file.openAgain());
+    }
+
+    const std::string data(FileUtil::MappedFile::MinMappedSize, 'x');
+    {
+        std::ofstream ofs(tmpFile);
+        ofs << data;
+    }
+
+    {
+        FileUtil::MappedFile file(tmpFile);
+        LOK_ASSERT(file.isValid());
+        LOK_ASSERT(file.isMapped());
+        LOK_ASSERT(file.view() == data);
+
+        const int fd = file.openAgain();
+        LOK_ASSERT(fd >= 0);
+        FileUtil::closeFD(fd);
+
+        // Replaced, as when installing: the mapping is intact, but can't be opened again.
+        const std::string newFile = tmpFile + ".new";
+        {
+            std::ofstream ofs(newFile);
+            ofs << data;
+        }
+
+        LOK_ASSERT_EQUAL(0, ::rename(newFile.c_str(), tmpFile.c_str()));
+        LOK_ASSERT_EQUAL(-1, file.openAgain());
+        LOK_ASSERT(file.view() == data);
+    }
+
+    FileUtil::removeFile(tmpFile);
+
+    const auto memFile = FileUtil::MappedFile::create(data);
+    LOK_ASSERT(memFile);
+    LOK_ASSERT(memFile->isValid());
+    LOK_ASSERT_EQUAL(data.size(), memFile->size());
+    LOK_ASSERT(memFile->view() == data);
+
+    const auto emptyFile = FileUtil::MappedFile::create(std::string());
+    LOK_ASSERT(emptyFile);
+    LOK_ASSERT(emptyFile->isValid());
+    LOK_ASSERT_EQUAL(std::size_t(0), emptyFile->size());
+    LOK_ASSERT(emptyFile->view().empty());
+}
+
+void WhiteBoxTests::testLinkAtomic()
+{
+    constexpr std::string_view testname = __func__;
+
+    const std::string tmpFile = FileUtil::getSysTempDirectoryPath() + "/test_link_atomic";
+    const std::string linkFile = tmpFile + ".upload";
+    {
+        std::ofstream ofs(linkFile);
+        ofs << "Previous";
+    }
+    {
+        std::ofstream ofs(tmpFile);
+        ofs << "Saved";
+    }
+
+    // Replaces the existing file, sharing the data.
+    LOK_ASSERT(FileUtil::linkAtomic(tmpFile, linkFile));
+    LOK_ASSERT_EQUAL(FileUtil::Stat(tmpFile).inodeNumber(), FileUtil::Stat(linkFile).inodeNumber());
+    LOK_ASSERT_EQUAL(std::size_t(2), FileUtil::Stat(tmpFile).hardLinkCount());
+
+    // Again, over a link to the same file, without leaving a stray one behind.
+    LOK_ASSERT(FileUtil::linkAtomic(tmpFile, linkFile));
+    LOK_ASSERT_EQUAL(std::size_t(2), FileUtil::Stat(tmpFile).hardLinkCount());
+
+    // Saving to a new file, and renaming it over, leaves the link as it was.
+    {
+        std::ofstream ofs(tmpFile + ".new");
+        ofs << "Saved again";
+    }
+    LOK_ASSERT_EQUAL(0, ::rename((tmpFile + ".new").c_str(), tmpFile.c_str()));
+    LOK_ASSERT_EQUAL_STR("Saved", FileUtil::MappedFile(linkFile).view());
+
+    LOK_ASSERT(!FileUtil::linkAtomic(tmpFile + ".missing", linkFile));
+
+    FileUtil::removeFile(tmpFile);
+    FileUtil::removeFile(linkFile);
+}
+
 void WhiteBoxTests::testStringCompare()
 {
     constexpr std::string_view testname = __func__;
@@ -1103,6 +1400,49 @@ void WhiteBoxTests::testStateEnum()
     oss.str("");
 }
 
+void WhiteBoxTests::testCommandTable()
+{
+    constexpr std::string_view testname = __func__;
+
+    enum class Fruit
+    {
+        Unknown,
+        Apple,
+        Banana,
+        Cherry
+    };
+
+    // Deliberately not sorted.
+    static constexpr auto Fruits = makeCommandTable<Fruit>(
+        { { "cherry", Fruit::Cherry }, { "apple", Fruit::Apple }, { "banana", Fruit::Banana } });
+    static_assert(!Fruits.hasDuplicates());
+    static_assert(Fruits.find("banana", Fruit::Unknown) == Fruit::Banana);
+
+    LOK_ASSERT(Fruits.find("apple", Fruit::Unknown) == Fruit::Apple);
+    LOK_ASSERT(Fruits.find("banana", Fruit::Unknown) == Fruit::Banana);
+    LOK_ASSERT(Fruits.find("cherry", Fruit::Unknown) == Fruit::Cherry);
+    LOK_ASSERT(Fruits.find("", Fruit::Unknown) == Fruit::Unknown);
+    LOK_ASSERT(Fruits.find("appl", Fruit::Unknown) == Fruit::Unknown);
+    LOK_ASSERT(Fruits.find("apples", Fruit::Unknown) == Fruit::Unknown);
+    LOK_ASSERT(Fruits.find("zucchini", Fruit::Unknown) == Fruit::Unknown);
+
+    constexpr auto Duplicates = makeCommandTable<Fruit>(
+        { { "apple", Fruit::Apple }, { "banana", Fruit::Banana }, { "apple", Fruit::Cherry } });
+    static_assert(Duplicates.hasDuplicates());
+
+    using LOOLProtocol::ClientCommand;
+    LOK_ASSERT(LOOLProtocol::getClientCommand("key") == ClientCommand::Key);
+    LOK_ASSERT(LOOLProtocol::getClientCommand("textinput") == ClientCommand::TextInput);
+    LOK_ASSERT(LOOLProtocol::getClientCommand("DEBUG") == ClientCommand::Debug);
+    LOK_ASSERT(LOOLProtocol::getClientCommand("switch_request") == ClientCommand::SwitchRequest);
+    LOK_ASSERT(LOOLProtocol::getClientCommand("debug") == ClientCommand::Unknown);
+    LOK_ASSERT(LOOLProtocol::getClientCommand("keys") == ClientCommand::Unknown);
+
+    const StringVector tokens = StringVector::tokenize("mouse type=buttondown x=1 y=2");
+    LOK_ASSERT(LOOLProtocol::getClientCommand(tokens.getView(0)) == ClientCommand::Mouse);
+    LOK_ASSERT(tokens.getView(4).empty());
+}
+
 void WhiteBoxTests::testFindInVector()
 {
     constexpr std::string_view testname = __func__;
@@ -1192,6 +1532,259 @@ void WhiteBoxTests::testThreadPool()
     pool.start();
     LOK_ASSERT_EQUAL(size_t(7), pool._threads.size());
 //    LOK_ASSERT_EQUAL(size_t(7 + existingUnrelatedThreads), waitForThreads(8 + existingUnrelatedThreads));
+
+    // The work is dealt into the queue of each thread, and all of it is done,
+    // whichever thread takes or steals it.
+    LOK_ASSERT_EQUAL(size_t(8), pool._queues.size());
+    for (int run = 0; run < 10; ++run)
+    {
+        std::atomic<int> done(0);
+        const int items = 1 + run * 7;
+        for (int i = 0; i < items; ++i)
+            pool.pushWork([&done]() { ++done; });
+        LOK_ASSERT_EQUAL(size_t(items), pool.count());
+
+        pool.run();
+        LOK_ASSERT_EQUAL(items, done.load());
+        LOK_ASSERT_EQUAL(size_t(0), pool.count());
+    }
+}
+
+void WhiteBoxTests::testThreadPoolSingleRun()
+{
+    constexpr std::string_view testname = __func__;
+    // coverity[tainted_data_argument : FALSE] - we trust this variable in tests
+    setenv("MAX_CONCURRENCY","4",1);
+    // coverity[tainted_argument] : don't warn that getenv("MAX_CONCURRENCY") is tainted
+    ThreadPool pool;
+
+    // A threaded run, which the caller may drain before the threads wake up,
+    // then a single item, which such a late thread can take: run() must not
+    // return before it is done.
+    for (int run = 0; run < 200; ++run)
+    {
+        std::atomic<int> done(0);
+        for (int i = 0; i < 4; ++i)
+            pool.pushWork([&done]() { ++done; });
+        pool.run();
+        LOK_ASSERT_EQUAL(4, done.load());
+
+        pool.pushWork(
+            [&done]()
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                ++done;
+            });
+        pool.run();
+        LOK_ASSERT_EQUAL(5, done.load());
+        LOK_ASSERT_EQUAL(size_t(0), pool._working);
+        LOK_ASSERT_EQUAL(size_t(0), pool.count());
+    }
+}
+
+void WhiteBoxTests::testPrespawnPolicy()
+{
+    constexpr std::string_view testname = __func__;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Fixed pool: always the minimum.
+    PrespawnPolicy fixed(2, 2, 0);
+    for (int i = 0; i < 100; ++i)
+        fixed.recordDemand("", false, start, 10);
+    LOK_ASSERT_EQUAL(2U, fixed.getTarget("", start, 10));
+
+    PrespawnPolicy policy;
+    policy.configure(1, 8, 0);
+    LOK_ASSERT_EQUAL(1U, policy.getTarget("", start, 10));
+
+    const uint64_t hits = PrespawnPolicy::getHitCount();
+    const uint64_t misses = PrespawnPolicy::getMissCount();
+
+    // A burst of 300 loads in 100 seconds, each kit taking 2 seconds to spawn.
+    policy.recordSpawnLatency("", std::chrono::milliseconds(2000));
+    auto now = start;
+    for (int i = 0; i < 300; ++i)
+    {
+        policy.recordDemand("", i % 2 == 0, now, 10);
+        now += std::chrono::milliseconds(333);
+    }
+
+    LOK_ASSERT_EQUAL(hits + 150, PrespawnPolicy::getHitCount());
+    LOK_ASSERT_EQUAL(misses + 150, PrespawnPolicy::getMissCount());
+
+    const double rate = policy.getPredictedRate("", now, 10);
+    LOK_ASSERT(rate > 0.5 && rate < 1.0);
+    const unsigned target = policy.getTarget("", now, 10);
+    LOK_ASSERT(target > 1 && target <= 8);
+
+    // Other configs are not affected.
+    LOK_ASSERT_EQUAL(1U, policy.getTarget("other", now, 10));
+
+    // Bounded by the maximum.
+    policy.recordSpawnLatency("", std::chrono::milliseconds(60000));
+    LOK_ASSERT_EQUAL(8U, policy.getTarget("", now, 10));
+
+    // Bounded by memory, but never below the minimum.
+    policy.configure(1, 8, 300 * 1024);
+    policy.recordSpareMemory(100 * 1024);
+    LOK_ASSERT_EQUAL(3U, policy.getTarget("", now, 10));
+    policy.configure(1, 8, 50 * 1024);
+    LOK_ASSERT_EQUAL(1U, policy.getTarget("", now, 10));
+    policy.configure(1, 8, 0);
+
+    // Shrinks back once the burst is over.
+    policy.recordSpawnLatency("", std::chrono::milliseconds(2000));
+    now += std::chrono::hours(1);
+    LOK_ASSERT(policy.getPredictedRate("", now, 10) < rate);
+
+    // But warms up ahead of the busy hour of the day: we had 300 loads at 10 o'clock.
+    now += std::chrono::hours(22);
+    LOK_ASSERT_EQUAL(1U, policy.getTarget("", now, 7));
+    const double warm = policy.getPredictedRate("", now, 9);
+    LOK_ASSERT(warm >= 300.0 / 3600 - 0.001);
+    LOK_ASSERT_EQUAL(warm, policy.getPredictedRate("", now, 10));
+
+    policy.forget("");
+    LOK_ASSERT_EQUAL(0.0, policy.getPredictedRate("", now, 10));
+}
+
+void WhiteBoxTests::testLoadProfile()
+{
+    constexpr std::string_view testname = __func__;
+
+    const auto start = std::chrono::steady_clock::now();
+    LoadProfile profile(start);
+    LOK_ASSERT(!profile.has(LoadProfile::Phase::Loaded));
+
+    profile.setDocument("Quarterly Report.DOCX", 2 * 1024 * 1024);
+    LOK_ASSERT_EQUAL_STR("docx", profile.getFormat());
+    LOK_ASSERT_EQUAL_STR("10m", profile.getSizeBucket());
+
+    profile.setDuration(LoadProfile::Phase::Download, 120ms);
+    profile.markReached(LoadProfile::Phase::Loaded, start + 900ms);
+    LOK_ASSERT(!profile.isComplete());
+
+    // Only the first time counts.
+    profile.markReached(LoadProfile::Phase::FirstTile, start + 1100ms);
+    profile.markReached(LoadProfile::Phase::FirstTile, start + 5000ms);
+    LOK_ASSERT(profile.isComplete());
+    LOK_ASSERT_EQUAL(1100L, static_cast<long>(
+                                profile.getDuration(LoadProfile::Phase::FirstTile).count()));
+    LOK_ASSERT_EQUAL_STR("{ \"format\": \"docx\", \"size\": 2097152, \"download\": 120, "
+                         "\"loaded\": 900, \"firsttile\": 1100 }",
+                         profile.toJson());
+
+    // Odd extensions are lumped together.
+    profile.setDocument("archive.tar-gz", 0);
+    LOK_ASSERT_EQUAL_STR("other", profile.getFormat());
+    profile.setDocument("notes.abc12", 0);
+    LOK_ASSERT_EQUAL_STR("other", profile.getFormat());
+    profile.setDocument("budget.fods", 0);
+    LOK_ASSERT_EQUAL_STR("fods", profile.getFormat());
+    profile.setDocument("README", 0);
+    LOK_ASSERT_EQUAL_STR("other", profile.getFormat());
+    LOK_ASSERT_EQUAL_STR("100k", profile.getSizeBucket());
+
+    LoadProfile::Histogram histogram;
+    LOK_ASSERT_EQUAL(0.0, histogram.getPercentile(50));
+    for (int i = 0; i < 90; ++i)
+        histogram.add(80ms); // In (50, 100].
+    for (int i = 0; i < 10; ++i)
+        histogram.add(100s); // Overflow.
+
+    LOK_ASSERT_EQUAL(uint64_t(100), histogram.getCount());
+    LOK_ASSERT_EQUAL(uint64_t(90), histogram.getBucket(1));
+    LOK_ASSERT_EQUAL(uint64_t(10), histogram.getBucket(LoadProfile::BucketBounds.size()));
+
+    const double median = histogram.getPercentile(50);
+    LOK_ASSERT(median > 50 && median <= 100);
+    LOK_ASSERT_EQUAL(100.0, histogram.getPercentile(90));
+    LOK_ASSERT_EQUAL(60000.0, histogram.getPercentile(99));
+}
+
+void WhiteBoxTests::testDelayHistogram()
+{
+    constexpr std::string_view testname = __func__;
+
+    DelayHistogram histogram;
+    LOK_ASSERT(histogram.empty());
+    histogram.add(300us); // In [0, 1].
+    histogram.add(1ms); // A bound is in its bucket.
+    histogram.add(1001us); // In (1, 2].
+    histogram.add(-5us); // Clock skew counts as none.
+    histogram.add(5s); // Overflow.
+
+    LOK_ASSERT_EQUAL(uint64_t(5), histogram.getCount());
+    LOK_ASSERT_EQUAL(uint64_t(3), histogram.getBucket(0));
+    LOK_ASSERT_EQUAL(uint64_t(1), histogram.getBucket(1));
+    LOK_ASSERT_EQUAL(uint64_t(1), histogram.getBucket(DelayHistogram::BucketBounds.size()));
+    LOK_ASSERT_EQUAL(uint64_t(5002301), histogram.getSumUs());
+
+    const std::string serialized = histogram.serialize();
+    LOK_ASSERT_EQUAL_STR("3,1,0,0,0,0,0,0,0,0,1,5002301", serialized);
+    LOK_ASSERT_EQUAL(1000.0, histogram.getPercentile(99));
+
+    DelayHistogram total;
+    LOK_ASSERT(total.deserialize(serialized));
+    total.merge(histogram);
+    LOK_ASSERT_EQUAL(uint64_t(10), total.getCount());
+    LOK_ASSERT_EQUAL(uint64_t(6), total.getBucket(0));
+    LOK_ASSERT_EQUAL(uint64_t(10004602), total.getSumUs());
+
+    // Malformed ones leave it untouched.
+    LOK_ASSERT(!total.deserialize(""));
+    LOK_ASSERT(!total.deserialize("3,1,0,0,0,0,0,0,0,0,1"));
+    LOK_ASSERT(!total.deserialize("3,1,0,0,0,0,0,0,0,0,1,5,7"));
+    LOK_ASSERT(!total.deserialize("3,1,0,0,0,0,0,0,0,0,-1,5"));
+    LOK_ASSERT(!total.deserialize("3,1,0,0,0,0,0,0,0,0,1,5 "));
+    LOK_ASSERT_EQUAL(uint64_t(10), total.getCount());
+}
+
+void WhiteBoxTests::testKeystrokeLatency()
+{
+    constexpr std::string_view testname = __func__;
+
+    const auto start = std::chrono::steady_clock::now();
+    KeystrokeLatency keystroke;
+    std::chrono::microseconds latency(0);
+
+    const TileDesc tile(CanonicalViewId(1), 0, 0, 256, 256, 3840, 3840, 3840, 3840, -1, 0, -1);
+    const TileDesc elsewhere(CanonicalViewId(1), 0, 0, 256, 256, 38400, 3840, 3840, 3840, -1, 0,
+                             -1);
+    const TileDesc otherPart(CanonicalViewId(1), 1, 0, 256, 256, 3840, 3840, 3840, 3840, -1, 0,
+                             -1);
+
+    // Nothing to follow yet.
+    LOK_ASSERT(!keystroke.invalidated(0, Util::Rectangle(0, 0, 7680, 7680), latency, start));
+    LOK_ASSERT(!keystroke.tileSent(tile, latency, start));
+
+    LOK_ASSERT(keystroke.keyTyped(start));
+    LOK_ASSERT_EQUAL(uint64_t(1), keystroke.getId());
+
+    // Those typed meanwhile are part of the same burst.
+    LOK_ASSERT(!keystroke.keyTyped(start + 10ms));
+
+    // No tile before the invalidation.
+    LOK_ASSERT(!keystroke.tileSent(tile, latency, start + 20ms));
+
+    LOK_ASSERT(keystroke.invalidated(0, Util::Rectangle(5000, 5000, 100, 100), latency,
+                                     start + 30ms));
+    LOK_ASSERT_EQUAL(30000L, static_cast<long>(latency.count()));
+    LOK_ASSERT(!keystroke.invalidated(0, Util::Rectangle(0, 0, 100, 100), latency, start + 40ms));
+
+    // Only a tile over the invalidated area shows it.
+    LOK_ASSERT(!keystroke.tileSent(elsewhere, latency, start + 50ms));
+    LOK_ASSERT(!keystroke.tileSent(otherPart, latency, start + 50ms));
+    LOK_ASSERT(keystroke.tileSent(tile, latency, start + 60ms));
+    LOK_ASSERT_EQUAL(60000L, static_cast<long>(latency.count()));
+    LOK_ASSERT(!keystroke.tileSent(tile, latency, start + 70ms));
+
+    // One that changed nothing visible is given up on.
+    LOK_ASSERT(keystroke.keyTyped(start + 100ms));
+    LOK_ASSERT(!keystroke.keyTyped(start + 200ms));
+    LOK_ASSERT(keystroke.keyTyped(start + 100ms + KeystrokeLatency::Timeout));
+    LOK_ASSERT_EQUAL(uint64_t(3), keystroke.getId());
 }
 
 CPPUNIT_TEST_SUITE_REGISTRATION(WhiteBoxTests);
@@ -15,10 +15,16 @@
 #include "config.h"
 
 #include <chrono>
+#include <fstream>
+#include <string_view>
 
 #include <common/Globals.hpp>
 #include <common/Png.hpp>
+#include <common/Protocol.hpp>
+#include <common/StringVector.hpp>
+#include <common/ThreadPool.hpp>
 #include <kit/Delta.hpp>
+#include <wsd/TileDesc.hpp>
 
 typedef std::vector<char> Pixmap;
 
@@ -65,21 +71,317 @@ public:
     }
 };
 
+/// The tile headers, from the kit to WSD, in the text and the binary forms.
+class TileHeaderTests {
+public:
+    static std::vector<std::string> headers;
+
+    /// Collects the tile headers sent by the kits in an uncompressed trace file.
+    static void loadTrace(const std::string& path)
+    {
+        std::ifstream trace(path);
+        std::string line;
+        while (std::getline(trace, line))
+        {
+            // <timestamp<pid<session<payload for the outgoing messages.
+            std::size_t pos = 0;
+            for (int field = 0; field < 3 && pos != std::string::npos; ++field)
+                pos = line.find('<', pos + 1);
+
+            if (line.empty() || line[0] != '<' || pos == std::string::npos)
+                continue;
+
+            const std::string_view payload = std::string_view(line).substr(pos + 1);
+            if ((!payload.starts_with("tile:") && !payload.starts_with("tilecombine:")) ||
+                payload.ends_with("..."))
+                continue;
+
+            try
+            {
+                TileCombined::parse(payload);
+                headers.emplace_back(payload);
+            }
+            catch (const std::exception& exc)
+            {
+                std::cerr << "Skipping invalid tile header: " << exc.what() << '\n';
+            }
+        }
+    }
+
+    /// A typical screenful: rows of 4 tiles, of which some are deltas.
+    static void synthesize()
+    {
+        for (int rows = 1; rows <= 4; ++rows)
+        {
+            std::vector<TileDesc> tiles;
+            for (int i = 0; i < rows * 4; ++i)
+            {
+                tiles.emplace_back(CanonicalViewId::None, 0, 0, 256, 256, (i % 4) * 3840,
+                                   (i / 4) * 3840, 3840, 3840, -1, 1000 + i * 37, -1);
+                tiles.back().setOldWireId(i % 3 ? 1234 + i : 0);
+                tiles.back().setWireId(1300 + i);
+            }
+
+            headers.push_back(TileCombined::create(tiles).serialize("tilecombine:"));
+        }
+    }
+
+    static void timeHeaders(const char *description, bool binary)
+    {
+        std::cout << "Benchmark " << description << " tile headers\n";
+
+        std::vector<TileCombined> parsed;
+        for (const std::string& header : headers)
+            parsed.push_back(TileCombined::parse(header));
+
+        std::size_t messages = 0;
+        std::size_t bytes = 0;
+        std::size_t tiles = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        // Serialize as the kit does, and parse back as WSD does.
+        int maxIters = (200000 + parsed.size() - 1) / parsed.size();
+        for (int it = 0; it < maxIters; ++it)
+        {
+            for (const TileCombined& header : parsed)
+            {
+                if (binary)
+                {
+                    const std::string message = header.serializeBinary();
+                    std::size_t offset = 0;
+                    tiles += TileCombined::parseBinary(message.data(), message.size(), offset)
+                                 .getTiles()
+                                 .size();
+                    bytes += message.size();
+                }
+                else
+                {
+                    const std::string message = header.serialize("tilecombine:", "\n");
+                    tiles += TileCombined::parse(message).getTiles().size();
+                    bytes += message.size();
+                }
+
+                messages++;
+            }
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        std::cout << "took: " <<
+            std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms - ";
+
+        assert(messages && tiles && "div by zero otherwise");
+
+        std::cout << "time/header: " <<
+            (1.0*std::chrono::duration_cast<std::chrono::microseconds>(end - start).count())/messages << "us, "
+                  << bytes / messages << " bytes/header, " << tiles / messages << " tiles/header\n";
+    }
+};
+
+std::vector<std::string> TileHeaderTests::headers;
+
+/// The dispatch of client messages on their first token, for a typing workload.
+class DispatchTests {
+public:
+    /// The commands in the order that ClientSession used to compare them, up to the
+    /// frequent ones of typing.
+    static constexpr std::string_view ChainOrder[] = {
+        "DEBUG", "ERROR", "TRACEEVENT", "urp", "loolclient", "versionbar", "jserror",
+        "jsexception", "load", "loadwithpassword", "commandvalues", "closedocument",
+        "versionrestore", "partpagerectangles", "ping", "renderfont", "status",
+        "statusupdate", "tile", "tilecombine", "save", "savetostorage", "clientvisiblearea",
+        "setclientpart", "selectclientpart", "moveselectedclientparts", "clientzoom",
+        "tileprocessed", "removesession", "renamefile", "dialogevent", "formfieldevent",
+        "sallogoverride", "contentcontrolevent", "loggingleveloverride", "traceeventrecording",
+        "a11ystate", "completefunction", "resetaccesstoken", "switch_request", "outlinestate",
+        "downloadas", "getchildid", "gettextselection", "paste", "insertfile", "key",
+        "textinput", "windowkey", "mouse", "windowmouse", "removetextcontext"
+    };
+
+    /// What the browser sends while typing a sentence, with the odd click and correction.
+    static std::vector<std::string> synthesize()
+    {
+        std::vector<std::string> messages;
+        const std::string_view text = "The quick brown fox jumps over the lazy dog. ";
+        for (std::size_t i = 0; i < text.size(); ++i)
+        {
+            const std::string charCode = std::to_string(static_cast<int>(text[i]));
+            messages.push_back("key type=input char=" + charCode + " key=0");
+            messages.push_back("key type=up char=" + charCode + " key=0");
+            messages.push_back("textinput id=0 text=" + charCode);
+            messages.push_back("tileprocessed wids=" + std::to_string(1000 + i));
+            if (i % 10 == 9)
+            {
+                messages.push_back("removetextcontext id=0 before=1 after=0");
+                messages.push_back("mouse type=buttondown x=1500 y=1500 count=1 buttons=1 modifier=0");
+                messages.push_back("mouse type=buttonup x=1500 y=1500 count=1 buttons=1 modifier=0");
+            }
+        }
+
+        return messages;
+    }
+
+    static void timeDispatch(const char *description, bool table)
+    {
+        std::cout << "Benchmark " << description << " dispatch of typing messages\n";
+
+        const std::vector<std::string> messages = synthesize();
+
+        std::size_t dispatched = 0;
+        std::size_t found = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        const int maxIters = (2000000 + messages.size() - 1) / messages.size();
+        for (int it = 0; it < maxIters; ++it)
+        {
+            for (const std::string& message : messages)
+            {
+                const StringVector tokens = StringVector::tokenizeView(message.data(), message.size());
+                if (table)
+                {
+                    found += LOOLProtocol::getClientCommand(tokens.getView(0)) !=
+                             LOOLProtocol::ClientCommand::Unknown;
+                }
+                else
+                {
+                    for (const std::string_view name : ChainOrder)
+                    {
+                        if (tokens.equals(0, name))
+                        {
+                            ++found;
+                            break;
+                        }
+                    }
+                }
+
+                dispatched++;
+            }
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        std::cout << "took: " <<
+            std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms - ";
+
+        assert(found == dispatched && "all the messages are known");
+
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::cout << "messages/sec: " << static_cast<std::size_t>(1e6 * dispatched / (us ? us : 1))
+                  << '\n';
+    }
+};
+
+/// The tiles encoded per second by the render pool, as it is sized from the CPU quota.
+class ThreadPoolTests {
+public:
+    /// A 256x256 tile of text-like strokes on white, for when no tiles are given.
+    static Pixmap synthesize()
+    {
+        Pixmap pix(256 * 256 * 4, static_cast<char>(0xff));
+        for (int y = 0; y < 256; ++y)
+        {
+            // Lines of glyphs: a stroke every few pixels, 12 rows on, 6 off.
+            if (y % 18 >= 12)
+                continue;
+
+            for (int x = (y * 7) % 5; x < 256; x += 3 + (x * y) % 4)
+            {
+                char* pixel = &pix[(y * 256 + x) * 4];
+                pixel[0] = pixel[1] = pixel[2] = static_cast<char>((x * 31 + y * 17) % 128);
+            }
+        }
+
+        return pix;
+    }
+
+    static void timeTiles(int threads)
+    {
+        std::cout << "Benchmark PNG tile encoding with " << threads << " threads\n";
+
+        // The pool reads its size when constructed, as in the kit.
+        setenv("MAX_CONCURRENCY", std::to_string(threads).c_str(), 1);
+        ThreadPool pool;
+
+        std::vector<Pixmap> tiles = pixmaps;
+        if (tiles.empty())
+            tiles.push_back(synthesize());
+
+        std::atomic<std::size_t> bytes(0);
+        std::size_t encoded = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        // Batches of a screenful, as renderTiles pushes them.
+        const int batch = 16;
+        const int maxIters = 1024 / batch;
+        for (int it = 0; it < maxIters; ++it)
+        {
+            for (int i = 0; i < batch; ++i)
+            {
+                Pixmap& pix = tiles[(it * batch + i) % tiles.size()];
+                pool.pushWork(
+                    [&pix, &bytes]()
+                    {
+                        std::vector<char> output;
+                        output.reserve(pix.size() / 4);
+                        if (Png::encodeBufferToPNG(reinterpret_cast<unsigned char*>(pix.data()),
+                                                   256, 256, output, LOK_TILEMODE_RGBA))
+                            bytes += output.size();
+                    });
+            }
+
+            pool.run();
+            encoded += batch;
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        std::cout << "took: " <<
+            std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms - ";
+
+        assert(bytes && "the tiles are encoded");
+
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::cout << "tiles/sec: " << static_cast<std::size_t>(1e6 * encoded / (us ? us : 1))
+                  << ", " << bytes / encoded << " bytes/tile\n";
+    }
+};
+
 int main (int argc, char **argv)
 {
     for (int i = 1; i < argc; i++)
     {
+        const std::string_view arg = argv[i];
+        if (arg.starts_with("--trace="))
+        {
+            TileHeaderTests::loadTrace(std::string(arg.substr(8)));
+            continue;
+        }
+
         uint32_t height, width, rowBytes;
         Pixmap img = Png::loadPng(argv[i], height, width, rowBytes);
 //        std::cout << "Loaded: " << argv[i] << " " << width << "x" << height << "\n";
         pixmaps.push_back(img);
     }
 
-    DeltaTests::timeRLE("CPU");
+    if (!pixmaps.empty())
+        DeltaTests::timeRLE("CPU");
 
     simd::init();
 
-    DeltaTests::timeRLE("SIMD");
+    if (!pixmaps.empty())
+        DeltaTests::timeRLE("SIMD");
+
+    if (TileHeaderTests::headers.empty())
+        TileHeaderTests::synthesize();
+
+    TileHeaderTests::timeHeaders("text", false);
+    TileHeaderTests::timeHeaders("binary", true);
+
+    DispatchTests::timeDispatch("chained", false);
+    DispatchTests::timeDispatch("table", true);
+
+    for (const int threads : { 1, 2, 4, 8 })
+        ThreadPoolTests::timeTiles(threads);
 
     return 0;
 }
@@ -11,6 +11,7 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <sstream>
@@ -55,6 +56,7 @@ bool DumpHex = false;
 bool DumpAll = false;
 bool DumpMap = false;
 bool DumpStrings = false;
+bool SummaryOnly = false;
 int  DumpWidth = 32;
 
 #define MAP_SIZE 21
@@ -591,6 +593,51 @@ static void dump_unshared(unsigned proc_id, unsigned parent_id,
     }
 }
 
+/// Shared and private dirty sizes of all mappings of a given name, in kB.
+struct MappingTotals {
+    addr_t _shared = 0;
+    addr_t _privateDirty = 0;
+};
+
+/// The basename of a mapped file, or [heap], [stack], [anon] etc.
+static std::string getMappingName(const char *header)
+{
+    const char *name = strchr(header, '[');
+    if (!name)
+        name = strchr(header, '/');
+    if (!name)
+        return "[anon]";
+
+    std::string str(name);
+    while (!str.empty() && (str.back() == '\n' || str.back() == ' '))
+        str.pop_back();
+
+    const auto lastSlash = str.rfind('/');
+    return lastSlash != std::string::npos ? str.substr(lastSlash + 1) : str;
+}
+
+/// Print which mappings have un-shared the most pages since fork,
+/// ie. the biggest copy-on-write breakers, to target them first.
+static void dumpMappingTotals(const std::unordered_map<std::string, MappingTotals> &totals)
+{
+    std::vector<std::pair<std::string, MappingTotals>> sorted(totals.begin(), totals.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const auto &a, const auto &b)
+              { return a.second._privateDirty > b.second._privateDirty; });
+
+    printf("Private dirty (un-shared since fork) by mapping\n");
+    printf("%20s %20s  %s\n", "Private Dirty", "Shared", "Mapping");
+    int count = 0;
+    for (const auto &it : sorted)
+    {
+        if (it.second._privateDirty == 0 || count++ >= 20)
+            break;
+        printf("%17lld kB %17lld kB  %s\n", it.second._privateDirty, it.second._shared,
+               it.first.c_str());
+    }
+    printf("--------------------------------------\n");
+}
+
 static void total_smaps(unsigned proc_id, unsigned parent_id,
                         const char *file, const char *cmdline)
 {
@@ -609,11 +656,17 @@ static void total_smaps(unsigned proc_id, unsigned parent_id,
     std::vector<addr_t> heapVAddrs, anonVAddrs, fileVAddrs;
     std::vector<addr_t> *pushTo = nullptr;
 
+    std::unordered_map<std::string, MappingTotals> mappingTotals;
+    MappingTotals *mapping = nullptr;
+
     if ((file_pointer = fopen(file, "r")) == nullptr)
         error(EXIT_FAILURE, errno, "%s", file);
 
     while (fgets(buffer, sizeof(buffer), file_pointer))
     {
+        if (buffer[0] < 'A' || buffer[0] > 'Z')
+            mapping = &mappingTotals[getMappingName(buffer)];
+
         // collect heap page details
         if (strstr(buffer, "[heap]"))
             pushTo = &heapVAddrs;
@@ -649,16 +702,22 @@ static void total_smaps(unsigned proc_id, unsigned parent_id,
                 if (strncmp("Shared_Dirty", smap_key, 12) == 0)
                 {
                     total_shared_dirty += smap_value;
+                    if (mapping)
+                        mapping->_shared += smap_value;
                     continue;
                 }
                 if (strncmp("Shared_Clean", smap_key, 12) == 0)
                 {
                     total_shared_clean += smap_value;
+                    if (mapping)
+                        mapping->_shared += smap_value;
                     continue;
                 }
                 if (strncmp("Private_Dirty", smap_key, 13) == 0)
                 {
                     total_private_dirty += smap_value;
+                    if (mapping)
+                        mapping->_privateDirty += smap_value;
                     continue;
                 }
                 if (strncmp("Private_Clean", smap_key, 13) == 0)
@@ -670,7 +729,8 @@ static void total_smaps(unsigned proc_id, unsigned parent_id,
         }
     }
     fclose(file_pointer);
-    space.scanMapsForStrings();
+    if (!SummaryOnly)
+        space.scanMapsForStrings();
 
     printf("%s\n", cmdline);
     printf("Process ID    :%20d\n", proc_id);
@@ -688,6 +748,11 @@ static void total_smaps(unsigned proc_id, unsigned parent_id,
     printf("Anon page cnt :%20lld\n", (addr_t)anonVAddrs.size());
     printf("File page cnt :%20lld\n", (addr_t)fileVAddrs.size());
     printf("--------------------------------------\n");
+    dumpMappingTotals(mappingTotals);
+
+    if (SummaryOnly)
+        return;
+
     space.printStats();
     printf("\n");
 
@@ -747,6 +812,8 @@ int main(int argc, char **argv)
             DumpAll = true;
         else if (strstr(arg, "--strings"))
             DumpStrings = true;
+        else if (strstr(arg, "--summary"))
+            SummaryOnly = true;
         else if (strstr(arg, "--width"))
         {
             DumpWidth = std::max((int)pow(2, round(log(atoi(argv[++i]))/log(2))), 8);
@@ -765,6 +832,7 @@ int main(int argc, char **argv)
         fprintf(stderr, "    --map           Print address into their memory maps\n");
         fprintf(stderr, "    --strings       Print all detected strings\n");
         fprintf(stderr, "    --all           Hex dump all writable pages whether touched or not\n");
+        fprintf(stderr, "    --summary       Only print the totals and the un-shared memory by mapping\n");
         fprintf(stderr, "    --width <bytes> Define width of hex dump in bytes, rounded to a power of 2\n");
         return 0;
     }
@@ -618,6 +618,8 @@ void Admin::pollingThread()
             std::chrono::duration_cast<std::chrono::milliseconds>(now - lastCPU).count();
         if (cpuWait <= MinStatsIntervalMs / 2) // Close enough
         {
+            _kitStatsCollector.setKitPids(LOOLWSD::getKitPids());
+            _model.setKitStats(_kitStatsCollector.getSnapshot());
             const size_t currentJiffies = getTotalCpuUsage();
             const size_t cpuPercent = 100 * 1000 * currentJiffies / (sysconf (_SC_CLK_TCK) * _cpuStatsTaskIntervalMs);
             _model.addCpuStats(cpuPercent);
@@ -630,6 +632,9 @@ void Admin::pollingThread()
             std::chrono::duration_cast<std::chrono::milliseconds>(now - lastMem).count();
         if (memWait <= MinStatsIntervalMs / 2) // Close enough
         {
+            _kitStatsCollector.setSMaps(_model.getDocumentSMaps());
+            _model.setKitStats(_kitStatsCollector.getSnapshot());
+
             // disable watchdog to avoid Document::updateMemoryDirty noise
             disableWatchdog();
             _model.UpdateMemoryDirty();
@@ -640,6 +645,8 @@ void Admin::pollingThread()
 
             if (totalMem != _lastTotalMemory)
             {
+                hibernateIdleDocuments(totalMem);
+
                 // If our total memory consumption is above limit, cleanup
                 triggerMemoryCleanup(totalMem);
 
@@ -811,6 +818,8 @@ void Admin::rescheduleMemTimer(unsigned interval)
 {
     _memStatsTaskIntervalMs = capAndRoundInterval(interval);
     LOG_INF("Memory stats interval changed - New interval: " << _memStatsTaskIntervalMs);
+    _kitStatsCollector.setInterval(
+        std::min(_memStatsTaskIntervalMs, _cpuStatsTaskIntervalMs));
     _netStatsTaskIntervalMs = capAndRoundInterval(interval); // Until we support modifying this.
     LOG_INF("Network stats interval changed - New interval: " << _netStatsTaskIntervalMs);
     wakeup();
@@ -820,6 +829,8 @@ void Admin::rescheduleCpuTimer(unsigned interval)
 {
     _cpuStatsTaskIntervalMs = capAndRoundInterval(interval);
     LOG_INF("CPU stats interval changed - New interval: " << _cpuStatsTaskIntervalMs);
+    _kitStatsCollector.setInterval(
+        std::min(_memStatsTaskIntervalMs, _cpuStatsTaskIntervalMs));
     wakeup();
 }
 
@@ -982,6 +993,25 @@ void Admin::setDocWopiUploadDuration(const std::string& docKey, const std::chron
     addCallback([this, docKey, uploadDuration]{ _model.setDocWopiUploadDuration(docKey, uploadDuration); });
 }
 
+void Admin::setDocSaveUploadDuration(const std::string& docKey,
+                                     const std::chrono::milliseconds saveDuration,
+                                     const std::chrono::milliseconds saveUploadDuration)
+{
+    addCallback([this, docKey, saveDuration, saveUploadDuration]
+                { _model.setDocSaveUploadDuration(docKey, saveDuration, saveUploadDuration); });
+}
+
+void Admin::setDocKit(const std::string& docKey, const pid_t pid,
+                      const std::weak_ptr<FILE>& smapsFp)
+{
+    addCallback([this, docKey, pid, smapsFp] { _model.setDocumentKit(docKey, pid, smapsFp); });
+}
+
+void Admin::hibernateDeclined(const std::string& docKey)
+{
+    addCallback([this, docKey] { _hibernatingDocKeys.erase(docKey); });
+}
+
 void Admin::addErrorExitCounters(unsigned segFaultCount, unsigned killedCount,
                                  unsigned oomKilledCount)
 {
@@ -994,6 +1024,46 @@ void Admin::addLostKitsTerminated(unsigned lostKitsTerminated)
     addCallback([this, lostKitsTerminated]{ _model.addLostKitsTerminated(lostKitsTerminated); });
 }
 
+void Admin::addFirstTileDuration(const std::string& docType, std::chrono::milliseconds duration)
+{
+    addCallback([this, docType, duration] { _model.addFirstTileDuration(docType, duration); });
+}
+
+void Admin::addTrimStage(const std::string& stage, uint64_t releasedBytes)
+{
+    addCallback([this, stage, releasedBytes] { _model.addTrimStage(stage, releasedBytes); });
+}
+
+void Admin::addLoadProfile(const LoadProfile& profile)
+{
+    addCallback([this, profile] { _model.addLoadProfile(profile); });
+}
+
+void Admin::addJailSetupDuration(const std::string& method, std::chrono::milliseconds duration)
+{
+    addCallback([this, method, duration] { _model.addJailSetupDuration(method, duration); });
+}
+
+void Admin::addCallbackDelays(const std::string& type, const DelayHistogram& histogram)
+{
+    addCallback([this, type, histogram] { _model.addCallbackDelays(type, histogram); });
+}
+
+void Admin::addKeystrokeLatency(const std::string& docType, const std::string& stage,
+                                std::chrono::microseconds latency)
+{
+    addCallback([this, docType, stage, latency]
+                { _model.addKeystrokeLatency(docType, stage, latency); });
+}
+
+void Admin::setDocMemorySharing(const std::string& docKey, size_t sharedKb, size_t unsharedKb,
+                                std::map<std::string, size_t> unsharedKbByMapping)
+{
+    addCallback(
+        [this, docKey, sharedKb, unsharedKb, mappings = std::move(unsharedKbByMapping)]() mutable
+        { _model.setDocMemorySharing(docKey, sharedKb, unsharedKb, std::move(mappings)); });
+}
+
 void Admin::routeTokenSanityCheck()
 {
     addCallback([this] { _model.routeTokenSanityCheck(); });
@@ -1057,6 +1127,12 @@ void Admin::triggerMemoryCleanup(const size_t totalMem)
         LOG_TRC("OOM Document: DocKey: [" << doc.getDocKey() << "], Idletime: ["
                                           << doc.getIdleTime() << "]," << " Saved: ["
                                           << doc.getSaved() << "], Mem: [" << doc.getMem() << ']');
+        if (!doc.hasKit())
+        {
+            // Hibernated; nothing to free.
+            continue;
+        }
+
         if (doc.getSaved())
         {
             // Kill the saved documents first.
@@ -1077,6 +1153,61 @@ void Admin::triggerMemoryCleanup(const size_t totalMem)
     }
 }
 
+void Admin::hibernateIdleDocuments(const size_t totalMem)
+{
+    static const bool enabled =
+        ConfigUtil::getConfigValue<bool>("per_document.hibernate[@enable]", false);
+    static const std::time_t minIdleSecs =
+        ConfigUtil::getConfigValue<unsigned>("per_document.hibernate.idle_secs", 600);
+    static const double memLimit =
+        ConfigUtil::getConfigValue<double>("per_document.hibernate.memproportion", 60.0);
+    if (!enabled || memLimit <= 0.0 || _totalSysMemKb == 0)
+        return;
+
+    const std::vector<DocBasicInfo> docList = _model.getDocumentsSortedByIdle();
+
+    // Forget the documents that went away, or hibernated, since we asked.
+    std::set<std::string> hibernating;
+    for (const auto& doc : docList)
+    {
+        if (doc.hasKit() && _hibernatingDocKeys.count(doc.getDocKey()))
+            hibernating.insert(doc.getDocKey());
+    }
+    _hibernatingDocKeys = std::move(hibernating);
+
+    int64_t memToFreeKb = static_cast<int64_t>(totalMem) -
+                          static_cast<int64_t>(_totalSysMemKb * memLimit / 100.);
+    if (memToFreeKb <= 0)
+        return;
+
+    LOGA_TRC(Admin, "Total memory consumed: " << totalMem << " KB, above the hibernation limit of "
+                                              << memLimit << "% by " << memToFreeKb << " KB");
+
+    for (const auto& doc : docList)
+    {
+        if (memToFreeKb <= 0 || doc.getIdleTime() < minIdleSecs)
+            break;
+
+        // Already hibernated.
+        if (!doc.hasKit())
+            continue;
+
+        memToFreeKb -= doc.getMem();
+
+        // Asked already; still saving, or going dormant.
+        if (_hibernatingDocKeys.count(doc.getDocKey()))
+            continue;
+
+        LOG_INF("Hibernating idle document with DocKey ["
+                << doc.getDocKey() << "], Idletime: [" << doc.getIdleTime() << "] using "
+                << doc.getMem() << " KB");
+
+        // Saves, then unloads from the Kit, keeping the sessions and tiles.
+        LOOLWSD::hibernateDocument(doc.getDocKey());
+        _hibernatingDocKeys.insert(doc.getDocKey());
+    }
+}
+
 void Admin::notifyDocsMemDirtyChanged()
 {
     _model.notifyDocsMemDirtyChanged();
@@ -1282,6 +1413,8 @@ void Admin::sendMetrics(const std::shared_ptr<StreamSocket>& socket,
 void Admin::start()
 {
     startMonitors();
+    _kitStatsCollector.setInterval(std::min(_memStatsTaskIntervalMs, _cpuStatsTaskIntervalMs));
+    _kitStatsCollector.startThread();
     startThread();
 }
 
@@ -1368,6 +1501,7 @@ void Admin::deleteMonitorSocket(const std::string& uriWithoutParam)
 void Admin::stop()
 {
     joinThread();
+    _kitStatsCollector.joinThread();
 }
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -174,9 +174,24 @@ public:
     void setDocWopiDownloadDuration(const std::string& docKey, std::chrono::milliseconds wopiDownloadDuration);
     void setDocWopiUploadDuration(const std::string& docKey,
                                   std::chrono::milliseconds uploadDuration);
+    void setDocSaveUploadDuration(const std::string& docKey, std::chrono::milliseconds saveDuration,
+                                  std::chrono::milliseconds saveUploadDuration);
+    /// The document moved to another Kit, or to none (pid 0) when it hibernated.
+    void setDocKit(const std::string& docKey, pid_t pid, const std::weak_ptr<FILE>& smapsFp);
+    /// The document didn't hibernate when asked; ask again next time.
+    void hibernateDeclined(const std::string& docKey);
     void addErrorExitCounters(unsigned segFaultCount, unsigned killedCount,
                               unsigned oomKilledCount);
     void addLostKitsTerminated(unsigned lostKitsTerminated);
+    void addFirstTileDuration(const std::string& docType, std::chrono::milliseconds duration);
+    void addTrimStage(const std::string& stage, uint64_t releasedBytes);
+    void addLoadProfile(const LoadProfile& profile);
+    void addJailSetupDuration(const std::string& method, std::chrono::milliseconds duration);
+    void addCallbackDelays(const std::string& type, const DelayHistogram& histogram);
+    void addKeystrokeLatency(const std::string& docType, const std::string& stage,
+                             std::chrono::microseconds latency);
+    void setDocMemorySharing(const std::string& docKey, size_t sharedKb, size_t unsharedKb,
+                             std::map<std::string, size_t> unsharedKbByMapping);
 
     void getMetrics(std::ostream& metrics) const;
 
@@ -204,6 +219,9 @@ private:
     /// Memory consumption has increased, start killing kits etc. till memory consumption gets back
     /// under @hardModeLimit
     void triggerMemoryCleanup(size_t hardModeLimit);
+    /// Memory consumption is above the hibernation threshold: unload the most
+    /// idle documents from their Kits, to reload when their users come back.
+    void hibernateIdleDocuments(size_t totalMem);
     void notifyDocsMemDirtyChanged();
     void cleanupResourceConsumingDocs();
     void cleanupLostKits();
@@ -234,6 +252,9 @@ private:
     size_t _totalAvailMemKb;
 
     size_t _lastTotalMemory;
+
+    /// The documents we asked to hibernate, that haven't gone or declined yet.
+    std::set<std::string> _hibernatingDocKeys;
     mutable size_t _lastJiffies;
     size_t _cleanupIntervalMs;
     uint64_t _lastSentCount;
@@ -256,6 +277,9 @@ private:
 
     int _forKitPid;
 
+    /// Reads the kits' /proc stats off the Admin thread.
+    KitStatsCollector _kitStatsCollector;
+
     int _cpuStatsTaskIntervalMs;
     int _memStatsTaskIntervalMs;
     int _netStatsTaskIntervalMs;
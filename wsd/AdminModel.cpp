@@ -30,6 +30,7 @@
 #include <net/WebSocketHandler.hpp>
 #include <wsd/LOOLWSD.hpp>
 #include <wsd/Exceptions.hpp>
+#include <wsd/PrespawnPolicy.hpp>
 
 #include <fnmatch.h>
 #include <dirent.h>
@@ -52,6 +53,17 @@ std::string concat(const std::string_view &prefix, const std::string_view name,
     return oss.str();
 }
 
+/// The collected stats of the kit with the given pid, if any.
+const KitStatsCollector::KitStats* findKitStats(const KitStatsCollector::Snapshot* snapshot,
+                                                pid_t pid)
+{
+    if (!snapshot)
+        return nullptr;
+
+    const auto it = snapshot->_kits.find(pid);
+    return it != snapshot->_kits.end() ? &it->second : nullptr;
+}
+
 } // namespace
 
 void Document::addView(const std::string& sessionId, const std::string& userName,
@@ -161,19 +173,27 @@ std::string Document::to_string() const
     return oss.str();
 }
 
-void Document::updateMemoryDirty()
+void Document::updateMemoryDirty(const KitStatsCollector::KitStats* kitStats)
 {
-    // Avoid accessing smaps too often
-    const time_t now = std::time(nullptr);
-    if (now - _lastTimeSMapsRead >= 5)
+    const size_t lastMemDirty = _memoryDirty;
+    if (kitStats && kitStats->_hasMemory)
     {
-        size_t lastMemDirty = _memoryDirty;
+        _memoryDirty = kitStats->_dirtyKb;
+    }
+    else
+    {
+        // Avoid accessing smaps too often
+        const time_t now = std::time(nullptr);
+        if (now - _lastTimeSMapsRead < 5)
+            return;
+
         auto procSMaps = _procSMaps.lock();
         _memoryDirty = procSMaps ? Util::getPssAndDirtyFromSMaps(procSMaps.get()).second : 0;
         _lastTimeSMapsRead = now;
-        if (lastMemDirty != _memoryDirty)
-            _hasMemDirtyChanged = true;
     }
+
+    if (lastMemDirty != _memoryDirty)
+        _hasMemDirtyChanged = true;
 }
 
 void Document::setLastJiffies(size_t newJ)
@@ -355,7 +375,8 @@ size_t AdminModel::getKitsJiffies() const
             const int pid = it.second.getPid();
             if (pid > 0)
             {
-                unsigned newJ = Util::getCpuUsage(pid);
+                const KitStatsCollector::KitStats* kitStats = findKitStats(_kitStats.get(), pid);
+                unsigned newJ = kitStats ? kitStats->_jiffies : Util::getCpuUsage(pid);
                 unsigned prevJ = it.second.getLastJiffies();
                 if(newJ >= prevJ)
                 {
@@ -757,7 +778,8 @@ std::vector<DocBasicInfo> AdminModel::getDocumentsSortedByIdle() const
         docs.emplace_back(it.second.getDocKey(),
                           it.second.getIdleTime(),
                           it.second.getMemoryDirty(),
-                          !it.second.getModifiedStatus());
+                          !it.second.getModifiedStatus(),
+                          it.second.getPid() > 0);
     }
 
     // Sort the list by idle times;
@@ -920,6 +942,28 @@ void AdminModel::setDocWopiUploadDuration(const std::string& docKey, const std::
         it->second.setWopiUploadDuration(wopiUploadDuration);
 }
 
+void AdminModel::setDocumentKit(const std::string& docKey, pid_t pid,
+                                const std::weak_ptr<FILE>& smapsFp)
+{
+    auto it = _documents.find(docKey);
+    if (it == _documents.end())
+        return;
+
+    it->second.setKit(pid, smapsFp);
+    it->second.updateMemoryDirty(nullptr);
+    if (pid <= 0)
+        ++_hibernatedCount;
+}
+
+void AdminModel::setDocSaveUploadDuration(const std::string& docKey,
+                                          std::chrono::milliseconds saveDuration,
+                                          std::chrono::milliseconds saveUploadDuration)
+{
+    auto it = _documents.find(docKey);
+    if (it != _documents.end())
+        it->second.setSaveUploadDuration(saveDuration, saveUploadDuration);
+}
+
 void AdminModel::addErrorExitCounters(unsigned segFaultCount, unsigned killedCount,
                                       unsigned oomKilledCount)
 {
@@ -933,6 +977,62 @@ void AdminModel::addLostKitsTerminated(unsigned lostKitsTerminated)
     _lostKitsTerminatedCount += lostKitsTerminated;
 }
 
+void AdminModel::setDocMemorySharing(const std::string& docKey, size_t sharedKb,
+                                     size_t unsharedKb,
+                                     std::map<std::string, size_t> unsharedKbByMapping)
+{
+    auto it = _documents.find(docKey);
+    if (it != _documents.end())
+        it->second.setMemorySharing(sharedKb, unsharedKb, std::move(unsharedKbByMapping));
+}
+
+void AdminModel::addFirstTileDuration(const std::string& docType,
+                                      std::chrono::milliseconds duration)
+{
+    _firstTileHistograms[docType].add(duration);
+}
+
+void AdminModel::addTrimStage(const std::string& stage, uint64_t releasedBytes)
+{
+    TrimStats& stats = _trimStats[stage];
+    ++stats._count;
+    stats._releasedBytes += releasedBytes;
+}
+
+void AdminModel::addLoadProfile(const LoadProfile& profile)
+{
+    for (std::size_t i = 0; i < LoadProfile::PhaseCount; ++i)
+    {
+        const auto phase = static_cast<LoadProfile::Phase>(i);
+        if (!profile.has(phase))
+            continue;
+
+        const std::string labels = std::string("phase=\"") + LoadProfile::name(phase) +
+                                   "\",format=\"" + profile.getFormat() + "\",size=\"" +
+                                   profile.getSizeBucket() + '"';
+        _loadHistograms[labels].add(profile.getDuration(phase));
+    }
+}
+
+void AdminModel::addJailSetupDuration(const std::string& method, std::chrono::milliseconds duration)
+{
+    _jailSetupHistograms[method].add(duration);
+}
+
+void AdminModel::addCallbackDelays(const std::string& type, const DelayHistogram& histogram)
+{
+    _callbackDelayHistograms[type].merge(histogram);
+}
+
+void AdminModel::addKeystrokeLatency(const std::string& docType, const std::string& stage,
+                                     std::chrono::microseconds latency)
+{
+    // The type is unknown until the status of the view comes.
+    const std::string labels = "type=\"" + (docType.empty() ? std::string("other") : docType) +
+                               "\",stage=\"" + stage + '"';
+    _keystrokeLatencyHistograms[labels].add(latency);
+}
+
 int filterNumberName(const struct dirent *dir)
 {
     return !fnmatch("[0-9]*", dir->d_name, 0);
@@ -1079,6 +1179,8 @@ struct DocumentAggregateStats final
         _bytesRecvFromClients.Update(d.getRecvBytes(), active);
         _wopiDownloadDuration.Update(d.getWopiDownloadDuration().count(), active);
         _wopiUploadDuration.Update(d.getWopiUploadDuration().count(), active);
+        _saveDuration.Update(d.getSaveDuration().count(), active);
+        _saveUploadDuration.Update(d.getSaveUploadDuration().count(), active);
 
         //View load duration
         for (const auto& v : d.getViews())
@@ -1107,6 +1209,8 @@ struct DocumentAggregateStats final
     ActiveExpiredStats _bytesRecvFromClients;
     ActiveExpiredStats _wopiDownloadDuration;
     ActiveExpiredStats _wopiUploadDuration;
+    ActiveExpiredStats _saveDuration;
+    ActiveExpiredStats _saveUploadDuration;
     ActiveExpiredStats _viewLoadDuration;
 
     int _resConsCount;
@@ -1167,8 +1271,21 @@ void AdminModel::CalcDocAggregateStats(DocumentAggregateStats& stats) const
         stats.Update(d.second, true);
 }
 
-void CalcKitStats(KitProcStats& stats)
+void CalcKitStats(KitProcStats& stats, const KitStatsCollector::Snapshot* kitStats)
 {
+    if (kitStats)
+    {
+        stats.unassignedCount = kitStats->_unassignedCount;
+        stats.assignedCount = kitStats->_assignedCount;
+        for (const auto& pair : kitStats->_kits)
+        {
+            stats._threadCount.Update(pair.second._threadCount);
+            stats._cpuTime.Update(pair.second._jiffies / sysconf(_SC_CLK_TCK));
+        }
+
+        return;
+    }
+
     std::vector<int> childProcs;
     stats.unassignedCount = AdminModel::getUnassignedKitPids(&childProcs);
     stats.assignedCount = AdminModel::getAssignedKitPids(&childProcs);
@@ -1191,6 +1308,27 @@ void PrintKitAggregateMetrics(std::ostream& oss, const char* name, const char* u
     values.Print(oss, prefix, unit);
 }
 
+template <const auto& Bounds>
+void PrintHistogramMetrics(std::ostream& oss, const char* name, const std::string& labels,
+                           const Histogram<Bounds>& histogram)
+{
+    uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < Bounds.size(); ++i)
+    {
+        cumulative += histogram.getBucket(i);
+        oss << name << "_milliseconds_bucket{" << labels << ",le=\"" << Bounds[i] << "\"} "
+            << cumulative << '\n';
+    }
+    oss << name << "_milliseconds_bucket{" << labels << ",le=\"+Inf\"} " << histogram.getCount()
+        << '\n';
+    oss << name << "_milliseconds_sum{" << labels << "} " << histogram.getSumUs() / 1000.0
+        << '\n';
+    oss << name << "_milliseconds_count{" << labels << "} " << histogram.getCount() << '\n';
+    for (const int percent : { 50, 90, 99 })
+        oss << name << "_p" << percent << "_milliseconds{" << labels << "} "
+            << static_cast<uint64_t>(histogram.getPercentile(percent)) << '\n';
+}
+
 void AdminModel::getMetrics(std::ostream& oss) const
 {
     ASSERT_CORRECT_THREAD_OWNER(_owner);
@@ -1212,7 +1350,7 @@ void AdminModel::getMetrics(std::ostream& oss) const
     KitProcStats kitStats;
 
     CalcDocAggregateStats(docStats);
-    CalcKitStats(kitStats);
+    CalcKitStats(kitStats, _kitStats.get());
 
     oss << "kit_count " << kitStats.unassignedCount + kitStats.assignedCount << std::endl;
     oss << "kit_unassigned_count " << kitStats.unassignedCount << std::endl;
@@ -1221,14 +1359,53 @@ void AdminModel::getMetrics(std::ostream& oss) const
     oss << "kit_lost_terminated_count " << _lostKitsTerminatedCount << std::endl;
     oss << "kit_killed_count " << _killedCount << std::endl;
     oss << "kit_killed_oom_count " << _oomKilledCount << std::endl;
+    oss << "kit_prespawn_hit_count " << PrespawnPolicy::getHitCount() << std::endl;
+    oss << "kit_prespawn_miss_count " << PrespawnPolicy::getMissCount() << std::endl;
+    oss << "kit_prespawn_target_count " << PrespawnPolicy::getLastTarget() << std::endl;
+    for (const auto& [method, histogram] : _jailSetupHistograms)
+        PrintHistogramMetrics(oss, "kit_jail_setup", "method=\"" + method + '"', histogram);
+    for (const auto& [type, histogram] : _callbackDelayHistograms)
+        PrintHistogramMetrics(oss, "kit_callback_delay", "type=\"" + type + '"', histogram);
     PrintKitAggregateMetrics(oss, "thread_count", "", kitStats._threadCount);
     PrintKitAggregateMetrics(oss, "memory_used", "bytes", docStats._kitUsedMemory.active());
     PrintKitAggregateMetrics(oss, "cpu_time", "seconds", kitStats._cpuTime);
+
+    // Which mappings break copy-on-write sharing with forkit the most, across all kits.
+    size_t sharedKb = 0;
+    size_t unsharedKb = 0;
+    std::map<std::string, size_t> unsharedKbByMapping;
+    for (const auto& it : _documents)
+    {
+        if (it.second.isExpired())
+            continue;
+
+        sharedKb += it.second.getMemorySharedKb();
+        unsharedKb += it.second.getMemoryUnsharedKb();
+        for (const auto& [mapping, kb] : it.second.getUnsharedKbByMapping())
+            unsharedKbByMapping[mapping] += kb;
+    }
+
+    oss << "kit_memory_shared_total_bytes " << sharedKb * 1024 << std::endl;
+    oss << "kit_memory_unshared_total_bytes " << unsharedKb * 1024 << std::endl;
+    for (const auto& [mapping, kb] : unsharedKbByMapping)
+        oss << "kit_memory_unshared_bytes{mapping=\"" << mapping << "\"} " << kb * 1024 << std::endl;
+
+    for (const auto& [docType, histogram] : _firstTileHistograms)
+        PrintHistogramMetrics(oss, "kit_first_tile", "type=\"" + docType + '"', histogram);
+    oss << std::endl;
+
+    for (const auto& [stage, stats] : _trimStats)
+    {
+        const std::string prefix = "kit_trim_" + stage;
+        oss << prefix << "_count " << stats._count << std::endl;
+        oss << prefix << "_released_bytes " << stats._releasedBytes << std::endl;
+    }
     oss << std::endl;
 
     oss << "document_resource_consuming_count " << docStats._resConsCount << std::endl;
     oss << "document_resource_consuming_abort_started_count " << docStats._resConsAbortPendingCount << std::endl;
     oss << "document_resource_consuming_aborted_count " << docStats._resConsAbortCount << std::endl;
+    oss << "document_hibernated_count " << _hibernatedCount << std::endl;
     oss << std::endl;
 
     PrintDocActExpMetrics(oss, "views_all_count", "", docStats._viewsCount);
@@ -1246,8 +1423,18 @@ void AdminModel::getMetrics(std::ostream& oss) const
     oss << std::endl;
     PrintDocActExpMetrics(oss, "wopi_download_duration", "milliseconds", docStats._wopiDownloadDuration);
     oss << std::endl;
+    PrintDocActExpMetrics(oss, "save_duration", "milliseconds", docStats._saveDuration);
+    oss << std::endl;
+    PrintDocActExpMetrics(oss, "save_upload_duration", "milliseconds", docStats._saveUploadDuration);
+    oss << std::endl;
     PrintDocActExpMetrics(oss, "view_load_duration", "milliseconds", docStats._viewLoadDuration);
 
+    oss << std::endl;
+    for (const auto& [labels, histogram] : _loadHistograms)
+        PrintHistogramMetrics(oss, "document_load_phase", labels, histogram);
+    for (const auto& [labels, histogram] : _keystrokeLatencyHistograms)
+        PrintHistogramMetrics(oss, "document_keystroke_latency", labels, histogram);
+
     oss << std::endl;
     oss << "error_storage_space_low " << StorageSpaceLowException::count << "\n";
     oss << "error_storage_connection " << StorageConnectionException::count << "\n";
@@ -1277,11 +1464,15 @@ void AdminModel::getMetrics(std::ostream& oss) const
         oss << "doc_views_active" << suffix << doc.getActiveViews() << "\n";
         oss << "doc_is_modified" << suffix << doc.getModifiedStatus() << "\n";
         oss << "doc_memory_used_bytes" << suffix << doc.getMemoryDirty() * 1024 << "\n";
+        oss << "doc_memory_shared_bytes" << suffix << doc.getMemorySharedKb() * 1024 << "\n";
+        oss << "doc_memory_unshared_bytes" << suffix << doc.getMemoryUnsharedKb() * 1024 << "\n";
         oss << "doc_cpu_used_seconds" << suffix << ((double)doc.getLastJiffies()/tick_per_sec) << "\n";
         oss << "doc_open_time_seconds" << suffix << doc.getOpenTime() << "\n";
         oss << "doc_idle_time_seconds" << suffix << doc.getIdleTime() << "\n";
         oss << "doc_download_time_seconds" << suffix << ((double)doc.getWopiDownloadDuration().count() / 1000) << "\n";
         oss << "doc_upload_time_seconds" << suffix << ((double)doc.getWopiUploadDuration().count() / 1000) << "\n";
+        oss << "doc_save_time_seconds" << suffix << ((double)doc.getSaveDuration().count() / 1000) << "\n";
+        oss << "doc_save_upload_time_seconds" << suffix << ((double)doc.getSaveUploadDuration().count() / 1000) << "\n";
         oss << std::endl;
     }
 }
@@ -1296,11 +1487,25 @@ std::set<pid_t> AdminModel::getDocumentPids() const
     return pids;
 }
 
+std::map<pid_t, std::weak_ptr<FILE>> AdminModel::getDocumentSMaps() const
+{
+    ASSERT_CORRECT_THREAD_OWNER(_owner);
+
+    std::map<pid_t, std::weak_ptr<FILE>> smaps;
+    for (const auto& it : _documents)
+    {
+        if (!it.second.isExpired() && it.second.getPid() > 0)
+            smaps.emplace(it.second.getPid(), it.second.getProcSMapsFp());
+    }
+
+    return smaps;
+}
+
 void AdminModel::UpdateMemoryDirty()
 {
     for (auto& it: _documents)
     {
-        it.second.updateMemoryDirty();
+        it.second.updateMemoryDirty(findKitStats(_kitStats.get(), it.second.getPid()));
     }
 }
 
@@ -11,6 +11,7 @@
 
 #include <ctime>
 #include <deque>
+#include <map>
 #include <memory>
 #include <regex>
 #include <set>
@@ -18,8 +19,11 @@
 #include <utility>
 #include <Poco/URI.h>
 
+#include <common/Histogram.hpp>
 #include <common/Log.hpp>
 #include "net/WebSocketHandler.hpp"
+#include "KitStatsCollector.hpp"
+#include "LoadProfile.hpp"
 
 struct DocumentAggregateStats;
 
@@ -129,13 +133,15 @@ class DocBasicInfo final
     std::time_t _idleTime;
     int _mem;
     bool _saved;
+    bool _hasKit;
 
 public:
-    DocBasicInfo(std::string docKey, std::time_t idleTime, int mem, bool saved)
+    DocBasicInfo(std::string docKey, std::time_t idleTime, int mem, bool saved, bool hasKit)
         : _docKey(std::move(docKey))
         , _idleTime(idleTime)
         , _mem(mem)
         , _saved(saved)
+        , _hasKit(hasKit)
     {
     }
 
@@ -146,6 +152,9 @@ public:
     int getMem() const { return _mem; }
 
     bool getSaved() const { return _saved; }
+
+    /// False while the document is hibernated.
+    bool hasKit() const { return _hasKit; }
 };
 
 /// A document in Admin controller.
@@ -159,6 +168,8 @@ public:
         , _docKey(docKey)
         , _filename(filename)
         , _memoryDirty(0)
+        , _memorySharedKb(0)
+        , _memoryUnsharedKb(0)
         , _lastJiffy(0)
         , _start(std::time(nullptr))
         , _lastActivity(_start)
@@ -168,6 +179,8 @@ public:
         , _recvBytes(0)
         , _wopiDownloadDuration(0)
         , _wopiUploadDuration(0)
+        , _saveDuration(0)
+        , _saveUploadDuration(0)
         , _lastTimeSMapsRead(0)
         , _badBehaviorDetectionTime(0)
         , _abortTime(0)
@@ -184,6 +197,15 @@ public:
 
     pid_t getPid() const { return _pid; }
 
+    /// Moves the document to another Kit, or to none (pid 0) when it hibernates.
+    void setKit(pid_t pid, std::weak_ptr<FILE> procSMaps)
+    {
+        _pid = pid;
+        _procSMaps = std::move(procSMaps);
+        _lastJiffy = 0;
+        _lastTimeSMapsRead = 0;
+    }
+
     std::string getFilename() const { return _filename; }
 
     std::string getHostName() const { return _hostName; }
@@ -210,9 +232,25 @@ public:
 
     void updateLastActivityTime(std::time_t lastActivity) { _lastActivity = lastActivity; }
     std::time_t getLastActivityTime() const { return _lastActivity; }
-    void updateMemoryDirty();
+    /// Updates from the collector's snapshot when it has our kit, else from smaps directly.
+    void updateMemoryDirty(const KitStatsCollector::KitStats* kitStats);
     size_t getMemoryDirty() const { return _memoryDirty; }
 
+    /// Sets the memory still shared with, and un-shared from, forkit as reported by the Kit.
+    void setMemorySharing(size_t sharedKb, size_t unsharedKb,
+                          std::map<std::string, size_t> unsharedKbByMapping)
+    {
+        _memorySharedKb = sharedKb;
+        _memoryUnsharedKb = unsharedKb;
+        _unsharedKbByMapping = std::move(unsharedKbByMapping);
+    }
+    size_t getMemorySharedKb() const { return _memorySharedKb; }
+    size_t getMemoryUnsharedKb() const { return _memoryUnsharedKb; }
+    const std::map<std::string, size_t>& getUnsharedKbByMapping() const
+    {
+        return _unsharedKbByMapping;
+    }
+
     std::string getSnapshot(std::time_t now) const;
     const std::string getHistory() const;
     void takeSnapshot();
@@ -237,7 +275,16 @@ public:
     std::chrono::milliseconds getWopiDownloadDuration() const { return _wopiDownloadDuration; }
     void setWopiUploadDuration(const std::chrono::milliseconds wopiUploadDuration) { _wopiUploadDuration = wopiUploadDuration; }
     std::chrono::milliseconds getWopiUploadDuration() const { return _wopiUploadDuration; }
+    void setSaveUploadDuration(std::chrono::milliseconds saveDuration,
+                               std::chrono::milliseconds saveUploadDuration)
+    {
+        _saveDuration = saveDuration;
+        _saveUploadDuration = saveUploadDuration;
+    }
+    std::chrono::milliseconds getSaveDuration() const { return _saveDuration; }
+    std::chrono::milliseconds getSaveUploadDuration() const { return _saveUploadDuration; }
     void setProcSMapsFp(std::weak_ptr<FILE> procSMaps) { _procSMaps = std::move(procSMaps); }
+    const std::weak_ptr<FILE>& getProcSMapsFp() const { return _procSMaps; }
     bool hasMemDirtyChanged() const { return _hasMemDirtyChanged; }
     void setMemDirtyChanged(bool changeStatus) { _hasMemDirtyChanged = changeStatus; }
     time_t getBadBehaviorDetectionTime() const { return _badBehaviorDetectionTime; }
@@ -258,6 +305,11 @@ private:
     std::string _filename;
     /// The dirty (ie. un-shared) memory of the document's Kit process.
     size_t _memoryDirty;
+    /// The memory still shared with forkit, and un-shared since the fork.
+    size_t _memorySharedKb;
+    size_t _memoryUnsharedKb;
+    /// The biggest un-sharing mappings (libraries, [heap], [anon] etc.)
+    std::map<std::string, size_t> _unsharedKbByMapping;
     /// Last noted Jiffy count
     size_t _lastJiffy;
     std::chrono::steady_clock::time_point _lastJiffyTime;
@@ -273,6 +325,10 @@ private:
     std::chrono::milliseconds _wopiDownloadDuration;
     std::chrono::milliseconds _wopiUploadDuration;
 
+    /// How long Core took to save, and from the save request until the result was stored.
+    std::chrono::milliseconds _saveDuration;
+    std::chrono::milliseconds _saveUploadDuration;
+
     std::weak_ptr<FILE> _procSMaps;
     std::time_t _lastTimeSMapsRead;
 
@@ -405,14 +461,34 @@ public:
     void setDocWopiDownloadDuration(const std::string& docKey, std::chrono::milliseconds wopiDownloadDuration);
     void setDocWopiUploadDuration(const std::string& docKey,
                                   std::chrono::milliseconds wopiUploadDuration);
+    void setDocSaveUploadDuration(const std::string& docKey, std::chrono::milliseconds saveDuration,
+                                  std::chrono::milliseconds saveUploadDuration);
     void addErrorExitCounters(unsigned segFaultCount, unsigned killedCount,
                               unsigned oomKilledCount);
     void setForKitPid(pid_t pid) { _forKitPid = pid; }
     void addLostKitsTerminated(unsigned lostKitsTerminated);
+    /// The document moved to another Kit, or to none (pid 0) when it hibernated.
+    void setDocumentKit(const std::string& docKey, pid_t pid, const std::weak_ptr<FILE>& smapsFp);
+    void addFirstTileDuration(const std::string& docType, std::chrono::milliseconds duration);
+    void addTrimStage(const std::string& stage, uint64_t releasedBytes);
+    void addLoadProfile(const LoadProfile& profile);
+    void addJailSetupDuration(const std::string& method, std::chrono::milliseconds duration);
+    void addCallbackDelays(const std::string& type, const DelayHistogram& histogram);
+    void addKeystrokeLatency(const std::string& docType, const std::string& stage,
+                             std::chrono::microseconds latency);
+    void setDocMemorySharing(const std::string& docKey, size_t sharedKb, size_t unsharedKb,
+                             std::map<std::string, size_t> unsharedKbByMapping);
 
     void getMetrics(std::ostream& oss) const;
 
     std::set<pid_t> getDocumentPids() const;
+    /// The smaps files of the live documents' kits, by pid.
+    std::map<pid_t, std::weak_ptr<FILE>> getDocumentSMaps() const;
+    /// The latest stats of the KitStatsCollector, used instead of reading /proc here.
+    void setKitStats(std::shared_ptr<const KitStatsCollector::Snapshot> kitStats)
+    {
+        _kitStats = std::move(kitStats);
+    }
     void UpdateMemoryDirty();
     void notifyDocsMemDirtyChanged();
 
@@ -478,6 +554,31 @@ private:
     uint64_t _lostKitsTerminatedCount = 0;
     uint64_t _killedCount = 0;
     uint64_t _oomKilledCount = 0;
+    uint64_t _hibernatedCount = 0;
+
+    /// Time from kit assignment to the first rendered tile, per document type.
+    std::map<std::string, LoadProfile::Histogram> _firstTileHistograms;
+
+    /// Memory released by the kits' idle trimming, per stage.
+    struct TrimStats
+    {
+        uint64_t _count = 0;
+        uint64_t _releasedBytes = 0;
+    };
+    std::map<std::string, TrimStats> _trimStats;
+
+    /// The durations of the load phases, by their phase, format and size labels.
+    std::map<std::string, LoadProfile::Histogram> _loadHistograms;
+
+    /// The durations of the jail setup of new kits, by method (mounted, pooled, copied).
+    std::map<std::string, LoadProfile::Histogram> _jailSetupHistograms;
+
+    /// How long the LOK callbacks waited in the kits' queues, by callback type.
+    std::map<std::string, DelayHistogram> _callbackDelayHistograms;
+
+    /// How long after a keystroke its invalidation, and then its tile, came, by their
+    /// document type and stage labels.
+    std::map<std::string, DelayHistogram> _keystrokeLatencyHistograms;
 
     std::time_t _lastActivity = 0;
 
@@ -497,6 +598,8 @@ private:
     unsigned _connStatsSize = 200;
 
     pid_t _forKitPid = 0;
+
+    std::shared_ptr<const KitStatsCollector::Snapshot> _kitStats;
 };
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -16,6 +16,7 @@
 #include <common/Common.hpp>
 #include <common/ConfigUtil.hpp>
 #include <common/HexUtil.hpp>
+#include <common/JsonScanner.hpp>
 #include <common/JsonUtil.hpp>
 #include <common/Log.hpp>
 #include <common/Protocol.hpp>
@@ -41,6 +42,7 @@
 #include <ios>
 #include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <string>
 #include <string_view>
@@ -177,6 +179,47 @@ void ClientSession::setState(SessionState newState)
     _lastStateTime = std::chrono::steady_clock::now();
 }
 
+void ClientSession::detachFromKit()
+{
+    LOG_TRC("Detaching from the Kit in " << name(_state));
+    _state = SessionState::DETACHED;
+    _lastStateTime = std::chrono::steady_clock::now();
+    _kitViewId = -1;
+    _tilesOnFly.clear();
+    _requestedTiles.clear();
+}
+
+bool ClientSession::reloadView(const std::shared_ptr<DocumentBroker>& docBroker)
+{
+    setState(SessionState::LOADING);
+
+    // The new Kit starts its wire-ids over, so send whole tiles from now on.
+    _tracker = ClientDeltaTracker();
+
+    // Open at the part we were on, rather than the one we first loaded.
+    std::string request = "load";
+    if (_clientSelectedPart >= 0 && !_isTextDocument)
+        request += " part=" + std::to_string(_clientSelectedPart);
+
+    const StringVector tokens = StringVector::tokenize(_loadRequest);
+    const std::size_t offset = tokens.size() > 1 && tokens.startsWith(1, "part=") ? 2 : 1;
+    if (tokens.size() > offset)
+        request += ' ' + tokens.cat(' ', offset);
+
+    return loadDocument(request.data(), request.size(), StringVector::tokenize(request),
+                        docBroker);
+}
+
+std::vector<std::string> ClientSession::getViewSetupInput() const
+{
+    std::vector<std::string> input;
+    if (!_clientZoomRequest.empty())
+        input.push_back(_clientZoomRequest);
+    if (!_clientVisibleAreaRequest.empty())
+        input.push_back(_clientVisibleAreaRequest);
+    return input;
+}
+
 bool ClientSession::disconnectFromKit()
 {
     assert(_state != SessionState::WAIT_DISCONNECT);
@@ -601,7 +644,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
 {
     LOG_TRC("handling incoming [" << getAbbreviatedMessage(buffer, length) << ']');
     const std::string firstLine = getFirstLine(buffer, length);
-    const StringVector tokens = StringVector::tokenize(firstLine.data(), firstLine.size());
+    const StringVector tokens = StringVector::tokenizeView(firstLine.data(), firstLine.size());
 
     std::shared_ptr<DocumentBroker> docBroker = getDocumentBroker();
     if (!docBroker || docBroker->isMarkedToDestroy())
@@ -616,17 +659,19 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         return false;
     }
 
-    if (tokens.equals(0, "DEBUG"))
+    const ClientCommand command = getClientCommand(tokens.getView(0));
+
+    if (command == ClientCommand::Debug)
     {
         LOG_DBG("From client: " << std::string(buffer, length).substr(strlen("DEBUG") + 1));
         return false;
     }
-    else if (tokens.equals(0, "ERROR"))
+    else if (command == ClientCommand::Error)
     {
         LOG_ERR("From client: " << std::string(buffer, length).substr(strlen("ERROR") + 1));
         return false;
     }
-    else if (tokens.equals(0, "TRACEEVENT"))
+    else if (command == ClientCommand::TraceEvent)
     {
         if (LOOLWSD::EnableTraceEventLogging)
         {
@@ -749,7 +794,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         }
     }
 
-    if (tokens.equals(0, "urp"))
+    if (command == ClientCommand::Urp)
     {
         // This can't be pushed down into the long list of tokens that are
         // forwarded to the child later as we need it to be able to run before
@@ -758,7 +803,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         return forwardToChild(std::string(buffer, length), docBroker);
     }
 
-    if (tokens.equals(0, "loolclient"))
+    if (command == ClientCommand::LoolClient)
     {
         if (tokens.size() < 2)
         {
@@ -839,7 +884,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         return true;
     }
 
-    if (tokens.equals(0, "versionbar"))
+    if (command == ClientCommand::VersionBar)
     {
 #if !MOBILEAPP
         std::string versionBar;
@@ -852,12 +897,12 @@ bool ClientSession::_handleInput(const char *buffer, int length)
             sendTextFrame("versionbar: " + versionBar);
 #endif
     }
-    else if (tokens.equals(0, "jserror") || tokens.equals(0, "jsexception"))
+    else if (command == ClientCommand::JsError || command == ClientCommand::JsException)
     {
         LOG_ERR(std::string(buffer, length));
         return true;
     }
-    else if (tokens.equals(0, "load"))
+    else if (command == ClientCommand::Load)
     {
         if (!getDocURL().empty())
         {
@@ -867,7 +912,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
 
         return loadDocument(buffer, length, tokens, docBroker);
     }
-    else if (tokens.equals(0, "loadwithpassword"))
+    else if (command == ClientCommand::LoadWithPassword)
     {
         std::string docPassword;
         if (tokens.size() > 1 && getTokenString(tokens[1], "password", docPassword))
@@ -885,11 +930,11 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         sendTextFrameAndLogError("error: cmd=" + tokens[0] + " kind=nodocloaded");
         return false;
     }
-    else if (tokens.equals(0, "commandvalues"))
+    else if (command == ClientCommand::CommandValues)
     {
         return getCommandValues(buffer, length, tokens, docBroker);
     }
-    else if (tokens.equals(0, "closedocument"))
+    else if (command == ClientCommand::CloseDocument)
     {
         // If this session is the owner of the file & 'EnableOwnerTermination' feature
         // is turned on by WOPI, let it close all sessions
@@ -908,7 +953,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
 
         return true;
     }
-    else if (tokens.equals(0, "versionrestore"))
+    else if (command == ClientCommand::VersionRestore)
     {
         if (tokens.size() > 1 && tokens.equals(1, "prerestore"))
         {
@@ -917,29 +962,29 @@ bool ClientSession::_handleInput(const char *buffer, int length)
             docBroker->closeDocument("versionrestore: prerestore_ack");
         }
     }
-    else if (tokens.equals(0, "partpagerectangles"))
+    else if (command == ClientCommand::PartPageRectangles)
     {
         // We don't support partpagerectangles any more, will be removed in the
         // next version
         sendTextFrame("partpagerectangles: ");
         return true;
     }
-    else if (tokens.equals(0, "ping"))
+    else if (command == ClientCommand::Ping)
     {
         std::string count = std::to_string(docBroker->getRenderedTileCount());
         sendTextFrame("pong rendercount=" + count);
         return true;
     }
-    else if (tokens.equals(0, "renderfont"))
+    else if (command == ClientCommand::RenderFont)
     {
         return sendFontRendering(buffer, length, tokens, docBroker);
     }
-    else if (tokens.equals(0, "status") || tokens.equals(0, "statusupdate"))
+    else if (command == ClientCommand::Status || command == ClientCommand::StatusUpdate)
     {
         assert(firstLine.size() == static_cast<std::size_t>(length));
         return forwardToChild(firstLine, docBroker);
     }
-    else if (tokens.equals(0, "tile"))
+    else if (command == ClientCommand::Tile)
     {
         const int canonicalViewId = to_underlying(getCanonicalViewId());
         if (!UnitWSD::isUnitTesting() && canonicalViewId < 1000)
@@ -950,7 +995,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         }
         return sendTile(buffer, length, tokens, docBroker);
     }
-    else if (tokens.equals(0, "tilecombine"))
+    else if (command == ClientCommand::TileCombine)
     {
         const int canonicalViewId = to_underlying(getCanonicalViewId());
         if (!UnitWSD::isUnitTesting() && canonicalViewId < 1000)
@@ -961,7 +1006,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         }
         return sendCombinedTiles(buffer, length, tokens, docBroker);
     }
-    else if (tokens.equals(0, "save"))
+    else if (command == ClientCommand::Save)
     {
         // If we can't write to Storage, there is no point in saving.
         if (!isWritable())
@@ -999,7 +1044,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
                                   dontSaveIfUnmodified != 0, extendedData);
         }
     }
-    else if (tokens.equals(0, "savetostorage"))
+    else if (command == ClientCommand::SaveToStorage)
     {
         // By default savetostorage implies forcing.
         int force = 1;
@@ -1011,7 +1056,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         // contract and do as told, not as we expect the API to be used. Use force if provided.
         docBroker->uploadToStorage(client_from_this(), force);
     }
-    else if (tokens.equals(0, "clientvisiblearea"))
+    else if (command == ClientCommand::ClientVisibleArea)
     {
         int x;
         int y;
@@ -1056,9 +1101,10 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         }
 
         _clientVisibleArea = Util::Rectangle(x, y, width, height);
-        return forwardToChild(std::string(buffer, length), docBroker);
+        _clientVisibleAreaRequest = std::string(buffer, length);
+        return forwardToChild(_clientVisibleAreaRequest, docBroker);
     }
-    else if (tokens.equals(0, "setclientpart"))
+    else if (command == ClientCommand::SetClientPart)
     {
         if(!_isTextDocument)
         {
@@ -1074,7 +1120,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
             return forwardToChild(std::string(buffer, length), docBroker);
         }
     }
-    else if (tokens.equals(0, "selectclientpart"))
+    else if (command == ClientCommand::SelectClientPart)
     {
         if(!_isTextDocument)
         {
@@ -1091,7 +1137,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
             return forwardToChild(std::string(buffer, length), docBroker);
         }
     }
-    else if (tokens.equals(0, "moveselectedclientparts"))
+    else if (command == ClientCommand::MoveSelectedClientParts)
     {
         if (!_isTextDocument)
         {
@@ -1108,7 +1154,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
             return forwardToChild(std::string(buffer, length), docBroker);
         }
     }
-    else if (tokens.equals(0, "clientzoom"))
+    else if (command == ClientCommand::ClientZoom)
     {
         int tilePixelWidth;
         int tilePixelHeight;
@@ -1130,9 +1176,10 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         _tileHeightPixel = tilePixelHeight;
         _tileWidthTwips = tileTwipWidth;
         _tileHeightTwips = tileTwipHeight;
-        return forwardToChild(std::string(buffer, length), docBroker);
+        _clientZoomRequest = std::string(buffer, length);
+        return forwardToChild(_clientZoomRequest, docBroker);
     }
-    else if (tokens.equals(0, "tileprocessed"))
+    else if (command == ClientCommand::TileProcessed)
     {
         std::string wids;
         if (tokens.size() != 2 ||
@@ -1159,7 +1206,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         docBroker->sendRequestedTiles(client_from_this());
         return true;
     }
-    else if (tokens.equals(0, "removesession"))
+    else if (command == ClientCommand::RemoveSession)
     {
         if (tokens.size() > 1 && (isDocumentOwner() || !isReadOnly()))
         {
@@ -1169,7 +1216,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         else
             LOG_WRN("Readonly session '" << getId() << "' trying to kill another view");
     }
-    else if (tokens.equals(0, "renamefile"))
+    else if (command == ClientCommand::RenameFile)
     {
         std::string encodedWopiFilename;
         if (tokens.size() < 2 || !getTokenString(tokens[1], "filename", encodedWopiFilename))
@@ -1190,7 +1237,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
 
         return true;
     }
-    else if (tokens.equals(0, "dialogevent"))
+    else if (command == ClientCommand::DialogEvent)
     {
         if (tokens.size() > 2)
         {
@@ -1215,13 +1262,13 @@ bool ClientSession::_handleInput(const char *buffer, int length)
 
         return forwardToChild(firstLine, docBroker);
     }
-    else if (tokens.equals(0, "formfieldevent") ||
-             tokens.equals(0, "sallogoverride") ||
-             tokens.equals(0, "contentcontrolevent"))
+    else if (command == ClientCommand::FormFieldEvent ||
+             command == ClientCommand::SalLogOverride ||
+             command == ClientCommand::ContentControlEvent)
     {
         return forwardToChild(firstLine, docBroker);
     }
-    else if (tokens.equals(0, "loggingleveloverride"))
+    else if (command == ClientCommand::LoggingLevelOverride)
     {
         if (tokens.size() > 0)
         {
@@ -1289,7 +1336,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
             }
         }
     }
-    else if (tokens.equals(0, "traceeventrecording"))
+    else if (command == ClientCommand::TraceEventRecording)
     {
         if (ConfigUtil::getConfigValue<bool>("trace_event[@enable]", false))
         {
@@ -1310,18 +1357,18 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         }
         return true;
     }
-    else if (tokens.equals(0, "a11ystate"))
+    else if (command == ClientCommand::A11yState)
     {
         if (ConfigUtil::getConfigValue<bool>("accessibility.enable", false))
         {
             return forwardToChild(std::string(buffer, length), docBroker);
         }
     }
-    else if (tokens.equals(0, "completefunction"))
+    else if (command == ClientCommand::CompleteFunction)
     {
         return forwardToChild(std::string(buffer, length), docBroker);
     }
-    else if (tokens.equals(0, "resetaccesstoken"))
+    else if (command == ClientCommand::ResetAccessToken)
     {
         if (tokens.size() != 2)
         {
@@ -1334,7 +1381,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         return true;
     }
 #if !MOBILEAPP && !WASMAPP
-    else if (tokens.equals(0, "switch_request"))
+    else if (command == ClientCommand::SwitchRequest)
     {
         if (tokens.size() != 2)
         {
@@ -1347,43 +1394,43 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         return true;
     }
 #endif // !MOBILEAPP && !WASMAPP
-    else if (tokens.equals(0, "outlinestate") ||
-             tokens.equals(0, "downloadas") ||
-             tokens.equals(0, "getchildid") ||
-             tokens.equals(0, "gettextselection") ||
-             tokens.equals(0, "paste") ||
-             tokens.equals(0, "insertfile") ||
-             tokens.equals(0, "key") ||
-             tokens.equals(0, "textinput") ||
-             tokens.equals(0, "windowkey") ||
-             tokens.equals(0, "mouse") ||
-             tokens.equals(0, "windowmouse") ||
-             tokens.equals(0, "windowgesture") ||
-             tokens.equals(0, "resetselection") ||
-             tokens.equals(0, "saveas") ||
-             tokens.equals(0, "exportas") ||
-             tokens.equals(0, "selectgraphic") ||
-             tokens.equals(0, "selecttext") ||
-             tokens.equals(0, "windowselecttext") ||
-             tokens.equals(0, "setpage") ||
-             tokens.equals(0, "uno") ||
-             tokens.equals(0, "urp") ||
-             tokens.equals(0, "useractive") ||
-             tokens.equals(0, "userinactive") ||
-             tokens.equals(0, "paintwindow") ||
-             tokens.equals(0, "windowcommand") ||
-             tokens.equals(0, "asksignaturestatus") ||
-             tokens.equals(0, "rendershapeselection") ||
-             tokens.equals(0, "resizewindow") ||
-             tokens.equals(0, "removetextcontext") ||
-             tokens.equals(0, "rendersearchresult") ||
-             tokens.equals(0, "geta11yfocusedparagraph") ||
-             tokens.equals(0, "geta11ycaretposition") ||
-             tokens.equals(0, "getpresentationinfo") ||
-             tokens.equals(0, "slideshowfollow"))
+    else if (command == ClientCommand::OutlineState ||
+             command == ClientCommand::DownloadAs ||
+             command == ClientCommand::GetChildId ||
+             command == ClientCommand::GetTextSelection ||
+             command == ClientCommand::Paste ||
+             command == ClientCommand::InsertFile ||
+             command == ClientCommand::Key ||
+             command == ClientCommand::TextInput ||
+             command == ClientCommand::WindowKey ||
+             command == ClientCommand::Mouse ||
+             command == ClientCommand::WindowMouse ||
+             command == ClientCommand::WindowGesture ||
+             command == ClientCommand::ResetSelection ||
+             command == ClientCommand::SaveAs ||
+             command == ClientCommand::ExportAs ||
+             command == ClientCommand::SelectGraphic ||
+             command == ClientCommand::SelectText ||
+             command == ClientCommand::WindowSelectText ||
+             command == ClientCommand::SetPage ||
+             command == ClientCommand::Uno ||
+             command == ClientCommand::Urp ||
+             command == ClientCommand::UserActive ||
+             command == ClientCommand::UserInactive ||
+             command == ClientCommand::PaintWindow ||
+             command == ClientCommand::WindowCommand ||
+             command == ClientCommand::AskSignatureStatus ||
+             command == ClientCommand::RenderShapeSelection ||
+             command == ClientCommand::ResizeWindow ||
+             command == ClientCommand::RemoveTextContext ||
+             command == ClientCommand::RenderSearchResult ||
+             command == ClientCommand::GetA11yFocusedParagraph ||
+             command == ClientCommand::GetA11yCaretPosition ||
+             command == ClientCommand::GetPresentationInfo ||
+             command == ClientCommand::SlideShowFollow)
     {
 #if !MOBILEAPP
-        if (tokens.equals(0, "uno"))
+        if (command == ClientCommand::Uno)
         {
             if (tokens.equals(1, ".uno:PrepareSignature") || tokens.equals(1, ".uno:DownloadSignature"))
             {
@@ -1392,7 +1439,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
         }
 #endif
 
-        if (tokens.equals(0, "key"))
+        if (command == ClientCommand::Key)
         {
             _keyEvents++;
 
@@ -1403,7 +1450,14 @@ bool ClientSession::_handleInput(const char *buffer, int length)
                 LOG_DBG("Suppressing Ctrl+q");
                 return true;
             }
+
+            // Only the typing is followed to its tiles: the navigation keys have no char.
+            if (tokens.equals(1, "type=input") && !tokens.equals(2, "char=0") &&
+                _keystrokeLatency.keyTyped())
+                LOG_TRC("Following keystroke #" << _keystrokeLatency.getId());
         }
+        else if (command == ClientCommand::TextInput && _keystrokeLatency.keyTyped())
+            LOG_TRC("Following keystroke #" << _keystrokeLatency.getId());
 
         if (isEditable() && LOOLProtocol::tokenIndicatesDocumentModification(tokens))
         {
@@ -1416,7 +1470,7 @@ bool ClientSession::_handleInput(const char *buffer, int length)
             return forwardToChild(dummyFrame, docBroker);
         }
 
-        if (tokens.equals(0, "slideshowfollow"))
+        if (command == ClientCommand::SlideShowFollow)
         {
             if(tokens.equals(1, "newfollowmepresentation"))
                 docBroker->setIsFollowmeSlideShowOn(true);
@@ -1441,28 +1495,28 @@ bool ClientSession::_handleInput(const char *buffer, int length)
 
         return forwardToChild(std::string(buffer, length), docBroker);
     }
-    else if (tokens.equals(0, "attemptlock"))
+    else if (command == ClientCommand::AttemptLock)
     {
         return attemptLock(docBroker);
     }
-    else if (tokens.equals(0, "blockingcommandstatus"))
+    else if (command == ClientCommand::BlockingCommandStatus)
     {
         return forwardToChild(std::string(buffer, length), docBroker);
     }
-    else if (tokens.equals(0, "toggletiledumping"))
+    else if (command == ClientCommand::ToggleTileDumping)
     {
         return forwardToChild(std::string(buffer, length), docBroker);
     }
-    else if (tokens.equals(0, "getslide"))
+    else if (command == ClientCommand::GetSlide)
     {
         return handleGetSlideRequest(tokens, docBroker);
     }
 #if !MOBILEAPP
-    else if (tokens.equals(0, "routetokensanitycheck"))
+    else if (command == ClientCommand::RouteTokenSanityCheck)
     {
         Admin::instance().routeTokenSanityCheck();
     }
-    else if (tokens.equals(0, "browsersetting") && tokens.size() >= 3)
+    else if (command == ClientCommand::BrowserSetting && tokens.size() >= 3)
     {
         std::string action;
         getTokenString(tokens[1], "action", action);
@@ -1674,6 +1728,7 @@ bool ClientSession::loadDocument(const char* /*buffer*/, int /*length*/,
     }
 
     _viewLoadStart = std::chrono::steady_clock::now();
+    _loadRequest = tokens.cat(' ', 0);
     LOG_INF("Requesting document load from child.");
     try
     {
@@ -2298,19 +2353,28 @@ bool ClientSession::handleKitToClientMessage(const std::shared_ptr<Message>& pay
         LOOLWSD::dumpOutgoingTrace(docBroker->getJailId(), getId(), firstLine);
 
     const auto& tokens = payload->tokens();
+
+    // A hibernated document reloads behind the scenes; don't show its progress.
+    if (docBroker->isHibernated() && tokens.startsWith(0, "statusindicator"))
+        return true;
+
     if (tokens.equals(0, "unocommandresult:"))
     {
         LOG_INF("Command: " << firstLine);
         const std::string stringJSON = payload->jsonString();
         if (!stringJSON.empty())
         {
-            try
+            // Only the result of saving needs a DOM; the others are passed through.
+            std::string commandName;
+            if (JsonScanner::getString(stringJSON, "commandName", commandName) &&
+                commandName == ".uno:Save")
             {
-                Poco::JSON::Parser parser;
-                const Poco::Dynamic::Var parsedJSON = parser.parse(stringJSON);
-                const auto& object = parsedJSON.extract<Poco::JSON::Object::Ptr>();
-                if (object->get("commandName").toString() == ".uno:Save")
+                try
                 {
+                    Poco::JSON::Parser parser;
+                    const Poco::Dynamic::Var parsedJSON = parser.parse(stringJSON);
+                    const auto& object = parsedJSON.extract<Poco::JSON::Object::Ptr>();
+
                     // Save to Storage and log result.
                     docBroker->handleSaveResponse(client_from_this(), object);
 
@@ -2319,10 +2383,10 @@ bool ClientSession::handleKitToClientMessage(const std::shared_ptr<Message>& pay
 
                     return true;
                 }
-            }
-            catch (const std::exception& exception)
-            {
-                LOG_ERR("Failed to handle [" << firstLine << "]: " << exception.what());
+                catch (const std::exception& exception)
+                {
+                    LOG_ERR("Failed to handle [" << firstLine << "]: " << exception.what());
+                }
             }
         }
         else
@@ -2571,13 +2635,14 @@ bool ClientSession::handleKitToClientMessage(const std::shared_ptr<Message>& pay
             const std::string prefix = json.substr(0, it);
             json.erase(0, it); // Remove the prefix to parse the purse JSON part.
 
-            Poco::JSON::Object::Ptr object;
-            if (JsonUtil::parseJSON(json, object))
+            // Patched in place: the rest of the selection is passed through as is.
+            std::string url;
+            if (JsonScanner::getString(json, "url", url))
             {
-                const std::string url = JsonUtil::getJSONValue<std::string>(object, "url");
                 if (!url.empty())
                 {
-                    const std::string id = JsonUtil::getJSONValue<std::string>(object, "id");
+                    std::string id;
+                    JsonScanner::getString(json, "id", id);
                     if (!id.empty())
                     {
                         docBroker->addEmbeddedMedia(
@@ -2585,12 +2650,13 @@ bool ClientSession::handleKitToClientMessage(const std::shared_ptr<Message>& pay
 
                         const std::string mediaUrl =
                             Uri::encode(createPublicURI("media", id, /*encode=*/false), "&");
-                        object->set("url", mediaUrl); // Replace the url with the public one.
-                        object->set("mimeType", "video/mp4"); //FIXME: get this from the source json
+                        // Replace the url with the public one.
+                        JsonScanner::setValue(json, "url",
+                                              '"' + JsonUtil::escapeJSONValue(mediaUrl) + '"');
+                        //FIXME: get this from the source json
+                        JsonScanner::setValue(json, "mimeType", "\"video/mp4\"");
 
-                        std::ostringstream mediaStr;
-                        object->stringify(mediaStr);
-                        const std::string msg = prefix + mediaStr.str();
+                        const std::string msg = prefix + json;
                         forwardToClient(std::make_shared<Message>(msg, Message::Dir::Out));
                         return true;
                     }
@@ -2667,8 +2733,9 @@ ClientSession::handleOpenDocKitToClientMessage(const std::shared_ptr<Message>& p
                 docBroker->setInteractive(false);
                 docBroker->setLoaded();
 
-                // Wopi post load actions.
-                if (_wopiFileInfo && !_wopiFileInfo->getTemplateSource().empty())
+                // Wopi post load actions, unless reloading after hibernation.
+                if (_wopiFileInfo && !_wopiFileInfo->getTemplateSource().empty() &&
+                    !docBroker->isHibernated())
                 {
                     LOG_DBG("Uploading template [" << _wopiFileInfo->getTemplateSource()
                                                    << "] to storage after loading.");
@@ -2727,45 +2794,36 @@ ClientSession::handleOpenDocKitToClientMessage(const std::shared_ptr<Message>& p
         if (statusJsonObject->has("mode"))
             _clientSelectedMode = std::atoi(statusJsonObject->get("mode").toString().c_str());
         if (statusJsonObject->has("type"))
-            _isTextDocument = statusJsonObject->get("type").toString() == "text";
+        {
+            _docType = statusJsonObject->get("type").toString();
+            _isTextDocument = _docType == "text";
+        }
         if (statusJsonObject->has("viewid"))
             _kitViewId = std::atoi(statusJsonObject->get("viewid").toString().c_str());
 
         // Forward the status response to the client.
         return forwardToClient(payload);
     }
+    else if (tokens.equals(0, "statusindicatorfinish:"))
+    {
+        docBroker->markLoadProfilePhase(LoadProfile::Phase::StatusIndicatorFinish);
+    }
     else if (tokens.equals(0, "statusupdate:"))
     {
-        Poco::JSON::Parser parser;
-        Poco::Dynamic::Var statusJsonVar = parser.parse(firstLine.substr(13));
-        const Poco::SharedPtr<Poco::JSON::Object>& statusJsonObject =
-            statusJsonVar.extract<Poco::JSON::Object::Ptr>();
-
-        if (statusJsonObject->has("mode"))
-            _clientSelectedMode = std::atoi(statusJsonObject->get("mode").toString().c_str());
+        JsonScanner::getInteger(firstLine, "mode", _clientSelectedMode);
     }
     else if (tokens.equals(0, "commandvalues:"))
     {
         const std::string stringJSON = payload->jsonString();
         if (!stringJSON.empty())
         {
-            try
-            {
-                Poco::JSON::Parser parser;
-                const Poco::Dynamic::Var result = parser.parse(stringJSON);
-                const auto& object = result.extract<Poco::JSON::Object::Ptr>();
-                const std::string commandName =
-                    object->has("commandName") ? object->get("commandName").toString() : "";
-                if (commandName == ".uno:CharFontName" || commandName == ".uno:StyleApply")
-                {
-                    // other commands should not be cached
-                    docBroker->tileCache().saveTextStream(TileCache::StreamType::CmdValues,
-                                                          commandName, payload->data());
-                }
-            }
-            catch (const std::exception& exception)
+            std::string commandName;
+            JsonScanner::getString(stringJSON, "commandName", commandName);
+            if (commandName == ".uno:CharFontName" || commandName == ".uno:StyleApply")
             {
-                LOG_ERR("commandvalues parsing failure: " << exception.what());
+                // other commands should not be cached
+                docBroker->tileCache().saveTextStream(TileCache::StreamType::CmdValues,
+                                                      commandName, payload->data());
             }
         }
     }
@@ -2797,55 +2855,45 @@ ClientSession::handleOpenDocKitToClientMessage(const std::shared_ptr<Message>& p
         assert(firstLine.size() == payload->size() &&
                "Unexpected multiline data in invalidatecursor");
 
-        const std::string stringJSON = payload->jsonString();
-        Poco::JSON::Parser parser;
-        try
-        {
-            const Poco::Dynamic::Var result = parser.parse(stringJSON);
-            const auto& object = result.extract<Poco::JSON::Object::Ptr>();
-            std::string rectangle = object->get("rectangle").toString();
-            StringVector rectangleTokens(StringVector::tokenize(std::move(rectangle), ','));
-            int x = 0, y = 0, w = 0, h = 0;
-            if (rectangleTokens.size() > 2 && stringToInteger(rectangleTokens[0], x) &&
-                stringToInteger(rectangleTokens[1], y))
+        std::string rectangle;
+        JsonScanner::getString(firstLine, "rectangle", rectangle);
+        StringVector rectangleTokens(StringVector::tokenize(std::move(rectangle), ','));
+        int x = 0, y = 0, w = 0, h = 0;
+        if (rectangleTokens.size() > 2 && stringToInteger(rectangleTokens[0], x) &&
+            stringToInteger(rectangleTokens[1], y))
+        {
+            if (rectangleTokens.size() > 3)
             {
-                if (rectangleTokens.size() > 3)
-                {
-                    stringToInteger(rectangleTokens[2], w);
-                    stringToInteger(rectangleTokens[3], h);
-                }
+                stringToInteger(rectangleTokens[2], w);
+                stringToInteger(rectangleTokens[3], h);
+            }
 
-                docBroker->invalidateCursor(x, y, w, h);
+            docBroker->invalidateCursor(x, y, w, h);
 
-                // session used for thumbnailing and target already was set
-                if (_thumbnailSession)
-                {
-                    setThumbnailPosition(std::make_pair(x, y));
+            // session used for thumbnailing and target already was set
+            if (_thumbnailSession)
+            {
+                setThumbnailPosition(std::make_pair(x, y));
 
-                    bool cursorAlreadyAtTargetPosition = getThumbnailTarget().empty();
-                    if (cursorAlreadyAtTargetPosition)
-                    {
-                        std::ostringstream renderThumbnailCmd;
-                        renderThumbnailCmd << "getthumbnail x=" << x << " y=" << y;
-                        docBroker->forwardToChild(client_from_this(), renderThumbnailCmd.str());
-                    }
-                    else
-                    {
-                        // this is initial cursor position message
-                        // wait for second invalidatecursor message
-                        // reset target so we will proceed next time
-                        setThumbnailTarget(std::string());
-                    }
+                bool cursorAlreadyAtTargetPosition = getThumbnailTarget().empty();
+                if (cursorAlreadyAtTargetPosition)
+                {
+                    std::ostringstream renderThumbnailCmd;
+                    renderThumbnailCmd << "getthumbnail x=" << x << " y=" << y;
+                    docBroker->forwardToChild(client_from_this(), renderThumbnailCmd.str());
+                }
+                else
+                {
+                    // this is initial cursor position message
+                    // wait for second invalidatecursor message
+                    // reset target so we will proceed next time
+                    setThumbnailTarget(std::string());
                 }
-            }
-            else
-            {
-                LOG_ERR("Unable to parse " << firstLine);
             }
         }
-        catch (const std::exception& exception)
+        else
         {
-            LOG_ERR("invalidatecursor parsing failure: " << exception.what());
+            LOG_ERR("Unable to parse " << firstLine);
         }
     }
 #if !MOBILEAPP
@@ -3399,21 +3447,21 @@ void ClientSession::handleTileInvalidation(const std::string& message,
         BOTTOMLEFT_PANE,
         BOTTOMRIGHT_PANE
     };
-    Util::Rectangle paneRects[4];
-    int numPanes = 0;
+
+    // Only what is invalidated in the visible panes needs rendering.
+    Util::Region dirty;
     for(int i = 0; i < 4; ++i)
     {
         if(!isSplitPane(panes[i]))
             continue;
 
-        Util::Rectangle rect = getNormalizedVisiblePaneArea(panes[i]);
-        if (rect.intersects(invalidateRect)) {
-            paneRects[numPanes++] = rect;
-        }
+        Util::Region paneDirty(getNormalizedVisiblePaneArea(panes[i]));
+        paneDirty.intersect(invalidateRect);
+        dirty.unite(paneDirty);
     }
 
     // We can ignore the invalidation if it's outside of all split-panes.
-    if(!numPanes)
+    if (dirty.isEmpty())
         return;
 
     if( part == -1 ) // If no part is specified we use the part used by the client
@@ -3424,65 +3472,81 @@ void ClientSession::handleTileInvalidation(const std::string& message,
     std::vector<TileDesc> invalidTiles;
     if((part == _clientSelectedPart && mode == _clientSelectedMode) || _isTextDocument)
     {
-        for(int paneIdx = 0; paneIdx < numPanes; ++paneIdx)
+        // Find the tiles with dirty surface; a tile across the edge of two
+        // rectangles of the region, or of two panes, is requested once.
+        std::set<std::pair<int, int>> dirtyTiles; // row, column
+        for (const Util::Rectangle& rect : dirty.getRectangles())
         {
-            const Util::Rectangle& normalizedVisArea = paneRects[paneIdx];
-            int lastVertTile = std::ceil(normalizedVisArea.getBottom() / static_cast<double>(_tileHeightTwips));
-            int lastHoriTile = std::ceil(normalizedVisArea.getRight() / static_cast<double>(_tileWidthTwips));
-
-            // Iterate through visible tiles
-            for(int i = normalizedVisArea.getTop() / _tileHeightTwips; i <= lastVertTile; ++i)
+            const int lastVertTile = (rect.getBottom() - 1) / _tileHeightTwips;
+            const int lastHoriTile = (rect.getRight() - 1) / _tileWidthTwips;
+            for (int i = rect.getTop() / _tileHeightTwips; i <= lastVertTile; ++i)
             {
-                for(int j = normalizedVisArea.getLeft() / _tileWidthTwips; j <= lastHoriTile; ++j)
-                {
-                    // Find tiles affected by invalidation
-                    Util::Rectangle tileRect (j * _tileWidthTwips, i * _tileHeightTwips, _tileWidthTwips, _tileHeightTwips);
-                    if(invalidateRect.intersects(tileRect))
-                    {
-                        TileDesc desc(canonicalViewId, part, mode,
-                                      _tileWidthPixel, _tileHeightPixel,
-                                      j * _tileWidthTwips, i * _tileHeightTwips,
-                                      _tileWidthTwips, _tileHeightTwips, -1, 0, -1);
-
-                        bool dup = false;
-                        // Check we don't have duplicates
-                        for (const auto &it : invalidTiles)
-                        {
-                            if (it == desc)
-                            {
-                                LOG_TRC("Duplicate tile skipped from invalidation " << desc.debugName());
-                                dup = true;
-                                break;
-                            }
-                        }
-
-                        if (!dup)
-                        {
-                            invalidTiles.push_back(desc);
-
-                            TileWireId makeDelta = 1;
-                            // FIXME: mobile with no TileCache & flushed kit cache
-                            // FIXME: out of (a)sync kit vs. TileCache re: keyframes ?
-                            if (getDocumentBroker()->hasTileCache() &&
-                                !getDocumentBroker()->tileCache().lookupTile(desc))
-                                makeDelta = 0; // force keyframe
-                            invalidTiles.back().setOldWireId(makeDelta);
-                            invalidTiles.back().setWireId(0);
-                        }
-                    }
-                }
+                for (int j = rect.getLeft() / _tileWidthTwips; j <= lastHoriTile; ++j)
+                    dirtyTiles.emplace(i, j);
             }
         }
+
+        for (const auto& tile : dirtyTiles)
+        {
+            TileDesc desc(canonicalViewId, part, mode,
+                          _tileWidthPixel, _tileHeightPixel,
+                          tile.second * _tileWidthTwips, tile.first * _tileHeightTwips,
+                          _tileWidthTwips, _tileHeightTwips, -1, 0, -1);
+
+            TileWireId makeDelta = 1;
+            // FIXME: mobile with no TileCache & flushed kit cache
+            // FIXME: out of (a)sync kit vs. TileCache re: keyframes ?
+            if (getDocumentBroker()->hasTileCache() &&
+                !getDocumentBroker()->tileCache().lookupTile(desc))
+                makeDelta = 0; // force keyframe
+            desc.setOldWireId(makeDelta);
+            desc.setWireId(0);
+            invalidTiles.push_back(desc);
+        }
     }
 
     if(!invalidTiles.empty())
     {
+        std::chrono::microseconds latency;
+        if (_keystrokeLatency.invalidated(part, dirty.getBounds(), latency))
+        {
+            LOG_TRC("Keystroke #" << _keystrokeLatency.getId() << " invalidated after "
+                                  << latency);
+#if !MOBILEAPP
+            Admin::instance().addKeystrokeLatency(_docType, "invalidated", latency);
+#endif
+        }
+
         TileCombined tileCombined = TileCombined::create(invalidTiles);
         tileCombined.setCanonicalViewId(canonicalViewId);
         docBroker->handleTileCombinedRequest(tileCombined, false, client_from_this());
     }
 }
 
+void ClientSession::traceKeystrokeTile(const TileDesc& desc)
+{
+    std::chrono::microseconds latency;
+    if (!_keystrokeLatency.tileSent(desc, latency))
+        return;
+
+    LOG_DBG("Keystroke #" << _keystrokeLatency.getId() << " rendered after " << latency);
+#if !MOBILEAPP
+    Admin::instance().addKeystrokeLatency(_docType, "rendered", latency);
+#endif
+
+    // The whole round-trip, as one complete event.
+    const auto typed = std::chrono::system_clock::now() - latency;
+    TraceEvent::emitOneRecordingIfEnabled(
+        "{\"name\":\"keystroke\",\"ph\":\"X\",\"ts\":" +
+        std::to_string(
+            std::chrono::duration_cast<std::chrono::microseconds>(typed.time_since_epoch())
+                .count()) +
+        ",\"dur\":" + std::to_string(latency.count()) +
+        ",\"pid\":" + std::to_string(Util::getProcessId()) +
+        ",\"tid\":" + std::to_string(Util::getThreadId()) + ",\"args\":{\"id\":" +
+        std::to_string(_keystrokeLatency.getId()) + ",\"session\":\"" + getId() + "\"}},\n");
+}
+
 bool ClientSession::isSplitPane(const SplitPaneName paneName) const
 {
     if (paneName == BOTTOMRIGHT_PANE)
@@ -14,6 +14,7 @@
 #include "SenderQueue.hpp"
 #include "ServerURL.hpp"
 #include "DocumentBroker.hpp"
+#include "KeystrokeLatency.hpp"
 
 #include <Poco/JSON/Object.h>
 #include <Poco/SharedPtr.h>
@@ -61,6 +62,15 @@ public:
     /// transition to a new state
     void setState(SessionState newState);
 
+    /// The document hibernated: the Kit, and our view in it, are gone.
+    void detachFromKit();
+
+    /// Loads our view again, as last seen, in the new Kit of a hibernated document.
+    bool reloadView(const std::shared_ptr<DocumentBroker>& docBroker);
+
+    /// The input that set up our view, such as the zoom, to replay once it's reloaded.
+    std::vector<std::string> getViewSetupInput() const;
+
     void setDocumentOwner(const bool documentOwner) { _isDocumentOwner = documentOwner; }
     bool isDocumentOwner() const { return _isDocumentOwner; }
 
@@ -107,7 +117,9 @@ public:
         TileWireId lastSentId = _tracker.updateTileSeq(desc);
         std::string header = desc.serialize("update:", "\n");
         LOG_TRC("Sending update from " << lastSentId << " to " << header);
-        return sendTextFrame(header.data(), header.size());
+        const bool sent = sendTextFrame(header.data(), header.size());
+        traceKeystrokeTile(desc);
+        return sent;
     }
 
     bool sendTileNow(const TileDesc &desc, const Tile &tile)
@@ -129,7 +141,9 @@ public:
 
         bool hasContent = tile->appendChangesSince(output, tile->isPng() ? 0 : lastSentId);
         LOG_TRC("Sending tile message: " << header << " lastSendId " << lastSentId << " content " << hasContent);
-        return sendBinaryFrame(output.data(), output.size());
+        const bool sent = sendBinaryFrame(output.data(), output.size());
+        traceKeystrokeTile(desc);
+        return sent;
     }
 
     bool sendBlob(const std::string &header, const Blob &blob)
@@ -371,6 +385,9 @@ private:
     void handleTileInvalidation(const std::string& message,
                                 const std::shared_ptr<DocumentBroker>& docBroker);
 
+    /// Reports the latency of the keystroke followed when the tile shows it.
+    void traceKeystrokeTile(const TileDesc& desc);
+
     bool isTileInsideVisibleArea(const TileDesc& tile) const;
 
     /// If this session is read-only because of failed lock, try to unlock and make it read-write.
@@ -447,9 +464,20 @@ private:
     /// Time when loading of view started
     std::chrono::steady_clock::time_point _viewLoadStart;
 
+    /// The load request, and the last zoom and visible area, to reload the view with.
+    std::string _loadRequest;
+    std::string _clientZoomRequest;
+    std::string _clientVisibleAreaRequest;
+
     /// Count of key-strokes
     uint64_t _keyEvents;
 
+    /// Follows a keystroke to its tiles, for the latency metrics.
+    KeystrokeLatency _keystrokeLatency;
+
+    /// The type of the document, as in the status: text, spreadsheet, etc.
+    std::string _docType;
+
     /// Epoch of the client's performance.now() function, as microseconds since Unix epoch
     uint64_t _performanceCounterEpoch;
 
@@ -15,10 +15,13 @@
 #include <common/Authorization.hpp>
 #include <common/Clipboard.hpp>
 #include <common/CommandControl.hpp>
+#include <common/CommandTable.hpp>
+#include <common/Histogram.hpp>
 #include <common/Common.hpp>
 #include <common/ConfigUtil.hpp>
 #include <common/FileUtil.hpp>
 #include <common/JailUtil.hpp>
+#include <common/JsonScanner.hpp>
 #include <common/JsonUtil.hpp>
 #include <common/Log.hpp>
 #include <common/Message.hpp>
@@ -44,11 +47,13 @@
 
 #include <Poco/DigestStream.h>
 #include <Poco/Exception.h>
+#include <Poco/File.h>
 #include <Poco/Path.h>
 #include <Poco/SHA1Engine.h>
 #include <Poco/StreamCopier.h>
 #include <Poco/URI.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
@@ -203,6 +208,7 @@ DocumentBroker::DocumentBroker(ChildType type, const std::string& uri, const Poc
     , _createTime(std::chrono::steady_clock::now())
     , _loadDuration(0)
     , _wopiDownloadDuration(0)
+    , _loadProfile(_createTime)
     , _tileVersion(0)
     , _cursorPosX(0)
     , _cursorPosY(0)
@@ -222,6 +228,8 @@ DocumentBroker::DocumentBroker(ChildType type, const std::string& uri, const Poc
           ConfigUtil::getConfigValue<bool>("per_document.background_autosave", true))
     , _backgroundManualSave(
           ConfigUtil::getConfigValue<bool>("per_document.background_manualsave", true))
+    , _hibernation(Hibernation::None)
+    , _hibernateAfterSave(false)
 {
     assert(!_docKey.empty());
     assert(!LOOLWSD::ChildRoot.empty());
@@ -598,6 +606,14 @@ void DocumentBroker::pollThread()
                             : (!_closeReason.empty() ? _closeReason : "unloading");
                     autoSaveAndStop(reason);
                 }
+#if !MOBILEAPP
+                else if (_hibernateAfterSave && !_saveManager.isSaving() && !isAsyncUploading())
+                {
+                    // Saved and uploaded since we were asked to hibernate; but only once.
+                    _hibernateAfterSave = false;
+                    hibernate(/*saveFirst=*/false);
+                }
+#endif
                 else if (!_stop && _saveManager.needAutoSaveCheck())
                 {
                     LOG_TRC("Triggering an autosave by timer");
@@ -820,6 +836,15 @@ void DocumentBroker::pollThread()
     LOG_DBG("Terminating child with reason: [" << _closeReason << ']');
     terminateChild(_closeReason);
 
+#if !MOBILEAPP
+    if (!_hibernatedPath.empty())
+    {
+        // Saved and uploaded before hibernating.
+        LOG_DBG("Removing the files of hibernated document [" << _docKey << ']');
+        FileUtil::removeFile(_hibernatedPath, /*recursive=*/true);
+    }
+#endif
+
     // Stop to mark it done and cleanup.
     _poll->stop();
 
@@ -913,6 +938,10 @@ DocumentBroker::~DocumentBroker()
 
     _sessions.clear();
 
+    // Without tiles, as when converting, the load is done only now.
+    if (_loadProfile.has(LoadProfile::Phase::Loaded))
+        reportLoadProfile();
+
     // Need to first make sure the child exited, socket closed,
     // and thread finished before we are destroyed.
     _childProcess.reset();
@@ -1063,6 +1092,8 @@ bool DocumentBroker::download(
 
             checkFileInfoCallDurationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start);
+            _loadProfile.setDuration(LoadProfile::Phase::CheckFileInfo,
+                                     checkFileInfoCallDurationMs);
         }
 
         wopiStorage->handleWOPIFileInfo(*wopiFileInfo, *_lockCtx);
@@ -1291,6 +1322,7 @@ bool DocumentBroker::doDownloadDocument(const Authorization& auth,
 
     getFileCallDurationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - start);
+    _loadProfile.setDuration(LoadProfile::Phase::Download, getFileCallDurationMs);
 
     _docState.setStatus(DocumentState::Status::Loading); // Done downloading.
 
@@ -1328,6 +1360,7 @@ bool DocumentBroker::doDownloadDocument(const Authorization& auth,
     }
 
     _filename = filename;
+    _loadProfile.setDocument(filename, FileUtil::Stat(localFilePath).size());
     if constexpr (!Util::isMobileApp())
     {
         _quarantine = std::make_unique<Quarantine>(*this, _filename);
@@ -2933,6 +2966,23 @@ void DocumentBroker::handleUploadToStorageSuccessful(const StorageBase::UploadRe
 
     if (!_uploadRequest->isSaveAs() && !_uploadRequest->isRename())
     {
+        // The end-to-end latency of the save, when this upload is of its result:
+        // from asking Core to save, to having it in the storage, including retries.
+        const auto lastSaveRequestTime = _saveManager.lastSaveRequestTime();
+        if (_saveManager.version() > 0 && lastSaveRequestTime < _saveManager.lastSaveResponseTime() &&
+            _saveManager.lastSaveResponseTime() <= _storageManager.lastUploadRequestTime())
+        {
+            const auto saveUploadDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - lastSaveRequestTime);
+            LOG_DBG("Saved in " << _saveManager.lastSaveDuration() << " and uploaded in "
+                                << _storageManager.lastUploadDuration() << ", "
+                                << saveUploadDuration << " from the save request to stored");
+#if !MOBILEAPP
+            _admin.setDocSaveUploadDuration(_docKey, _saveManager.lastSaveDuration(),
+                                            saveUploadDuration);
+#endif
+        }
+
         // Saved and stored; update flags.
         _saveManager.setLastModifiedLocalTime(_uploadRequest->newFileModifiedLocalTime());
 
@@ -3314,6 +3364,7 @@ void DocumentBroker::setLoaded()
             std::max(std::chrono::seconds(minTimeoutSecs), std::chrono::seconds(5)));
         LOG_INF("Document [" << _docKey << "] loaded in " << _loadDuration
                              << ", saving-timeout set to " << _saveManager.getSavingTimeout());
+        markLoadProfilePhase(LoadProfile::Phase::Loaded);
         LOG_DBG("Document [" << _docKey
                              << "] PSS: " << Util::getMemoryUsagePSS(_childProcess->getPid())
                              << " KB, total PSS: " << Util::getProcessTreePss(Util::getProcessId())
@@ -3327,6 +3378,28 @@ void DocumentBroker::setLoaded()
     }
 }
 
+void DocumentBroker::markLoadProfilePhase(LoadProfile::Phase phase)
+{
+    if (_loadProfile.isReported() || _loadProfile.has(phase))
+        return;
+
+    _loadProfile.markReached(phase);
+    if (_loadProfile.isComplete())
+        reportLoadProfile();
+}
+
+void DocumentBroker::reportLoadProfile()
+{
+    if (_loadProfile.isReported())
+        return;
+
+    _loadProfile.setReported();
+    LOG_INF("Load profile of [" << _docKey << "]: " << _loadProfile.toJson());
+#if !MOBILEAPP
+    _admin.addLoadProfile(_loadProfile);
+#endif
+}
+
 void DocumentBroker::setInteractive(bool value)
 {
     if (isInteractive() != value)
@@ -3341,6 +3414,40 @@ void DocumentBroker::onViewLoaded(const std::shared_ptr<ClientSession>& session)
     // Only lock the document on storage for editing sessions.
     lockIfEditing(session);
 
+#if !MOBILEAPP
+    if (_hibernation == Hibernation::Waking)
+    {
+        // Set the view up as the client last had it, then forward what it sent meanwhile.
+        for (const std::string& input : session->getViewSetupInput())
+            forwardToChild(session, input);
+
+        const auto it = _hibernatedInput.find(session->getId());
+        if (it != _hibernatedInput.end())
+        {
+            const std::vector<std::pair<std::string, bool>> input = std::move(it->second);
+            _hibernatedInput.erase(it);
+            for (const auto& [message, binary] : input)
+                forwardToChild(session, message, binary);
+        }
+
+        if (std::all_of(_sessions.begin(), _sessions.end(),
+                        [](const auto& pair) { return pair.second->isViewLoaded(); }))
+        {
+            LOG_INF("Document [" << _docKey << "] woke up with " << _sessions.size()
+                                 << " sessions");
+            _hibernation = Hibernation::None;
+            _hibernatedInput.clear();
+
+            // Drop the tiles requested while waking up, and have them all requested again.
+            clearCaches();
+            broadcastMessage("invalidatetiles: EMPTY");
+
+            if (_unitWsd)
+                _unitWsd->onDocBrokerWokeUp(_docKey);
+        }
+    }
+#endif
+
     // A view loaded.
     if (UnitWSD::isUnitTesting())
     {
@@ -3837,6 +3944,12 @@ std::size_t DocumentBroker::addSession(const std::shared_ptr<ClientSession>& ses
 
     try
     {
+#if !MOBILEAPP
+        // The new view needs the document loaded in a Kit.
+        if (_hibernation == Hibernation::Dormant && !wakeUp())
+            throw std::runtime_error("Failed to wake up hibernated document [" + _docKey + ']');
+#endif
+
         // First, download the document, since this can fail.
         if (!download(session, _childProcess->getJailId(), session->getPublicUri(),
                       session->getTemplateOptionPublicUri(),
@@ -4337,7 +4450,9 @@ void DocumentBroker::uploadPresetsToWopiHost()
         LOG_TRC("Uploading file from jailPath[" << filePath << "] to wopiHost["
                                                 << uriObject.toString() << ']');
 
-        httpRequest.setBodyFile(fileJailPath);
+        if (!httpRequest.setBodyFile(fileJailPath))
+            continue;
+
         httpRequest.set("Content-Type", "application/octet-stream");
 
         auto httpSession = StorageConnectionManager::getHttpSession(uriObject);
@@ -4379,24 +4494,75 @@ void DocumentBroker::unregisterDownloadId(const std::string& downloadId)
         _registeredDownloadLinks.erase(found);
 }
 
+namespace
+{
+/// The messages that the kit sends to the DocumentBroker, as their first token.
+enum class KitCommand : std::uint8_t
+{
+    Unknown,
+    CallbackDelays,
+    ErrorToAll,
+    FirstTile,
+    ForcedTraceEvent,
+    LoadPhase,
+    MemSharing,
+    MemoryTrimmed,
+    RegisterDownload,
+    SlideLayer,
+    SlideRenderingComplete,
+    Tile,
+    TileBinary,
+    TileCombine,
+    TraceEvent,
+    Trimmed,
+    UnitResult,
+};
+
+KitCommand getKitCommand(const std::string_view token)
+{
+    static constexpr auto Commands = makeCommandTable<KitCommand>({
+        { TileCombined::BinaryToken, KitCommand::TileBinary },
+        { "tile:", KitCommand::Tile },
+        { "tilecombine:", KitCommand::TileCombine },
+        { "errortoall:", KitCommand::ErrorToAll },
+        { "registerdownload:", KitCommand::RegisterDownload },
+        { "traceevent:", KitCommand::TraceEvent },
+        { "forcedtraceevent:", KitCommand::ForcedTraceEvent },
+        { "memorytrimmed:", KitCommand::MemoryTrimmed },
+        { "memsharing:", KitCommand::MemSharing },
+        { "firsttile:", KitCommand::FirstTile },
+        { "loadphase:", KitCommand::LoadPhase },
+        { "trimmed:", KitCommand::Trimmed },
+        { "callbackdelays:", KitCommand::CallbackDelays },
+        { "unitresult:", KitCommand::UnitResult },
+        { "slidelayer:", KitCommand::SlideLayer },
+        { "sliderenderingcomplete:", KitCommand::SlideRenderingComplete },
+    });
+    static_assert(!Commands.hasDuplicates(), "Each kit command must have a single name");
+
+    return Commands.find(token, KitCommand::Unknown);
+}
+} // namespace
+
 /// Handles input from the prisoner / child kit process
 bool DocumentBroker::handleInput(const std::shared_ptr<Message>& message)
 {
     LOG_TRC("DocumentBroker handling child message: [" << message->abbr() << ']');
 
+    // The binary tile headers are traced in their text form, once parsed.
     if constexpr (!Util::isMobileApp())
     {
-        if (LOOLWSD::TraceDumper)
+        if (LOOLWSD::TraceDumper && !message->firstTokenMatches(TileCombined::BinaryToken))
             LOOLWSD::dumpOutgoingTrace(getJailId(), "0", message->abbr());
     }
 
     if (_unitWsd && _unitWsd->filterLOKitMessage(message))
         return true;
 
+    const KitCommand command = getKitCommand(message->tokens().getView(0));
     if (LOOLProtocol::getFirstToken(message->forwardToken(), '-') == "client")
     {
-        if (message->firstTokenMatches("slidelayer:") ||
-            message->firstTokenMatches("sliderenderingcomplete:"))
+        if (command == KitCommand::SlideLayer || command == KitCommand::SlideRenderingComplete)
         {
             handleSlideLayerResponse(message);
         }
@@ -4405,93 +4571,183 @@ bool DocumentBroker::handleInput(const std::shared_ptr<Message>& message)
     }
     else
     {
-        if (message->firstTokenMatches("tile:"))
+        switch (command)
         {
-            handleTileResponse(message);
-        }
-        else if (message->firstTokenMatches("tilecombine:"))
-        {
-            handleTileCombinedResponse(message);
-        }
-        else if (message->firstTokenMatches("errortoall:"))
-        {
-            LOG_CHECK_RET(message->tokens().size() == 3, false);
-            std::string cmd, kind;
-            LOOLProtocol::getTokenString((*message)[1], "cmd", cmd);
-            LOG_CHECK_RET(cmd != "", false);
-            LOOLProtocol::getTokenString((*message)[2], "kind", kind);
-            LOG_CHECK_RET(kind != "", false);
-            Util::alertAllUsers(cmd, kind);
-        }
-        else if (message->firstTokenMatches("registerdownload:"))
-        {
-            LOG_CHECK_RET(message->tokens().size() == 4, false);
-            std::string downloadid, url, clientId;
-            LOOLProtocol::getTokenString((*message)[1], "downloadid", downloadid);
-            LOG_CHECK_RET(downloadid != "", false);
-            LOOLProtocol::getTokenString((*message)[2], "url", url);
-            LOG_CHECK_RET(url != "", false);
-            LOOLProtocol::getTokenString((*message)[3], "clientid", clientId);
-            LOG_CHECK_RET(!clientId.empty(), false);
-
-            const std::string decoded = Uri::decode(url);
-            const std::string filePath(FileUtil::buildLocalPathToJail(LOOLWSD::EnableMountNamespaces,
-                                                                      LOOLWSD::ChildRoot + getJailId(),
-                                                                      JAILED_DOCUMENT_ROOT + decoded));
-
-            std::ifstream ifs(filePath);
-            const std::string svg((std::istreambuf_iterator<char>(ifs)),
-                                (std::istreambuf_iterator<char>()));
-            ifs.close();
-
-            if (svg.empty())
-                LOG_WRN("Empty download: [id: " << downloadid << ", url: " << url << ']');
+            case KitCommand::TileBinary:
+            {
+                handleTileBinaryResponse(message);
+                break;
+            }
+            case KitCommand::Tile:
+            {
+                handleTileResponse(message);
+                break;
+            }
+            case KitCommand::TileCombine:
+            {
+                handleTileCombinedResponse(message);
+                break;
+            }
+            case KitCommand::ErrorToAll:
+            {
+                LOG_CHECK_RET(message->tokens().size() == 3, false);
+                std::string cmd, kind;
+                LOOLProtocol::getTokenString((*message)[1], "cmd", cmd);
+                LOG_CHECK_RET(cmd != "", false);
+                LOOLProtocol::getTokenString((*message)[2], "kind", kind);
+                LOG_CHECK_RET(kind != "", false);
+                Util::alertAllUsers(cmd, kind);
+                break;
+            }
+            case KitCommand::RegisterDownload:
+            {
+                LOG_CHECK_RET(message->tokens().size() == 4, false);
+                std::string downloadid, url, clientId;
+                LOOLProtocol::getTokenString((*message)[1], "downloadid", downloadid);
+                LOG_CHECK_RET(downloadid != "", false);
+                LOOLProtocol::getTokenString((*message)[2], "url", url);
+                LOG_CHECK_RET(url != "", false);
+                LOOLProtocol::getTokenString((*message)[3], "clientid", clientId);
+                LOG_CHECK_RET(!clientId.empty(), false);
+
+                const std::string decoded = Uri::decode(url);
+                const std::string filePath(FileUtil::buildLocalPathToJail(LOOLWSD::EnableMountNamespaces,
+                                                                          LOOLWSD::ChildRoot + getJailId(),
+                                                                          JAILED_DOCUMENT_ROOT + decoded));
+
+                std::ifstream ifs(filePath);
+                const std::string svg((std::istreambuf_iterator<char>(ifs)),
+                                    (std::istreambuf_iterator<char>()));
+                ifs.close();
+
+                if (svg.empty())
+                    LOG_WRN("Empty download: [id: " << downloadid << ", url: " << url << ']');
+
+                const auto it = _sessions.find(clientId);
+                if (it != _sessions.end())
+                {
+                    std::ofstream ofs(filePath);
+                    ofs << it->second->processSVGContent(svg);
+                }
 
-            const auto it = _sessions.find(clientId);
-            if (it != _sessions.end())
+                _registeredDownloadLinks[downloadid] = std::move(url);
+                break;
+            }
+            case KitCommand::TraceEvent:
+            {
+                LOG_CHECK_RET(message->tokens().size() == 1, false);
+                if (LOOLWSD::TraceEventFile != NULL && TraceEvent::isRecordingOn())
+                {
+                    const auto& firstLine = message->firstLine();
+                    if (firstLine.size() < message->size())
+                        LOOLWSD::writeTraceEventRecording(message->data().data() + firstLine.size() + 1,
+                                                          message->size() - firstLine.size() - 1);
+                }
+                break;
+            }
+            case KitCommand::ForcedTraceEvent:
+            {
+                LOG_CHECK_RET(message->tokens().size() == 1, false);
+                if (LOOLWSD::TraceEventFile != NULL)
+                {
+                    const auto& firstLine = message->firstLine();
+                    if (firstLine.size() < message->size())
+                        LOOLWSD::writeTraceEventRecording(message->data().data() + firstLine.size() + 1,
+                                                          message->size() - firstLine.size() - 1);
+                }
+                break;
+            }
+            case KitCommand::MemoryTrimmed:
             {
-                std::ofstream ofs(filePath);
-                ofs << it->second->processSVGContent(svg);
+                clearCaches();
+                break;
             }
+            case KitCommand::MemSharing:
+            {
+                int sharedKb = 0;
+                int unsharedKb = 0;
+                std::string top;
+                if (LOOLProtocol::getTokenInteger(message->tokens(), "shared", sharedKb) &&
+                    LOOLProtocol::getTokenInteger(message->tokens(), "unshared", unsharedKb))
+                {
+                    // top=<mapping>:<kb>,<mapping>:<kb>,...
+                    std::map<std::string, size_t> unsharedKbByMapping;
+                    LOOLProtocol::getTokenString(message->tokens(), "top", top);
+                    const StringVector entries = StringVector::tokenize(top, ',');
+                    for (std::size_t i = 0; i < entries.size(); ++i)
+                    {
+                        const std::string entry = entries[i];
+                        const size_t colon = entry.rfind(':');
+                        if (colon != std::string::npos && colon > 0)
+                            unsharedKbByMapping[entry.substr(0, colon)] =
+                                std::strtoul(entry.c_str() + colon + 1, nullptr, 10);
+                    }
 
-            _registeredDownloadLinks[downloadid] = std::move(url);
-        }
-        else if (message->firstTokenMatches("traceevent:"))
-        {
-            LOG_CHECK_RET(message->tokens().size() == 1, false);
-            if (LOOLWSD::TraceEventFile != NULL && TraceEvent::isRecordingOn())
+                    _admin.setDocMemorySharing(_docKey, sharedKb, unsharedKb,
+                                               std::move(unsharedKbByMapping));
+                }
+                break;
+            }
+            case KitCommand::FirstTile:
             {
-                const auto& firstLine = message->firstLine();
-                if (firstLine.size() < message->size())
-                    LOOLWSD::writeTraceEventRecording(message->data().data() + firstLine.size() + 1,
-                                                      message->size() - firstLine.size() - 1);
+                std::string type;
+                int duration = 0;
+                if (LOOLProtocol::getTokenString(message->tokens(), "type", type) &&
+                    LOOLProtocol::getTokenInteger(message->tokens(), "duration", duration))
+                {
+                    _admin.addFirstTileDuration(type, std::chrono::milliseconds(duration));
+                }
+                break;
             }
-        }
-        else if (message->firstTokenMatches("forcedtraceevent:"))
-        {
-            LOG_CHECK_RET(message->tokens().size() == 1, false);
-            if (LOOLWSD::TraceEventFile != NULL)
+            case KitCommand::LoadPhase:
             {
-                const auto& firstLine = message->firstLine();
-                if (firstLine.size() < message->size())
-                    LOOLWSD::writeTraceEventRecording(message->data().data() + firstLine.size() + 1,
-                                                      message->size() - firstLine.size() - 1);
+                std::string name;
+                int duration = 0;
+                if (LOOLProtocol::getTokenString(message->tokens(), "name", name) &&
+                    LOOLProtocol::getTokenInteger(message->tokens(), "duration", duration) &&
+                    name == LoadProfile::name(LoadProfile::Phase::DocumentLoad))
+                {
+                    _loadProfile.setDuration(LoadProfile::Phase::DocumentLoad,
+                                             std::chrono::milliseconds(duration));
+                }
+                break;
+            }
+            case KitCommand::Trimmed:
+            {
+                std::string stage;
+                std::string released;
+                if (LOOLProtocol::getTokenString(message->tokens(), "stage", stage) &&
+                    LOOLProtocol::getTokenString(message->tokens(), "released", released))
+                {
+                    _admin.addTrimStage(stage, Util::u64FromString(released, 0).first);
+                }
+                break;
+            }
+            case KitCommand::CallbackDelays:
+            {
+                std::string type;
+                std::string serialized;
+                DelayHistogram histogram;
+                if (LOOLProtocol::getTokenString(message->tokens(), "type", type) &&
+                    LOOLProtocol::getTokenString(message->tokens(), "histogram", serialized) &&
+                    histogram.deserialize(serialized))
+                {
+                    _admin.addCallbackDelays(type, histogram);
+                }
+                break;
             }
-        }
-        else if (message->firstTokenMatches("memorytrimmed:"))
-        {
-            clearCaches();
-        }
 #if ENABLE_DEBUG
-        else if (message->firstTokenMatches("unitresult:"))
-        {
-            UnitWSD::get().processUnitResult(message->tokens());
-        }
+            case KitCommand::UnitResult:
+            {
+                UnitWSD::get().processUnitResult(message->tokens());
+                break;
+            }
 #endif
-        else
-        {
-            LOG_ERR("Unexpected message: [" << message->abbr() << ']');
-            return false;
+            default:
+            {
+                LOG_ERR("Unexpected message: [" << message->abbr() << ']');
+                return false;
+            }
         }
     }
 
@@ -4543,6 +4799,16 @@ void DocumentBroker::handleTileRequest(const StringVector &tokens, bool forceKey
     if (!cachedTile || cachedTile->tooLarge())
         tile.forceKeyframe();
 
+#if !MOBILEAPP
+    if (isHibernated())
+    {
+        // Everything is requested again once woken up.
+        if (_hibernation == Hibernation::Dormant)
+            wakeUp();
+        return;
+    }
+#endif
+
     auto now = std::chrono::steady_clock::now();
     tileCache().subscribeToTileRendering(tile, session, now);
 
@@ -4558,6 +4824,16 @@ void DocumentBroker::sendTileCombine(const TileCombined& newTileCombined)
 {
     assert(!newTileCombined.hasDuplicates());
 
+#if !MOBILEAPP
+    if (isHibernated())
+    {
+        // Everything is requested again once woken up.
+        if (_hibernation == Hibernation::Dormant)
+            wakeUp();
+        return;
+    }
+#endif
+
     // Forward to child to render.
     const std::string req = newTileCombined.serialize("tilecombine");
     LOG_TRC("Some of the tiles were not prerendered. Sending residual tilecombine: " << req);
@@ -4687,15 +4963,13 @@ void DocumentBroker::handleGetSlideRequest(const StringVector& tokens,
 
 void DocumentBroker::handleSlideLayerResponse(const std::shared_ptr<Message>& message)
 {
-    size_t pos = Util::findInVector(message->data(), "\n");
-    std::string msg(message->data().data(), pos == std::string::npos ? message->size() : pos);
-    Poco::JSON::Object::Ptr jsonPtr;
-    if (!JsonUtil::parseJSON(msg, jsonPtr))
+    const std::string& msg = message->firstLine();
+    std::string key;
+    if (!JsonScanner::getString(msg, "cacheKey", key))
     {
-        LOG_ERR("Invalid slide layer response, could not parse JSON: " << msg);
+        LOG_ERR("Invalid slide layer response, no cacheKey in JSON: " << msg);
         return;
     }
-    const std::string key = JsonUtil::getJSONValue<std::string>(jsonPtr, "cacheKey");
 
     // This message has forwardToken which can cause issue if reused for forwardToClient when using cache.
     // But we ignore it because when reusing cache we only send data from the message and not entire message
@@ -4972,6 +5246,7 @@ void DocumentBroker::handleTileResponse(const std::shared_ptr<Message>& message)
             const std::size_t offset = firstLine.size() + 1;
 
             tileCache().saveTileAndNotify(tile, buffer + offset, length - offset);
+            markLoadProfilePhase(LoadProfile::Phase::FirstTile);
         }
         else
         {
@@ -5006,6 +5281,8 @@ void DocumentBroker::handleTileCombinedResponse(const std::shared_ptr<Message>&
                 tileCache().saveTileAndNotify(tile, buffer + offset, tile.getImgSize());
                 offset += tile.getImgSize();
             }
+
+            markLoadProfilePhase(LoadProfile::Phase::FirstTile);
         }
         else
         {
@@ -5019,6 +5296,54 @@ void DocumentBroker::handleTileCombinedResponse(const std::shared_ptr<Message>&
     }
 }
 
+void DocumentBroker::handleTileBinaryResponse(const std::shared_ptr<Message>& message)
+{
+    ASSERT_CORRECT_THREAD();
+
+    try
+    {
+        const char* buffer = message->data().data();
+        const std::size_t length = message->size();
+        std::size_t offset = 0;
+        const TileCombined tileCombined = TileCombined::parseBinary(buffer, length, offset);
+
+        if (Log::isEnabled(Log::Level::DBG) || LOOLWSD::TraceDumper)
+        {
+            const std::string header = tileCombined.serialize("tilecombine:");
+            LOG_DBG("Handling binary tile header: " << header);
+            if constexpr (!Util::isMobileApp())
+            {
+                if (LOOLWSD::TraceDumper)
+                    LOOLWSD::dumpOutgoingTrace(getJailId(), "0", header);
+            }
+        }
+
+        std::size_t imagesSize = 0;
+        for (const auto& tile : tileCombined.getTiles())
+            imagesSize += tile.getImgSize();
+
+        if (imagesSize != length - offset)
+        {
+            LOG_ERR("Dropping binary tile response with " << length - offset
+                                                          << " bytes of images instead of "
+                                                          << imagesSize);
+            return;
+        }
+
+        for (const auto& tile : tileCombined.getTiles())
+        {
+            tileCache().saveTileAndNotify(tile, buffer + offset, tile.getImgSize());
+            offset += tile.getImgSize();
+        }
+
+        markLoadProfilePhase(LoadProfile::Phase::FirstTile);
+    }
+    catch (const std::exception& exc)
+    {
+        LOG_ERR("Failed to process binary tile response: " << exc.what() << '.');
+    }
+}
+
 bool DocumentBroker::haveAnotherEditableSession(const std::string& id) const
 {
     ASSERT_CORRECT_THREAD();
@@ -5191,6 +5516,25 @@ bool DocumentBroker::forwardToChild(const std::shared_ptr<ClientSession>& sessio
         return true;
     }
 
+#if !MOBILEAPP
+    // Hold the input of views that are hibernated, or reloading, until they are loaded.
+    if (_hibernation == Hibernation::Dormant ||
+        (_hibernation == Hibernation::Waking && !session->isViewLoaded() &&
+         !message.starts_with("load ") && message != "disconnect"))
+    {
+        if (message != "userinactive")
+        {
+            LOG_TRC("Holding input of hibernated view [" << session->getId()
+                                                         << "]: " << getAbbreviatedMessage(message));
+            _hibernatedInput[session->getId()].emplace_back(message, binary);
+            if (_hibernation == Hibernation::Dormant)
+                return wakeUp();
+        }
+
+        return true;
+    }
+#endif
+
     // Ignore textinput, mouse and key message when document is unloading
     if (isUnloading() && (message.starts_with("textinput ") || message.starts_with("mouse ") ||
                           message.starts_with("key ")))
@@ -5375,6 +5719,168 @@ void DocumentBroker::closeDocument(const std::string& reason)
     }
 }
 
+#if !MOBILEAPP
+
+/// Moves the directory @from to @to, creating the parents of the latter.
+static bool moveDirectory(const std::string& from, const std::string& to)
+{
+    try
+    {
+        Poco::File(Poco::Path(to).parent()).createDirectories();
+    }
+    catch (const Poco::Exception& exc)
+    {
+        LOG_ERR("Failed to create the parent directory of [" << to << "]: " << exc.displayText());
+        return false;
+    }
+
+    if (::rename(from.c_str(), to.c_str()) < 0)
+    {
+        LOG_SYS("Failed to move [" << from << "] to [" << to << ']');
+        return false;
+    }
+
+    return true;
+}
+
+bool DocumentBroker::hibernate(const bool saveFirst)
+{
+    ASSERT_CORRECT_THREAD();
+
+    if (tryHibernate(saveFirst))
+        return true;
+
+    // Have Admin ask again later, unless we try again ourselves once saved.
+    if (!_hibernateAfterSave)
+        _admin.hibernateDeclined(_docKey);
+
+    return false;
+}
+
+bool DocumentBroker::tryHibernate(const bool saveFirst)
+{
+    if (_hibernation != Hibernation::None || !_childProcess || !_storage || !isLoaded() ||
+        isUnloading() || isInteractive() ||
+        _docState.activity() != DocumentState::Activity::None || _saveManager.isSaving() ||
+        isAsyncUploading() || !_templateOptionUriJailed.empty())
+    {
+        LOG_DBG("Document [" << _docKey << "] is busy and will not hibernate");
+        return false;
+    }
+
+    // The user's presets live in the Kit's profile, to upload them when unloading.
+    if (!_presetTimestamp.empty())
+    {
+        LOG_DBG("Document [" << _docKey << "] has user presets and will not hibernate");
+        return false;
+    }
+
+    if (_sessions.empty() ||
+        std::any_of(_sessions.begin(), _sessions.end(),
+                    [](const auto& pair) { return !pair.second->isViewLoaded(); }))
+    {
+        LOG_DBG("Document [" << _docKey << "] has views loading and will not hibernate");
+        return false;
+    }
+
+    if (needToSaveToDisk() != NeedToSave::No)
+    {
+        if (!saveFirst)
+        {
+            LOG_DBG("Document [" << _docKey << "] is not saved and will not hibernate");
+            return false;
+        }
+
+        // The poll thread tries again once saved and uploaded.
+        LOG_DBG("Saving document [" << _docKey << "] before hibernating");
+        _hibernateAfterSave = true;
+        autoSave(/*force=*/true, /*dontSaveIfUnmodified=*/true);
+        return false;
+    }
+
+    if (needToUploadToStorage() != NeedToUpload::No)
+    {
+        LOG_DBG("Document [" << _docKey << "] is not uploaded yet and will not hibernate");
+        return false;
+    }
+
+    // The Kit removes its jail when it exits; keep the document out of it.
+    const std::string docPath = Poco::Path(_storage->getRootFilePath()).parent().toString();
+    const std::string hibernatedPath = LOOLWSD::ChildRoot +
+                                       JailUtil::CHILDROOT_TMP_HIBERNATED_PATH + '/' +
+                                       Util::rng::getFilename(16);
+    if (!moveDirectory(docPath, hibernatedPath))
+        return false;
+
+    LOG_INF("Hibernating document [" << _docKey << "] with " << _sessions.size()
+                                     << " sessions, unloading it from Kit [" << getPid() << ']');
+
+    _hibernatedPath = hibernatedPath;
+    for (const auto& it : _sessions)
+        it.second->detachFromKit();
+
+    _childProcess->close();
+    _hibernation = Hibernation::Dormant;
+    _admin.setDocKit(_docKey, 0, std::weak_ptr<FILE>());
+
+    if (_unitWsd)
+        _unitWsd->onDocBrokerHibernated(_docKey);
+
+    return true;
+}
+
+bool DocumentBroker::wakeUp()
+{
+    ASSERT_CORRECT_THREAD();
+
+    assert(_hibernation == Hibernation::Dormant && "Expected a hibernated document");
+    LOG_INF("Waking up hibernated document [" << _docKey << ']');
+
+    std::shared_ptr<ChildProcess> child = getNewChild_Blocks(_poll, _configId, _mobileAppDocId);
+    if (!child)
+    {
+        LOG_ERR("Failed to get a new child to wake up document [" << _docKey << ']');
+        closeDocument("idle");
+        return false;
+    }
+
+    // Same paths, under the new jail.
+    _jailId = child->getJailId();
+    _storage->setLocalStorePath(getJailRoot());
+    if (!moveDirectory(_hibernatedPath,
+                       Poco::Path(_storage->getRootFilePath()).parent().toString()))
+    {
+        child->close();
+        closeDocument("idle");
+        return false;
+    }
+
+    _hibernatedPath.clear();
+    _childProcess = std::move(child);
+    _childProcess->setDocumentBroker(shared_from_this());
+    LOG_INF("Doc [" << _docKey << "] attached to child [" << _childProcess->getPid() << ']');
+
+    setupPriorities();
+
+    // The new Kit numbers its tiles anew, so what we have cached is no good.
+    clearCaches();
+
+    _admin.setDocKit(_docKey, getPid(), _childProcess->getSMapsFp());
+
+    _hibernation = Hibernation::Waking;
+    for (const auto& it : _sessions)
+    {
+        const std::shared_ptr<ClientSession>& session = it.second;
+        _childProcess->sendTextFrame("session " + session->getId() + ' ' + _docKey + ' ' +
+                                     _docId);
+        session->reloadView(shared_from_this());
+    }
+
+    return true;
+}
+
+#endif // !MOBILEAPP
+
 void DocumentBroker::disconnectedFromKit(bool unexpected)
 {
     ASSERT_CORRECT_THREAD();
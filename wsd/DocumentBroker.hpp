@@ -24,6 +24,7 @@
 #include <Poco/JSON/Object.h>
 
 #include "Authorization.hpp"
+#include "LoadProfile.hpp"
 #include "Log.hpp"
 #include "QuarantineUtil.hpp"
 #include "TileDesc.hpp"
@@ -302,6 +303,9 @@ public:
     /// Notify that the load has completed
     virtual void setLoaded();
 
+    /// Notes that a milestone of the load is reached, the first time only.
+    void markLoadProfilePhase(LoadProfile::Phase phase);
+
     /// Notify that the document has dialogs before load
     virtual void setInteractive(bool value);
 
@@ -489,6 +493,17 @@ public:
     /// Ask the document broker to close. Makes sure that the document is saved.
     void closeDocument(const std::string& reason);
 
+#if !MOBILEAPP
+    /// Unloads the document from its Kit, to free the memory, keeping the sessions
+    /// and the tiles. The next input reloads it in a new Kit. True iff dormant now.
+    /// A modified document is saved first, if @saveFirst, and tried again once uploaded;
+    /// otherwise Admin is told that we declined, to ask again later.
+    bool hibernate(bool saveFirst = true);
+#endif
+
+    /// True while hibernated, and until all the views are reloaded.
+    bool isHibernated() const { return _hibernation != Hibernation::None; }
+
     /// Flag that we have been disconnected from the Kit and request unloading.
     void disconnectedFromKit(bool unexpected);
 
@@ -657,6 +672,9 @@ private:
 
     void refreshLock();
 
+    /// Logs the load profile and adds it to the metrics, once.
+    void reportLoadProfile();
+
     /// Loads a document from the public URI into the jail.
     bool download(const std::shared_ptr<ClientSession>& session, const std::string& jailId,
                   const Poco::URI& uriPublic,
@@ -713,6 +731,8 @@ private:
     void handleTileResponse(const std::shared_ptr<Message>& message);
     void handleDialogPaintResponse(const std::vector<char>& payload, bool child);
     void handleTileCombinedResponse(const std::shared_ptr<Message>& message);
+    /// Handles the tiles rendered by the kit, with the binary form of the header.
+    void handleTileBinaryResponse(const std::shared_ptr<Message>& message);
     void handleSlideLayerResponse(const std::shared_ptr<Message>& message);
     void handleDialogRequest(const std::string& dialogCmd);
 
@@ -1397,6 +1417,12 @@ private:
         /// Marks the last upload request time as now.
         void markLastUploadRequestTime() { _request.markLastRequestTime(); }
 
+        /// Returns the last upload request time.
+        std::chrono::steady_clock::time_point lastUploadRequestTime() const
+        {
+            return _request.lastRequestTime();
+        }
+
         /// The duration elapsed since we sent the last upload request to storage.
         std::chrono::milliseconds timeSinceLastUploadRequest() const
         {
@@ -1847,6 +1873,8 @@ private:
     std::chrono::steady_clock::time_point _createTime;
     std::chrono::milliseconds _loadDuration;
     std::chrono::milliseconds _wopiDownloadDuration;
+    /// Where the time of loading went.
+    LoadProfile _loadProfile;
 
     /// Versioning is used to prevent races between
     /// painting and invalidation.
@@ -1893,6 +1921,32 @@ private:
 
     const bool _backgroundManualSave : 1;
 
+#if !MOBILEAPP
+    /// hibernate() without telling Admin when declined.
+    bool tryHibernate(bool saveFirst);
+
+    /// Reloads the hibernated document, and its views, in a new Kit.
+    /// Closes the document when that fails.
+    bool wakeUp();
+#endif
+
+    STATE_ENUM(
+        Hibernation,
+        None, ///< Loaded in our Kit, as usual.
+        Dormant, ///< No Kit; the files are kept in _hibernatedPath.
+        Waking, ///< Reloading in a new Kit.
+    );
+    Hibernation _hibernation;
+
+    /// Saving to hibernate; try again once saved and uploaded.
+    bool _hibernateAfterSave;
+
+    /// Where the files of the document are kept while hibernated, outside any jail.
+    std::string _hibernatedPath;
+
+    /// The input of each session while hibernated, to forward once its view is reloaded.
+    std::map<std::string, std::vector<std::pair<std::string, bool>>> _hibernatedInput;
+
     /// Unique DocBroker ID for tracing and debugging.
     static std::atomic<unsigned> DocBrokerId;
 };
@@ -18,6 +18,7 @@
 #include "HttpRequest.hpp"
 #include "RequestDetails.hpp"
 #include "ServerURL.hpp"
+#include "SpookyV2.h"
 #include <Common.hpp>
 #include <Crypto.hpp>
 #include <Log.hpp>
@@ -60,6 +61,7 @@
 
 
 
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
 #include <string>
@@ -69,6 +71,11 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <zlib.h>
+#include <zstd.h>
+#if HAVE_BROTLI
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
 #include <security/pam_appl.h>
 
 #include <openssl/evp.h>
@@ -78,9 +85,6 @@ using Poco::Net::HTTPRequest;
 using Poco::Net::NameValueCollection;
 using Poco::Util::Application;
 
-// We have files that are at least 2.5 MB already.
-// WASM files are in the order of 30 MB, however,
-constexpr auto MaxFileSizeToCacheInBytes = 50 * 1024 * 1024;
 constexpr std::string_view MetaViewPort = "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1, minimum-scale=1\">";
 
 namespace
@@ -215,27 +219,253 @@ std::string stringifyBoolFromConfig(const Poco::Util::LayeredConfiguration& conf
     return config.getBool(propertyName, defaultValue) ? "true" : "false";
 }
 
+// Static files are compressed once, in the background, so we can afford the highest levels.
+constexpr int GzipLevel = Z_BEST_COMPRESSION;
+constexpr int ZstdLevel = 19;
+#if HAVE_BROTLI
+constexpr int BrotliQuality = BROTLI_MAX_QUALITY;
+#endif
+
+/// Files smaller than this fit in a packet or two anyway, so aren't worth compressing.
+constexpr std::size_t MinCompressionSize = 1024;
+
+/// Compressed variants that don't save at least this fraction, of the original
+/// and of any smaller variant we already have, are not worth keeping in memory.
+constexpr double MinCompressionSaving = 0.1;
+
+/// Gzip the given data. Returns an empty string on failure.
+std::string gzipData(const std::string& name, const std::string_view data)
+{
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    const int initResult = deflateInit2(&strm, GzipLevel, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY);
+    if (initResult != Z_OK)
+    {
+        LOG_ERR("Failed to deflateInit2 for file [" << name << "], result: " << initResult);
+        deflateEnd(&strm);
+        return std::string();
+    }
+
+    std::string compressedFile;
+    const long unsigned int compSize = compressBound(data.size());
+    compressedFile.resize(compSize);
+    strm.next_in = (unsigned char*)data.data();
+    strm.avail_in = data.size();
+    strm.avail_out = compSize;
+    strm.next_out = (unsigned char*)compressedFile.data();
+    strm.total_out = strm.total_in = 0;
+
+    const int deflateResult = deflate(&strm, Z_FINISH);
+    deflateEnd(&strm);
+    if (deflateResult != Z_OK && deflateResult != Z_STREAM_END)
+    {
+        LOG_ERR("Failed to deflate [" << name << "], result: " << deflateResult);
+        return std::string(); // Can't trust the compressed data, if any.
+    }
+
+    compressedFile.resize(compSize - strm.avail_out);
+    return compressedFile;
+}
+
+/// Zstd-compress the given data. Returns an empty string on failure.
+std::string zstdData(const std::string& name, const std::string_view data)
+{
+    std::string compressedFile;
+    compressedFile.resize(ZSTD_compressBound(data.size()));
+    const std::size_t compSize = ZSTD_compress(compressedFile.data(), compressedFile.size(),
+                                               data.data(), data.size(), ZstdLevel);
+    if (ZSTD_isError(compSize))
+    {
+        LOG_ERR("Failed to zstd-compress [" << name << "]: " << ZSTD_getErrorName(compSize));
+        return std::string();
+    }
+
+    compressedFile.resize(compSize);
+    return compressedFile;
+}
+
+/// Brotli-compress the given data. Returns an empty string on failure or when unsupported.
+std::string brotliData([[maybe_unused]] const std::string& name,
+                       [[maybe_unused]] const std::string_view data)
+{
+#if HAVE_BROTLI
+    std::string compressedFile;
+    std::size_t compSize = BrotliEncoderMaxCompressedSize(data.size());
+    compressedFile.resize(compSize);
+    if (compSize == 0 ||
+        !BrotliEncoderCompress(BrotliQuality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC,
+                               data.size(), reinterpret_cast<const uint8_t*>(data.data()),
+                               &compSize, reinterpret_cast<uint8_t*>(compressedFile.data())))
+    {
+        LOG_ERR("Failed to brotli-compress [" << name << ']');
+        return std::string();
+    }
+
+    compressedFile.resize(compSize);
+    return compressedFile;
+#else
+    return std::string();
+#endif
+}
+
+/// Decompress brotli data. Returns an empty string on failure or when unsupported.
+std::string unbrotliData([[maybe_unused]] const std::string& name,
+                         [[maybe_unused]] const std::string_view data)
+{
+#if HAVE_BROTLI
+    BrotliDecoderState* state = BrotliDecoderCreateInstance(nullptr, nullptr, nullptr);
+    if (!state)
+    {
+        LOG_ERR("Failed to create brotli decoder for [" << name << ']');
+        return std::string();
+    }
+
+    std::string decompressed;
+    std::size_t availableIn = data.size();
+    const uint8_t* nextIn = reinterpret_cast<const uint8_t*>(data.data());
+    BrotliDecoderResult result = BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
+    while (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT)
+    {
+        const std::size_t offset = decompressed.size();
+        decompressed.resize(std::max<std::size_t>(offset * 2, data.size() * 4));
+        std::size_t availableOut = decompressed.size() - offset;
+        uint8_t* nextOut = reinterpret_cast<uint8_t*>(decompressed.data() + offset);
+        result = BrotliDecoderDecompressStream(state, &availableIn, &nextIn, &availableOut,
+                                               &nextOut, nullptr);
+        decompressed.resize(decompressed.size() - availableOut);
+    }
+
+    BrotliDecoderDestroyInstance(state);
+    if (result != BROTLI_DECODER_RESULT_SUCCESS)
+    {
+        LOG_ERR("Failed to decompress brotli file [" << name << ']');
+        return std::string();
+    }
+
+    return decompressed;
+#else
+    return std::string();
+#endif
+}
+
 } // namespace
 
 FileServerRequestHandler::FileServerRequestHandler(const std::string& root)
+    : _stopCompression(false)
 {
-    // Read all files that we can serve into memory and compress them.
+    // Map all files that we can serve into memory.
     // lool files
     try
     {
         readDirToHash(root, "/browser/dist");
-
-        // Shrink this from approx 200M to 50M for debug version
-        for (auto& entry : FileHash)
-        {
-            entry.second.first.shrink_to_fit();
-            entry.second.second.shrink_to_fit();
-        }
     }
     catch (...)
     {
         LOG_ERR("Failed to read from directory " << root);
     }
+
+    // Files only shipped pre-compressed are decompressed on the first request
+    // that can't take brotli, if ever; see getDecompressedVariant().
+
+    // Compress them in the background; until done, we serve what we have.
+    _compressionThread = std::thread(&FileServerRequestHandler::compressFiles, this);
+}
+
+void FileServerRequestHandler::compressFiles()
+{
+    Util::setThreadName("file_compress");
+
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t uncompressedTotal = 0;
+    std::array<std::size_t, NumContentEncodings> compressedTotals{};
+
+    // Hash everything first, which is cheap, so per-file ETags are available early.
+    for (auto& entry : FileHash)
+    {
+        if (_stopCompression)
+            return;
+
+        // Files only shipped pre-compressed are identified by their brotli bytes.
+        std::shared_ptr<const FileUtil::MappedFile> content =
+            getVariant(entry.first, ContentEncoding::Identity);
+        if (!content)
+            content = getVariant(entry.first, ContentEncoding::Brotli);
+
+        std::string hash =
+            Util::encodeId(SpookyHash::Hash64(content->data(), content->size(), 0), 16);
+
+        std::lock_guard<std::mutex> lock(_variantsMutex);
+        entry.second._hash = std::move(hash);
+    }
+
+    for (const auto& entry : FileHash)
+    {
+        const std::string& path = entry.first;
+        const std::shared_ptr<const FileUtil::MappedFile> uncompressed =
+            getVariant(path, ContentEncoding::Identity);
+        if (!uncompressed || uncompressed->size() < MinCompressionSize)
+            continue; // Too small, or only shipped pre-compressed.
+
+        uncompressedTotal += uncompressed->size();
+        std::size_t smallestSize = uncompressed->size();
+        for (const ContentEncoding encoding :
+             { ContentEncoding::Gzip, ContentEncoding::Zstd, ContentEncoding::Brotli })
+        {
+            if (_stopCompression)
+            {
+                LOG_DBG("Stopping static file compression");
+                return;
+            }
+
+            // Pre-compressed files from disk take precedence.
+            if (const auto existing = getVariant(path, encoding))
+            {
+                smallestSize = std::min(smallestSize, existing->size());
+                continue;
+            }
+
+            std::string compressed;
+            switch (encoding)
+            {
+                case ContentEncoding::Gzip:
+                    compressed = gzipData(path, uncompressed->view());
+                    break;
+                case ContentEncoding::Zstd:
+                    compressed = zstdData(path, uncompressed->view());
+                    break;
+                case ContentEncoding::Brotli:
+                    compressed = brotliData(path, uncompressed->view());
+                    break;
+                case ContentEncoding::Identity:
+                    break;
+            }
+
+            // Not worth it, e.g. images, or barely better than gzip, which every
+            // client that takes the others takes as well.
+            if (compressed.empty() || compressed.size() > smallestSize * (1 - MinCompressionSaving))
+                continue;
+
+            smallestSize = compressed.size();
+
+            auto variant = FileUtil::MappedFile::create(std::move(compressed));
+            compressedTotals[static_cast<std::size_t>(encoding)] += variant->size();
+
+            std::lock_guard<std::mutex> lock(_variantsMutex);
+            FileHash.at(path)._variants[static_cast<std::size_t>(encoding)] = std::move(variant);
+        }
+    }
+
+    LOG_INF("Compressed " << FileHash.size() << " static files (" << uncompressedTotal
+                          << " bytes) in " << std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                  std::chrono::steady_clock::now() - start)
+                          << " to " << compressedTotals[static_cast<std::size_t>(ContentEncoding::Gzip)]
+                          << " bytes gzip, "
+                          << compressedTotals[static_cast<std::size_t>(ContentEncoding::Zstd)]
+                          << " bytes zstd, and "
+                          << compressedTotals[static_cast<std::size_t>(ContentEncoding::Brotli)]
+                          << " bytes brotli");
 }
 
 //static
@@ -244,18 +474,31 @@ void FileServerRequestHandler::dumpState(std::ostream& os)
     os << "FileHash with " << FileHash.size() << " entries\n";
 
     size_t fileHashEstSize = sizeof(FileHash);
+    size_t mappedSize = 0;
+    size_t compressedSize = 0;
+    std::lock_guard<std::mutex> lock(_variantsMutex);
     for (const auto& entry : FileHash)
     {
-        fileHashEstSize += entry.first.capacity();
-        fileHashEstSize += entry.second.first.capacity();
-        fileHashEstSize += entry.second.second.capacity();
+        fileHashEstSize += entry.first.capacity() + sizeof(entry.second);
+        for (std::size_t i = 0; i < NumContentEncodings; ++i)
+        {
+            const auto& variant = entry.second._variants[i];
+            if (variant)
+                (i == 0 ? mappedSize : compressedSize) += variant->size();
+        }
     }
 
     os << "\t Estimated allocation size: " << fileHashEstSize << " bytes\n";
+    os << "\t Read or mapped from disk: " << mappedSize << " bytes\n";
+    os << "\t Compressed variants: " << compressedSize << " bytes\n";
 }
 
 FileServerRequestHandler::~FileServerRequestHandler()
 {
+    _stopCompression = true;
+    if (_compressionThread.joinable())
+        _compressionThread.join();
+
     // Clean cached files.
     FileHash.clear();
 }
@@ -985,8 +1228,7 @@ bool FileServerRequestHandler::handleRequest(const HTTPRequest& request,
         }
 
         // Is this a file we read at startup - if not; it's not for serving.
-        if (FileHash.find(relPath) == FileHash.end() &&
-            FileHash.find(relPath + ".br") == FileHash.end())
+        if (FileHash.find(relPath) == FileHash.end())
         {
             throw Poco::FileNotFoundException("Invalid URI request (hash): [" +
                                               requestUri.toString() + "].");
@@ -1072,26 +1314,6 @@ bool FileServerRequestHandler::handleRequest(const HTTPRequest& request,
 
             response.setContentType(std::move(mimeType));
 
-            auto it = request.find("If-None-Match");
-            if (it != request.end())
-            {
-                // if ETags match avoid re-sending the file.
-                if (!noCache && it->second == etagString)
-                {
-                    // TESTME: harder ... - do we even want ETag support ?
-                    std::ostringstream oss;
-                    Poco::DateTime now;
-                    Poco::DateTime later(now.utcTime(), int64_t(1000)*1000 * 60 * 60 * 24 * 128);
-                    std::string extraHeaders =
-                        "Expires: " + Poco::DateTimeFormatter::format(
-                            later, Poco::DateTimeFormat::HTTP_FORMAT) + "\r\n" +
-                        "Cache-Control: max-age=11059200\r\n";
-                    HttpHelper::sendErrorAndShutdown(http::StatusCode::NotModified, socket,
-                                                     std::string(), extraHeaders);
-                    return true;
-                }
-            }
-
 #if !MOBILEAPP
             if (LOOLWSD::WASMState != LOOLWSD::WASMActivationState::Disabled &&
                 relPath.find("wasm") != std::string::npos)
@@ -1102,7 +1324,6 @@ bool FileServerRequestHandler::handleRequest(const HTTPRequest& request,
             }
 #endif // !MOBILEAPP
 
-            const bool brotli = request.hasToken("Accept-Encoding", "br");
 #if ENABLE_DEBUG
             if (std::getenv("LOOL_SERVE_FROM_FS"))
             {
@@ -1110,7 +1331,8 @@ bool FileServerRequestHandler::handleRequest(const HTTPRequest& request,
                 // Avoids having to restart lool everytime you make a change in lool
                 std::string filePath =
                     Poco::Path(LOOLWSD::FileServerRoot, relPath).absolute().toString();
-                if (brotli && FileUtil::Stat(filePath + ".br").exists())
+                if (request.hasToken("Accept-Encoding", "br") &&
+                    FileUtil::Stat(filePath + ".br").exists())
                 {
                     filePath += ".br";
                     response.set("Content-Encoding", "br");
@@ -1121,38 +1343,105 @@ bool FileServerRequestHandler::handleRequest(const HTTPRequest& request,
             }
 #endif
 
-            bool compressed = false;
-            const std::string* content;
-            if (brotli && FileHash.find(relPath + ".br") != FileHash.end())
+            std::array<std::shared_ptr<const FileUtil::MappedFile>, NumContentEncodings> variants;
+            std::string hash;
+            std::chrono::system_clock::time_point lastModified;
             {
-                compressed = true;
-                response.set("Content-Encoding", "br");
-                content = getUncompressedFile(relPath + ".br");
+                std::lock_guard<std::mutex> lock(_variantsMutex);
+                const CachedFile& cachedFile = FileHash.at(relPath);
+                variants = cachedFile._variants;
+                hash = cachedFile._hash;
+                lastModified = cachedFile._lastModified;
             }
-            else if (request.hasToken("Accept-Encoding", "gzip"))
+
+            std::array<bool, NumContentEncodings> available;
+            for (std::size_t i = 0; i < NumContentEncodings; ++i)
+                available[i] = variants[i] != nullptr;
+
+            const std::string acceptEncoding = request.get("Accept-Encoding", std::string());
+            const ContentEncoding encoding = negotiateContentEncoding(acceptEncoding, available);
+            std::shared_ptr<const FileUtil::MappedFile> content =
+                variants[static_cast<std::size_t>(encoding)];
+            if (!content && encoding == ContentEncoding::Identity)
+                content = getDecompressedVariant(relPath);
+            if (!content)
+                throw Poco::FileNotFoundException("Invalid URI request (encoding): [" +
+                                                  requestUri.toString() + "].");
+
+            // Until the file is hashed, fall back to the version-wide ETag.
+            const std::string etag = hash.empty() ? etagString : makeETag(hash, encoding);
+            const std::string lastModifiedTime = Poco::DateTimeFormatter::format(
+                Poco::Timestamp::fromEpochTime(std::chrono::system_clock::to_time_t(lastModified)),
+                Poco::DateTimeFormat::HTTP_FORMAT);
+
+            if (!noCache && isNotModified(request.get("If-None-Match", std::string()),
+                                          request.get("If-Modified-Since", std::string()),
+                                          etag, lastModified))
             {
-                compressed = true;
-                response.set("Content-Encoding", "gzip");
-                content = getCompressedFile(relPath);
+                Poco::DateTime now;
+                Poco::DateTime later(now.utcTime(), int64_t(1000)*1000 * 60 * 60 * 24 * 128);
+                std::string extraHeaders =
+                    "Expires: " + Poco::DateTimeFormatter::format(
+                        later, Poco::DateTimeFormat::HTTP_FORMAT) + "\r\n" +
+                    "Cache-Control: max-age=11059200\r\n" +
+                    "ETag: " + etag + "\r\n" +
+                    "Vary: Accept-Encoding\r\n";
+                HttpHelper::sendErrorAndShutdown(http::StatusCode::NotModified, socket,
+                                                 std::string(), extraHeaders);
+                return true;
             }
-            else
-                content = getUncompressedFile(relPath);
 
-            response.setContentLength(content->size());
+            const bool compressed = (encoding != ContentEncoding::Identity);
+            if (compressed)
+                response.set("Content-Encoding", std::string(contentEncodingName(encoding)));
+            response.add("Vary", "Accept-Encoding");
+            response.set("Accept-Ranges", "bytes");
+            response.set("Last-Modified", lastModifiedTime);
 
             if (!noCache)
             {
                 // 60 * 60 * 24 * 128 (days) = 11059200
                 response.set("Cache-Control", "max-age=11059200");
-                response.set("ETag", etagString);
+                response.set("ETag", etag);
             }
             response.add("X-Content-Type-Options", "nosniff");
 
+            // Ranges apply to the selected representation, so offsets are into the coded bytes.
+            const std::size_t size = content->size();
+            std::size_t offset = 0;
+            std::size_t length = size;
+            const std::string range = request.get("Range", std::string());
+            if (!range.empty() &&
+                isRangeApplicable(request.get("If-Range", std::string()), etag, lastModifiedTime))
+            {
+                switch (parseByteRange(range, size, offset, length))
+                {
+                    case RangeStatus::Ignore:
+                        offset = 0;
+                        length = size;
+                        break;
+                    case RangeStatus::Partial:
+                        response.setStatusCode(http::StatusCode::PartialContent);
+                        response.set("Content-Range", "bytes " + std::to_string(offset) + '-' +
+                                                          std::to_string(offset + length - 1) +
+                                                          '/' + std::to_string(size));
+                        break;
+                    case RangeStatus::Unsatisfiable:
+                        HttpHelper::sendErrorAndShutdown(
+                            http::StatusCode::RangeNotSatisfiable, socket, std::string(),
+                            "Content-Range: bytes */" + std::to_string(size) + "\r\n");
+                        return true;
+                }
+            }
+
+            response.setContentLength(length);
+
             LOG_TRC('#' << socket->getFD() << ": Sending " << (!compressed ? "un" : "")
                         << "compressed : file [" << relPath << "]: " << response.header());
 
-            socket->send(response);
-            socket->send(*content);
+            // The body is sent straight from the mapping; no copying into the socket buffer.
+            if (socket->send(response))
+                socket->sendFile(std::move(content), offset, length);
         }
     }
     catch (const Poco::Net::NotAuthenticatedException& exc)
@@ -1246,69 +1535,12 @@ void FileServerRequestHandler::readDirToHash(const std::string &basePath, const
         if (S_ISDIR(fileStat.st_mode))
             readDirToHash(basePath, relPath);
 
-        else if (S_ISREG(fileStat.st_mode) && relPath.ends_with(".br"))
-        {
-            // Only cache without compressing.
-            fileCount++;
-            filesRead.append(currentFile->d_name);
-            filesRead += ' ';
-
-            std::string uncompressedFile;
-            const ssize_t size =
-                FileUtil::readFile(basePath + relPath, uncompressedFile, MaxFileSizeToCacheInBytes);
-            assert(size < MaxFileSizeToCacheInBytes && "MaxFileSizeToCacheInBytes is too small for "
-                                                       "static-file serving; please increase it");
-            if (size <= 0)
-            {
-                assert(uncompressedFile.empty() &&
-                       "Unexpected data in uncompressedFile after failed read");
-                if (size < 0)
-                {
-                    LOG_ERR("Failed to read file [" << basePath + relPath
-                                                    << "] or is too large to cache and serve");
-                }
-            }
-
-            FileHash.emplace(prefix + relPath,
-                             std::make_pair(std::move(uncompressedFile), std::string()));
-        }
         else if (S_ISREG(fileStat.st_mode))
         {
-            std::string uncompressedFile;
-            const ssize_t size =
-                FileUtil::readFile(basePath + relPath, uncompressedFile, MaxFileSizeToCacheInBytes);
-            assert(size < MaxFileSizeToCacheInBytes && "MaxFileSizeToCacheInBytes is too small for "
-                                                       "static-file serving; please increase it");
-            if (size <= 0)
+            auto uncompressedFile = std::make_shared<FileUtil::MappedFile>(basePath + relPath);
+            if (!uncompressedFile->isValid())
             {
-                assert(uncompressedFile.empty() &&
-                       "Unexpected data in uncompressedFile after failed read");
-                if (size < 0)
-                {
-                    LOG_ERR("Failed to read file [" << basePath + relPath
-                                                    << "] or is too large to cache and serve");
-                }
-
-                // Always add the entry, even if the contents are empty.
-                FileHash.emplace(prefix + relPath,
-                                 std::make_pair(std::move(uncompressedFile), std::string()));
-                continue;
-            }
-
-            z_stream strm;
-            strm.zalloc = Z_NULL;
-            strm.zfree = Z_NULL;
-            strm.opaque = Z_NULL;
-            const int initResult = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY);
-            if (initResult != Z_OK)
-            {
-                LOG_ERR("Failed to deflateInit2 for file [" << basePath + relPath
-                                                            << "], result: " << initResult);
-                // Add the uncompressed version; it's better to serve uncompressed than nothing at all.
-                FileHash.emplace(prefix + relPath,
-                                 std::make_pair(std::move(uncompressedFile), std::string()));
-
-                deflateEnd(&strm);
+                LOG_ERR("Failed to map file [" << basePath + relPath << "] to cache and serve");
                 continue;
             }
 
@@ -1316,33 +1548,23 @@ void FileServerRequestHandler::readDirToHash(const std::string &basePath, const
             filesRead.append(currentFile->d_name);
             filesRead += ' ';
 
-            // Compress.
-            assert(size > 0 && "No data to compress");
-            assert(!uncompressedFile.empty() && "Unexpected empty uncompressedFile");
-            std::string compressedFile;
-            const long unsigned int compSize = compressBound(size);
-            compressedFile.resize(compSize);
-            strm.next_in = (unsigned char*)uncompressedFile.data();
-            strm.avail_in = size;
-            strm.avail_out = compSize;
-            strm.next_out = (unsigned char*)compressedFile.data();
-            strm.total_out = strm.total_in = 0;
-
-            const int deflateResult = deflate(&strm, Z_FINISH);
-            if (deflateResult != Z_OK && deflateResult != Z_STREAM_END)
-            {
-                LOG_ERR("Failed to deflate [" << basePath + relPath
-                                              << "], result: " << deflateResult);
-                compressedFile.clear(); // Can't trust the compressed data, if any.
-            }
-            else
+            const auto lastModified = std::chrono::system_clock::from_time_t(fileStat.st_mtime);
+
+            // Pre-compressed files are served as-is, as a variant of the original.
+            if (relPath.ends_with(".br"))
             {
-                compressedFile.resize(compSize - strm.avail_out);
+                CachedFile& cachedFile = FileHash[prefix + relPath.substr(0, relPath.size() - 3)];
+                cachedFile._variants[static_cast<std::size_t>(ContentEncoding::Brotli)] =
+                    std::move(uncompressedFile);
+                if (cachedFile._lastModified == std::chrono::system_clock::time_point())
+                    cachedFile._lastModified = lastModified;
+                continue;
             }
 
-            FileHash.emplace(prefix + relPath, std::make_pair(std::move(uncompressedFile),
-                                                              std::move(compressedFile)));
-            deflateEnd(&strm);
+            CachedFile& cachedFile = FileHash[prefix + relPath];
+            cachedFile._variants[static_cast<std::size_t>(ContentEncoding::Identity)] =
+                std::move(uncompressedFile);
+            cachedFile._lastModified = lastModified;
         }
     }
     closedir(workingdir);
@@ -1352,16 +1574,58 @@ void FileServerRequestHandler::readDirToHash(const std::string &basePath, const
                             << filesRead);
 }
 
-const std::string *FileServerRequestHandler::getCompressedFile(const std::string &path)
+std::shared_ptr<const FileUtil::MappedFile>
+FileServerRequestHandler::getVariant(const std::string& path, const ContentEncoding encoding) const
+{
+    const auto it = FileHash.find(path);
+    if (it == FileHash.end())
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(_variantsMutex);
+    return it->second._variants[static_cast<std::size_t>(encoding)];
+}
+
+std::shared_ptr<const FileUtil::MappedFile>
+FileServerRequestHandler::getDecompressedVariant(const std::string& path)
+{
+    const std::shared_ptr<const FileUtil::MappedFile> brotli =
+        getVariant(path, ContentEncoding::Brotli);
+    if (!brotli)
+        return nullptr;
+
+    std::string decompressed = unbrotliData(path, brotli->view());
+    if (decompressed.empty())
+    {
+        LOG_WRN("Cannot serve [" << path << "] to clients that don't take brotli");
+        return nullptr;
+    }
+
+    LOG_DBG("Decompressed [" << path << "] to " << decompressed.size() << " bytes");
+    auto identity = FileUtil::MappedFile::create(std::move(decompressed));
+
+    std::lock_guard<std::mutex> lock(_variantsMutex);
+    auto& variant = FileHash.at(path)._variants[static_cast<std::size_t>(ContentEncoding::Identity)];
+    if (!variant) // Unless another request beat us to it.
+        variant = std::move(identity);
+
+    return variant;
+}
+
+std::string_view FileServerRequestHandler::getCompressedFile(const std::string &path) const
 {
     // If a compressed version is not available, return the original uncompressed data.
-    const auto& pair = FileHash[path];
-    return pair.second.empty() ? &pair.first : &pair.second;
+    // The mappings live as long as we do, so the views stay valid.
+    const auto compressed = getVariant(path, ContentEncoding::Gzip);
+    if (compressed)
+        return compressed->view();
+
+    return getUncompressedFile(path);
 }
 
-const std::string *FileServerRequestHandler::getUncompressedFile(const std::string &path)
+std::string_view FileServerRequestHandler::getUncompressedFile(const std::string &path) const
 {
-    return &FileHash[path].first;
+    const auto uncompressed = getVariant(path, ContentEncoding::Identity);
+    return uncompressed ? uncompressed->view() : std::string_view();
 }
 
 std::string FileServerRequestHandler::getRequestPathname(const HTTPRequest& request,
@@ -1621,7 +1885,7 @@ void FileServerRequestHandler::replaceServiceRoot(const HTTPRequest& request,
     const std::string responseRoot = cnxDetails.getResponseRoot();
     const std::string relPath = getRequestPathname(request, requestDetails);
     LOG_DBG("Preprocessing file: " << relPath);
-    std::string preprocess = *getUncompressedFile(relPath);
+    std::string preprocess(getUncompressedFile(relPath));
     Poco::replaceInPlace(preprocess, std::string("%SERVICE_ROOT%"), responseRoot);
     Poco::replaceInPlace(preprocess, std::string("%VERSION%"), Util::getLoolVersionHash());
     httpResponse.setBody(preprocess, "text/javascript");
@@ -1640,7 +1904,12 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
     // Is this a file we read at startup - if not; it's not for serving.
     const std::string relPath = getRequestPathname(request, requestDetails);
     LOG_DBG("Preprocessing file: " << relPath);
-    std::string preprocess = *getUncompressedFile(relPath);
+
+    // The variables that only take a few distinct values, mostly from the config,
+    // are bound once per variant of the template, which we cache. The per-request
+    // ones (tokens, user-supplied settings, etc.) are then substituted on each request.
+    std::unordered_map<std::string, std::string> vars;
+    std::unordered_map<std::string, std::string> requestVars;
 
     // We need to pass certain parameters from the lool html GET URI
     // to the embedded document URI. Here we extract those params
@@ -1651,78 +1920,75 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
 
 
     const std::string userAgent = request.get("User-Agent", "");
-    Poco::replaceInPlace(preprocess, std::string("%BROWSER_VIEWPORT%"),
-                         !userAgent.empty() && userAgent.find("Mobile") != std::string::npos ? std::string(MetaViewPort) : "");
+    vars["BROWSER_VIEWPORT"] = !userAgent.empty() && userAgent.find("Mobile") != std::string::npos ? std::string(MetaViewPort) : "";
 
     std::string socketProxy = "false";
     if (requestDetails.isProxy())
         socketProxy = "true";
-    Poco::replaceInPlace(preprocess, std::string("%SOCKET_PROXY%"), socketProxy);
+    vars["SOCKET_PROXY"] = socketProxy;
 
     const std::string responseRoot = cnxDetails.getResponseRoot();
     std::string userInterfaceMode;
     std::string userInterfaceTheme;
     std::string savedUIState = "true";
 
-    Poco::replaceInPlace(preprocess, ACCESS_TOKEN, urv[ACCESS_TOKEN]);
-    Poco::replaceInPlace(preprocess, ACCESS_TOKEN_TTL, urv[ACCESS_TOKEN_TTL]);
-    Poco::replaceInPlace(preprocess, NO_AUTH_HEADER, urv[NO_AUTH_HEADER]);
-    Poco::replaceInPlace(preprocess, ACCESS_HEADER, urv[ACCESS_HEADER]);
-    Poco::replaceInPlace(preprocess, std::string("%HOST%"), cnxDetails.getWebSocketUrl());
-    Poco::replaceInPlace(preprocess, std::string("%VERSION%"), Util::getLoolVersionHash());
-    Poco::replaceInPlace(preprocess, std::string("%LOOLWSD_VERSION%"), Util::getLoolVersion());
-    Poco::replaceInPlace(preprocess, std::string("%SERVICE_ROOT%"), responseRoot);
-    Poco::replaceInPlace(preprocess, UI_DEFAULTS, macaron::Base64::Encode(
-                         uiDefaultsToJSON(urv[UI_DEFAULTS], userInterfaceMode, userInterfaceTheme, savedUIState)));
-    Poco::replaceInPlace(preprocess, std::string("%UI_THEME%"), userInterfaceTheme); // UI_THEME refers to light or dark theme
-    Poco::replaceInPlace(preprocess, BRANDING_THEME, urv[BRANDING_THEME]);
-    Poco::replaceInPlace(preprocess, std::string("%SAVED_UI_STATE%"), savedUIState);
-    Poco::replaceInPlace(preprocess, POSTMESSAGE_ORIGIN, urv[POSTMESSAGE_ORIGIN]);
-    Poco::replaceInPlace(preprocess, CHECK_FILE_INFO_OVERRIDE,
-                         checkFileInfoToJSON(urv[CHECK_FILE_INFO_OVERRIDE]));
-    Poco::replaceInPlace(preprocess, WOPI_SETTING_BASE_URL, urv[WOPI_SETTING_BASE_URL]);
-    Poco::replaceInPlace(preprocess, std::string("%WOPI_HOST_ID%"), form.get("host_session_id", ""));
+    requestVars["ACCESS_TOKEN"] = urv[ACCESS_TOKEN];
+    requestVars["ACCESS_TOKEN_TTL"] = urv[ACCESS_TOKEN_TTL];
+    requestVars["NO_AUTH_HEADER"] = urv[NO_AUTH_HEADER];
+    requestVars["ACCESS_HEADER"] = urv[ACCESS_HEADER];
+    vars["HOST"] = cnxDetails.getWebSocketUrl();
+    vars["VERSION"] = Util::getLoolVersionHash();
+    vars["LOOLWSD_VERSION"] = Util::getLoolVersion();
+    vars["SERVICE_ROOT"] = responseRoot;
+    requestVars["UI_DEFAULTS"] = macaron::Base64::Encode(
+        uiDefaultsToJSON(urv[UI_DEFAULTS], userInterfaceMode, userInterfaceTheme, savedUIState));
+    vars["UI_THEME"] = userInterfaceTheme; // UI_THEME refers to light or dark theme
+    requestVars["BRANDING_THEME"] = urv[BRANDING_THEME];
+    vars["SAVED_UI_STATE"] = savedUIState;
+    requestVars["POSTMESSAGE_ORIGIN"] = urv[POSTMESSAGE_ORIGIN];
+    requestVars["CHECK_FILE_INFO_OVERRIDE"] = checkFileInfoToJSON(urv[CHECK_FILE_INFO_OVERRIDE]);
+    requestVars["WOPI_SETTING_BASE_URL"] = urv[WOPI_SETTING_BASE_URL];
+    requestVars["WOPI_HOST_ID"] = form.get("host_session_id", "");
 
     const auto& config = Application::instance().config();
 
     std::string protocolDebug = stringifyBoolFromConfig(config, "logging.protocol", false);
-    Poco::replaceInPlace(preprocess, std::string("%PROTOCOL_DEBUG%"), protocolDebug);
+    vars["PROTOCOL_DEBUG"] = protocolDebug;
 
     bool enableDebug = false;
 #if ENABLE_DEBUG
     enableDebug = true;
 #endif
     std::string enableDebugStr = stringifyBoolFromConfig(config, "logging.protocol", enableDebug);
-    Poco::replaceInPlace(preprocess, std::string("%ENABLE_DEBUG%"), enableDebugStr);
+    vars["ENABLE_DEBUG"] = enableDebugStr;
 
     static const std::string hexifyEmbeddedUrls =
         ConfigUtil::getConfigValue<bool>("hexify_embedded_urls", false) ? "true" : "false";
-    Poco::replaceInPlace(preprocess, std::string("%HEXIFY_URL%"), hexifyEmbeddedUrls);
+    vars["HEXIFY_URL"] = hexifyEmbeddedUrls;
 
     static const std::string useStatusbarSaveIndicator =
         config.getBool("user_interface.statusbar_save_indicator", false) ? "true" : "false";
-    Poco::replaceInPlace(preprocess, std::string("%STATUSBAR_SAVE_INDICATOR%"), useStatusbarSaveIndicator);
+    vars["STATUSBAR_SAVE_INDICATOR"] = useStatusbarSaveIndicator;
 
-    updateThemeResources(preprocess, responseRoot, urv[BRANDING_THEME], config);
+    getThemeVariables(vars, responseRoot, urv[BRANDING_THEME], config);
 
-    Poco::replaceInPlace(preprocess, CSS_VARS, cssVarsToStyle(urv[CSS_VARS]));
+    requestVars["CSS_VARIABLES"] = cssVarsToStyle(urv[CSS_VARS]);
 
     if (config.getBool("browser_logging", false))
     {
         Poco::SHA1Engine engine;
         engine.update(LOOLWSD::LogToken);
-        Poco::replaceInPlace(preprocess, std::string("%BROWSER_LOGGING%"),
-                             Poco::DigestEngine::digestToHex(engine.digest()));
+        vars["BROWSER_LOGGING"] = Poco::DigestEngine::digestToHex(engine.digest());
     }
     else
-        Poco::replaceInPlace(preprocess, std::string("%BROWSER_LOGGING%"), std::string());
+        vars["BROWSER_LOGGING"] = std::string();
 
     const unsigned int outOfFocusTimeoutSecs = config.getUInt("per_view.out_of_focus_timeout_secs", 300);
-    Poco::replaceInPlace(preprocess, std::string("%OUT_OF_FOCUS_TIMEOUT_SECS%"), std::to_string(outOfFocusTimeoutSecs));
+    vars["OUT_OF_FOCUS_TIMEOUT_SECS"] = std::to_string(outOfFocusTimeoutSecs);
     const unsigned int idleTimeoutSecs = config.getUInt("per_view.idle_timeout_secs", 900);
-    Poco::replaceInPlace(preprocess, std::string("%IDLE_TIMEOUT_SECS%"), std::to_string(idleTimeoutSecs));
+    vars["IDLE_TIMEOUT_SECS"] = std::to_string(idleTimeoutSecs);
     const unsigned int minSavedMessTimeoutSecs = config.getUInt("per_view.min_saved_message_timeout_secs", 0);
-    Poco::replaceInPlace(preprocess, std::string("%MIN_SAVED_MESSAGE_TIMEOUT_SECS%"), std::to_string(minSavedMessTimeoutSecs));
+    vars["MIN_SAVED_MESSAGE_TIMEOUT_SECS"] = std::to_string(minSavedMessTimeoutSecs);
 
     #if ENABLE_WELCOME_MESSAGE
         std::string enableWelcomeMessage = "true";
@@ -1731,18 +1997,18 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
         {
             autoShowWelcome = stringifyBoolFromConfig(config, "welcome.enable", false);
         }
-        Poco::replaceInPlace(preprocess, std::string("%PRODUCT_BRANDING_NAME%"), std::string());
-        Poco::replaceInPlace(preprocess, std::string("%PRODUCT_BRANDING_URL%"), std::string());
+        vars["PRODUCT_BRANDING_NAME"] = std::string();
+        vars["PRODUCT_BRANDING_URL"] = std::string();
     #else // configurable
         std::string enableWelcomeMessage = stringifyBoolFromConfig(config, "welcome.enable", false);
         std::string autoShowWelcome = stringifyBoolFromConfig(config, "welcome.enable", false);
     #endif
 
-    Poco::replaceInPlace(preprocess, std::string("%ENABLE_WELCOME_MSG%"), enableWelcomeMessage);
-    Poco::replaceInPlace(preprocess, std::string("%AUTO_SHOW_WELCOME%"), autoShowWelcome);
+    vars["ENABLE_WELCOME_MSG"] = enableWelcomeMessage;
+    vars["AUTO_SHOW_WELCOME"] = autoShowWelcome;
 
     std::string enableAccessibility = stringifyBoolFromConfig(config, "accessibility.enable", false);
-    Poco::replaceInPlace(preprocess, std::string("%ENABLE_ACCESSIBILITY%"), enableAccessibility);
+    vars["ENABLE_ACCESSIBILITY"] = enableAccessibility;
 
     // the config value of 'notebookbar/tabbed' or 'classic/compact' overrides the UIMode
     // from the WOPI
@@ -1761,40 +2027,40 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
     if (enableAccessibility == "true" || (userInterfaceMode != "classic" && userInterfaceMode != "notebookbar"))
         userInterfaceMode = "notebookbar";
 
-    Poco::replaceInPlace(preprocess, std::string("%USER_INTERFACE_MODE%"), userInterfaceMode);
+    vars["USER_INTERFACE_MODE"] = userInterfaceMode;
 
     std::string uiRtlSettings;
     if (LangUtil::isRtlLanguage(requestDetails.getParam("lang")))
         uiRtlSettings = " dir=\"rtl\" ";
-    Poco::replaceInPlace(preprocess, std::string("%UI_RTL_SETTINGS%"), uiRtlSettings);
+    vars["UI_RTL_SETTINGS"] = uiRtlSettings;
 
     std::string enableMacrosExecution = stringifyBoolFromConfig(config, "security.enable_macros_execution", false);
-    Poco::replaceInPlace(preprocess, std::string("%ENABLE_MACROS_EXECUTION%"), enableMacrosExecution);
+    vars["ENABLE_MACROS_EXECUTION"] = enableMacrosExecution;
 
 
     if (!config.getBool("feedback.show", true) && config.getBool("home_mode.enable", false))
     {
-        Poco::replaceInPlace(preprocess, std::string("%AUTO_SHOW_FEEDBACK%"), (std::string)"false");
+        vars["AUTO_SHOW_FEEDBACK"] = "false";
     }
     else
     {
-        Poco::replaceInPlace(preprocess, std::string("%AUTO_SHOW_FEEDBACK%"), (std::string)"true");
+        vars["AUTO_SHOW_FEEDBACK"] = "true";
     }
 
     bool allowUpdateNotification = config.getBool("allow_update_popup", true);
-    Poco::replaceInPlace(preprocess, std::string("%ENABLE_UPDATE_NOTIFICATION%"), boolToString(allowUpdateNotification));
+    vars["ENABLE_UPDATE_NOTIFICATION"] = boolToString(allowUpdateNotification);
 
-    Poco::replaceInPlace(preprocess, std::string("%FEEDBACK_URL%"), std::string(FEEDBACK_URL));
-    Poco::replaceInPlace(preprocess, std::string("%WELCOME_URL%"), std::string(WELCOME_URL));
+    vars["FEEDBACK_URL"] = std::string(FEEDBACK_URL);
+    vars["WELCOME_URL"] = std::string(WELCOME_URL);
 
 
-    Poco::replaceInPlace(preprocess, std::string("%DEEPL_ENABLED%"), boolToString(config.getBool("deepl.enabled", false)));
-    Poco::replaceInPlace(preprocess, std::string("%ZOTERO_ENABLED%"), boolToString(config.getBool("zotero.enable", true)));
-    Poco::replaceInPlace(preprocess, std::string("%DOCUMENT_SIGNING_ENABLED%"), boolToString(config.getBool("document_signing.enable", true)));
-    Poco::replaceInPlace(preprocess, std::string("%WASM_ENABLED%"), boolToString(ConfigUtil::getConfigValue<bool>("wasm.enable", false)));
-    Poco::replaceInPlace(preprocess, std::string("%CANVAS_SLIDESHOW_ENABLED%"), boolToString(ConfigUtil::getConfigValue<bool>("canvas_slideshow_enabled", true)));
+    vars["DEEPL_ENABLED"] = boolToString(config.getBool("deepl.enabled", false));
+    vars["ZOTERO_ENABLED"] = boolToString(config.getBool("zotero.enable", true));
+    vars["DOCUMENT_SIGNING_ENABLED"] = boolToString(config.getBool("document_signing.enable", true));
+    vars["WASM_ENABLED"] = boolToString(ConfigUtil::getConfigValue<bool>("wasm.enable", false));
+    vars["CANVAS_SLIDESHOW_ENABLED"] = boolToString(ConfigUtil::getConfigValue<bool>("canvas_slideshow_enabled", true));
     Poco::URI indirectionURI(config.getString("indirection_endpoint.url", ""));
-    Poco::replaceInPlace(preprocess, std::string("%INDIRECTION_URL%"), indirectionURI.toString());
+    vars["INDIRECTION_URL"] = indirectionURI.toString();
 
     std::string extraExportFormats;
     if (ConfigUtil::getConfigValue<bool>("extra_export_formats.impress_swf", false))
@@ -1809,12 +2075,11 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
         extraExportFormats += " impress_svg";
     if (ConfigUtil::getConfigValue<bool>("extra_export_formats.impress_tiff", false))
         extraExportFormats += " impress_tiff";
-    Poco::replaceInPlace(preprocess, std::string("%EXTRA_EXPORT_FORMATS%"), extraExportFormats);
+    vars["EXTRA_EXPORT_FORMATS"] = extraExportFormats;
 
     bool geoLocationSetup = config.getBool("indirection_endpoint.geolocation_setup.enable", false);
     if (geoLocationSetup)
-        Poco::replaceInPlace(preprocess, std::string("%GEOLOCATION_SETUP%"),
-                             boolToString(geoLocationSetup));
+        vars["GEOLOCATION_SETUP"] = boolToString(geoLocationSetup);
 
     const std::string mimeType = "text/html";
 
@@ -1903,8 +2168,7 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
         // frame ancestors are also allowed for img-src in order to load the views avatars
         csp.appendDirective("img-src", frameAncestors);
         csp.appendDirective("frame-ancestors", frameAncestors);
-        const std::string escapedFrameAncestors = Uri::encode(frameAncestors, "'");
-        Poco::replaceInPlace(preprocess, std::string("%FRAME_ANCESTORS%"), escapedFrameAncestors);
+        requestVars["FRAME_ANCESTORS"] = Uri::encode(frameAncestors, "'");
     }
     else
     {
@@ -2006,6 +2270,7 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
         }
     }
 
+    const std::string preprocess = getTemplateVariant(relPath, vars)->substitute(requestVars);
     httpResponse.setBody(preprocess, mimeType);
 
     socket->send(httpResponse);
@@ -2014,6 +2279,53 @@ FileServerRequestHandler::ResourceAccessDetails FileServerRequestHandler::prepro
     return ResourceAccessDetails(std::move(wopiSrc), urv[ACCESS_TOKEN], urv[NO_AUTH_HEADER], urv[DEBUG_WOPI_CONFIG_ID]);
 }
 
+std::shared_ptr<const PreProcessedFile> FileServerRequestHandler::getTemplateVariant(
+    const std::string& relPath, const std::unordered_map<std::string, std::string>& variantVars)
+{
+    // The key is the path and the variables in a stable order.
+    std::vector<std::pair<std::string_view, std::string_view>> sortedVars(variantVars.begin(),
+                                                                         variantVars.end());
+    std::sort(sortedVars.begin(), sortedVars.end());
+
+    std::string key = relPath;
+    for (const auto& pair : sortedVars)
+    {
+        key += '\0';
+        key += pair.first;
+        key += '=';
+        key += pair.second;
+    }
+
+    std::lock_guard<std::mutex> lock(_templatesMutex);
+
+    const auto it = _templateVariants.find(key);
+    if (it != _templateVariants.end())
+        return it->second;
+
+    std::shared_ptr<const PreProcessedFile>& compiled = _templates[relPath];
+    if (!compiled)
+    {
+        compiled = std::make_shared<PreProcessedFile>(relPath, std::string(getUncompressedFile(relPath)));
+        LOG_DBG("Compiled template [" << relPath << "] into " << compiled->segmentCount()
+                                      << " segments");
+    }
+
+    // Some of the variables come from the request (e.g. the host), so don't let
+    // the variants grow without bounds.
+    constexpr std::size_t MaxTemplateVariants = 64;
+    if (_templateVariants.size() >= MaxTemplateVariants)
+    {
+        LOG_DBG("Dropping " << _templateVariants.size() << " cached template variants");
+        _templateVariants.clear();
+    }
+
+    auto variant = std::make_shared<const PreProcessedFile>(compiled->bind(variantVars));
+    LOG_DBG("New variant of template [" << relPath << "] with " << variant->segmentCount()
+                                        << " segments");
+    _templateVariants.emplace(std::move(key), variant);
+    return variant;
+}
+
 void FileServerRequestHandler::preprocessWelcomeFile(const HTTPRequest& request,
                                                      http::Response& httpResponse,
                                                      const RequestDetails& requestDetails,
@@ -2022,7 +2334,7 @@ void FileServerRequestHandler::preprocessWelcomeFile(const HTTPRequest& request,
 {
     const std::string relPath = getRequestPathname(request, requestDetails);
     LOG_DBG("Preprocessing file: " << relPath);
-    std::string templateWelcome = *getUncompressedFile(relPath);
+    std::string templateWelcome(getUncompressedFile(relPath));
 
     HTMLForm form(request, message);
     std::string uiTheme = form.get("ui_theme", "");
@@ -2391,7 +2703,7 @@ void FileServerRequestHandler::preprocessIntegratorAdminFile(const HTTPRequest&
 
     const std::string relPath = getRequestPathname(request, requestDetails);
     LOG_DBG("Preprocessing file: " << relPath);
-    std::string adminFile = *getUncompressedFile(relPath);
+    std::string adminFile(getUncompressedFile(relPath));
 
     HTMLForm form(request, message);
     const UserRequestVars urv(request, form);
@@ -2483,10 +2795,10 @@ void FileServerRequestHandler::preprocessAdminFile(const HTTPRequest& request,
 
     const std::string relPath = getRequestPathname(request, requestDetails);
     LOG_DBG("Preprocessing file: " << relPath);
-    std::string adminFile = *getUncompressedFile(relPath);
+    std::string adminFile(getUncompressedFile(relPath));
     const std::string templatePath =
         Poco::Path(relPath).setFileName("admintemplate.html").toString();
-    std::string templateFile = *getUncompressedFile(templatePath);
+    std::string templateFile(getUncompressedFile(templatePath));
 
     const std::string escapedJwtToken = Uri::encode(jwtToken, "'");
     Poco::replaceInPlace(templateFile, std::string("%JWT_TOKEN%"), escapedJwtToken);
@@ -2494,7 +2806,7 @@ void FileServerRequestHandler::preprocessAdminFile(const HTTPRequest& request,
         relPath == "/browser/dist/admin/adminClusterOverviewAbout.html")
     {
         std::string bodyPath = Poco::Path(relPath).setFileName("adminClusterBody.html").toString();
-        std::string bodyFile = *getUncompressedFile(bodyPath);
+        std::string bodyFile(getUncompressedFile(bodyPath));
         Poco::replaceInPlace(templateFile, std::string("<!--%BODY%-->"), bodyFile);
         Poco::replaceInPlace(templateFile, std::string("<!--%MAIN_CONTENT%-->"), adminFile);
         Poco::replaceInPlace(templateFile, std::string("%ROUTE_TOKEN%"), LOOLWSD::RouteToken);
@@ -2502,7 +2814,7 @@ void FileServerRequestHandler::preprocessAdminFile(const HTTPRequest& request,
     else
     {
         std::string bodyPath = Poco::Path(relPath).setFileName("adminBody.html").toString();
-        std::string bodyFile = *getUncompressedFile(bodyPath);
+        std::string bodyFile(getUncompressedFile(bodyPath));
         Poco::replaceInPlace(templateFile, std::string("<!--%BODY%-->"), bodyFile);
         Poco::replaceInPlace(templateFile, std::string("<!--%MAIN_CONTENT%-->"),
                              adminFile); // Now template has the main content..
@@ -2565,10 +2877,9 @@ static std::string sanitizeTheme(const std::string& theme)
     return safeTheme;
 }
 
-void FileServerRequestHandler::updateThemeResources(std::string& fileContent,
-                                                    const std::string& responseRoot,
-                                                    const std::string& theme,
-                                                    const Poco::Util::AbstractConfiguration& config)
+void FileServerRequestHandler::getThemeVariables(
+    std::unordered_map<std::string, std::string>& vars, const std::string& responseRoot,
+    const std::string& theme, const Poco::Util::AbstractConfiguration& config)
 {
     static const bool useIntegrationTheme =
         config.getBool("user_interface.use_integration_theme", true);
@@ -2620,11 +2931,23 @@ void FileServerRequestHandler::updateThemeResources(std::string& fileContent,
         brandJS = ossBrandJS.str();
     }
 
-    Poco::replaceInPlace(fileContent, std::string("<!--%BRANDING_CSS%-->"), brandCSS);
-    Poco::replaceInPlace(fileContent, std::string("<!--%BRANDING_JS%-->"), brandJS);
+    vars["BRANDING_CSS"] = std::move(brandCSS);
+    vars["BRANDING_JS"] = std::move(brandJS);
+    vars["USE_INTEGRATION_THEME"] = useIntegrationTheme && hasIntegrationTheme ? "true" : "false";
+}
+
+void FileServerRequestHandler::updateThemeResources(std::string& fileContent,
+                                                    const std::string& responseRoot,
+                                                    const std::string& theme,
+                                                    const Poco::Util::AbstractConfiguration& config)
+{
+    std::unordered_map<std::string, std::string> vars;
+    getThemeVariables(vars, responseRoot, theme, config);
 
-    const std::string useIntegrationThemeString = useIntegrationTheme && hasIntegrationTheme ? "true" : "false";
-    Poco::replaceInPlace(fileContent, std::string("%USE_INTEGRATION_THEME%"), useIntegrationThemeString);
+    Poco::replaceInPlace(fileContent, std::string("<!--%BRANDING_CSS%-->"), vars["BRANDING_CSS"]);
+    Poco::replaceInPlace(fileContent, std::string("<!--%BRANDING_JS%-->"), vars["BRANDING_JS"]);
+    Poco::replaceInPlace(fileContent, std::string("%USE_INTEGRATION_THEME%"),
+                         vars["USE_INTEGRATION_THEME"]);
 }
 
 /* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -11,11 +11,17 @@
 
 #include <LOOLWSD.hpp>
 #include <ConfigUtil.hpp>
+#include <FileUtil.hpp>
 #include <HttpRequest.hpp>
 #include <Poco/Net/PartHandler.h>
 #include <Socket.hpp>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 class RequestDetails;
@@ -51,9 +57,24 @@ public:
     std::size_t size() const { return _size; }
 
     /// Substitute variables per the given map.
-    std::string substitute(const std::unordered_map<std::string, std::string>& values);
+    std::string substitute(const std::unordered_map<std::string, std::string>& values) const;
+
+    /// Returns a copy with the given variables substituted and the rest left
+    /// as variables, to be substituted later. Adjacent data segments are merged.
+    PreProcessedFile bind(const std::unordered_map<std::string, std::string>& values) const;
+
+    /// The number of segments, data and variables.
+    std::size_t segmentCount() const { return _segments.size(); }
 
 private:
+    PreProcessedFile(std::string filename, std::size_t size,
+                     std::vector<std::pair<SegmentType, std::string>> segments)
+        : _filename(std::move(filename))
+        , _size(size)
+        , _segments(std::move(segments))
+    {
+    }
+
     const std::string _filename; ///< Filename on disk, with extension.
     const std::size_t _size; ///< Number of bytes in original file.
     /// The segments of the file in <IsVariable, Data> pairs.
@@ -82,6 +103,61 @@ inline std::ostream& operator<<(std::ostream& os, const PreProcessedFile::Segmen
 class FileServerRequestHandler
 {
 public:
+    /// The content-codings we serve static files with, in increasing order of preference.
+    enum class ContentEncoding : std::uint8_t
+    {
+        Identity,
+        Gzip,
+        Zstd,
+        Brotli
+    };
+
+    static constexpr std::size_t NumContentEncodings = 4;
+
+    /// Returns the Content-Encoding header value for the given coding.
+    static std::string_view contentEncodingName(ContentEncoding encoding);
+
+    /// Picks the coding to serve given the client's Accept-Encoding header value
+    /// and the codings we have available (indexed by ContentEncoding).
+    /// Honours the client's q-values and breaks ties with our own preference.
+    /// Falls back to Identity when nothing else is acceptable.
+    static ContentEncoding
+    negotiateContentEncoding(std::string_view acceptEncoding,
+                             const std::array<bool, NumContentEncodings>& available);
+
+    /// Returns the strong ETag of a file representation, from its content hash.
+    static std::string makeETag(std::string_view hash, ContentEncoding encoding);
+
+    /// Returns true iff the If-None-Match header value matches the given ETag.
+    /// Uses the weak comparison, as required for If-None-Match.
+    static bool etagMatches(std::string_view ifNoneMatch, std::string_view etag);
+
+    /// Returns true iff the client's cached copy, as described by the If-None-Match
+    /// and If-Modified-Since header values (either may be empty), is still current.
+    /// If-Modified-Since is ignored when If-None-Match is given.
+    static bool isNotModified(std::string_view ifNoneMatch, std::string_view ifModifiedSince,
+                              std::string_view etag,
+                              std::chrono::system_clock::time_point lastModified);
+
+    /// Returns true iff a Range request should be honoured, given the If-Range
+    /// header value (possibly empty), which must be the current strong ETag or
+    /// the exact Last-Modified date.
+    static bool isRangeApplicable(std::string_view ifRange, std::string_view etag,
+                                  std::string_view lastModifiedTime);
+
+    /// The outcome of parsing a Range header.
+    enum class RangeStatus : std::uint8_t
+    {
+        Ignore, ///< Invalid or unsupported (e.g. multiple ranges); serve the whole file.
+        Partial, ///< Serve the given range.
+        Unsatisfiable ///< No byte of the range is within the file.
+    };
+
+    /// Parses a single byte-range Range header value for a file of the given size.
+    /// On RangeStatus::Partial, sets the offset and length of the range to serve.
+    static RangeStatus parseByteRange(std::string_view range, std::size_t size,
+                                      std::size_t& offset, std::size_t& length);
+
     /// The WOPI URL and authentication details,
     /// as extracted from the lool.html file-serving request.
     class ResourceAccessDetails
@@ -162,6 +238,11 @@ private:
                                     const std::string& theme,
                                     const Poco::Util::AbstractConfiguration& config);
 
+    /// Sets the BRANDING_CSS, BRANDING_JS and USE_INTEGRATION_THEME variables.
+    static void getThemeVariables(std::unordered_map<std::string, std::string>& vars,
+                                  const std::string& responseRoot, const std::string& theme,
+                                  const Poco::Util::AbstractConfiguration& config);
+
     void preprocessIntegratorAdminFile(const Poco::Net::HTTPRequest& request,
                                        http::Response& httpResponse,
                                        const RequestDetails& requestDetails,
@@ -201,9 +282,12 @@ public:
 
     void readDirToHash(const std::string &basePath, const std::string &path, const std::string &prefix = std::string());
 
-    const std::string *getCompressedFile(const std::string &path);
+    /// Returns the gzip-compressed contents of the file, or the uncompressed
+    /// contents when no compressed version is available (yet).
+    std::string_view getCompressedFile(const std::string &path) const;
 
-    const std::string *getUncompressedFile(const std::string &path);
+    /// Returns the contents of the file, or an empty view if it isn't cached.
+    std::string_view getUncompressedFile(const std::string &path) const;
 
     /// If configured and necessary, sets the HSTS headers.
     static void hstsHeaders([[maybe_unused]] http::Response& response)
@@ -227,7 +311,52 @@ public:
     void dumpState(std::ostream& os);
 
 private:
-    std::map<std::string, std::pair<std::string, std::string>> FileHash;
+    /// A static file we serve. The contents are mapped or read from disk, or
+    /// compressed in memory, and sent without copying into the socket buffer.
+    struct CachedFile
+    {
+        /// The contents in each coding, indexed by ContentEncoding.
+        /// Null when not available (or not compressed yet).
+        std::array<std::shared_ptr<const FileUtil::MappedFile>, NumContentEncodings> _variants;
+
+        /// The hash of the uncompressed contents, for ETags. Empty until hashed.
+        std::string _hash;
+
+        /// The modified time of the file on disk.
+        std::chrono::system_clock::time_point _lastModified;
+    };
+
+    /// Returns the contents of the file in the given coding, if we have it.
+    std::shared_ptr<const FileUtil::MappedFile> getVariant(const std::string& path,
+                                                           ContentEncoding encoding) const;
+
+    /// Returns the uncompressed contents of a file only shipped pre-compressed,
+    /// decompressing and keeping them on first use. Null without brotli support.
+    std::shared_ptr<const FileUtil::MappedFile> getDecompressedVariant(const std::string& path);
+
+    /// Returns the template of the given file with the given variables bound.
+    /// These should only take a few distinct values, since the compiled
+    /// templates and each of their variants are cached.
+    std::shared_ptr<const PreProcessedFile>
+    getTemplateVariant(const std::string& relPath,
+                       const std::unordered_map<std::string, std::string>& variantVars);
+
+    /// Hashes all cached files and generates their missing compressed variants.
+    /// Runs in the background, so it doesn't delay serving.
+    void compressFiles();
+
+    /// The entries are only added in the constructor; the hashes and variants
+    /// are then filled in by the compression thread, or on demand, under _variantsMutex.
+    std::map<std::string, CachedFile> FileHash;
+    mutable std::mutex _variantsMutex;
+    std::thread _compressionThread;
+    std::atomic<bool> _stopCompression;
+
+    /// The compiled templates of the preprocessed files, by path.
+    std::unordered_map<std::string, std::shared_ptr<const PreProcessedFile>> _templates;
+    /// The templates with the variant variables bound, by path and variant key.
+    std::unordered_map<std::string, std::shared_ptr<const PreProcessedFile>> _templateVariants;
+    std::mutex _templatesMutex;
     static void sendError(http::StatusCode errorCode, const std::string& requestPath,
                           const std::shared_ptr<StreamSocket>& socket,
                           const std::string& shortMessage, const std::string& longMessage,
@@ -14,6 +14,10 @@
 
 #include <JsonUtil.hpp>
 
+#include <Poco/DateTime.h>
+#include <Poco/DateTimeFormat.h>
+#include <Poco/DateTimeParser.h>
+
 #include <cctype>
 
 #include <common/base64.hpp>
@@ -138,7 +142,7 @@ PreProcessedFile::PreProcessedFile(std::string filename, const std::string& data
     }
 }
 
-std::string PreProcessedFile::substitute(const std::unordered_map<std::string, std::string>& values)
+std::string PreProcessedFile::substitute(const std::unordered_map<std::string, std::string>& values) const
 {
     std::string recon;
     recon.reserve(_size * 2);
@@ -182,6 +186,307 @@ std::string PreProcessedFile::substitute(const std::unordered_map<std::string, s
     return recon;
 }
 
+PreProcessedFile
+PreProcessedFile::bind(const std::unordered_map<std::string, std::string>& values) const
+{
+    std::vector<std::pair<SegmentType, std::string>> segments;
+    segments.reserve(_segments.size());
+    std::size_t size = 0;
+    for (const auto& seg : _segments)
+    {
+        std::string_view data = seg.second;
+        if (seg.first != SegmentType::Data)
+        {
+            const auto it = values.find(seg.second);
+            if (it == values.end())
+            {
+                // Left for later.
+                segments.push_back(seg);
+                continue;
+            }
+
+            data = it->second;
+        }
+
+        size += data.size();
+        if (!segments.empty() && segments.back().first == SegmentType::Data)
+            segments.back().second.append(data);
+        else
+            segments.emplace_back(SegmentType::Data, std::string(data));
+    }
+
+    return PreProcessedFile(_filename, size, std::move(segments));
+}
+
+std::string_view FileServerRequestHandler::contentEncodingName(const ContentEncoding encoding)
+{
+    switch (encoding)
+    {
+        case ContentEncoding::Identity:
+            return "identity";
+        case ContentEncoding::Gzip:
+            return "gzip";
+        case ContentEncoding::Zstd:
+            return "zstd";
+        case ContentEncoding::Brotli:
+            return "br";
+    }
+
+    return "identity";
+}
+
+namespace
+{
+/// Parses the weight of an Accept-Encoding entry (e.g. "q=0.5") in thousandths.
+/// Returns 1000 when missing and 0 when invalid.
+int parseQValue(std::string_view params)
+{
+    int qvalue = 1000;
+    StringVector::tokenize_foreach(
+        [&qvalue](std::size_t, std::string_view param)
+        {
+            while (!param.empty() && param.front() == ' ')
+                param.remove_prefix(1);
+
+            if (param.size() < 3 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=')
+                return false;
+
+            // qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] )
+            param.remove_prefix(2);
+            qvalue = 0;
+            int scale = 1000;
+            for (std::size_t i = 0; i < param.size() && param[i] != ' '; ++i)
+            {
+                if (param[i] == '.' && i == 1)
+                    continue;
+
+                if (!std::isdigit(param[i]) || scale == 0)
+                {
+                    qvalue = 0;
+                    break;
+                }
+
+                qvalue += (param[i] - '0') * scale;
+                scale /= 10;
+            }
+
+            qvalue = std::min(qvalue, 1000);
+            return true;
+        },
+        params.data(), params.size(), ';');
+
+    return qvalue;
+}
+} // namespace
+
+FileServerRequestHandler::ContentEncoding FileServerRequestHandler::negotiateContentEncoding(
+    const std::string_view acceptEncoding, const std::array<bool, NumContentEncodings>& available)
+{
+    // The client's weight of each coding, in thousandths; -1 when not listed.
+    std::array<int, NumContentEncodings> qvalues;
+    qvalues.fill(-1);
+    int wildcard = -1;
+
+    StringVector::tokenize_foreach(
+        [&](std::size_t, std::string_view entry)
+        {
+            const std::size_t semicolon = entry.find(';');
+            std::string_view coding = entry.substr(0, semicolon);
+            while (!coding.empty() && coding.front() == ' ')
+                coding.remove_prefix(1);
+            while (!coding.empty() && coding.back() == ' ')
+                coding.remove_suffix(1);
+
+            const int qvalue = semicolon == std::string_view::npos
+                                   ? 1000
+                                   : parseQValue(entry.substr(semicolon + 1));
+
+            if (coding == "*")
+                wildcard = qvalue;
+            else if (Util::iequal(coding, "identity"))
+                qvalues[static_cast<std::size_t>(ContentEncoding::Identity)] = qvalue;
+            else if (Util::iequal(coding, "gzip") || Util::iequal(coding, "x-gzip"))
+                qvalues[static_cast<std::size_t>(ContentEncoding::Gzip)] = qvalue;
+            else if (Util::iequal(coding, "zstd"))
+                qvalues[static_cast<std::size_t>(ContentEncoding::Zstd)] = qvalue;
+            else if (Util::iequal(coding, "br"))
+                qvalues[static_cast<std::size_t>(ContentEncoding::Brotli)] = qvalue;
+
+            return false;
+        },
+        acceptEncoding.data(), acceptEncoding.size(), ',');
+
+    // Unlisted codings get the wildcard's weight, except identity,
+    // which is acceptable unless explicitly refused.
+    for (std::size_t i = 0; i < NumContentEncodings; ++i)
+    {
+        if (qvalues[i] < 0)
+            qvalues[i] = (wildcard >= 0 ? wildcard : (i == 0 ? 1 : 0));
+    }
+
+    // The highest weight wins; ties go to the later, i.e. more preferred, coding.
+    ContentEncoding best = ContentEncoding::Identity;
+    int bestQValue = 0;
+    for (std::size_t i = 0; i < NumContentEncodings; ++i)
+    {
+        if (available[i] && qvalues[i] > 0 && qvalues[i] >= bestQValue)
+        {
+            best = static_cast<ContentEncoding>(i);
+            bestQValue = qvalues[i];
+        }
+    }
+
+    return best;
+}
+
+std::string FileServerRequestHandler::makeETag(const std::string_view hash,
+                                               const ContentEncoding encoding)
+{
+    // Each representation needs its own strong validator.
+    std::string etag;
+    etag.reserve(hash.size() + 8);
+    etag += '"';
+    etag += hash;
+    if (encoding != ContentEncoding::Identity)
+    {
+        etag += '-';
+        etag += contentEncodingName(encoding);
+    }
+
+    etag += '"';
+    return etag;
+}
+
+bool FileServerRequestHandler::etagMatches(const std::string_view ifNoneMatch,
+                                           std::string_view etag)
+{
+    // Weak comparison: ignore the weakness indicator on either side.
+    if (etag.starts_with("W/"))
+        etag.remove_prefix(2);
+
+    bool match = false;
+    StringVector::tokenize_foreach(
+        [&match, etag](std::size_t, std::string_view candidate)
+        {
+            while (!candidate.empty() && candidate.front() == ' ')
+                candidate.remove_prefix(1);
+            while (!candidate.empty() && candidate.back() == ' ')
+                candidate.remove_suffix(1);
+
+            if (candidate.starts_with("W/"))
+                candidate.remove_prefix(2);
+
+            match = (candidate == "*" || candidate == etag);
+            return match;
+        },
+        ifNoneMatch.data(), ifNoneMatch.size(), ',');
+
+    return match;
+}
+
+bool FileServerRequestHandler::isNotModified(const std::string_view ifNoneMatch,
+                                             const std::string_view ifModifiedSince,
+                                             const std::string_view etag,
+                                             const std::chrono::system_clock::time_point lastModified)
+{
+    if (!ifNoneMatch.empty())
+        return etagMatches(ifNoneMatch, etag);
+
+    if (ifModifiedSince.empty())
+        return false;
+
+    Poco::DateTime since;
+    int tzd = 0;
+    if (!Poco::DateTimeParser::tryParse(Poco::DateTimeFormat::HTTP_FORMAT,
+                                        std::string(ifModifiedSince), since, tzd))
+        return false;
+
+    // HTTP dates have a resolution of seconds.
+    const std::time_t modified = std::chrono::system_clock::to_time_t(lastModified);
+    return modified <= since.timestamp().epochTime() - tzd;
+}
+
+bool FileServerRequestHandler::isRangeApplicable(const std::string_view ifRange,
+                                                 const std::string_view etag,
+                                                 const std::string_view lastModifiedTime)
+{
+    if (ifRange.empty())
+        return true;
+
+    // Entity tags are compared strongly here; a weak one never matches.
+    if (ifRange.front() == '"' || ifRange.starts_with("W/"))
+        return ifRange == etag && !etag.starts_with("W/");
+
+    return ifRange == lastModifiedTime;
+}
+
+FileServerRequestHandler::RangeStatus
+FileServerRequestHandler::parseByteRange(std::string_view range, const std::size_t size,
+                                         std::size_t& offset, std::size_t& length)
+{
+    // We only support a single range: bytes=first-[last] or bytes=-suffix.
+    constexpr std::string_view Prefix = "bytes=";
+    if (!range.starts_with(Prefix) || range.find(',') != std::string_view::npos)
+        return RangeStatus::Ignore;
+
+    range.remove_prefix(Prefix.size());
+    const std::size_t dash = range.find('-');
+    if (dash == std::string_view::npos)
+        return RangeStatus::Ignore;
+
+    const auto parseNumber = [](std::string_view digits, std::size_t& number)
+    {
+        number = 0;
+        if (digits.empty() || digits.size() > 18) // Don't overflow.
+            return false;
+
+        for (const char c : digits)
+        {
+            if (c < '0' || c > '9')
+                return false;
+
+            number = number * 10 + (c - '0');
+        }
+
+        return true;
+    };
+
+    std::size_t first = 0;
+    std::size_t last = 0;
+    if (dash == 0)
+    {
+        // Suffix range: the last N bytes.
+        std::size_t suffix = 0;
+        if (!parseNumber(range.substr(1), suffix))
+            return RangeStatus::Ignore;
+
+        if (suffix == 0 || size == 0)
+            return RangeStatus::Unsatisfiable;
+
+        first = size - std::min(suffix, size);
+        last = size - 1;
+    }
+    else
+    {
+        if (!parseNumber(range.substr(0, dash), first))
+            return RangeStatus::Ignore;
+
+        if (dash + 1 == range.size())
+            last = size - 1; // Open-ended.
+        else if (!parseNumber(range.substr(dash + 1), last) || last < first)
+            return RangeStatus::Ignore;
+
+        if (first >= size)
+            return RangeStatus::Unsatisfiable;
+
+        last = std::min(last, size - 1);
+    }
+
+    offset = first;
+    length = last - first + 1;
+    return RangeStatus::Partial;
+}
+
 std::string FileServerRequestHandler::uiDefaultsToJSON(const std::string& uiDefaults, std::string& uiMode, std::string& uiTheme, std::string& savedUIState)
 {
     static std::string previousUIDefaults;
@@ -0,0 +1,96 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <common/Rectangle.hpp>
+#include <wsd/TileDesc.hpp>
+
+/// Follows a keystroke of a client from its key message, through the first
+/// invalidation of the visible area that comes back from the kit, to the
+/// first tile over that area sent back to the client: the latency the user sees.
+/// The kit handles the messages of a view in order, so the session's own
+/// messages are enough to correlate them, without tagging them in the protocol.
+/// One keystroke is followed at a time; those typed meanwhile show up with its tiles.
+/// Not thread-safe; owned by the ClientSession.
+class KeystrokeLatency
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /// A keystroke whose tile doesn't come in this long is given up on:
+    /// it likely changed nothing visible, as in a protected cell.
+    static constexpr std::chrono::seconds Timeout = std::chrono::seconds(5);
+
+    KeystrokeLatency()
+        : _id(0)
+        , _part(0)
+        , _following(false)
+        , _invalidated(false)
+    {
+    }
+
+    /// A key was typed. Returns true when it is the one followed from now on.
+    bool keyTyped(TimePoint now = std::chrono::steady_clock::now())
+    {
+        if (_following && now - _typed < Timeout)
+            return false;
+
+        ++_id;
+        _following = true;
+        _invalidated = false;
+        _typed = now;
+        return true;
+    }
+
+    /// The visible area within bounds of part was invalidated. Returns true, with
+    /// the time since the keystroke, when it is the first invalidation since.
+    bool invalidated(int part, const Util::Rectangle& bounds, std::chrono::microseconds& latency,
+                     TimePoint now = std::chrono::steady_clock::now())
+    {
+        if (!_following || _invalidated)
+            return false;
+
+        _invalidated = true;
+        _part = part;
+        _bounds = bounds;
+        latency = std::chrono::duration_cast<std::chrono::microseconds>(now - _typed);
+        return true;
+    }
+
+    /// A tile is sent to the client. Returns true, with the time since the keystroke,
+    /// when it is the first over the invalidated area; the keystroke is then done.
+    bool tileSent(const TileDesc& tile, std::chrono::microseconds& latency,
+                  TimePoint now = std::chrono::steady_clock::now())
+    {
+        if (!_following || !_invalidated || tile.getPart() != _part || !tile.intersects(_bounds))
+            return false;
+
+        _following = false;
+        latency = std::chrono::duration_cast<std::chrono::microseconds>(now - _typed);
+        return true;
+    }
+
+    /// The correlation id of the keystroke followed, for the logs and trace events.
+    std::uint64_t getId() const { return _id; }
+
+    /// When the keystroke followed was typed.
+    TimePoint getTyped() const { return _typed; }
+
+private:
+    std::uint64_t _id;
+    TimePoint _typed;
+    int _part;
+    Util::Rectangle _bounds;
+    bool _following;
+    bool _invalidated;
+};
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
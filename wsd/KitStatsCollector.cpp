@@ -0,0 +1,218 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <config.h>
+
+#include "KitStatsCollector.hpp"
+
+#include <common/Log.hpp>
+#include <common/Util.hpp>
+
+#include <cassert>
+#include <cerrno>
+#include <string_view>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+void KitStatsCollector::startThread()
+{
+    assert(!_thread);
+    _exit = false;
+    _thread.reset(new std::thread(&KitStatsCollector::collectingThread, this));
+}
+
+void KitStatsCollector::joinThread()
+{
+    if (_thread)
+    {
+        _exit = true;
+        _condition.notify_all();
+        _thread->join();
+        _thread.reset();
+    }
+
+    for (const auto& pair : _kits)
+        closeFiles(pair.second);
+    _kits.clear();
+}
+
+void KitStatsCollector::setSMaps(std::map<pid_t, std::weak_ptr<FILE>> smaps)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _newSMaps = std::move(smaps);
+    _haveNewSMaps = true;
+}
+
+void KitStatsCollector::setKitPids(std::set<pid_t> pids)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _newKitPids = std::move(pids);
+    _haveNewKitPids = true;
+}
+
+void KitStatsCollector::collectingThread()
+{
+    Util::setThreadName("kitstats");
+
+    std::unique_lock<std::mutex> guard(_lock);
+    while (!_exit)
+    {
+        if (_haveNewSMaps)
+        {
+            _smaps = std::move(_newSMaps);
+            _newSMaps.clear();
+            _haveNewSMaps = false;
+        }
+
+        if (_haveNewKitPids)
+        {
+            _kitPids = std::move(_newKitPids);
+            _newKitPids.clear();
+            _haveNewKitPids = false;
+        }
+
+        guard.unlock();
+        collect();
+        guard.lock();
+
+        _condition.wait_for(guard, std::chrono::milliseconds(_intervalMs.load()));
+    }
+}
+
+void KitStatsCollector::collect()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    discoverKits();
+
+    // smaps is much costlier than stat, don't read it on every tick.
+    const std::shared_ptr<const Snapshot> previous = getSnapshot();
+    const bool readSMaps = !previous || start - _lastSMapsRead >= SMapsInterval;
+    if (readSMaps)
+        _lastSMapsRead = start;
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->_time = start;
+    snapshot->_kits.reserve(_kits.size());
+
+    for (auto it = _kits.begin(); it != _kits.end();)
+    {
+        bool isKit = false;
+        KitStats stats;
+        Util::ProcStat procStat;
+        if (!readComm(it->second._commFd, isKit, stats._assigned) || !isKit ||
+            !Util::getProcStat(it->second._statFd, procStat))
+        {
+            // Gone. Holding the fds, we can't mistake a recycled pid for it.
+            closeFiles(it->second);
+            it = _kits.erase(it);
+            continue;
+        }
+
+        stats._threadCount = procStat._threadCount;
+        stats._jiffies = procStat._jiffies;
+
+        const auto smapsIt = _smaps.find(it->first);
+        if (!readSMaps)
+        {
+            const auto previousIt = previous->_kits.find(it->first);
+            if (previousIt != previous->_kits.end() && smapsIt != _smaps.end())
+            {
+                stats._hasMemory = previousIt->second._hasMemory;
+                stats._pssKb = previousIt->second._pssKb;
+                stats._dirtyKb = previousIt->second._dirtyKb;
+            }
+        }
+        else if (smapsIt != _smaps.end())
+        {
+            if (std::shared_ptr<FILE> smaps = smapsIt->second.lock())
+            {
+                const std::pair<std::size_t, std::size_t> pssAndDirty =
+                    Util::getPssAndDirtyFromSMaps(smaps.get());
+                stats._hasMemory = true;
+                stats._pssKb = pssAndDirty.first;
+                stats._dirtyKb = pssAndDirty.second;
+            }
+        }
+
+        if (stats._assigned)
+            ++snapshot->_assignedCount;
+        else
+            ++snapshot->_unassignedCount;
+
+        snapshot->_kits.emplace(it->first, stats);
+        ++it;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_snapshotLock);
+        _snapshot = std::move(snapshot);
+    }
+
+    LOG_TRC("Collected the stats of "
+            << _kits.size() << " kits in "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count()
+            << "us.");
+}
+
+void KitStatsCollector::discoverKits()
+{
+    char path[64];
+    for (const pid_t pid : _kitPids)
+    {
+        if (_kits.find(pid) != _kits.end())
+            continue;
+
+        // A fresh fork is named kit_spare_ only after a moment; try again next tick.
+        snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+        const int commFd = open(path, O_RDONLY | O_CLOEXEC);
+        if (commFd < 0)
+            continue;
+
+        bool isKit = false;
+        bool assigned = false;
+        if (readComm(commFd, isKit, assigned) && isKit)
+        {
+            snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+            const int statFd = open(path, O_RDONLY | O_CLOEXEC);
+            if (statFd >= 0)
+            {
+                _kits.emplace(pid, ProcFiles{ commFd, statFd });
+                continue;
+            }
+        }
+
+        close(commFd);
+    }
+}
+
+bool KitStatsCollector::readComm(int fd, bool& isKit, bool& assigned)
+{
+    char comm[64];
+    ssize_t len;
+    while ((len = pread(fd, comm, sizeof(comm), 0)) < 0 && errno == EINTR)
+        ;
+
+    if (len <= 0)
+        return false;
+
+    const std::string_view name(comm, len);
+    assigned = name.starts_with("kitbroker_");
+    isKit = assigned || name.starts_with("kit_spare_");
+    return true;
+}
+
+void KitStatsCollector::closeFiles(const ProcFiles& files)
+{
+    close(files._commFd);
+    close(files._statFd);
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,128 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+/// Collects the /proc stats of all the kit processes on a thread of its
+/// own, so that hundreds of kits don't stall the Admin poll.
+/// The /proc files of each kit are opened once and re-read with pread(2)
+/// every tick; the results of a tick are published as an immutable
+/// snapshot, under a lock held only to swap it, so readers never wait on a tick.
+class KitStatsCollector
+{
+public:
+    struct KitStats
+    {
+        /// kitbroker_ (has a document) vs. kit_spare_.
+        bool _assigned = false;
+        std::size_t _threadCount = 0;
+        /// utime + stime, in clock ticks.
+        std::size_t _jiffies = 0;
+        /// From smaps, only for kits whose fd we were given.
+        bool _hasMemory = false;
+        std::size_t _pssKb = 0;
+        std::size_t _dirtyKb = 0;
+    };
+
+    struct Snapshot
+    {
+        std::chrono::steady_clock::time_point _time;
+        std::unordered_map<pid_t, KitStats> _kits;
+        int _assignedCount = 0;
+        int _unassignedCount = 0;
+    };
+
+    KitStatsCollector()
+        : _intervalMs(DefaultIntervalMs)
+        , _exit(false)
+        , _haveNewSMaps(false)
+        , _haveNewKitPids(false)
+    {
+    }
+
+    ~KitStatsCollector() { joinThread(); }
+
+    void startThread();
+    void joinThread();
+
+    void setInterval(int intervalMs)
+    {
+        _intervalMs = intervalMs;
+        _condition.notify_all();
+    }
+
+    /// Sets the smaps files of the kits, which the kits opened for us.
+    void setSMaps(std::map<pid_t, std::weak_ptr<FILE>> smaps);
+
+    /// Sets the pids of the kits that we spawned, spare or not.
+    void setKitPids(std::set<pid_t> pids);
+
+    /// The stats of the last tick, or null before the first one.
+    std::shared_ptr<const Snapshot> getSnapshot() const
+    {
+        std::lock_guard<std::mutex> guard(_snapshotLock);
+        return _snapshot;
+    }
+
+    /// Collects once, on the calling thread.
+    void collect();
+
+private:
+    static constexpr int DefaultIntervalMs = 1000;
+    static constexpr std::chrono::seconds SMapsInterval = std::chrono::seconds(5);
+
+    /// The fds of /proc/<pid>/comm and /proc/<pid>/stat of a kit.
+    struct ProcFiles
+    {
+        int _commFd;
+        int _statFd;
+    };
+
+    void collectingThread();
+
+    /// Opens the /proc files of the kits that we don't track yet.
+    void discoverKits();
+
+    /// Reads the process name; false when the process is gone.
+    static bool readComm(int fd, bool& isKit, bool& assigned);
+
+    static void closeFiles(const ProcFiles& files);
+
+    /// Only touched on the collecting thread.
+    std::map<pid_t, ProcFiles> _kits;
+    std::map<pid_t, std::weak_ptr<FILE>> _smaps;
+    std::set<pid_t> _kitPids;
+    std::chrono::steady_clock::time_point _lastSMapsRead;
+
+    mutable std::mutex _snapshotLock;
+    std::shared_ptr<const Snapshot> _snapshot;
+
+    std::atomic<int> _intervalMs;
+    std::atomic<bool> _exit;
+    std::unique_ptr<std::thread> _thread;
+    std::mutex _lock;
+    std::condition_variable _condition;
+    std::map<pid_t, std::weak_ptr<FILE>> _newSMaps;
+    bool _haveNewSMaps;
+    std::set<pid_t> _newKitPids;
+    bool _haveNewKitPids;
+};
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -86,6 +86,7 @@
 #include <Crypto.hpp>
 #include <DelaySocket.hpp>
 #include <wsd/DocumentBroker.hpp>
+#include <wsd/PrespawnPolicy.hpp>
 #include <wsd/Process.hpp>
 #include <common/JsonUtil.hpp>
 #include <common/FileUtil.hpp>
@@ -143,6 +144,8 @@ std::vector<std::shared_ptr<ChildProcess>> NewChildren;
 std::atomic<int> TotalOutstandingForks(0);
 std::map<std::string, int> OutstandingForks;
 std::map<std::string, std::chrono::steady_clock::time_point> LastForkRequestTimes;
+/// Decides the number of spare children per configId. Guarded by NewChildrenMutex.
+PrespawnPolicy SpawnPolicy;
 typedef std::map<std::string, std::shared_ptr<ForKitProcess>> SubForKitMap;
 SubForKitMap SubForKitProcs;
 std::map<std::string, std::chrono::steady_clock::time_point> LastSubForKitBrokerExitTimes;
@@ -421,6 +424,7 @@ SubForKitMap::iterator dropSubForKit(SubForKitMap::iterator it)
 
     LastSubForKitBrokerExitTimes.erase(configId);
     OutstandingForks.erase(configId);
+    SpawnPolicy.forget(configId);
     it = SubForKitProcs.erase(it);
     UnitWSD::get().killSubForKit(configId);
 
@@ -593,6 +597,23 @@ static bool cleanupChildren()
     return static_cast<int>(NewChildren.size()) != count;
 }
 
+/// The local hour of the day, to follow the daily load pattern.
+static unsigned getHourOfDay()
+{
+    const std::time_t t = std::time(nullptr);
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    return tm.tm_hour;
+}
+
+/// The number of spare children to keep for the given configId.
+static int getPrespawnTarget(const std::string& configId)
+{
+    Util::assertIsLocked(NewChildrenMutex);
+
+    return SpawnPolicy.getTarget(configId, std::chrono::steady_clock::now(), getHourOfDay());
+}
+
 /// Decides how many children need spawning and spawns.
 static void rebalanceChildren(const std::string& configId, int64_t balance)
 {
@@ -644,7 +665,7 @@ static void prespawnChildren()
     std::unique_lock<std::mutex> lock(NewChildrenMutex, std::defer_lock);
     if (lock.try_lock())
     {
-        rebalanceChildren("", LOOLWSD::NumPreSpawnedChildren);
+        rebalanceChildren("", getPrespawnTarget(""));
     }
 }
 
@@ -660,9 +681,25 @@ static size_t addNewChild(std::shared_ptr<ChildProcess> child)
     assert(child && "Adding null child");
     const auto pid = child->getPid();
     const std::string& configId = child->getConfigId();
+#if !MOBILEAPP
+    // The footprint of an unused kit, to bound the pool by memory.
+    const std::size_t pssKb = Util::getMemoryUsagePSS(pid);
+#endif
 
     std::unique_lock<std::mutex> lock(NewChildrenMutex);
 
+#if !MOBILEAPP
+    if (OutstandingForks[configId] > 0)
+    {
+        SpawnPolicy.recordSpawnLatency(configId,
+                                       std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::steady_clock::now() -
+                                           LastForkRequestTimes[configId]));
+    }
+
+    SpawnPolicy.recordSpareMemory(pssKb);
+#endif
+
     --TotalOutstandingForks;
     --OutstandingForks[configId];
     // Prevent from going -ve if we have unexpected children.
@@ -928,9 +965,14 @@ std::shared_ptr<ChildProcess> getNewChild_Blocks(const std::shared_ptr<SocketPol
 
     std::chrono::milliseconds spawnTimeoutMs = ChildSpawnTimeoutMs.load() / 2;
 
+    const bool hit = std::any_of(NewChildren.begin(), NewChildren.end(),
+                                 [&configId](const auto& candidate)
+                                 { return candidate->getConfigId() == configId; });
+    SpawnPolicy.recordDemand(configId, hit, startTime, getHourOfDay());
+
     if (configId.empty() || SubForKitProcs.contains(configId))
     {
-        int numPreSpawn = LOOLWSD::NumPreSpawnedChildren;
+        int numPreSpawn = getPrespawnTarget(configId);
         ++numPreSpawn; // Replace the one we'll dispatch just now.
         LOG_DBG("getNewChild: Rebalancing children of config[" << configId << "] to " << numPreSpawn);
         rebalanceChildren(configId, numPreSpawn);
@@ -1901,9 +1943,37 @@ void LOOLWSD::innerInitialize(Poco::Util::Application& self)
     }
     LOG_INF("NumPreSpawnedChildren set to " << NumPreSpawnedChildren << '.');
 
+    // Grow the pool beyond num_prespawn_children by predicting the document-load demand.
+    unsigned maxPreSpawnedChildren = NumPreSpawnedChildren;
+    std::size_t maxPreSpawnMemoryKb = 0;
+    if (ConfigUtil::getConfigValue<bool>(conf, "adaptive_prespawn.enable", false))
+    {
+        maxPreSpawnedChildren =
+            ConfigUtil::getConfigValue<int>(conf, "adaptive_prespawn.max_children", 4);
+        maxPreSpawnMemoryKb =
+            ConfigUtil::getConfigValue<int>(conf, "adaptive_prespawn.max_memory_mb", 1024) * 1024;
+#if ENABLE_DEBUG
+        if (SingleKit)
+            maxPreSpawnedChildren = NumPreSpawnedChildren;
+#endif
+    }
+
+    SpawnPolicy.configure(NumPreSpawnedChildren, maxPreSpawnedChildren, maxPreSpawnMemoryKb);
+    LOG_INF("Prespawning between " << SpawnPolicy.getMinChildren() << " and "
+                                   << SpawnPolicy.getMaxChildren() << " children.");
+
     FileUtil::registerFileSystemForDiskSpaceChecks(ChildRoot);
 
     int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+
+    // In a container, we may be given only a share of the CPUs we see.
+    const unsigned cpuLimit = Util::getCGroupCpuLimit();
+    if (cpuLimit > 0 && static_cast<int>(cpuLimit) < threads)
+    {
+        LOG_INF("The cgroup CPU quota allows " << cpuLimit << " of the " << threads << " CPUs.");
+        threads = cpuLimit;
+    }
+
     int maxConcurrency = ConfigUtil::getConfigValue<int>(conf, "per_document.max_concurrency", 4);
 
     if (maxConcurrency > 16)
@@ -1914,8 +1984,8 @@ void LOOLWSD::innerInitialize(Poco::Util::Application& self)
     }
     if (maxConcurrency > threads)
     {
-        LOG_ERR("Setting concurrency above the number of physical "
-                "threads yields extra latency and memory usage for no benefit. "
+        LOG_ERR("Setting concurrency above the number of available "
+                "CPU threads yields extra latency and memory usage for no benefit. "
                 "Clamping " << maxConcurrency << " to " << threads << " threads.");
         maxConcurrency = threads;
     }
@@ -2622,6 +2692,19 @@ void LOOLWSD::closeDocument(const std::string& docKey, const std::string& messag
     }
 }
 
+#if !MOBILEAPP
+void LOOLWSD::hibernateDocument(const std::string& docKey)
+{
+    std::unique_lock<std::mutex> docBrokersLock(DocBrokersMutex);
+    auto docBrokerIt = DocBrokers.find(docKey);
+    if (docBrokerIt != DocBrokers.end())
+    {
+        std::shared_ptr<DocumentBroker> docBroker = docBrokerIt->second;
+        docBroker->addCallback([docBroker]() { docBroker->hibernate(); });
+    }
+}
+#endif
+
 void LOOLWSD::autoSave(const std::string& docKey)
 {
     std::unique_lock<std::mutex> docBrokersLock(DocBrokersMutex);
@@ -2829,7 +2912,7 @@ bool LOOLWSD::createForKit()
     // Init the Admin manager
     Admin::instance().setForKitPid(ForKitProcId);
 
-    const int balance = LOOLWSD::NumPreSpawnedChildren - OutstandingForks[defaultConfigId];
+    const int balance = getPrespawnTarget(defaultConfigId) - OutstandingForks[defaultConfigId];
     if (balance > 0)
         rebalanceChildren(defaultConfigId, balance);
 
@@ -2939,7 +3022,7 @@ private:
             else
                 LOG_WRN("Unknown Kit process closed with pid " << (child ? child->getPid() : -1));
 #if !MOBILEAPP
-            rebalanceChildren(configId, LOOLWSD::NumPreSpawnedChildren);
+            rebalanceChildren(configId, getPrespawnTarget(configId));
 #endif
         }
     }
@@ -3036,7 +3119,7 @@ private:
                     socket->getInBuffer().clear();
                     // created subforkit for a reason, create spare early
                     std::unique_lock<std::mutex> lock(NewChildrenMutex);
-                    rebalanceChildren(configId, LOOLWSD::NumPreSpawnedChildren);
+                    rebalanceChildren(configId, getPrespawnTarget(configId));
 
                     UnitWSD::get().newSubForKit(SubForKitProcs[configId], configId);
                 }
@@ -3054,6 +3137,7 @@ private:
             LOG_TRC("New child spawned after " << durationMs << " of requesting");
 
             // New Child is spawned.
+            std::string jailSetup;
             const Poco::URI::QueryParameters params = requestURI.getQueryParameters();
             const int pid = socket->getPid();
             for (const auto& param : params)
@@ -3062,6 +3146,8 @@ private:
                     jailId = param.second;
                 else if (param.first == "configid")
                     configId = param.second;
+                else if (param.first == "jailsetup")
+                    jailSetup = param.second;
                 else if (param.first == "version")
                     LOOLWSD::LOKitVersion = param.second;
                 else if (param.first.size() > 6 &&
@@ -3087,6 +3173,13 @@ private:
             socket->getInBuffer().clear();
 
             LOG_INF("New child [" << pid << "], jailId: " << jailId << ", configId: " << configId);
+
+            const auto setupIt = admsProps.find("info_setup_ms");
+            if (!jailSetup.empty() && setupIt != admsProps.end())
+            {
+                Admin::instance().addJailSetupDuration(
+                    jailSetup, std::chrono::milliseconds(std::atoll(setupIt->second.c_str())));
+            }
 #else
             pid_t pid = 100;
             jailId = "jail";
@@ -3316,6 +3409,7 @@ public:
            << "\n  NewChildren: " << NewChildren.size() << " (" << NewChildren.capacity() << ')'
            << "\n  OutstandingForks: " << TotalOutstandingForks
            << "\n  NumPreSpawnedChildren: " << LOOLWSD::NumPreSpawnedChildren
+           << "\n  PrespawnTarget: " << PrespawnPolicy::getLastTarget()
            << "\n  ChildSpawnTimeoutMs: " << ChildSpawnTimeoutMs.load()
 #if !MOBILEAPP
            << "\n  of which ConvertTo: " << ConvertToBroker::getInstanceCount()
@@ -219,6 +219,11 @@ public:
     /// Close document with @docKey and a @message
     static void closeDocument(const std::string& docKey, const std::string& message);
 
+#if !MOBILEAPP
+    /// Hibernate the document with @docKey, if idle. Called from Admin, and tests.
+    static void hibernateDocument(const std::string& docKey);
+#endif
+
     /// Autosave a given document (currently only called from Admin).
     static void autoSave(const std::string& docKey);
 
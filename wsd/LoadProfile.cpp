@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <config.h>
+
+#include "LoadProfile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <sstream>
+#include <string_view>
+
+void LoadProfile::markReached(Phase phase, std::chrono::steady_clock::time_point now)
+{
+    if (!has(phase))
+        setDuration(phase, std::chrono::duration_cast<std::chrono::milliseconds>(now - _start));
+}
+
+void LoadProfile::setDocument(const std::string& filename, std::size_t sizeBytes)
+{
+    // Keep the cardinality of the metrics in check: any other extension is "other".
+    static constexpr std::array<std::string_view, 30> KnownFormats = {
+        "csv",  "doc",  "docm", "docx", "dot",  "dotx", "fodg", "fodp", "fods", "fodt",
+        "odg",  "odp",  "ods",  "odt",  "otg",  "otp",  "ots",  "ott",  "pdf",  "pot",
+        "potx", "pps",  "ppsx", "ppt",  "pptx", "rtf",  "txt",  "xls",  "xlsm", "xlsx"
+    };
+
+    _sizeBytes = sizeBytes;
+    _format = "other";
+
+    const std::size_t dot = filename.rfind('.');
+    if (dot == std::string::npos)
+        return;
+
+    std::string format = filename.substr(dot + 1);
+    std::transform(format.begin(), format.end(), format.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (std::binary_search(KnownFormats.begin(), KnownFormats.end(), std::string_view(format)))
+        _format = std::move(format);
+}
+
+const char* LoadProfile::getSizeBucket(std::size_t sizeBytes)
+{
+    if (sizeBytes < 100 * 1024)
+        return "100k";
+    if (sizeBytes < 1024 * 1024)
+        return "1m";
+    if (sizeBytes < 10 * 1024 * 1024)
+        return "10m";
+    if (sizeBytes < 100 * 1024 * 1024)
+        return "100m";
+    return "huge";
+}
+
+const char* LoadProfile::name(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::CheckFileInfo:
+            return "checkfileinfo";
+        case Phase::Download:
+            return "download";
+        case Phase::DocumentLoad:
+            return "documentload";
+        case Phase::Loaded:
+            return "loaded";
+        case Phase::StatusIndicatorFinish:
+            return "statusindicatorfinish";
+        case Phase::FirstTile:
+            return "firsttile";
+        case Phase::Count:
+            break;
+    }
+
+    return "unknown";
+}
+
+std::string LoadProfile::toJson() const
+{
+    std::ostringstream oss;
+    oss << "{ \"format\": \"" << _format << "\", \"size\": " << _sizeBytes;
+    for (std::size_t i = 0; i < PhaseCount; ++i)
+    {
+        const Phase phase = static_cast<Phase>(i);
+        if (has(phase))
+            oss << ", \"" << name(phase) << "\": " << getDuration(phase).count();
+    }
+
+    oss << " }";
+    return oss.str();
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <common/Histogram.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Where the time of a document load goes, phase by phase, to be
+/// aggregated per file format and size so that regressions of a
+/// format stand out.
+/// The first phases are durations (the storage calls, and documentLoad
+/// in the kit); the rest are milestones, timed from the creation of
+/// the DocumentBroker, which is where the load starts.
+/// Not thread-safe; owned by the DocumentBroker.
+class LoadProfile
+{
+public:
+    enum class Phase : std::uint8_t
+    {
+        CheckFileInfo, ///< The WOPI CheckFileInfo call.
+        Download, ///< GetFile, or the link/copy into the jail for local storage.
+        DocumentLoad, ///< lok::Office::documentLoad in the kit.
+        Loaded, ///< The first view reported loaded.
+        StatusIndicatorFinish, ///< The first statusindicatorfinish: from Core.
+        FirstTile, ///< The first tile rendered.
+        Count
+    };
+
+    static constexpr std::size_t PhaseCount = static_cast<std::size_t>(Phase::Count);
+
+    /// The upper bounds, in milliseconds, of the buckets of a Histogram.
+    static constexpr std::array<std::uint32_t, 11> BucketBounds = {
+        50, 100, 250, 500, 1000, 2000, 4000, 8000, 15000, 30000, 60000
+    };
+
+    /// A histogram of the durations of a phase.
+    using Histogram = ::Histogram<BucketBounds>;
+
+    LoadProfile(std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now())
+        : _start(start)
+        , _sizeBytes(0)
+        , _reported(false)
+    {
+        _durations.fill(std::chrono::milliseconds(-1));
+    }
+
+    /// Sets the duration of a phase measured elsewhere.
+    void setDuration(Phase phase, std::chrono::milliseconds duration)
+    {
+        _durations[static_cast<std::size_t>(phase)] = duration;
+    }
+
+    /// Marks a milestone as reached now, if not already.
+    void markReached(Phase phase,
+                     std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    bool has(Phase phase) const { return getDuration(phase).count() >= 0; }
+
+    /// The duration of a phase, or negative when unknown.
+    std::chrono::milliseconds getDuration(Phase phase) const
+    {
+        return _durations[static_cast<std::size_t>(phase)];
+    }
+
+    void setDocument(const std::string& filename, std::size_t sizeBytes);
+
+    /// The lowercase extension, or "other" for unusual or missing ones.
+    const std::string& getFormat() const { return _format; }
+
+    /// The size bucket of the document: "100k", "1m", "10m", "100m" or "huge".
+    const char* getSizeBucket() const { return getSizeBucket(_sizeBytes); }
+
+    static const char* getSizeBucket(std::size_t sizeBytes);
+
+    static const char* name(Phase phase);
+
+    /// True once the record is complete: loaded, and rendered.
+    bool isComplete() const { return has(Phase::Loaded) && has(Phase::FirstTile); }
+
+    bool isReported() const { return _reported; }
+    void setReported() { _reported = true; }
+
+    /// The per-load record, as a single-line JSON object.
+    std::string toJson() const;
+
+private:
+    std::chrono::steady_clock::time_point _start;
+    std::array<std::chrono::milliseconds, PhaseCount> _durations;
+    std::string _format;
+    std::size_t _sizeBytes;
+    bool _reported;
+};
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
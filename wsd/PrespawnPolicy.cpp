@@ -0,0 +1,159 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <config.h>
+
+#include "PrespawnPolicy.hpp"
+
+#include <common/Log.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+std::atomic<uint64_t> PrespawnPolicy::HitCount(0);
+std::atomic<uint64_t> PrespawnPolicy::MissCount(0);
+std::atomic<unsigned> PrespawnPolicy::LastTarget(0);
+
+void PrespawnPolicy::configure(unsigned minChildren, unsigned maxChildren,
+                               std::size_t maxMemoryKb)
+{
+    _minChildren = minChildren;
+    _maxChildren = std::max(minChildren, maxChildren);
+    _maxMemoryKb = maxMemoryKb;
+}
+
+void PrespawnPolicy::rollHour(ConfigState& state, unsigned hourOfDay)
+{
+    const int hour = hourOfDay % 24;
+    if (state._hour == hour)
+        return;
+
+    if (state._hour >= 0)
+    {
+        // Fold the finished hour, and any hours skipped without demand.
+        uint64_t count = state._hourCount;
+        for (int h = state._hour; h != hour; h = (h + 1) % 24)
+        {
+            double& bucket = state._hourly[h];
+            bucket = (bucket < 0) ? count : HourlyWeight * count + (1 - HourlyWeight) * bucket;
+            count = 0;
+        }
+    }
+
+    state._hour = hour;
+    state._hourCount = 0;
+}
+
+void PrespawnPolicy::recordDemand(const std::string& configId, bool hit, TimePoint now,
+                                  unsigned hourOfDay)
+{
+    ConfigState& state = _configs[configId];
+
+    if (state._rateScore > 0)
+    {
+        const std::chrono::duration<double> elapsed = now - state._lastDemand;
+        state._rateScore *= std::exp(-elapsed.count() / RateWindow.count());
+    }
+
+    state._rateScore += 1;
+    state._lastDemand = now;
+
+    rollHour(state, hourOfDay);
+    ++state._hourCount;
+
+    if (hit)
+        ++HitCount;
+    else
+        ++MissCount;
+}
+
+void PrespawnPolicy::recordSpawnLatency(const std::string& configId,
+                                        std::chrono::milliseconds latency)
+{
+    ConfigState& state = _configs[configId];
+    const double ms = latency.count();
+    state._spawnLatencyMs = (state._spawnLatencyMs <= 0)
+                                ? ms
+                                : LatencyWeight * ms + (1 - LatencyWeight) * state._spawnLatencyMs;
+}
+
+void PrespawnPolicy::recordSpareMemory(std::size_t pssKb)
+{
+    if (pssKb == 0)
+        return;
+
+    _spareMemoryKb = (_spareMemoryKb == 0) ? pssKb : (pssKb + 3 * _spareMemoryKb) / 4;
+}
+
+double PrespawnPolicy::getPredictedRate(const std::string& configId, TimePoint now,
+                                        unsigned hourOfDay) const
+{
+    const auto it = _configs.find(configId);
+    if (it == _configs.end())
+        return 0;
+
+    const ConfigState& state = it->second;
+
+    double rate = 0;
+    if (state._rateScore > 0)
+    {
+        const std::chrono::duration<double> elapsed = now - state._lastDemand;
+        rate = state._rateScore * std::exp(-elapsed.count() / RateWindow.count()) /
+               RateWindow.count();
+    }
+
+    // Look at the next hour too, to be warm before the peak arrives.
+    const int hour = hourOfDay % 24;
+    for (const int h : { hour, (hour + 1) % 24 })
+    {
+        double perHour = state._hourly[h];
+        if (h == state._hour)
+            perHour = std::max<double>(perHour, state._hourCount);
+
+        rate = std::max(rate, perHour / 3600);
+    }
+
+    return rate;
+}
+
+unsigned PrespawnPolicy::getTarget(const std::string& configId, TimePoint now, unsigned hourOfDay)
+{
+    unsigned target = _minChildren;
+    if (_maxChildren > _minChildren)
+    {
+        const auto it = _configs.find(configId);
+        if (it != _configs.end())
+        {
+            rollHour(it->second, hourOfDay);
+
+            const double latencyMs = it->second._spawnLatencyMs > 0
+                                         ? it->second._spawnLatencyMs
+                                         : DefaultSpawnLatency.count();
+            const double expected = getPredictedRate(configId, now, hourOfDay) * latencyMs /
+                                    1000 * SafetyFactor;
+            target = std::clamp<unsigned>(std::ceil(std::min<double>(expected, _maxChildren)),
+                                          _minChildren, _maxChildren);
+        }
+
+        if (_maxMemoryKb > 0 && _spareMemoryKb > 0)
+        {
+            const unsigned fits = static_cast<unsigned>(_maxMemoryKb / _spareMemoryKb);
+            target = std::max(_minChildren, std::min(target, fits));
+        }
+    }
+
+    if (configId.empty() && LastTarget != target)
+    {
+        LOG_DBG("Prespawn target changed from " << LastTarget << " to " << target
+                                                << " spare kits");
+        LastTarget = target;
+    }
+
+    return target;
+}
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
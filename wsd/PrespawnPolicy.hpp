@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4; fill-column: 100 -*- */
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/// Decides how many spare kits to keep pre-spawned per configId.
+/// Demand is predicted from the recent rate of document loads (an
+/// exponentially-weighted rate) and from a per-hour-of-day profile,
+/// so that the pool grows ahead of the daily peaks and shrinks after.
+/// The number of spares is what we expect to be requested while a new
+/// kit is being spawned, clamped to [min, max] and to a memory ceiling.
+/// Not thread-safe; the caller serializes access (NewChildrenMutex).
+class PrespawnPolicy
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /// Time constant of the exponentially-weighted load rate.
+    static constexpr std::chrono::seconds RateWindow = std::chrono::seconds(300);
+    /// Weight of the latest day in each hour-of-day bucket.
+    static constexpr double HourlyWeight = 0.3;
+    /// Weight of the latest sample in the spawn latency average.
+    static constexpr double LatencyWeight = 0.2;
+    /// Head-room over the expected demand while spawning.
+    static constexpr double SafetyFactor = 2.0;
+    /// Spawn latency assumed until we have measured one.
+    static constexpr std::chrono::milliseconds DefaultSpawnLatency =
+        std::chrono::milliseconds(1000);
+
+    PrespawnPolicy(unsigned minChildren = 1, unsigned maxChildren = 1, std::size_t maxMemoryKb = 0)
+        : _minChildren(minChildren)
+        , _maxChildren(maxChildren)
+        , _maxMemoryKb(maxMemoryKb)
+        , _spareMemoryKb(0)
+    {
+    }
+
+    /// (Re)configure the bounds. With maxChildren <= minChildren the
+    /// policy degenerates to the fixed minChildren spares.
+    void configure(unsigned minChildren, unsigned maxChildren, std::size_t maxMemoryKb);
+
+    unsigned getMinChildren() const { return _minChildren; }
+    unsigned getMaxChildren() const { return _maxChildren; }
+
+    /// Records a document load asking for a kit of configId,
+    /// and whether a spare was ready for it (hit) or not (miss).
+    void recordDemand(const std::string& configId, bool hit, TimePoint now, unsigned hourOfDay);
+
+    /// Records how long a kit of configId took to spawn.
+    void recordSpawnLatency(const std::string& configId, std::chrono::milliseconds latency);
+
+    /// Records the memory footprint (PSS) of a freshly spawned, unused kit.
+    void recordSpareMemory(std::size_t pssKb);
+
+    /// The number of spares we should keep for configId.
+    unsigned getTarget(const std::string& configId, TimePoint now, unsigned hourOfDay);
+
+    /// Forget the state of a configId that went away.
+    void forget(const std::string& configId) { _configs.erase(configId); }
+
+    /// The predicted load rate, in documents per second.
+    double getPredictedRate(const std::string& configId, TimePoint now, unsigned hourOfDay) const;
+
+    static uint64_t getHitCount() { return HitCount; }
+    static uint64_t getMissCount() { return MissCount; }
+    /// The last computed target for the default config.
+    static unsigned getLastTarget() { return LastTarget; }
+
+private:
+    struct ConfigState
+    {
+        ConfigState()
+            : _rateScore(0)
+            , _hour(-1)
+            , _hourCount(0)
+            , _spawnLatencyMs(0)
+        {
+            _hourly.fill(-1);
+        }
+
+        /// Decayed count of loads; rate is _rateScore / RateWindow.
+        double _rateScore;
+        TimePoint _lastDemand;
+        /// Smoothed number of loads per hour-of-day, -1 when unknown.
+        std::array<double, 24> _hourly;
+        /// The hour being counted, and its count so far.
+        int _hour;
+        uint64_t _hourCount;
+        /// Smoothed spawn latency, 0 when unknown.
+        double _spawnLatencyMs;
+    };
+
+    /// Folds the count of the finished hour into the profile.
+    static void rollHour(ConfigState& state, unsigned hourOfDay);
+
+    unsigned _minChildren;
+    unsigned _maxChildren;
+    std::size_t _maxMemoryKb;
+    /// Smoothed PSS of a spare kit, 0 when unknown.
+    std::size_t _spareMemoryKb;
+    std::map<std::string, ConfigState> _configs;
+
+    static std::atomic<uint64_t> HitCount;
+    static std::atomic<uint64_t> MissCount;
+    static std::atomic<unsigned> LastTarget;
+};
+
+/* vim:set shiftwidth=4 softtabstop=4 expandtab: */
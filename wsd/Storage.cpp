@@ -86,6 +86,14 @@ std::string StorageBase::getJailPresetsPath() const
     return getLocalJailPath(_localStorePath, JAILED_CONFIG_ROOT);
 }
 
+void StorageBase::setLocalStorePath(const std::string& localStorePath)
+{
+    const std::string filename = Poco::Path(_jailedFilePath).getFileName();
+    _localStorePath = localStorePath;
+    setRootFilePath(Poco::Path(getLocalRootPath(), filename).toString());
+    setRootFilePathAnonym(LOOLWSD::anonymizeUrl(getRootFilePath()));
+}
+
 #endif
 
 void StorageBase::initialize()
@@ -388,6 +388,13 @@ public:
         _jailedFilePathAnonym = newPath;
     }
 
+#if !MOBILEAPP
+    /// Moves the jailed file, by name, to the same path under another chroot,
+    /// as when a hibernated document is reloaded by a new Kit.
+    /// The caller moves the files themselves.
+    void setLocalStorePath(const std::string& localStorePath);
+#endif
+
     void setDownloaded(bool loaded) { _isDownloaded = loaded; }
 
     bool isDownloaded() const { return _isDownloaded; }
@@ -542,7 +549,7 @@ private:
     Poco::URI _uri;
     Poco::URI _templateOptionUri;
     FileInfo _fileInfo;
-    const std::string _localStorePath;
+    std::string _localStorePath;
     const std::string _jailPath;
     std::string _jailedFilePath;
     std::string _jailedFilePathAnonym;
@@ -436,12 +436,10 @@ bool TileCache::intersectsTile(const TileDesc &tileDesc, int part, int mode, int
     if (canonicalViewId != tileDesc.getCanonicalViewId())
         return false;
 
-    const int left = std::max(x, tileDesc.getTilePosX());
-    const int right = std::min(x + width, tileDesc.getTilePosX() + tileDesc.getTileWidth());
-    const int top = std::max(y, tileDesc.getTilePosY());
-    const int bottom = std::min(y + height, tileDesc.getTilePosY() + tileDesc.getTileHeight());
-
-    return left <= right && top <= bottom;
+    // Like ClientSession::handleTileInvalidation: a tile merely touching the edge isn't dirty.
+    return Util::Rectangle(x, y, width, height)
+        .overlaps(Util::Rectangle(tileDesc.getTilePosX(), tileDesc.getTilePosY(),
+                                  tileDesc.getTileWidth(), tileDesc.getTileHeight()));
 }
 
 // FIXME: to be further simplified when we centralize tile messages.
@@ -15,6 +15,10 @@
 #include <StringVector.hpp>
 
 #include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <unordered_map>
 #include <sstream>
 #include <string>
@@ -55,6 +59,57 @@ namespace TileParse
         range.first->second = value;
         return true;
     }
+
+    /// Parses the leading decimal number of the string, without copying it.
+    template <typename T> bool toNumber(const std::string_view string, T& value)
+    {
+        return std::from_chars(string.data(), string.data() + string.size(), value).ec ==
+               std::errc();
+    }
+
+    /// Appends the decimal form of value, without a temporary string.
+    template <typename T> void appendNumber(std::string& result, T value)
+    {
+        char buffer[std::numeric_limits<T>::digits10 + 3];
+        const std::to_chars_result end = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        result.append(buffer, end.ptr);
+    }
+
+    /// Reads the non-empty elements of a comma-separated list, in place.
+    class ListReader
+    {
+    public:
+        explicit ListReader(const std::string_view list)
+            : _list(list)
+            , _pos(0)
+        {
+        }
+
+        /// Returns the next element, or an empty one at the end.
+        std::string_view next()
+        {
+            while (_pos < _list.size() && _list[_pos] == ',')
+                ++_pos;
+
+            const std::size_t end = std::min(_list.find(',', _pos), _list.size());
+            const std::string_view element = _list.substr(_pos, end - _pos);
+            _pos = end;
+            return element;
+        }
+
+        static std::size_t count(const std::string_view list)
+        {
+            ListReader reader(list);
+            std::size_t count = 0;
+            while (!reader.next().empty())
+                ++count;
+            return count;
+        }
+
+    private:
+        const std::string_view _list;
+        std::size_t _pos;
+    };
 }
 
 enum class CanonicalViewId : int
@@ -121,6 +176,7 @@ public:
     int getImgSize() const { return _imgSize; }
     void setImgSize(const int imgSize) { _imgSize = imgSize; }
     bool isPreview() const { return _id >= 0; }
+    int getId() const { return _id; }
     void setId(TileWireId id) { _id = id; }
     void setOldWireId(TileWireId id) { _oldWireId = id; }
     void forceKeyframe() { setOldWireId(0); }
@@ -428,11 +484,11 @@ class TileCombined
 {
 private:
     TileCombined(CanonicalViewId canonicalViewId, int part, int mode, int width, int height,
-                 const std::string& tilePositionsX, const std::string& tilePositionsY,
-                 int tileWidth, int tileHeight, const std::string& vers,
-                 const std::string& imgSizes,
-                 const std::string& oldWireIds,
-                 const std::string& wireIds) :
+                 const std::string_view tilePositionsX, const std::string_view tilePositionsY,
+                 int tileWidth, int tileHeight, const std::string_view vers,
+                 const std::string_view imgSizes,
+                 const std::string_view oldWireIds,
+                 const std::string_view wireIds) :
         _canonicalViewId(canonicalViewId),
         _part(part),
         _mode(mode),
@@ -459,75 +515,159 @@ private:
                 std::to_string(_tileHeight));
         }
 
-        StringVector positionXtokens(StringVector::tokenize(tilePositionsX, ','));
-        StringVector positionYtokens(StringVector::tokenize(tilePositionsY, ','));
-        StringVector imgSizeTokens(StringVector::tokenize(imgSizes, ','));
-        StringVector verTokens(StringVector::tokenize(vers, ','));
-        StringVector oldWireIdTokens(StringVector::tokenize(oldWireIds, ','));
-        StringVector wireIdTokens(StringVector::tokenize(wireIds, ','));
-
-        const std::size_t numberOfPositions = positionXtokens.size();
+        const std::size_t numberOfPositions = TileParse::ListReader::count(tilePositionsX);
 
         // check that the comma-separated strings have the same number of elements
-        if (numberOfPositions != positionYtokens.size() ||
-            (!imgSizes.empty() && numberOfPositions != imgSizeTokens.size()) ||
-            (!vers.empty() && numberOfPositions != verTokens.size()) ||
-            (!oldWireIds.empty() && numberOfPositions != oldWireIdTokens.size()) ||
-            (!wireIds.empty() && numberOfPositions != wireIdTokens.size()))
+        if (numberOfPositions != TileParse::ListReader::count(tilePositionsY) ||
+            (!imgSizes.empty() && numberOfPositions != TileParse::ListReader::count(imgSizes)) ||
+            (!vers.empty() && numberOfPositions != TileParse::ListReader::count(vers)) ||
+            (!oldWireIds.empty() && numberOfPositions != TileParse::ListReader::count(oldWireIds)) ||
+            (!wireIds.empty() && numberOfPositions != TileParse::ListReader::count(wireIds)))
         {
             throw BadArgumentException("Invalid tilecombine descriptor. Unequal number of tiles in parameters.");
         }
 
+        TileParse::ListReader positionsX(tilePositionsX);
+        TileParse::ListReader positionsY(tilePositionsY);
+        TileParse::ListReader imgSizeReader(imgSizes);
+        TileParse::ListReader verReader(vers);
+        TileParse::ListReader oldWireIdReader(oldWireIds);
+        TileParse::ListReader wireIdReader(wireIds);
+
+        _tiles.reserve(numberOfPositions);
         for (std::size_t i = 0; i < numberOfPositions; ++i)
         {
             int x = 0;
-            if (!LOOLProtocol::stringToInteger(positionXtokens[i], x))
+            if (!TileParse::toNumber(positionsX.next(), x))
             {
                 throw BadArgumentException("Invalid 'tileposx' in tilecombine descriptor.");
             }
 
             int y = 0;
-            if (!LOOLProtocol::stringToInteger(positionYtokens[i], y))
+            if (!TileParse::toNumber(positionsY.next(), y))
             {
                 throw BadArgumentException("Invalid 'tileposy' in tilecombine descriptor.");
             }
 
             int imgSize = 0;
-            if (imgSizeTokens.empty() || LOOLProtocol::stringToInteger(imgSizeTokens[i], imgSize))
-                _hasImgSizes = _hasImgSizes || (imgSize != 0);
-            else
+            if (!imgSizes.empty() && !TileParse::toNumber(imgSizeReader.next(), imgSize))
             {
                 throw BadArgumentException("Invalid 'imgsize' in tilecombine descriptor.");
             }
 
             int ver = -1;
-            if (!verTokens.empty() && !verTokens[i].empty() && !LOOLProtocol::stringToInteger(verTokens[i], ver))
+            if (!vers.empty() && !TileParse::toNumber(verReader.next(), ver))
             {
                 throw BadArgumentException("Invalid 'ver' in tilecombine descriptor.");
             }
 
             TileWireId oldWireId = 0;
-            if (oldWireIdTokens.empty() || LOOLProtocol::stringToUInt32(oldWireIdTokens[i], oldWireId))
-                _hasOldWids = _hasOldWids || (oldWireId != 0);
-            else
+            const std::string_view oldWireIdToken = oldWireIdReader.next();
+            if (!oldWireIds.empty() && !TileParse::toNumber(oldWireIdToken, oldWireId))
             {
-                throw BadArgumentException("Invalid tilecombine descriptor. oldWireIdToken: " + oldWireIdTokens[i]);
+                throw BadArgumentException("Invalid tilecombine descriptor. oldWireIdToken: " +
+                                           std::string(oldWireIdToken));
             }
 
             TileWireId wireId = 0;
-            if (wireIdTokens.empty() || LOOLProtocol::stringToUInt32(wireIdTokens[i], wireId))
-                _hasWids = _hasWids || (wireId != 0);
-            else
+            const std::string_view wireIdToken = wireIdReader.next();
+            if (!wireIds.empty() && !TileParse::toNumber(wireIdToken, wireId))
             {
-                throw BadArgumentException("Invalid tilecombine descriptor. wireIdToken: " + wireIdTokens[i]);
+                throw BadArgumentException("Invalid tilecombine descriptor. wireIdToken: " +
+                                           std::string(wireIdToken));
             }
 
-            _tiles.emplace_back(_canonicalViewId, _part, _mode, _width, _height, x, y, _tileWidth, _tileHeight, ver, imgSize, -1);
-            _tiles.back().setOldWireId(oldWireId);
-            _tiles.back().setWireId(wireId);
-            _aabbox.extend(_tiles.back().toAABBox());
+            addTile(x, y, ver, imgSize, oldWireId, wireId);
         }
     }
+
+    /// Adds a tile with the common fields. A preview has an id >= 0.
+    void addTile(int x, int y, int ver, int imgSize, TileWireId oldWireId, TileWireId wireId,
+                 int id = -1)
+    {
+        _tiles.emplace_back(_canonicalViewId, _part, _mode, _width, _height, x, y, _tileWidth,
+                            _tileHeight, ver, imgSize, id);
+        _tiles.back().setOldWireId(oldWireId);
+        _tiles.back().setWireId(wireId);
+        _aabbox.extend(_tiles.back().toAABBox());
+        _hasImgSizes = _hasImgSizes || imgSize != 0;
+        _hasOldWids = _hasOldWids || oldWireId != 0;
+        _hasWids = _hasWids || wireId != 0;
+    }
+
+    /// The fields of a text tilecombine, as they are parsed.
+    struct ParseResults
+    {
+        enum argenum { height, mode, nviewid, part, tileheight, tilewidth, width, maxEnum };
+
+        typedef std::pair<const std::string_view, int> arg_value;
+
+        arg_value args[maxEnum] = {
+            { STRINGIFY(height), 0 },
+            { STRINGIFY(mode), 0 },
+            { STRINGIFY(nviewid), 0 },
+            { STRINGIFY(part), 0 },
+            { STRINGIFY(tileheight), 0 },
+            { STRINGIFY(tilewidth), 0 },
+            { STRINGIFY(width), 0 }
+        };
+
+        // The lists, in the parsed string.
+        std::string_view tilePositionsX;
+        std::string_view tilePositionsY;
+        std::string_view imgSizes;
+        std::string_view versions;
+        std::string_view oldWireIds;
+        std::string_view wireIds;
+
+#ifndef NDEBUG
+        ParseResults()
+        {
+            static bool isSorted = TileParse::checkSorted(args, maxEnum);
+            assert(isSorted);
+        }
+#endif
+
+        // We don't expect undocumented fields and
+        // assume all values to be int.
+        void add(const std::string_view token)
+        {
+            const std::size_t equals = token.find('=');
+            if (equals == std::string_view::npos)
+                return;
+
+            const std::string_view name = token.substr(0, equals);
+            const std::string_view value = token.substr(equals + 1);
+            if (name == "tileposx")
+                tilePositionsX = value;
+            else if (name == "tileposy")
+                tilePositionsY = value;
+            else if (name == "imgsize")
+                imgSizes = value;
+            else if (name == "ver")
+                versions = value;
+            else if (name == "oldwid")
+                oldWireIds = value;
+            else if (name == "wid")
+                wireIds = value;
+            else
+            {
+                int v = 0;
+                if (TileParse::toNumber(value, v))
+                    TileParse::setArg(args, name, v);
+            }
+        }
+
+        TileCombined create() const
+        {
+            return TileCombined(CanonicalViewId(args[nviewid].second), args[part].second,
+                                args[mode].second, args[width].second, args[height].second,
+                                tilePositionsX, tilePositionsY, args[tilewidth].second,
+                                args[tileheight].second, versions, imgSizes, oldWireIds,
+                                wireIds);
+        }
+    };
+
 protected:
     TileCombined() :
         _canonicalViewId(CanonicalViewId::Invalid),
@@ -599,191 +739,211 @@ public:
     std::string serialize(std::string_view prefix = std::string_view(),
                           std::string_view suffix = std::string_view()) const
     {
-        std::ostringstream oss;
-        int num = 0;
-        oss << prefix
-            << " nviewid=" << _canonicalViewId
-            << " part=" << _part
-            << " width=" << _width
-            << " height=" << _height
-            << " tileposx=";
+        std::string result;
+        serialize(prefix, suffix, result);
+        return result;
+    }
 
-        num = 0;
-        for (const auto& tile : _tiles)
-            oss << (num++ ? "," : "") << tile.getTilePosX();
+    /// Serialize this instance at the end of result, to reuse its buffer.
+    void serialize(std::string_view prefix, std::string_view suffix, std::string& result) const
+    {
+        // Up to 11 digits and a comma per number; 6 lists at most.
+        result.reserve(result.size() + prefix.size() + suffix.size() + 160 +
+                       _tiles.size() * 6 * 12);
 
-        oss << " tileposy=";
-        num = 0;
-        for (const auto& tile : _tiles)
-            oss << (num++ ? "," : "") << tile.getTilePosY();
+        result.append(prefix);
+        result.append(" nviewid=");
+        TileParse::appendNumber(result, to_underlying(_canonicalViewId));
+        result.append(" part=");
+        TileParse::appendNumber(result, _part);
+        result.append(" width=");
+        TileParse::appendNumber(result, _width);
+        result.append(" height=");
+        TileParse::appendNumber(result, _height);
+
+        appendList(result, " tileposx=", &TileDesc::getTilePosX);
+        appendList(result, " tileposy=", &TileDesc::getTilePosY);
 
         if (_hasImgSizes)
-        {
-            oss << " imgsize=";
-            num = 0;
-            for (const auto& tile : _tiles)
-                oss << (num++ ? "," : "") << tile.getImgSize();
-        }
+            appendList(result, " imgsize=", &TileDesc::getImgSize);
 
-        oss << " tilewidth=" << _tileWidth
-            << " tileheight=" << _tileHeight;
+        result.append(" tilewidth=");
+        TileParse::appendNumber(result, _tileWidth);
+        result.append(" tileheight=");
+        TileParse::appendNumber(result, _tileHeight);
 
-        oss << " ver=";
-        num = 0;
-        for (const auto& tile : _tiles)
-            oss << (num++ ? "," : "") << tile.getVersion();
+        appendList(result, " ver=", &TileDesc::getVersion);
 
         if (_hasOldWids)
-        {
-            oss << " oldwid=";
-            num = 0;
-            for (const auto& tile : _tiles)
-                oss << (num++ ? "," : "") << tile.getOldWireId();
-        }
+            appendList(result, " oldwid=", &TileDesc::getOldWireId);
 
         if (_hasWids)
-        {
-            oss << " wid=";
-            num = 0;
-            for (const auto& tile : _tiles)
-                oss << (num++ ? "," : "") << tile.getWireId();
-        }
+            appendList(result, " wid=", &TileDesc::getWireId);
 
         if (_mode)
-            oss << " mode=" << _mode;
+        {
+            result.append(" mode=");
+            TileParse::appendNumber(result, _mode);
+        }
 
-        oss << suffix;
-        return oss.str();
+        result.append(suffix);
     }
 
-    /// Deserialize a TileDesc from a tokenized string.
-    static TileCombined parse(const StringVector& tokens)
+    /// The first token of the binary form, followed by a new-line.
+    static constexpr std::string_view BinaryToken = "tilebin:";
+    /// Bumped whenever the layout of the binary form changes.
+    static constexpr std::uint32_t BinaryVersion = 2;
+    /// The number of 32-bit fields of each tile in the binary form.
+    static constexpr std::size_t BinaryTileFields = 7;
+
+    /// Serialize this instance into the binary form, for the kit to WSD hop
+    /// only: after the token and new-line come 32-bit integers in host order,
+    /// the version, the number of tiles, nviewid, part, mode, width, height,
+    /// tilewidth and tileheight, and then tileposx, tileposy, ver, imgsize,
+    /// oldwid, wid and id (-1 unless a preview) of each tile.
+    std::string serializeBinary() const
     {
-        enum argenum { height, mode, nviewid, part, tileheight, tilewidth, width, maxEnum };
+        std::string result;
+        result.reserve(BinaryToken.size() + 1 +
+                       (9 + BinaryTileFields * _tiles.size()) * sizeof(std::uint32_t));
+        result.append(BinaryToken);
+        result.push_back('\n');
 
-        struct TileCombinedParseResults
+        const auto write = [&result](std::uint32_t value)
         {
-            typedef std::pair<const std::string_view, int> arg_value;
+            char bytes[sizeof(value)];
+            std::memcpy(bytes, &value, sizeof(value));
+            result.append(bytes, sizeof(bytes));
+        };
 
-            arg_value args[maxEnum] = {
-                { STRINGIFY(height), 0 },
-                { STRINGIFY(mode), 0 },
-                { STRINGIFY(nviewid), 0 },
-                { STRINGIFY(part), 0 },
-                { STRINGIFY(tileheight), 0 },
-                { STRINGIFY(tilewidth), 0 },
-                { STRINGIFY(width), 0 }
-            };
+        write(BinaryVersion);
+        write(static_cast<std::uint32_t>(_tiles.size()));
+        write(to_underlying(_canonicalViewId));
+        write(_part);
+        write(_mode);
+        write(_width);
+        write(_height);
+        write(_tileWidth);
+        write(_tileHeight);
+        for (const auto& tile : _tiles)
+        {
+            write(tile.getTilePosX());
+            write(tile.getTilePosY());
+            write(tile.getVersion());
+            write(tile.getImgSize());
+            write(tile.getOldWireId());
+            write(tile.getWireId());
+            write(tile.getId());
+        }
 
-#ifndef NDEBUG
-            TileCombinedParseResults()
-            {
-                static bool isSorted = TileParse::checkSorted(args, maxEnum);
-                assert(isSorted);
-            }
-#endif
+        return result;
+    }
 
-            bool set(const std::string_view arg, int value)
-            {
-                return TileParse::setArg(args, arg, value);
-            }
+    /// Deserialize a TileCombined from its binary form, at the start of a message
+    /// of the given size. Sets headerSize to the offset of what follows it.
+    static TileCombined parseBinary(const char* data, std::size_t size, std::size_t& headerSize)
+    {
+        std::size_t offset = BinaryToken.size() + 1;
+        if (size < offset || std::string_view(data, BinaryToken.size()) != BinaryToken ||
+            data[BinaryToken.size()] != '\n')
+        {
+            throw BadArgumentException("Invalid binary tile header.");
+        }
 
-            int operator[](argenum arg) const
-            {
-                return args[arg].second;
-            }
+        const auto read = [&]()
+        {
+            std::uint32_t value;
+            if (size - offset < sizeof(value))
+                throw BadArgumentException("Truncated binary tile header.");
+
+            std::memcpy(&value, data + offset, sizeof(value));
+            offset += sizeof(value);
+            return value;
         };
 
-        // We don't expect undocumented fields and
-        // assume all values to be int.
-        TileCombinedParseResults pairs;
+        const std::uint32_t version = read();
+        if (version != BinaryVersion)
+            throw BadArgumentException("Unsupported binary tile header version " +
+                                       std::to_string(version) + '.');
+
+        const std::uint32_t count = read();
+        if (count == 0 || count > size / (BinaryTileFields * sizeof(std::uint32_t)))
+            throw BadArgumentException("Invalid tile count in binary tile header.");
+
+        TileCombined result;
+        result._canonicalViewId = CanonicalViewId(static_cast<int>(read()));
+        result._part = read();
+        result._mode = read();
+        result._width = read();
+        result._height = read();
+        result._tileWidth = read();
+        result._tileHeight = read();
+        result._isCombined = true;
+
+        result._tiles.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            const int x = read();
+            const int y = read();
+            const int ver = read();
+            const int imgSize = read();
+            const TileWireId oldWireId = read();
+            const TileWireId wireId = read();
+            const int id = read();
+
+            // Validates the fields, common ones included.
+            result.addTile(x, y, ver, imgSize, oldWireId, wireId, id);
+        }
 
-        std::string tilePositionsX;
-        std::string tilePositionsY;
-        std::string imgSizes;
-        std::string versions;
-        std::string oldwireIds;
-        std::string wireIds;
+        headerSize = offset;
+        return result;
+    }
 
+    /// Deserialize a TileDesc from a tokenized string.
+    static TileCombined parse(const StringVector& tokens)
+    {
+        ParseResults results;
         for (const auto& token : tokens)
-        {
-            std::string name;
-            std::string value;
-            if (LOOLProtocol::parseNameValuePair(tokens.getParam(token), name, value))
-            {
-                if (name == "tileposx")
-                {
-                    tilePositionsX = std::move(value);
-                }
-                else if (name == "tileposy")
-                {
-                    tilePositionsY = std::move(value);
-                }
-                else if (name == "imgsize")
-                {
-                    imgSizes = std::move(value);
-                }
-                else if (name == "ver")
-                {
-                    versions = std::move(value);
-                }
-                else if (name == "oldwid")
-                {
-                    oldwireIds = std::move(value);
-                }
-                else if (name == "wid")
-                {
-                    wireIds = std::move(value);
-                }
-                else
-                {
-                    int v = 0;
-                    if (LOOLProtocol::stringToInteger(value, v))
-                    {
-                        pairs.set(name, v);
-                    }
-                }
-            }
-        }
+            results.add(tokens.getParamView(token));
 
-        return TileCombined(CanonicalViewId(pairs[nviewid]),
-                            pairs[part], pairs[mode],
-                            pairs[width], pairs[height],
-                            tilePositionsX, tilePositionsY,
-                            pairs[tilewidth], pairs[tileheight],
-                            versions, imgSizes, oldwireIds, wireIds);
+        return results.create();
     }
 
     /// Deserialize a TileDesc from a string format.
     static TileCombined parse(std::string_view message)
     {
-        return parse(StringVector::tokenize(message.data(), message.size()));
+        ParseResults results;
+        StringVector::tokenize_foreach(
+            [&results](std::size_t, const std::string_view token)
+            {
+                results.add(token);
+                return false;
+            },
+            message.data(), message.size());
+
+        return results.create();
     }
 
     static TileCombined create(const std::vector<TileDesc>& tiles)
     {
         assert(!tiles.empty());
 
-        std::ostringstream xs;
-        std::ostringstream ys;
-        std::ostringstream vers;
-        std::ostringstream oldhs;
-        std::ostringstream hs;
-
+        TileCombined result;
+        result._canonicalViewId = tiles[0].getCanonicalViewId();
+        result._part = tiles[0].getPart();
+        result._mode = tiles[0].getEditMode();
+        result._width = tiles[0].getWidth();
+        result._height = tiles[0].getHeight();
+        result._tileWidth = tiles[0].getTileWidth();
+        result._tileHeight = tiles[0].getTileHeight();
+        result._isCombined = true;
+
+        result._tiles.reserve(tiles.size());
         for (const auto& tile : tiles)
-        {
-            xs << tile.getTilePosX() << ',';
-            ys << tile.getTilePosY() << ',';
-            vers << tile.getVersion() << ',';
-            oldhs << tile.getOldWireId() << ',';
-            hs << tile.getWireId() << ',';
-        }
+            result.addTile(tile.getTilePosX(), tile.getTilePosY(), tile.getVersion(), 0,
+                           tile.getOldWireId(), tile.getWireId(), tile.getId());
 
-        vers.seekp(-1, std::ios_base::cur); // Remove last comma.
-        return TileCombined(tiles[0].getCanonicalViewId(), tiles[0].getPart(), tiles[0].getEditMode(),
-                            tiles[0].getWidth(), tiles[0].getHeight(),
-                            xs.str(), ys.str(), tiles[0].getTileWidth(), tiles[0].getTileHeight(),
-                            vers.str(), "", oldhs.str(), hs.str());
+        return result;
     }
 
     void initFrom(const TileDesc &desc)
@@ -808,6 +968,19 @@ public:
         initFrom(desc);
     }
 
+private:
+    template <typename T>
+    void appendList(std::string& result, std::string_view name, T (TileDesc::*getter)() const) const
+    {
+        result.append(name);
+        for (std::size_t i = 0; i < _tiles.size(); ++i)
+        {
+            if (i)
+                result.push_back(',');
+            TileParse::appendNumber(result, (_tiles[i].*getter)());
+        }
+    }
+
 protected:
     std::vector<TileDesc> _tiles;
     Util::Rectangle _aabbox;
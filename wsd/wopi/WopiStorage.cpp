@@ -830,7 +830,15 @@ std::size_t WopiStorage::uploadLocalFileToStorageAsync(
         httpRequest.setContentType("application/octet-stream");
         httpRequest.setContentLength(size);
 
-        httpRequest.setBodyFile(filePath);
+        if (!httpRequest.setBodyFile(filePath))
+        {
+            LOG_ERR("Cannot open file [" << filePathAnonym << "] to upload to wopi storage.");
+            _uploadHttpSession.reset();
+            asyncUploadCallback(
+                AsyncUpload(AsyncUpload::State::Error,
+                    UploadResult(UploadResult::Result::FAILED, "File not found.")));
+            return 0;
+        }
 
         http::Session::FinishedCallback finishedCallback =
             [this, startTime, wopiLog,